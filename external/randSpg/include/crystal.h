@@ -18,6 +18,7 @@
 #define CRYSTAL_H
 
 #include <cstdlib>
+#include <memory>
 #include <vector>
 
 // For some reason, uint isn't always defined on windows...
@@ -129,6 +130,19 @@ class Crystal {
    */
   bool usingVdwRadii() {return m_usingVdwRadii;};
 
+  /* Set a table of atomic radii, indexed by atomic number, to be used for
+   * interatomic distance checks instead of the global radii in ElemInfo.
+   * The table is shared and never modified, so crystals that are generated
+   * on different threads may use the same one. Set it to nullptr to use
+   * ElemInfo again.
+   *
+   * @param radii The radii table.
+   */
+  void setRadii(const std::shared_ptr<const std::vector<double>>& radii)
+  {
+    m_radii = radii;
+  };
+
   /* Adds an atom to this crystal.
    *
    * @param atom The atom to be added.
@@ -275,9 +289,10 @@ class Crystal {
   void centerCellAroundAtom(size_t ind);
 
   /* Finds the minimum interatomic distance between two atoms based upon
-   * their atomic number and radii information in the ElemInfo class. Any
-   * modifications to the radii (scaling or setting) should have been made
-   * before this function is called.
+   * their atomic number and the radii table set with setRadii(). If no
+   * table was set, the radii information in the ElemInfo class is used, and
+   * any modifications to the radii (scaling or setting) should have been
+   * made before this function is called.
    *
    * @param as1 The first atom.
    * @param as2 The second atom.
@@ -401,6 +416,9 @@ class Crystal {
   // Are we using vdw or covalent radii? We will use covalent by default
   bool m_usingVdwRadii;
 
+  // If set, these radii are used instead of the ones in ElemInfo
+  std::shared_ptr<const std::vector<double>> m_radii;
+
   // More cached values
   // Matrix for conversion to cartesian coordinates
   // Since we have an upper triangle matrix, we don't need [1][0], [1][1], and [2][0]
@@ -16,6 +16,7 @@
 #ifndef RAND_SPG_H
 #define RAND_SPG_H
 
+#include <memory>
 #include <string>
 #include <vector>
 #include <tuple>
@@ -51,6 +52,9 @@ typedef std::pair<uint, uint> numAndType;
 
 typedef std::pair<std::string, std::string> fillCellInfo;
 
+// Defined in randSpgCombinatorics.h
+struct singleAtomPossibility;
+
 struct randSpgInput {
   // The space group to be generated. Set in constructor.
   uint spg;
@@ -266,6 +270,27 @@ class RandSpg {
    */
   static Crystal randSpgCrystal(const randSpgInput& input);
 
+  /*
+   * The same as randSpgCrystal(), except that the system possibilities for
+   * the spacegroup and atoms have already been found (they are filtered
+   * here by the forced Wyckoff options of the input) and the atomic radii
+   * are taken from @p radii. The radius options of the input and the global
+   * radii in ElemInfo are ignored unless @p radii is nullptr. Since nothing
+   * global is modified, this may be called from several threads at once.
+   *
+   * @param input The input. The radius options are not used.
+   * @param possibilities The result of
+   *                      RandSpgCombinatorics::getSystemPossibilities() for
+   *                      the spacegroup and atoms of the input.
+   * @param radii The atomic radii, indexed by atomic number.
+   *
+   * @return The crystal. It has zero volume if generation failed.
+   */
+  static Crystal randSpgCrystalFromPossibilities(
+    const randSpgInput& input,
+    const std::vector<std::vector<singleAtomPossibility>>& possibilities,
+    const std::shared_ptr<const std::vector<double>>& radii);
+
   static std::vector<numAndType> getNumOfEachType(
                                    const std::vector<uint>& atoms);
 
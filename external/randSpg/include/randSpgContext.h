@@ -0,0 +1,120 @@
+/**********************************************************************
+  randSpgContext.h - A thread-safe context for spacegroup generation.
+
+  Copyright (C) 2018 by Patrick S. Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+ ***********************************************************************/
+
+#ifndef RAND_SPG_CONTEXT_H
+#define RAND_SPG_CONTEXT_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "randSpg.h"
+#include "randSpgCombinatorics.h"
+
+/* RandSpg::randSpgCrystal() sets the atomic radii by modifying the global
+ * radii in ElemInfo, and it finds all of the system possibilities (the most
+ * time consuming step) every time it is called. So it may not be called
+ * from more than one thread at a time, and repeated calls for the same
+ * spacegroup and composition repeat the same work.
+ *
+ * A RandSpgContext instead owns an immutable table of radii that is given
+ * to every crystal it generates, and it memoizes the system possibilities
+ * and the results of isSpgPossible() for every spacegroup and composition
+ * it has seen (the order of the atoms does not matter). All of its
+ * functions may be called from several threads at once.
+ */
+class RandSpgContext {
+ public:
+  /* Constructor.
+   *
+   * @param IADScalingFactor The scaling factor for the atomic radii.
+   * @param minRadius The minimum radius. All radii below it are set to it.
+   * @param manualAtomicRadii Pairs of atomic numbers and radii that are
+   *                          set explicitly. These are applied last.
+   * @param usingVdwRadii Whether to start from van der Waals radii instead
+   *                      of covalent radii.
+   */
+  explicit RandSpgContext(double IADScalingFactor = 1.0,
+                          double minRadius = 0.0,
+                          const std::vector<std::pair<uint, double>>&
+                            manualAtomicRadii =
+                              std::vector<std::pair<uint, double>>(),
+                          bool usingVdwRadii = false);
+
+  /* Get the radii table, indexed by atomic number.
+   *
+   * @return The radii table.
+   */
+  std::shared_ptr<const std::vector<double>> radii() const {return m_radii;};
+
+  /* Get the radius that is used for a given atomic number.
+   *
+   * @param atomicNum The atomic number.
+   *
+   * @return The radius, or 0 if the atomic number is invalid.
+   */
+  double radius(uint atomicNum) const;
+
+  /* The same as RandSpg::isSpgPossible(), but the result is memoized.
+   *
+   * @param spg The spacegroup to check.
+   * @param atoms A vector of atomic numbers (one for each atom).
+   *
+   * @return True if the spacegroup may be generated. False if it cannot.
+   */
+  bool isSpgPossible(uint spg, const std::vector<uint>& atoms);
+
+  /* The same as RandSpgCombinatorics::getSystemPossibilities(), but the
+   * result is memoized.
+   *
+   * @param spg The spacegroup.
+   * @param atoms A vector of atomic numbers (one for each atom).
+   *
+   * @return The system possibilities. It is shared with the cache, so it
+   *         must not be modified.
+   */
+  std::shared_ptr<const systemPossibilities> getSystemPossibilities(
+                                          uint spg,
+                                          const std::vector<uint>& atoms);
+
+  /* Generate a crystal. This is the same as RandSpg::randSpgCrystal(),
+   * except that the radius options of the input are ignored: the radii of
+   * this context are used instead.
+   *
+   * @param input The input.
+   *
+   * @return The crystal. It has zero volume if generation failed.
+   */
+  Crystal randSpgCrystal(const randSpgInput& input);
+
+  /* Clear the memoized possibilities and isSpgPossible() results. */
+  void clearCache();
+
+ private:
+  // The spacegroup and the sorted atoms
+  typedef std::pair<uint, std::vector<uint>> cacheKey;
+  static cacheKey makeKey(uint spg, const std::vector<uint>& atoms);
+
+  std::shared_ptr<const std::vector<double>> m_radii;
+
+  std::mutex m_cacheMutex;
+  std::map<cacheKey, std::shared_ptr<const systemPossibilities>>
+    m_possibilitiesCache;
+  std::map<cacheKey, bool> m_spgPossibleCache;
+};
+
+#endif
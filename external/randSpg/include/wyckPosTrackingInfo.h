@@ -23,6 +23,7 @@
 #include <cassert>
 
 #include "randSpg.h"
+#include "rng.h"
 
 // In here, we keep Wyckoff positions that have the same uniqueness and
 // multiplicity. For now, they can only be non-unique
@@ -52,7 +53,7 @@ class WyckPosTrackingInfo {
 
   wyckPos getRandomWyckPos() const
   {
-    return positions[rand() % positions.size()];
+    return positions[getRandInt(0, positions.size() - 1)];
   };
 
   std::vector<wyckPos> getPositions() const {return positions;};
@@ -16,6 +16,7 @@
 #define XTALOPT_WRAPPER_H
 
 #include "randSpg.h"
+#include "randSpgContext.h"
 #include <xtalopt/structures/xtal.h>
 #include "crystal.h"
 
@@ -27,15 +28,16 @@ namespace RandSpgXtalOptWrapper {
     latticeStruct lat = c.getLattice();
     XtalOpt::Xtal* xtal = new XtalOpt::Xtal(lat.a, lat.b, lat.c,
                                             lat.alpha, lat.beta, lat.gamma);
+    std::vector<GlobalSearch::Vector3> fcoords;
+    fcoords.reserve(atoms.size());
     for (size_t i = 0; i < atoms.size(); i++) {
       const atomStruct& as = atoms.at(i);
       GlobalSearch::Atom& atom = xtal->addAtom();
-      // Need to convert these coordinates to cartesian...
-      GlobalSearch::Vector3 pos(as.x,as.y,as.z);
-      pos = xtal->fracToCart(pos);
-      atom.setPos(pos);
       atom.setAtomicNumber(as.atomicNum);
+      fcoords.push_back(GlobalSearch::Vector3(as.x, as.y, as.z));
     }
+    // Need to convert these coordinates to cartesian...
+    xtal->setFracCoords(fcoords);
     return xtal;
   }
 
@@ -44,11 +46,13 @@ namespace RandSpgXtalOptWrapper {
     latticeStruct lat(xtal->getA(), xtal->getB(), xtal->getC(),
                       xtal->getAlpha(), xtal->getBeta(), xtal->getGamma());
     std::vector<atomStruct> atoms;
-    std::vector<GlobalSearch::Atom> xAtoms = xtal->atoms();
+    const std::vector<GlobalSearch::Atom>& xAtoms = xtal->atoms();
+    const std::vector<GlobalSearch::Vector3> fcoords = xtal->getFracCoords();
+    atoms.reserve(xAtoms.size());
 
     for (size_t i = 0; i < xAtoms.size(); i++) {
       unsigned int atomicNum = xAtoms.at(i).atomicNumber();
-      GlobalSearch::Vector3 fracCoords = xtal->cartToFrac(xAtoms.at(i).pos());
+      const GlobalSearch::Vector3& fracCoords = fcoords.at(i);
       atomStruct as(atomicNum, fracCoords[0], fracCoords[1], fracCoords[2]);
       atoms.push_back(as);
     }
@@ -67,5 +71,17 @@ namespace RandSpgXtalOptWrapper {
     if (c.getVolume() == 0) return NULL;
     else return crystal2Xtal(c);
   }
+
+  // Returns a dynamically allocated xtal. The radii and the memoized
+  // combinatorics of @p context are used, so this may be called from
+  // several threads at once.
+  XtalOpt::Xtal* randSpgXtal(RandSpgContext& context,
+                             const randSpgInput& input)
+  {
+    Crystal c = context.randSpgCrystal(input);
+    // If the volume is zero, the generation failed
+    if (c.getVolume() == 0) return NULL;
+    else return crystal2Xtal(c);
+  }
 }
 #endif
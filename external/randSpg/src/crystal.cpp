@@ -460,6 +460,15 @@ bool Crystal::fillUnitCell(uint spg)
 // Radii should have already been scaled and set before calling this
 double Crystal::getMinIAD(const atomStruct& as1, const atomStruct& as2) const
 {
+  if (m_radii) {
+    if (as1.atomicNum >= m_radii->size() || as2.atomicNum >= m_radii->size()) {
+      cout << "Error in " << __FUNCTION__ << ": an invalid atomic number was "
+           << "entered!\n";
+      return 0.0;
+    }
+    return (*m_radii)[as1.atomicNum] + (*m_radii)[as2.atomicNum];
+  }
+
   double rad1 = ElemInfo::getRadius(as1.atomicNum, m_usingVdwRadii);
   double rad2 = ElemInfo::getRadius(as2.atomicNum, m_usingVdwRadii);
   return rad1 + rad2;
@@ -351,7 +351,8 @@ getForcedWyckAssignmentsAndNumber(const vector<pair<uint, char>>& forcedWyckAssi
 
 Crystal createValidCrystal(uint spg, const latticeStruct& latticeMins,
                            const latticeStruct& latticeMaxes,
-                           double minVolume, double maxVolume)
+                           double minVolume, double maxVolume,
+                           const shared_ptr<const vector<double>>& radii)
 {
   Crystal ret;
   // If we fail to do this 1000 times, return an empty crystal
@@ -364,6 +365,7 @@ Crystal createValidCrystal(uint spg, const latticeStruct& latticeMins,
     // First let's get a lattice...
     latticeStruct st = RandSpg::generateLatticeForSpg(spg, latticeMins, latticeMaxes);
     Crystal crystal(st);
+    crystal.setRadii(radii);
 
     // Make sure it's a valid lattice
     if (st.a == 0 || st.b == 0 || st.c == 0 ||
@@ -410,26 +412,13 @@ Crystal RandSpg::randSpgCrystal(const randSpgInput& input)
 {
   START_FT;
 
-  // Convenience: so we don't have to say 'input.<option>' for every call
-  uint spg                                                      = input.spg;
-  const vector<uint>& atoms                                     = input.atoms;
-  const latticeStruct& latticeMins                              = input.latticeMins;
-  const latticeStruct& latticeMaxes                             = input.latticeMaxes;
-  double IADScalingFactor                                       = input.IADScalingFactor;
-  double minRadius                                              = input.minRadius;
   const std::vector<std::pair<uint, double>>& manualAtomicRadii = input.manualAtomicRadii;
-  double minVolume                                              = input.minVolume;
-  double maxVolume                                              = input.maxVolume;
-  vector<pair<uint, char>> forcedWyckAssignments                = input.forcedWyckAssignments;
-  char verbosity                                                = input.verbosity;
-  int numAttempts                                               = input.maxAttempts;
-  bool forceMostGeneralWyckPos                                  = input.forceMostGeneralWyckPos;
 
   // Change the atomic radii as necessary
-  ElemInfo::applyScalingFactor(IADScalingFactor);
+  ElemInfo::applyScalingFactor(input.IADScalingFactor);
 
   // Set the min radius
-  ElemInfo::setMinRadius(minRadius);
+  ElemInfo::setMinRadius(input.minRadius);
 
   // Set some explicit radii
   for (size_t i = 0; i < manualAtomicRadii.size(); i++) {
@@ -438,7 +427,32 @@ Crystal RandSpg::randSpgCrystal(const randSpgInput& input)
     ElemInfo::setRadius(atomicNum, rad);
   }
 
-  systemPossibilities possibilities = RandSpgCombinatorics::getSystemPossibilities(spg, atoms);
+  systemPossibilities possibilities =
+    RandSpgCombinatorics::getSystemPossibilities(input.spg, input.atoms);
+
+  return randSpgCrystalFromPossibilities(input, possibilities, nullptr);
+}
+
+Crystal RandSpg::randSpgCrystalFromPossibilities(
+  const randSpgInput& input,
+  const vector<systemPossibility>& allPossibilities,
+  const shared_ptr<const vector<double>>& radii)
+{
+  START_FT;
+
+  // Convenience: so we don't have to say 'input.<option>' for every call
+  uint spg                                                      = input.spg;
+  const vector<uint>& atoms                                     = input.atoms;
+  const latticeStruct& latticeMins                              = input.latticeMins;
+  const latticeStruct& latticeMaxes                             = input.latticeMaxes;
+  double minVolume                                              = input.minVolume;
+  double maxVolume                                              = input.maxVolume;
+  vector<pair<uint, char>> forcedWyckAssignments                = input.forcedWyckAssignments;
+  char verbosity                                                = input.verbosity;
+  int numAttempts                                               = input.maxAttempts;
+  bool forceMostGeneralWyckPos                                  = input.forceMostGeneralWyckPos;
+
+  systemPossibilities possibilities = allPossibilities;
 
   if (possibilities.size() == 0) {
     cout << "Error in RandSpg::" << __FUNCTION__ << "(): this spg '" << spg
@@ -489,7 +503,7 @@ Crystal RandSpg::randSpgCrystal(const randSpgInput& input)
   for (size_t i = 0; i < numAttempts; i++) {
 
     Crystal crystal = createValidCrystal(spg, latticeMins, latticeMaxes,
-                                         minVolume, maxVolume);
+                                         minVolume, maxVolume, radii);
 
     // Now, let's assign some atoms!
     atomAssignments assignments = RandSpgCombinatorics::getRandomAtomAssignments(possibilities, modifiedForcedWyckVector);
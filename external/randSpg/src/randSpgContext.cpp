@@ -0,0 +1,136 @@
+/**********************************************************************
+  randSpgContext.cpp - A thread-safe context for spacegroup generation.
+
+  Copyright (C) 2018 by Patrick S. Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+ ***********************************************************************/
+
+#include "randSpgContext.h"
+
+#include "elemInfoDatabase.h"
+
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+
+RandSpgContext::RandSpgContext(double IADScalingFactor, double minRadius,
+                               const vector<pair<uint, double>>&
+                                 manualAtomicRadii,
+                               bool usingVdwRadii)
+{
+  // This follows the same steps as RandSpg::randSpgCrystal() does with the
+  // radii in ElemInfo: scale, apply the min radius, then set explicit radii
+  shared_ptr<vector<double>> radii = make_shared<vector<double>>(
+    usingVdwRadii ? ElemInfoDatabase::_vdwRadii
+                  : ElemInfoDatabase::_covalentRadii);
+
+  for (size_t i = 1; i < radii->size(); i++) {
+    (*radii)[i] *= IADScalingFactor;
+    if ((*radii)[i] < minRadius) (*radii)[i] = minRadius;
+  }
+
+  for (size_t i = 0; i < manualAtomicRadii.size(); i++) {
+    uint atomicNum = manualAtomicRadii[i].first;
+    double rad = manualAtomicRadii[i].second;
+    if (atomicNum == 0 || atomicNum >= radii->size()) {
+      cout << "Error in " << __FUNCTION__ << ": Invalid atomicNum, "
+           << atomicNum << ", was entered!\n";
+      continue;
+    }
+    if (rad < 0) {
+      cout << "Error in " << __FUNCTION__ << ": a negative radius, '"
+           << rad << "', was entered.\n";
+      continue;
+    }
+    (*radii)[atomicNum] = rad;
+  }
+
+  m_radii = radii;
+}
+
+RandSpgContext::cacheKey RandSpgContext::makeKey(uint spg,
+                                                 const vector<uint>& atoms)
+{
+  // Neither answer depends on the order of the atoms
+  cacheKey key(spg, atoms);
+  sort(key.second.begin(), key.second.end());
+  return key;
+}
+
+double RandSpgContext::radius(uint atomicNum) const
+{
+  if (atomicNum == 0 || atomicNum >= m_radii->size()) return 0.0;
+  return (*m_radii)[atomicNum];
+}
+
+bool RandSpgContext::isSpgPossible(uint spg, const vector<uint>& atoms)
+{
+  cacheKey key = makeKey(spg, atoms);
+  {
+    lock_guard<mutex> lock(m_cacheMutex);
+    auto it = m_spgPossibleCache.find(key);
+    if (it != m_spgPossibleCache.end()) return it->second;
+
+    // If we already have all of the possibilities, we know the answer
+    auto posIt = m_possibilitiesCache.find(key);
+    if (posIt != m_possibilitiesCache.end()) {
+      bool possible = !posIt->second->empty();
+      m_spgPossibleCache[key] = possible;
+      return possible;
+    }
+  }
+
+  // This may take a while, so do not hold the lock. If another thread
+  // finds the same answer at the same time, no harm is done.
+  bool possible = RandSpg::isSpgPossible(spg, key.second);
+
+  lock_guard<mutex> lock(m_cacheMutex);
+  m_spgPossibleCache[key] = possible;
+  return possible;
+}
+
+shared_ptr<const systemPossibilities>
+RandSpgContext::getSystemPossibilities(uint spg, const vector<uint>& atoms)
+{
+  cacheKey key = makeKey(spg, atoms);
+  {
+    lock_guard<mutex> lock(m_cacheMutex);
+    auto it = m_possibilitiesCache.find(key);
+    if (it != m_possibilitiesCache.end()) return it->second;
+  }
+
+  shared_ptr<const systemPossibilities> possibilities =
+    make_shared<const systemPossibilities>(
+      RandSpgCombinatorics::getSystemPossibilities(spg, key.second));
+
+  lock_guard<mutex> lock(m_cacheMutex);
+  // If another thread beat us to it, use theirs so everyone shares one copy
+  auto inserted = m_possibilitiesCache.insert(make_pair(key, possibilities));
+  m_spgPossibleCache[key] = !inserted.first->second->empty();
+  return inserted.first->second;
+}
+
+Crystal RandSpgContext::randSpgCrystal(const randSpgInput& input)
+{
+  shared_ptr<const systemPossibilities> possibilities =
+    getSystemPossibilities(input.spg, input.atoms);
+
+  return RandSpg::randSpgCrystalFromPossibilities(input, *possibilities,
+                                                  m_radii);
+}
+
+void RandSpgContext::clearCache()
+{
+  lock_guard<mutex> lock(m_cacheMutex);
+  m_possibilitiesCache.clear();
+  m_spgPossibleCache.clear();
+}
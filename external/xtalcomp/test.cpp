@@ -14,9 +14,19 @@
 
 #include "xtalcomp.h"
 
+#include <set>
+
 #include <stdio.h>
 #include <stdlib.h>
 
+// Makes the duplicate bookkeeping available to the tests
+class DuplicateTester : public XtalComp
+{
+ public:
+  using XtalComp::expandFractionalCoordinates;
+  using XtalComp::indexDuplicates;
+};
+
 void runTest(bool (*testFunc)(), const char * testName, int &successes,
              int &failures)
 {
@@ -478,6 +488,144 @@ bool atomsOverlapping()
   return true;
 }
 
+// The rx1 atoms that are marked as matched along with atom ind. This is
+// the search over every entry of the duplicate map that compareCurrent()
+// used to do after each match.
+std::set<size_t> duplicatesByScan(const XtalComp::DuplicateMap &dups,
+                                  size_t ind)
+{
+  std::set<size_t> marked;
+  for (XtalComp::DuplicateMap::const_iterator it = dups.begin(),
+       itEnd = dups.end(); it != itEnd; ++it) {
+    if (ind == it->first ||
+        (it->second.first <= ind && ind <= it->second.second)) {
+      marked.insert(it->first);
+      for (size_t i = it->second.first; i <= it->second.second; ++i)
+        marked.insert(i);
+    }
+  }
+  return marked;
+}
+
+bool duplicateIndex()
+{
+  XcMatrix cell ( 3.0, 0.0, 0.0, 2.0, 4.0, 0.0, 2.0, 5.0, 3.0 );
+
+  // Atoms on a corner, on edges, on faces, just inside and just outside
+  // of the boundaries, and in the middle of the cell
+  std::vector<XcVector> pos;
+  pos.push_back(XcVector(0.0, 0.0, 0.0));
+  pos.push_back(XcVector(0.5, 0.0, 0.0));
+  pos.push_back(XcVector(0.0, 0.5, 0.999));
+  pos.push_back(XcVector(0.5, 0.5, 0.5));
+  pos.push_back(XcVector(1.0, 0.25, 0.5));
+  pos.push_back(XcVector(0.001, 0.999, 0.5));
+  pos.push_back(XcVector(-0.001, 0.75, 0.25));
+  pos.push_back(XcVector(0.25, 0.75, 0.0));
+  pos.push_back(XcVector(0.999, 0.999, 0.999));
+
+  std::vector<unsigned int> types;
+  for (size_t i = 0; i < pos.size(); ++i)
+    types.push_back(1 + i % 3);
+
+  XtalComp::DuplicateMap dups;
+  DuplicateTester::expandFractionalCoordinates(&types, &pos, &dups, cell,
+                                               0.05);
+  if (dups.empty() || pos.size() != types.size())
+    return false;
+
+  // Every atom is marked along with the same atoms as before
+  std::vector<XtalComp::DuplicateMap::const_iterator> index;
+  DuplicateTester::indexDuplicates(dups, pos.size(), &index);
+  if (index.size() != pos.size())
+    return false;
+  for (size_t i = 0; i < pos.size(); ++i) {
+    std::set<size_t> marked;
+    if (index[i] != dups.end()) {
+      marked.insert(index[i]->first);
+      for (size_t j = index[i]->second.first; j <= index[i]->second.second;
+           ++j)
+        marked.insert(j);
+    }
+    if (marked != duplicatesByScan(dups, i))
+      return false;
+  }
+
+  return true;
+}
+
+bool boundaryAtoms()
+{
+  XcMatrix cell1 ( 3.0, 0.0, 0.0, 2.0, 4.0, 0.0, 2.0, 5.0, 3.0 );
+  XcMatrix cell2 (cell1);
+
+  // Most of the atoms are duplicated on the opposite boundaries
+  std::vector<XcVector> pos1;
+  pos1.push_back(XcVector(0.0, 0.0, 0.0));
+  pos1.push_back(XcVector(0.5, 0.0, 0.0));
+  pos1.push_back(XcVector(0.0, 0.5, 0.0));
+  pos1.push_back(XcVector(0.0, 0.0, 0.5));
+  pos1.push_back(XcVector(0.5, 0.5, 0.0));
+  pos1.push_back(XcVector(0.25, 0.5, 0.75));
+
+  std::vector<unsigned int> types1;
+  types1.push_back(1);
+  types1.push_back(2);
+  types1.push_back(2);
+  types1.push_back(2);
+  types1.push_back(1);
+  types1.push_back(1);
+  std::vector<unsigned int> types2 (types1);
+
+  // Translate by half a cell, which moves the atoms between the corners
+  // and the edges
+  std::vector<XcVector> pos2;
+  for (size_t i = 0; i < pos1.size(); ++i) {
+    XcVector v = pos1[i] + XcVector(0.5, 0.5, 0.5);
+    for (unsigned short j = 0; j < 3; ++j) {
+      if (v[j] >= 1.0)
+        v[j] -= 1.0;
+    }
+    pos2.push_back(v);
+  }
+
+  bool match = XtalComp::compare(cell1, types1, pos1,
+                                 cell2, types2, pos2,
+                                 NULL, 0.05, 0.25);
+  if (!match)
+    return false;
+
+  // An atom on a face is duplicated on the opposite face. Each copy can
+  // only be matched once, so two atoms on either side of the boundary
+  // can't both match the same atom.
+  XcMatrix cell3 ( 3.0, 0.0, 0.0, 0.0, 4.0, 0.0, 0.0, 0.0, 5.0 );
+  std::vector<XcVector> pos3;
+  pos3.push_back(XcVector(0.0, 0.5, 0.5));
+  pos3.push_back(XcVector(0.3, 0.6, 0.7));
+  pos3.push_back(XcVector(0.0, 0.0, 0.0));
+  std::vector<XcVector> pos4 (pos3);
+  pos4[1] = XcVector(0.998, 0.5, 0.5);
+
+  std::vector<unsigned int> types3;
+  types3.push_back(1);
+  types3.push_back(1);
+  types3.push_back(2);
+
+  match = XtalComp::compare(cell3, types3, pos3,
+                            cell3, types3, pos4,
+                            NULL, 0.05, 0.25);
+  if (match)
+    return false;
+
+  match = XtalComp::compare(cell3, types3, pos4,
+                            cell3, types3, pos3,
+                            NULL, 0.05, 0.25);
+  if (match)
+    return false;
+
+  return true;
+}
+
 int main()
 {
   int failures = 0;
@@ -492,6 +640,8 @@ int main()
   runTest(&allOfTheAbove, "All of the above test", successes, failures);
   runTest(&hexagonalCellTest, "Hexagonal cell test", successes, failures);
   runTest(&atomsOverlapping, "Atoms Overlapping Test", successes, failures);
+  runTest(&duplicateIndex, "Duplicate index test", successes, failures);
+  runTest(&boundaryAtoms, "Boundary atoms test", successes, failures);
 
   return failures;
 }
@@ -327,6 +327,7 @@ XtalComp::XtalComp(ReducedXtal *x1, ReducedXtal *x2,
   setLeastFrequentAtomInfo();
   setReferenceBasis();
   prepareRx1();
+  buildRx1Grid();
   buildSuperLfCCoordList2();
 
 #ifdef XTALCOMP_DEBUG
@@ -424,6 +425,97 @@ void XtalComp::prepareRx1()
   m_rx1->translateAndExpandCoords(rx1_ftrans, m_lengthtol, &m_duplicatedAtoms);
 }
 
+void XtalComp::buildRx1Grid()
+{
+  const std::vector<unsigned int> &types = m_rx1->types();
+  const std::vector<XcVector> &fcoords = m_rx1->fcoords();
+  const std::vector<unsigned int> &rx2_types = m_rx2->types();
+
+  // A cartesian displacement of length m_lengthtol changes fractional
+  // coordinate i by at most m_lengthtol * |row i of fmat|. Use bins that
+  // are at least twice that wide (with a little room for rounding). Small
+  // cells only need a few bins, so keep about one bin per atom.
+  const double maxDim = std::max(1.0, floor(cbrt(types.size())));
+  const XcMatrix &fmat = m_rx1->fmat();
+  for (unsigned short i = 0; i < 3; ++i) {
+    const double width = 2.02 * m_lengthtol * fmat.row(i).norm();
+    double dim = (width > 0.0) ? floor(1.0 / width) : maxDim;
+    dim = std::min(std::max(dim, 1.0), maxDim);
+    m_rx1GridDims[i] = static_cast<int>(dim) + 4;
+  }
+  const size_t numBins = static_cast<size_t>(m_rx1GridDims[0]) *
+                         m_rx1GridDims[1] * m_rx1GridDims[2];
+
+  // Number the species. rx1 and rx2 have the same composition.
+  std::vector<unsigned int> uniqueTypes (types);
+  std::sort(uniqueTypes.begin(), uniqueTypes.end());
+  uniqueTypes.erase(std::unique(uniqueTypes.begin(), uniqueTypes.end()),
+                    uniqueTypes.end());
+  m_rx2Species.resize(rx2_types.size());
+  for (size_t i = 0; i < rx2_types.size(); ++i) {
+    m_rx2Species[i] = std::lower_bound(uniqueTypes.begin(),
+                                       uniqueTypes.end(), rx2_types[i]) -
+                      uniqueTypes.begin();
+  }
+
+  // Count the atoms in each bin, then fill in the bins in order
+  std::vector<size_t> gridIndices (types.size());
+  m_rx1GridStart.assign(uniqueTypes.size() * numBins + 1, 0);
+  for (size_t i = 0; i < types.size(); ++i) {
+    const size_t species = std::lower_bound(uniqueTypes.begin(),
+                                            uniqueTypes.end(), types[i]) -
+                           uniqueTypes.begin();
+    int bins[3], neighbors[3];
+    getRx1GridBins(fcoords[i], bins, neighbors);
+    gridIndices[i] = rx1GridIndex(species, bins);
+    ++m_rx1GridStart[gridIndices[i] + 1];
+  }
+  for (size_t i = 1; i < m_rx1GridStart.size(); ++i)
+    m_rx1GridStart[i] += m_rx1GridStart[i - 1];
+  std::vector<size_t> next (m_rx1GridStart.begin(), m_rx1GridStart.end() - 1);
+  m_rx1GridAtoms.resize(types.size());
+  for (size_t i = 0; i < types.size(); ++i)
+    m_rx1GridAtoms[next[gridIndices[i]]++] = i;
+
+  // Look up the duplicates of each rx1 atom once
+  indexDuplicates(m_duplicatedAtoms, types.size(), &m_rx1Duplicates);
+
+  // Order rx2's atoms by the number of atoms of their type. Atoms of
+  // different types never compete for the same rx1 atom, so this does
+  // not change the result of compareCurrent().
+  std::vector<size_t> speciesCounts (uniqueTypes.size(), 0);
+  for (size_t i = 0; i < m_rx2Species.size(); ++i)
+    ++speciesCounts[m_rx2Species[i]];
+  std::vector<std::pair<std::pair<size_t, size_t>, size_t> > order;
+  order.reserve(m_rx2Species.size());
+  for (size_t i = 0; i < m_rx2Species.size(); ++i) {
+    const size_t species = m_rx2Species[i];
+    order.push_back(std::make_pair(
+      std::make_pair(speciesCounts[species], species), i));
+  }
+  std::sort(order.begin(), order.end());
+  m_rx2Order.resize(order.size());
+  for (size_t i = 0; i < order.size(); ++i)
+    m_rx2Order[i] = order[i].second;
+}
+
+void XtalComp::getRx1GridBins(const XcVector &fcoord, int bins[3],
+                              int neighbors[3]) const
+{
+  // The expanded rx1 atoms may be a little outside of the cell, so there
+  // are two extra bins on each side. Anything further out than that
+  // cannot match an atom inside the cell, so it is clamped.
+  for (unsigned short i = 0; i < 3; ++i) {
+    const int dim = m_rx1GridDims[i] - 4;
+    const double pos = fcoord[i] * dim + 2.0;
+    const double bin = std::min(std::max(floor(pos), 0.0),
+                                static_cast<double>(dim + 3));
+    bins[i] = static_cast<int>(bin);
+    neighbors[i] = (pos - bin < 0.5) ? std::max(bins[i] - 1, 0)
+                                     : std::min(bins[i] + 1, dim + 3);
+  }
+}
+
 void XtalComp::getCurrentTransform(float ret[16])
 {
   // Fill ret with the 4x4 matrix of the current transform.
@@ -882,6 +974,21 @@ void XtalComp::buildTransformedXtal2()
   }
 }
 
+void XtalComp::indexDuplicates(
+    const DuplicateMap &duplicateAtoms, const size_t numAtoms,
+    std::vector<DuplicateMap::const_iterator> *index)
+{
+  // The ranges of duplicates are appended after the original atoms, so
+  // each atom is in at most one entry.
+  index->assign(numAtoms, duplicateAtoms.end());
+  for (DuplicateMap::const_iterator it = duplicateAtoms.begin(),
+       itEnd = duplicateAtoms.end(); it != itEnd; ++it) {
+    (*index)[it->first] = it;
+    for (size_t i = it->second.first; i <= it->second.second; ++i)
+      (*index)[i] = it;
+  }
+}
+
 void XtalComp::expandFractionalCoordinates(std::vector<unsigned int> *types,
                                            std::vector<XcVector> *fcoords,
                                            DuplicateMap *duplicateAtoms,
@@ -1528,97 +1635,99 @@ bool XtalComp::compareCurrent()
   const std::vector<unsigned int> &rx2_types = m_transformedTypes;
   assert(rx2_ccoords.size() == rx2_types.size());
 
-  bool rx2AtomMatched;
+  XcVector rx2_fcoord;
   XcVector rx2_xformedCoord;
   XcVector diffVec;
+  const size_t noMatch = rx1_types.size();
 
   // If an rx1 atom has already been matched, it can't be matched again! PSA
   std::vector<bool> rx1AtomAlreadyMatched(rx1_types.size(), false);
 
-  // Iterate through all atoms in rx2
-  for (size_t rx2Ind = 0; rx2Ind < rx2_types.size(); ++rx2Ind) {
-    const unsigned int &rx2_type = rx2_types[rx2Ind];
+  // Iterate through all atoms in rx2, least frequent types first
+  for (size_t orderInd = 0; orderInd < m_rx2Order.size(); ++orderInd) {
+    const size_t rx2Ind = m_rx2Order[orderInd];
     const XcVector &rx2_ccoord = rx2_ccoords[rx2Ind];
-    rx2AtomMatched = false;
 
 #ifdef XTALCOMP_DEBUG
+    const unsigned int &rx2_type = rx2_types[rx2Ind];
     DEBUG_STRING_INT("Rx2 atom:", rx2Ind);
     DEBUG_ATOM(rx2_type, rx2_ccoord);
 #endif
 
     // convert rx2_ccoord to rx1's basis:
-    rx2_xformedCoord = m_rx1->fmat() * rx2_ccoord;
+    rx2_fcoord = m_rx1->fmat() * rx2_ccoord;
 
     // Wrap to cell
-    if (StableComp::lt((rx2_xformedCoord[0] = fmod(rx2_xformedCoord[0], 1.0)), 0.0, PRECISION)) ++rx2_xformedCoord[0];
-    if (StableComp::lt((rx2_xformedCoord[1] = fmod(rx2_xformedCoord[1], 1.0)), 0.0, PRECISION)) ++rx2_xformedCoord[1];
-    if (StableComp::lt((rx2_xformedCoord[2] = fmod(rx2_xformedCoord[2], 1.0)), 0.0, PRECISION)) ++rx2_xformedCoord[2];
+    if (StableComp::lt((rx2_fcoord[0] = fmod(rx2_fcoord[0], 1.0)), 0.0, PRECISION)) ++rx2_fcoord[0];
+    if (StableComp::lt((rx2_fcoord[1] = fmod(rx2_fcoord[1], 1.0)), 0.0, PRECISION)) ++rx2_fcoord[1];
+    if (StableComp::lt((rx2_fcoord[2] = fmod(rx2_fcoord[2], 1.0)), 0.0, PRECISION)) ++rx2_fcoord[2];
 
     // convert back to a cartesian coordinate
-    rx2_xformedCoord = m_rx1->cmat() * rx2_xformedCoord;
+    rx2_xformedCoord = m_rx1->cmat() * rx2_fcoord;
 
 #ifdef XTALCOMP_DEBUG
     DEBUG_STRING("Rx2 atom, wrapped to Rx1's cell:");
     DEBUG_ATOM(rx2_type, rx2_xformedCoord);
 #endif
 
-    // Iterate through all atoms in rx1
-    for (size_t rx1Ind = 0; rx1Ind < rx1_types.size(); ++rx1Ind) {
-      // If the types don't match, move to the next rx1 atom
-      const unsigned int &rx1_type = rx1_types[rx1Ind];
-#ifdef XTALCOMP_DEBUG
-      printf("Rx1 type: %d\n", rx1_type);
-#endif
-      if (rx1_type != rx2_type) {
-        continue;
-      }
+    // Find the matching rx1 atom with the lowest index. Only the rx1
+    // atoms of the same type in the nearest bins can match.
+    size_t rx1Match = noMatch;
+    const size_t rx2Species = m_rx2Species[rx2Ind];
+    int bins[3], neighbors[3];
+    getRx1GridBins(rx2_fcoord, bins, neighbors);
+    for (unsigned short corner = 0; corner < 8; ++corner) {
+      const int cornerBins[3] = {(corner & 1) ? neighbors[0] : bins[0],
+                                 (corner & 2) ? neighbors[1] : bins[1],
+                                 (corner & 4) ? neighbors[2] : bins[2]};
+      const size_t gridIndex = rx1GridIndex(rx2Species, cornerBins);
+      for (size_t i = m_rx1GridStart[gridIndex],
+             iEnd = m_rx1GridStart[gridIndex + 1];
+           i < iEnd && m_rx1GridAtoms[i] < rx1Match; ++i) {
+        const size_t rx1Ind = m_rx1GridAtoms[i];
+        if (rx1AtomAlreadyMatched[rx1Ind] == true) {
+          continue;
+        }
 
-      if (rx1AtomAlreadyMatched[rx1Ind] == true) {
+        // If the coordinates don't match, move to the next rx1 atom
+        diffVec = rx2_xformedCoord - rx1_ccoords[rx1Ind];
 #ifdef XTALCOMP_DEBUG
-    DEBUG_STRING("Already matched!");
+        DEBUG_STRING_INT("Rx1 coords:", rx1Ind);
+        DEBUG_VECTOR(rx1_ccoords[rx1Ind]);
+        DEBUG_STRING("Diffvec:");
+        DEBUG_VECTOR(diffVec);
 #endif
-        continue;
-      }
+        // Compare distance squared to squared length tolerance
+        if (diffVec.squaredNorm() > tolSquared) {
+          continue;
+        }
 
-      // If the coordinates don't match, move to the next rx2 atom
-      const XcVector &rx1_ccoord = rx1_ccoords[rx1Ind];
-#ifdef XTALCOMP_DEBUG
-      DEBUG_STRING_INT("Rx1 coords:", rx1Ind);
-      DEBUG_VECTOR(rx1_ccoord);
-#endif
-      diffVec = rx2_xformedCoord - rx1_ccoord;
-#ifdef XTALCOMP_DEBUG
-      DEBUG_STRING("Diffvec:");
-      DEBUG_VECTOR(diffVec);
-#endif
-      // Compare distance squared to squared length tolerance
-      if (diffVec.squaredNorm() > tolSquared) {
-        continue;
+        // The atoms match. The rest of the atoms in this bin have higher
+        // indices.
+        rx1Match = rx1Ind;
+        break;
       }
+    }
 
-      // Otherwise, the atoms match. move to next atom
-      rx2AtomMatched = true;
-      rx1AtomAlreadyMatched[rx1Ind] = true;
+    if (rx1Match != noMatch) {
+      rx1AtomAlreadyMatched[rx1Match] = true;
       // Check for other duplicates to add to rx1AtomAlreadyMatched
-      for (DuplicateMap::const_iterator it = m_duplicatedAtoms.begin(),
-           itEnd = m_duplicatedAtoms.end(); it != itEnd; ++it) {
-        if (rx1Ind == it->first ||
-            (it->second.first <= rx1Ind && rx1Ind <= it->second.second)) {
-          rx1AtomAlreadyMatched[it->first] = true;
-          std::fill(rx1AtomAlreadyMatched.begin() + it->second.first,
-                    rx1AtomAlreadyMatched.begin() + it->second.second + 1,
-                    true);
+      const DuplicateMap::const_iterator &dup = m_rx1Duplicates[rx1Match];
+      if (dup != m_duplicatedAtoms.end()) {
+        rx1AtomAlreadyMatched[dup->first] = true;
+        std::fill(rx1AtomAlreadyMatched.begin() + dup->second.first,
+                  rx1AtomAlreadyMatched.begin() + dup->second.second + 1,
+                  true);
 #ifdef XTALCOMP_DEBUG
-          std::cout << "rx1AtomAlreadyMatched at rx1 indices " << it->first
-                    << " and " << it->second.first << "-" << it->second.second
-                    << " = true now\n";
+        std::cout << "rx1AtomAlreadyMatched at rx1 indices " << dup->first
+                  << " and " << dup->second.first << "-"
+                  << dup->second.second << " = true now\n";
 #endif
-        }
       }
-      break;
     }
+
     // If the current rx1Atom was not matched, fail:
-    if (!rx2AtomMatched) {
+    if (rx1Match == noMatch) {
 #ifdef XTALCOMP_DEBUG
       DEBUG_STRING("Not a match.");
       DEBUG_DIV;
@@ -134,6 +134,44 @@ class XtalComp
   std::vector<XcVector> m_superLfCCoordList2;
   void findCandidateTransforms();
 
+  // Bucket rx1's atoms by type into a fractional grid for
+  // compareCurrent(). The bins are at least twice m_lengthtol wide along
+  // each axis, so an atom can only match the rx1 atoms in its own bin
+  // and in the neighboring bins on the sides that it is closest to.
+  void buildRx1Grid();
+  // The bin of fcoord along each axis, and the neighboring bin that is
+  // closest to it
+  void getRx1GridBins(const XcVector &fcoord, int bins[3],
+                      int neighbors[3]) const;
+  size_t rx1GridIndex(size_t species, const int bins[3]) const
+  {
+    return ((species * m_rx1GridDims[0] + bins[0]) * m_rx1GridDims[1] +
+            bins[1]) * m_rx1GridDims[2] + bins[2];
+  }
+  // Number of bins along each axis, including two on each side for the
+  // expanded atoms just outside of the cell
+  int m_rx1GridDims[3];
+  // The rx1 atoms of species s in a bin are m_rx1GridAtoms[k] for
+  // m_rx1GridStart[j] <= k < m_rx1GridStart[j + 1], where
+  // j = rx1GridIndex(s, bins). They are in increasing order.
+  std::vector<size_t> m_rx1GridStart;
+  std::vector<size_t> m_rx1GridAtoms;
+  // The species (index into the sorted list of types) of each rx2 atom
+  std::vector<size_t> m_rx2Species;
+
+  // The entry of m_duplicatedAtoms that each rx1 atom belongs to, or
+  // m_duplicatedAtoms.end()
+  std::vector<DuplicateMap::const_iterator> m_rx1Duplicates;
+  // Set index[i] to the entry of duplicateAtoms that atom i belongs to,
+  // or to duplicateAtoms.end()
+  static void indexDuplicates(
+          const DuplicateMap &duplicateAtoms, const size_t numAtoms,
+          std::vector<DuplicateMap::const_iterator> *index);
+
+  // The rx2 atoms ordered by the number of atoms of their type, so that
+  // the least frequent types, which are the quickest to fail, come first
+  std::vector<size_t> m_rx2Order;
+
   // Add atoms around cell boundaries for stability during comparisons
   static void expandFractionalCoordinates(
           std::vector<unsigned int> *types, std::vector<XcVector> *fcoords,
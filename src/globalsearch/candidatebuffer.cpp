@@ -0,0 +1,269 @@
+/**********************************************************************
+  CandidateBuffer - A bounded buffer of pre-generated structures
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ ***********************************************************************/
+
+#include <globalsearch/candidatebuffer.h>
+
+#include <globalsearch/structure.h>
+
+#include <algorithm>
+
+namespace GlobalSearch {
+
+CandidateBuffer::CandidateBuffer(Executor& executor)
+  : m_executor(executor), m_capacity(4), m_maxAge(4), m_pending(0),
+    m_version(0), m_generation(0), m_running(false), m_numHits(0),
+    m_numMisses(0), m_numDiscarded(0)
+{
+}
+
+CandidateBuffer::~CandidateBuffer()
+{
+  stop();
+}
+
+void CandidateBuffer::setProducer(const Producer& producer)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_producer = producer;
+}
+
+size_t CandidateBuffer::capacity() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_capacity;
+}
+
+void CandidateBuffer::setCapacity(size_t n)
+{
+  std::vector<Structure*> discarded;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_capacity = n;
+    while (m_candidates.size() > m_capacity) {
+      discarded.push_back(m_candidates.back().structure);
+      m_candidates.pop_back();
+    }
+    m_numDiscarded += discarded.size();
+  }
+  discard(discarded);
+}
+
+size_t CandidateBuffer::maxAge() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_maxAge;
+}
+
+void CandidateBuffer::setMaxAge(size_t n)
+{
+  std::vector<Structure*> discarded;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_maxAge = n;
+    dropStaleLocked(discarded);
+  }
+  discard(discarded);
+}
+
+size_t CandidateBuffer::size() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_candidates.size();
+}
+
+size_t CandidateBuffer::numPending() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_pending;
+}
+
+size_t CandidateBuffer::maxProducers() const
+{
+  return static_cast<size_t>(std::max(m_executor.maxThreadCount() - 1, 1));
+}
+
+void CandidateBuffer::forEach(
+  const std::function<void(const Structure*)>& f) const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  for (const auto& candidate : m_candidates)
+    f(candidate.structure);
+}
+
+Structure* CandidateBuffer::take()
+{
+  Structure* structure = nullptr;
+  std::vector<Structure*> discarded;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_running = true;
+    dropStaleLocked(discarded);
+    if (!m_candidates.empty()) {
+      structure = m_candidates.front().structure;
+      m_candidates.pop_front();
+      ++m_numHits;
+    } else {
+      ++m_numMisses;
+    }
+    refillLocked();
+  }
+  discard(discarded);
+  return structure;
+}
+
+void CandidateBuffer::refill()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_running = true;
+  refillLocked();
+}
+
+void CandidateBuffer::advance(size_t n)
+{
+  std::vector<Structure*> discarded;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_version += n;
+    dropStaleLocked(discarded);
+    if (m_running)
+      refillLocked();
+  }
+  discard(discarded);
+}
+
+void CandidateBuffer::invalidate()
+{
+  std::vector<Structure*> discarded;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    ++m_generation;
+    for (const auto& candidate : m_candidates)
+      discarded.push_back(candidate.structure);
+    m_candidates.clear();
+    m_numDiscarded += discarded.size();
+    if (m_running)
+      refillLocked();
+  }
+  discard(discarded);
+}
+
+void CandidateBuffer::stop()
+{
+  std::vector<Structure*> discarded;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_running = false;
+    ++m_generation;
+    for (const auto& candidate : m_candidates)
+      discarded.push_back(candidate.structure);
+    m_candidates.clear();
+    m_numDiscarded += discarded.size();
+    m_producerFinished.wait(lock, [this]() { return m_pending == 0; });
+  }
+  discard(discarded);
+}
+
+size_t CandidateBuffer::numHits() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_numHits;
+}
+
+size_t CandidateBuffer::numMisses() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_numMisses;
+}
+
+size_t CandidateBuffer::numDiscarded() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_numDiscarded;
+}
+
+void CandidateBuffer::produce(size_t generation, size_t version)
+{
+  Producer producer;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    // Skip the work if the result would be thrown away anyway
+    if (generation == m_generation)
+      producer = m_producer;
+  }
+
+  Structure* structure = producer ? producer() : nullptr;
+
+  std::vector<Structure*> discarded;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    --m_pending;
+    if (structure) {
+      if (generation == m_generation && m_version - version <= m_maxAge &&
+          m_candidates.size() < m_capacity) {
+        m_candidates.push_back({ structure, version });
+        // Start the producers that were held back by maxProducers()
+        if (m_running)
+          refillLocked();
+      } else {
+        discarded.push_back(structure);
+        ++m_numDiscarded;
+        // Replace it with one made from the current pool
+        if (m_running)
+          refillLocked();
+      }
+    } else if (generation != m_generation && m_running) {
+      refillLocked();
+    }
+    m_producerFinished.notify_all();
+  }
+  discard(discarded);
+}
+
+void CandidateBuffer::dropStaleLocked(std::vector<Structure*>& discarded)
+{
+  size_t numDiscarded = discarded.size();
+  for (auto it = m_candidates.begin(); it != m_candidates.end();) {
+    if (m_version - it->version > m_maxAge) {
+      discarded.push_back(it->structure);
+      it = m_candidates.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  m_numDiscarded += discarded.size() - numDiscarded;
+}
+
+void CandidateBuffer::refillLocked()
+{
+  if (!m_producer)
+    return;
+
+  size_t generation = m_generation;
+  size_t version = m_version;
+  size_t maxPending = maxProducers();
+  while (m_candidates.size() + m_pending < m_capacity &&
+         m_pending < maxPending) {
+    ++m_pending;
+    m_executor.run([this, generation, version]() {
+      produce(generation, version);
+    }, Executor::LowPriority);
+  }
+}
+
+void CandidateBuffer::discard(const std::vector<Structure*>& structures)
+{
+  for (const auto& structure : structures)
+    structure->deleteLater();
+}
+}
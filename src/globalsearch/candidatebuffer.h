@@ -0,0 +1,172 @@
+/**********************************************************************
+  CandidateBuffer - A bounded buffer of pre-generated structures
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ ***********************************************************************/
+
+#ifndef GLOBALSEARCH_CANDIDATEBUFFER_H
+#define GLOBALSEARCH_CANDIDATEBUFFER_H
+
+#include <globalsearch/executor.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace GlobalSearch {
+class Structure;
+
+/**
+ * @class CandidateBuffer candidatebuffer.h <globalsearch/candidatebuffer.h>
+ *
+ * @brief A bounded buffer of structures that were generated before they
+ * were needed.
+ *
+ * Generating an offspring can take a long time, since the generator may
+ * reject thousands of structures before one passes the checks. When the
+ * generation only starts after the queue asks for a new structure, the
+ * free slot on the cluster sits idle for that long. The producer set with
+ * setProducer() is instead ran in the background to keep up to capacity()
+ * validated candidates waiting, and take() hands one out immediately.
+ *
+ * Candidates are generated from the parent pool as it was when they were
+ * made. advance() should be called each time the pool changes (e.g., a
+ * structure finishes optimizing). Candidates that are more than maxAge()
+ * advances old are discarded. invalidate() discards all of them, and
+ * should be called when the pool changes significantly (e.g., a new best
+ * structure is found).
+ *
+ * Nothing is generated until the first call to take(), so an idle buffer
+ * costs nothing.
+ *
+ * The executor only orders its queue by priority, and a producer may run
+ * for a long time once it has started. At most maxProducers() of them run
+ * at once so that the executor always has a thread left for other work.
+ */
+class CandidateBuffer
+{
+public:
+  /// Returns a new structure owned by the caller, or nullptr on failure.
+  /// It may be called from several threads at once.
+  typedef std::function<Structure*()> Producer;
+
+  /**
+   * Constructor.
+   *
+   * @param executor The executor the producer is ran on.
+   */
+  explicit CandidateBuffer(Executor& executor = Executor::cpu());
+
+  /**
+   * Destructor. Calls stop().
+   */
+  ~CandidateBuffer();
+
+  void setProducer(const Producer& producer);
+
+  /// The maximum number of candidates that are kept waiting
+  size_t capacity() const;
+  void setCapacity(size_t n);
+
+  /// The number of advance() calls after which a candidate is discarded
+  size_t maxAge() const;
+  void setMaxAge(size_t n);
+
+  /// The number of candidates that are waiting
+  size_t size() const;
+
+  /// The number of candidates that are being generated
+  size_t numPending() const;
+
+  /// The number of producers that may run at once. This is one less than
+  /// the executor's maximum thread count, but at least one.
+  size_t maxProducers() const;
+
+  /// Call @p f on each candidate that is waiting. The buffer is locked
+  /// meanwhile, so @p f may not keep the candidate or call the buffer.
+  void forEach(const std::function<void(const Structure*)>& f) const;
+
+  /**
+   * Take the oldest candidate that is still fresh and start generating
+   * a replacement. The caller takes ownership.
+   *
+   * @return The candidate, or nullptr if none were ready.
+   */
+  Structure* take();
+
+  /// Start generating candidates until there are capacity() of them,
+  /// counting those already being generated.
+  void refill();
+
+  /// Record that the parent pool has changed @p n times.
+  void advance(size_t n = 1);
+
+  /// Discard every candidate, including those being generated.
+  void invalidate();
+
+  /// Discard every candidate and wait for the producers that are running.
+  /// Nothing is generated until take() is called again.
+  void stop();
+
+  /// The number of take() calls that returned a candidate
+  size_t numHits() const;
+
+  /// The number of take() calls that found no candidate
+  size_t numMisses() const;
+
+  /// The number of candidates that were thrown away
+  size_t numDiscarded() const;
+
+private:
+  struct Candidate
+  {
+    Structure* structure;
+    size_t version;
+  };
+
+  // Ran on the executor. The result is kept if the buffer has not been
+  // invalidated since @p generation and is not too old.
+  void produce(size_t generation, size_t version);
+
+  // Removes candidates older than m_maxAge. m_mutex must be locked.
+  void dropStaleLocked(std::vector<Structure*>& discarded);
+
+  // Starts producers until there are enough candidates or maxProducers()
+  // are running. m_mutex must be locked.
+  void refillLocked();
+
+  // Schedules deletion of @p structures
+  static void discard(const std::vector<Structure*>& structures);
+
+  Executor& m_executor;
+  Producer m_producer;
+
+  mutable std::mutex m_mutex;
+  std::condition_variable m_producerFinished;
+  std::deque<Candidate> m_candidates;
+  size_t m_capacity;
+  size_t m_maxAge;
+  size_t m_pending;
+  // Incremented by advance()
+  size_t m_version;
+  // Incremented by invalidate() and stop()
+  size_t m_generation;
+  bool m_running;
+
+  size_t m_numHits;
+  size_t m_numMisses;
+  size_t m_numDiscarded;
+};
+}
+
+#endif // GLOBALSEARCH_CANDIDATEBUFFER_H
@@ -0,0 +1,162 @@
+/**********************************************************************
+  Executor - A bounded thread pool with priorities and queue metrics
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ ***********************************************************************/
+
+#include <globalsearch/executor.h>
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QRunnable>
+#include <QThread>
+
+#include <algorithm>
+#include <exception>
+
+namespace GlobalSearch {
+
+// The executor whose task the current thread is running, if any
+static thread_local const Executor* t_currentExecutor = nullptr;
+
+class Executor::Task : public QRunnable
+{
+public:
+  Task(Executor* executor, std::function<void()> f)
+    : m_executor(executor), m_function(std::move(f))
+  {
+    m_timer.start();
+  }
+
+  void run() override
+  {
+    --m_executor->m_queued;
+    ++m_executor->m_active;
+    long long waitTime = m_timer.elapsed();
+
+    const Executor* previousExecutor = t_currentExecutor;
+    t_currentExecutor = m_executor;
+
+    // An exception must not escape into QThreadPool, which would
+    // terminate the program. Tasks from submit() have already stored it
+    // in their future, so this only catches the ones from run().
+    try {
+      m_function();
+    } catch (const std::exception& e) {
+      qWarning() << "Error: a task in the" << m_executor->name()
+                 << "executor threw an exception:" << e.what();
+    } catch (...) {
+      qWarning() << "Error: a task in the" << m_executor->name()
+                 << "executor threw an exception";
+    }
+
+    t_currentExecutor = previousExecutor;
+
+    m_executor->m_totalWaitTime += waitTime;
+    ++m_executor->m_completed;
+    --m_executor->m_active;
+  }
+
+private:
+  Executor* m_executor;
+  std::function<void()> m_function;
+  QElapsedTimer m_timer;
+};
+
+Executor::Executor(const QString& name, int maxThreadCount)
+  : m_name(name), m_queued(0), m_maxQueued(0), m_active(0), m_completed(0),
+    m_totalWaitTime(0)
+{
+  setMaxThreadCount(maxThreadCount);
+}
+
+Executor::~Executor()
+{
+  m_pool.waitForDone();
+}
+
+void Executor::setMaxThreadCount(int n)
+{
+  m_pool.setMaxThreadCount(std::max(n, 1));
+}
+
+void Executor::start(std::function<void()> f, Priority priority)
+{
+  int queued = ++m_queued;
+
+  // Keep track of the high water mark
+  int maxQueued = m_maxQueued.load();
+  while (queued > maxQueued &&
+         !m_maxQueued.compare_exchange_weak(maxQueued, queued)) {
+  }
+
+  m_pool.start(new Task(this, std::move(f)), priority);
+}
+
+bool Executor::isWorkerThread() const
+{
+  return t_currentExecutor == this;
+}
+
+double Executor::averageWaitTime() const
+{
+  size_t completed = m_completed.load();
+  if (completed == 0)
+    return 0.0;
+  return static_cast<double>(m_totalWaitTime.load()) / completed;
+}
+
+void Executor::resetMetrics()
+{
+  m_maxQueued = m_queued.load();
+  m_completed = 0;
+  m_totalWaitTime = 0;
+}
+
+QString Executor::metricsString() const
+{
+  return QString("%1: %2 running (max %3), %4 queued (max %5), %6 finished, "
+                 "average wait %7 ms")
+    .arg(m_name)
+    .arg(activeCount())
+    .arg(maxThreadCount())
+    .arg(queueDepth())
+    .arg(maxQueueDepth())
+    .arg(numCompleted())
+    .arg(averageWaitTime(), 0, 'f', 1);
+}
+
+Executor& Executor::io()
+{
+  // Changed to the number of ssh connections when they are made
+  static Executor executor("I/O", std::max(QThread::idealThreadCount(), 8));
+  return executor;
+}
+
+Executor& Executor::cpu()
+{
+  static Executor executor("CPU", std::max(QThread::idealThreadCount(), 2));
+  return executor;
+}
+
+Executor& Executor::maintenance()
+{
+  static Executor executor("Maintenance", 2);
+  return executor;
+}
+
+QString Executor::allMetricsString()
+{
+  return io().metricsString() + "\n" + cpu().metricsString() + "\n" +
+         maintenance().metricsString();
+}
+
+} // end namespace GlobalSearch
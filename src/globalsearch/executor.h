@@ -0,0 +1,175 @@
+/**********************************************************************
+  Executor - A bounded thread pool with priorities and queue metrics
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ ***********************************************************************/
+
+#ifndef GLOBALSEARCH_EXECUTOR_H
+#define GLOBALSEARCH_EXECUTOR_H
+
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+
+#include <QString>
+#include <QThreadPool>
+
+namespace GlobalSearch {
+
+/**
+ * @class Executor executor.h <globalsearch/executor.h>
+ *
+ * @brief A thread pool with its own maximum thread count that keeps
+ * track of how many tasks are waiting to be ran.
+ *
+ * All background work used to be sent to the global QThreadPool with
+ * QtConcurrent::run(). Since that pool is sized to the number of cores,
+ * a few handlers blocking on an ssh connection were enough to keep
+ * structure generation and duplicate checking from running. Work is
+ * instead split between the executors returned by io(), cpu(), and
+ * maintenance() so that each kind of work can only starve itself.
+ *
+ * Tasks with a higher priority are started before tasks with a lower
+ * priority that are waiting in the same executor. Running tasks are never
+ * preempted, so long running low priority work should not take every
+ * thread (see CandidateBuffer::maxProducers()).
+ */
+class Executor
+{
+public:
+  enum Priority
+  {
+    LowPriority = -1,
+    NormalPriority = 0,
+    HighPriority = 1
+  };
+
+  /**
+   * Constructor.
+   *
+   * @param name The name used when printing metrics.
+   * @param maxThreadCount The maximum number of tasks ran at once.
+   */
+  Executor(const QString& name, int maxThreadCount);
+
+  /**
+   * Destructor. Waits for the running and queued tasks to finish.
+   */
+  ~Executor();
+
+  /**
+   * Run @p f in the background. @p f is copied. If @p f throws, the
+   * exception is printed and dropped.
+   */
+  template <typename Functor>
+  void run(Functor f, Priority priority = NormalPriority)
+  {
+    start(std::function<void()>(std::move(f)), priority);
+  }
+
+  /**
+   * Run @p f in the background and get a future for its result. If @p f
+   * throws, the exception is rethrown by the future's get().
+   *
+   * If this is called from one of this executor's own tasks, @p f is ran
+   * right away in the calling thread instead. Otherwise, a task that waits
+   * on the future could wait forever for a thread that it is holding.
+   */
+  template <typename Functor>
+  auto submit(Functor f, Priority priority = NormalPriority)
+    -> std::future<decltype(f())>
+  {
+    typedef decltype(f()) ResultType;
+    auto task = std::make_shared<std::packaged_task<ResultType()>>(f);
+    std::future<ResultType> future = task->get_future();
+    if (isWorkerThread())
+      (*task)();
+    else
+      start([task]() { (*task)(); }, priority);
+    return future;
+  }
+
+  /// Whether the calling thread is running one of this executor's tasks
+  bool isWorkerThread() const;
+
+  QString name() const { return m_name; }
+
+  int maxThreadCount() const { return m_pool.maxThreadCount(); }
+  void setMaxThreadCount(int n);
+
+  /// The number of tasks that are waiting to be started
+  int queueDepth() const { return m_queued.load(); }
+
+  /// The largest queueDepth() seen since the last resetMetrics()
+  int maxQueueDepth() const { return m_maxQueued.load(); }
+
+  /// The number of tasks that are running
+  int activeCount() const { return m_active.load(); }
+
+  /// The number of tasks that have finished since the last resetMetrics()
+  size_t numCompleted() const { return m_completed.load(); }
+
+  /// The average time in milliseconds that the tasks finished since the
+  /// last resetMetrics() waited before they were started
+  double averageWaitTime() const;
+
+  void resetMetrics();
+
+  /// A one line summary of the metrics above
+  QString metricsString() const;
+
+  /**
+   * Wait for all running and queued tasks to finish.
+   *
+   * @param msecs The time to wait, or -1 to wait forever.
+   *
+   * @return True if all of the tasks finished.
+   */
+  bool waitForDone(int msecs = -1) { return m_pool.waitForDone(msecs); }
+
+  /// For blocking I/O, such as the QueueManager handlers that talk to
+  /// the queue over ssh. setMaxThreadCount() should be set to the number
+  /// of ssh connections when they are made.
+  static Executor& io();
+
+  /// For CPU bound work, such as structure generation and comparison.
+  /// It has at least two threads so that the candidate buffer, which
+  /// leaves one thread free, can always run.
+  static Executor& cpu();
+
+  /// For low priority work, such as saving and resetting.
+  static Executor& maintenance();
+
+  /// The metricsString() of each of the above on separate lines
+  static QString allMetricsString();
+
+private:
+  class Task;
+
+  void start(std::function<void()> f, Priority priority);
+
+  QString m_name;
+
+  std::atomic<int> m_queued;
+  std::atomic<int> m_maxQueued;
+  std::atomic<int> m_active;
+  std::atomic<size_t> m_completed;
+  std::atomic<long long> m_totalWaitTime;
+
+  // This is declared last so that it waits for the tasks before anything
+  // they use is destroyed
+  QThreadPool m_pool;
+};
+
+} // end namespace GlobalSearch
+
+#endif // GLOBALSEARCH_EXECUTOR_H
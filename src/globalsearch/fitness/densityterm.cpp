@@ -0,0 +1,36 @@
+/**********************************************************************
+  DensityTerm - A fitness term for the mass density of a crystal
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ ***********************************************************************/
+
+#include <globalsearch/fitness/densityterm.h>
+
+#include <globalsearch/eleminfo.h>
+#include <globalsearch/structures/molecule.h>
+
+namespace GlobalSearch {
+
+// g/mol / Angstrom^3 -> g/cm^3
+static const double AMU_PER_CUBIC_ANGSTROM_TO_G_PER_CC = 1.66053904;
+
+double DensityTerm::evaluate(const Molecule& mol) const
+{
+  if (!mol.hasUnitCell())
+    return 0.0;
+
+  double mass = 0.0;
+  for (const auto& atom : mol.atoms())
+    mass += ElemInfo::getAtomicMass(atom.atomicNumber());
+
+  return AMU_PER_CUBIC_ANGSTROM_TO_G_PER_CC * mass / mol.unitCell().volume();
+}
+}
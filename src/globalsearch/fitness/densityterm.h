@@ -0,0 +1,37 @@
+/**********************************************************************
+  DensityTerm - A fitness term for the mass density of a crystal
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ ***********************************************************************/
+
+#ifndef GLOBALSEARCH_DENSITY_TERM_H
+#define GLOBALSEARCH_DENSITY_TERM_H
+
+#include <globalsearch/fitness/fitnessterm.h>
+
+namespace GlobalSearch {
+
+/**
+ * @class DensityTerm densityterm.h <globalsearch/fitness/densityterm.h>
+ * @brief The density of the unit cell in g/cm^3. Denser structures are
+ *        favored.
+ */
+class DensityTerm : public FitnessTerm
+{
+public:
+  std::string name() const override { return "density"; }
+  bool higherIsBetter() const override { return true; }
+  using FitnessTerm::evaluate;
+  double evaluate(const Molecule& mol) const override;
+};
+}
+
+#endif // GLOBALSEARCH_DENSITY_TERM_H
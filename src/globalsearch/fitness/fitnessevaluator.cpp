@@ -0,0 +1,327 @@
+/**********************************************************************
+  FitnessEvaluator - Evaluates weighted fitness terms in batches and caches
+                     the results
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ ***********************************************************************/
+
+#include <globalsearch/fitness/fitnessevaluator.h>
+
+#include <globalsearch/fitness/densityterm.h>
+#include <globalsearch/fitness/pairpotentialterm.h>
+#include <globalsearch/structure.h>
+#include <globalsearch/utilities/makeunique.h>
+
+#include <QDebug>
+#include <QReadLocker>
+#include <QStringList>
+#include <QtConcurrent>
+
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <unordered_set>
+
+namespace GlobalSearch {
+
+static const double NOT_EVALUATED = std::numeric_limits<double>::quiet_NaN();
+
+// A hash of the atoms and the cell. If it changes, the cached values for
+// the structure are no longer valid.
+static size_t geometrySignature(const Molecule& mol)
+{
+  std::hash<double> hasher;
+  size_t seed = mol.numAtoms();
+  auto combine = [&seed](size_t v) {
+    seed ^= v + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+  };
+
+  for (const auto& atom : mol.atoms()) {
+    combine(atom.atomicNumber());
+    for (int i = 0; i < 3; ++i)
+      combine(hasher(atom.pos()[i]));
+  }
+
+  const Matrix3 cellMatrix = mol.unitCell().cellMatrix();
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j)
+      combine(hasher(cellMatrix(i, j)));
+  }
+
+  return seed;
+}
+
+// The geometry signature combined with the identity of the structure, so
+// that a new structure allocated at the address of a deleted one does not
+// pick up its cached values
+static size_t structureSignature(const Structure& s)
+{
+  size_t seed = geometrySignature(s);
+  for (size_t v : { static_cast<size_t>(s.getGeneration()),
+                    static_cast<size_t>(s.getIDNumber()) }) {
+    seed ^= v + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+  }
+  return seed;
+}
+
+FitnessEvaluator::FitnessEvaluator()
+{
+  addTerm(make_unique<DensityTerm>());
+  addTerm(make_unique<PairPotentialTerm>());
+}
+
+void FitnessEvaluator::addTerm(std::unique_ptr<FitnessTerm> term,
+                               double weight)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  long long ind = termIndex(term->name());
+  if (ind >= 0) {
+    m_terms[ind] = std::move(term);
+    m_weights[ind] = weight;
+    // The cached values may belong to the old term
+    m_cache.clear();
+    return;
+  }
+
+  m_terms.push_back(std::move(term));
+  m_weights.push_back(weight);
+}
+
+size_t FitnessEvaluator::numTerms() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_terms.size();
+}
+
+std::vector<std::string> FitnessEvaluator::termNames() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  std::vector<std::string> ret;
+  for (const auto& term : m_terms)
+    ret.push_back(term->name());
+  return ret;
+}
+
+long long FitnessEvaluator::termIndex(const std::string& name) const
+{
+  for (size_t i = 0; i < m_terms.size(); ++i) {
+    if (m_terms[i]->name() == name)
+      return i;
+  }
+  return -1;
+}
+
+bool FitnessEvaluator::setWeight(const std::string& name, double weight)
+{
+  if (!std::isfinite(weight) || weight < 0.0)
+    return false;
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  long long ind = termIndex(name);
+  if (ind < 0)
+    return false;
+
+  m_weights[ind] = weight;
+  return true;
+}
+
+double FitnessEvaluator::weight(const std::string& name) const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  long long ind = termIndex(name);
+  return (ind < 0) ? 0.0 : m_weights[ind];
+}
+
+double FitnessEvaluator::totalWeight() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  double sum = 0.0;
+  for (const auto& weight : m_weights)
+    sum += weight;
+  return sum;
+}
+
+QString FitnessEvaluator::weightsString() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  QStringList entries;
+  for (size_t i = 0; i < m_terms.size(); ++i) {
+    if (m_weights[i] > 0.0) {
+      entries.append(QString(m_terms[i]->name().c_str()) + ":" +
+                     QString::number(m_weights[i]));
+    }
+  }
+  return entries.join(", ");
+}
+
+bool FitnessEvaluator::setWeightsFromString(const QString& str)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  std::vector<double> weights(m_terms.size(), 0.0);
+
+  QStringList entries = str.split(",", QString::SkipEmptyParts);
+  for (const auto& entry : entries) {
+    QStringList split = entry.split(":");
+    bool ok = false;
+    double weight = (split.size() == 2) ? split[1].toDouble(&ok) : 0.0;
+    if (!ok || !std::isfinite(weight) || weight < 0.0) {
+      qDebug() << "Error in" << __FUNCTION__ << ": could not read fitness"
+               << "term weight:" << entry;
+      return false;
+    }
+
+    long long ind = termIndex(split[0].trimmed().toStdString());
+    if (ind < 0) {
+      qDebug() << "Error in" << __FUNCTION__ << ": unknown fitness term:"
+               << split[0].trimmed();
+      return false;
+    }
+    weights[ind] = weight;
+  }
+
+  m_weights = weights;
+  return true;
+}
+
+std::vector<FitnessEvaluator::ActiveTerm> FitnessEvaluator::evaluate(
+  const QList<Structure*>& structures)
+{
+  std::vector<ActiveTerm> ret;
+  // Indices of the active terms in m_terms
+  std::vector<size_t> active;
+  // Shared so that the terms survive if they are replaced meanwhile
+  std::vector<std::shared_ptr<FitnessTerm>> terms;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (size_t i = 0; i < m_terms.size(); ++i) {
+      if (m_weights[i] <= 0.0)
+        continue;
+
+      active.push_back(i);
+      terms.push_back(m_terms[i]);
+      ActiveTerm term;
+      term.name = m_terms[i]->name();
+      term.weight = m_weights[i];
+      term.higherIsBetter = m_terms[i]->higherIsBetter();
+      term.values.assign(structures.size(), NOT_EVALUATED);
+      ret.push_back(std::move(term));
+    }
+  }
+
+  if (active.empty()) {
+    clearCache();
+    return ret;
+  }
+
+  // Use the cache where we can and take snapshots of everything else
+  std::vector<Molecule> snapshots;
+  std::vector<size_t> snapshotInds;
+  std::vector<size_t> signatures;
+  for (int i = 0; i < structures.size(); ++i) {
+    Structure* s = structures[i];
+    QReadLocker structureLocker(&s->lock());
+    size_t signature = structureSignature(*s);
+
+    bool cached = false;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      auto it = m_cache.find(s);
+      if (it != m_cache.end() && it->second.signature == signature) {
+        cached = true;
+        const auto& values = it->second.values;
+        for (size_t j = 0; j < active.size(); ++j) {
+          if (active[j] >= values.size() || std::isnan(values[active[j]])) {
+            cached = false;
+            break;
+          }
+          ret[j].values[i] = values[active[j]];
+        }
+      }
+    }
+
+    if (!cached) {
+      snapshots.push_back(static_cast<const Molecule&>(*s));
+      snapshotInds.push_back(i);
+      signatures.push_back(signature);
+    }
+  }
+
+  // Drop the structures that were not given, since they are no longer in
+  // the population or have been deleted
+  {
+    std::unordered_set<const Structure*> current(structures.begin(),
+                                                 structures.end());
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (auto it = m_cache.begin(); it != m_cache.end();) {
+      if (current.count(it->first) == 0)
+        it = m_cache.erase(it);
+      else
+        ++it;
+    }
+  }
+
+  if (snapshots.empty())
+    return ret;
+
+  // Split the snapshots into one batch per thread. Each batch writes to
+  // its own elements of the value vectors.
+  size_t numBatches = std::max(1, m_threadPool.maxThreadCount());
+  size_t batchSize = (snapshots.size() + numBatches - 1) / numBatches;
+  QList<QFuture<void>> futures;
+  for (size_t start = 0; start < snapshots.size(); start += batchSize) {
+    size_t end = std::min(start + batchSize, snapshots.size());
+    futures.append(
+      QtConcurrent::run(&m_threadPool, [&, start, end]() {
+        std::vector<const Molecule*> batch;
+        for (size_t k = start; k < end; ++k)
+          batch.push_back(&snapshots[k]);
+
+        for (size_t j = 0; j < terms.size(); ++j) {
+          std::vector<double> values = terms[j]->evaluate(batch);
+          for (size_t k = start; k < end; ++k)
+            ret[j].values[snapshotInds[k]] = values[k - start];
+        }
+      }));
+  }
+
+  for (auto& future : futures)
+    future.waitForFinished();
+
+  // Store the new values
+  std::unique_lock<std::mutex> lock(m_mutex);
+  for (size_t k = 0; k < snapshotInds.size(); ++k) {
+    CacheEntry& entry = m_cache[structures[snapshotInds[k]]];
+    if (entry.signature != signatures[k] || entry.values.empty()) {
+      entry.signature = signatures[k];
+      entry.values.assign(m_terms.size(), NOT_EVALUATED);
+    }
+    entry.values.resize(m_terms.size(), NOT_EVALUATED);
+    for (size_t j = 0; j < active.size(); ++j) {
+      if (active[j] < entry.values.size())
+        entry.values[active[j]] = ret[j].values[snapshotInds[k]];
+    }
+  }
+
+  return ret;
+}
+
+void FitnessEvaluator::clearCache()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_cache.clear();
+}
+
+size_t FitnessEvaluator::cacheSize() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_cache.size();
+}
+}
@@ -0,0 +1,148 @@
+/**********************************************************************
+  FitnessEvaluator - Evaluates weighted fitness terms in batches and caches
+                     the results
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ ***********************************************************************/
+
+#ifndef GLOBALSEARCH_FITNESS_EVALUATOR_H
+#define GLOBALSEARCH_FITNESS_EVALUATOR_H
+
+#include <globalsearch/fitness/fitnessterm.h>
+
+#include <QList>
+#include <QString>
+#include <QThreadPool>
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace GlobalSearch {
+class Structure;
+
+/**
+ * @class FitnessEvaluator fitnessevaluator.h
+ *        <globalsearch/fitness/fitnessevaluator.h>
+ * @brief Owns the fitness terms and their weights, and evaluates the
+ *        active terms for lists of structures.
+ *
+ * A term is active when its weight is greater than zero. Evaluation takes
+ * a snapshot of each structure's geometry and runs the terms on a private
+ * thread pool. Results are cached per structure along with a signature of
+ * its generation, ID and geometry, so a structure is only evaluated again
+ * if it changes. Each evaluation drops the cached values of structures
+ * that it was not given, so the cache only holds the current population.
+ *
+ * The density and pair potential terms are always registered. Others may
+ * be added with addTerm().
+ */
+class FitnessEvaluator
+{
+public:
+  FitnessEvaluator();
+
+  /**
+   * Add a term. The evaluator takes ownership of it. A term with the same
+   * name is replaced.
+   */
+  void addTerm(std::unique_ptr<FitnessTerm> term, double weight = 0.0);
+
+  size_t numTerms() const;
+
+  /**
+   * The names of all terms in the order they were added.
+   */
+  std::vector<std::string> termNames() const;
+
+  /**
+   * Set the weight of the term named @p name. Returns false if there is no
+   * such term or if the weight is negative or not finite.
+   */
+  bool setWeight(const std::string& name, double weight);
+
+  /**
+   * The weight of the term named @p name. 0 if there is no such term.
+   */
+  double weight(const std::string& name) const;
+
+  /**
+   * The sum of the weights of all terms.
+   */
+  double totalWeight() const;
+
+  /**
+   * Whether any term has a nonzero weight.
+   */
+  bool hasActiveTerms() const { return totalWeight() > 0.0; }
+
+  /**
+   * The weights of the active terms as a string of comma-separated
+   * "name:weight" pairs. Used for the fitnessTermWeights option.
+   */
+  QString weightsString() const;
+
+  /**
+   * Set the weights from a string produced by weightsString(). Terms that
+   * are not listed get a weight of zero. Returns false if a name is
+   * unknown or an entry could not be read.
+   */
+  bool setWeightsFromString(const QString& str);
+
+  /**
+   * A term that is active along with its weight and values.
+   */
+  struct ActiveTerm
+  {
+    std::string name;
+    double weight;
+    bool higherIsBetter;
+    // One value for each structure that was evaluated
+    std::vector<double> values;
+  };
+
+  /**
+   * Evaluate the active terms for @p structures. Cached values are used
+   * where possible. Must not be called while holding a lock on any of the
+   * structures.
+   */
+  std::vector<ActiveTerm> evaluate(const QList<Structure*>& structures);
+
+  /**
+   * Remove all cached values.
+   */
+  void clearCache();
+
+  /**
+   * The number of structures with cached values.
+   */
+  size_t cacheSize() const;
+
+private:
+  struct CacheEntry
+  {
+    size_t signature;
+    // Indexed like m_terms. NaN means not evaluated.
+    std::vector<double> values;
+  };
+
+  long long termIndex(const std::string& name) const;
+
+  std::vector<std::shared_ptr<FitnessTerm>> m_terms;
+  std::vector<double> m_weights;
+  std::unordered_map<const Structure*, CacheEntry> m_cache;
+  mutable std::mutex m_mutex;
+  QThreadPool m_threadPool;
+};
+}
+
+#endif // GLOBALSEARCH_FITNESS_EVALUATOR_H
@@ -0,0 +1,72 @@
+/**********************************************************************
+  FitnessTerm - An in-process contribution to the fitness function
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ ***********************************************************************/
+
+#ifndef GLOBALSEARCH_FITNESS_TERM_H
+#define GLOBALSEARCH_FITNESS_TERM_H
+
+#include <string>
+#include <vector>
+
+namespace GlobalSearch {
+class Molecule;
+
+/**
+ * @class FitnessTerm fitnessterm.h <globalsearch/fitness/fitnessterm.h>
+ * @brief A property of a structure that may be weighted into the fitness
+ *        used for parent selection.
+ *
+ * Terms are evaluated by the FitnessEvaluator on worker threads, on copies
+ * of the structures' geometries, so implementations must not touch any
+ * shared state. They must not perform any network or subprocess calls
+ * either, since they are evaluated on the selection path.
+ */
+class FitnessTerm
+{
+public:
+  virtual ~FitnessTerm() = default;
+
+  /**
+   * A unique name for the term. This is used in settings and in the
+   * fitnessTermWeights option.
+   */
+  virtual std::string name() const = 0;
+
+  /**
+   * Whether larger values of this term are more favorable.
+   */
+  virtual bool higherIsBetter() const = 0;
+
+  /**
+   * Evaluate the term for a single structure.
+   */
+  virtual double evaluate(const Molecule& mol) const = 0;
+
+  /**
+   * Evaluate the term for a batch of structures. The default
+   * implementation calls evaluate() on each one. Terms with expensive
+   * setup may override this to share the setup across the batch.
+   */
+  virtual std::vector<double> evaluate(
+    const std::vector<const Molecule*>& batch) const
+  {
+    std::vector<double> ret;
+    ret.reserve(batch.size());
+    for (const auto& mol : batch)
+      ret.push_back(evaluate(*mol));
+    return ret;
+  }
+};
+}
+
+#endif // GLOBALSEARCH_FITNESS_TERM_H
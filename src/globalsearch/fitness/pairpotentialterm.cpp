@@ -0,0 +1,87 @@
+/**********************************************************************
+  PairPotentialTerm - A fitness term for a quick pair-potential estimate of
+                      the stability of a structure
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ ***********************************************************************/
+
+#include <globalsearch/fitness/pairpotentialterm.h>
+
+#include <globalsearch/eleminfo.h>
+#include <globalsearch/structures/molecule.h>
+
+#include <cmath>
+
+namespace GlobalSearch {
+
+double PairPotentialTerm::evaluate(const Molecule& mol) const
+{
+  const auto& atoms = mol.atoms();
+  if (atoms.empty())
+    return 0.0;
+
+  std::vector<double> radii;
+  radii.reserve(atoms.size());
+  double maxRadius = 0.0;
+  for (const auto& atom : atoms) {
+    radii.push_back(ElemInfo::getCovalentRadius(atom.atomicNumber()));
+    maxRadius = std::max(maxRadius, radii.back());
+  }
+
+  const double maxCutoff = m_cutoffFactor * 2.0 * maxRadius;
+
+  // The lattice translations that may contain a neighbor within the cutoff
+  std::vector<Vector3> translations;
+  if (mol.hasUnitCell()) {
+    const UnitCell& cell = mol.unitCell();
+    const double volume = cell.volume();
+    const Vector3 a = cell.aVector(), b = cell.bVector(), c = cell.cVector();
+    // The number of images needed along each vector is the cutoff over the
+    // distance between the lattice planes
+    int na = std::ceil(maxCutoff * b.cross(c).norm() / volume);
+    int nb = std::ceil(maxCutoff * c.cross(a).norm() / volume);
+    int nc = std::ceil(maxCutoff * a.cross(b).norm() / volume);
+    for (int i = -na; i <= na; ++i) {
+      for (int j = -nb; j <= nb; ++j) {
+        for (int k = -nc; k <= nc; ++k)
+          translations.push_back(i * a + j * b + k * c);
+      }
+    }
+  } else {
+    translations.push_back(Vector3(0.0, 0.0, 0.0));
+  }
+
+  // Each unordered pair is counted once, so self images and (i, j) pairs
+  // are each weighted by one half.
+  double energy = 0.0;
+  for (size_t i = 0; i < atoms.size(); ++i) {
+    for (size_t j = i; j < atoms.size(); ++j) {
+      // Distance where the potential is at its minimum
+      double rMin = radii[i] + radii[j];
+      double cutoff = m_cutoffFactor * rMin;
+      double cutoffSquared = cutoff * cutoff;
+      double factor = (i == j) ? 0.5 : 1.0;
+      Vector3 diff = atoms[j].pos() - atoms[i].pos();
+      for (const auto& t : translations) {
+        double rSquared = (diff + t).squaredNorm();
+        if (rSquared > cutoffSquared || rSquared < 1.0e-8)
+          continue;
+
+        // (rMin / r)^6
+        double s6 = std::pow(rMin * rMin / rSquared, 3);
+        energy += factor * (s6 * s6 - 2.0 * s6);
+      }
+    }
+  }
+
+  return energy / atoms.size();
+}
+}
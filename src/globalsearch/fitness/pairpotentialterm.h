@@ -0,0 +1,55 @@
+/**********************************************************************
+  PairPotentialTerm - A fitness term for a quick pair-potential estimate of
+                      the stability of a structure
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ ***********************************************************************/
+
+#ifndef GLOBALSEARCH_PAIR_POTENTIAL_TERM_H
+#define GLOBALSEARCH_PAIR_POTENTIAL_TERM_H
+
+#include <globalsearch/fitness/fitnessterm.h>
+
+namespace GlobalSearch {
+
+/**
+ * @class PairPotentialTerm pairpotentialterm.h
+ *        <globalsearch/fitness/pairpotentialterm.h>
+ * @brief The Lennard-Jones energy per atom in reduced units.
+ *
+ * Each pair has unit well depth and its minimum at the sum of the
+ * covalent radii of the two atoms. Periodic images within the cutoff
+ * are included when the structure has a unit cell. Lower energies are
+ * favored.
+ */
+class PairPotentialTerm : public FitnessTerm
+{
+public:
+  /**
+   * @param cutoffFactor Pairs farther apart than this many times the sum
+   *                     of their covalent radii are ignored.
+   */
+  explicit PairPotentialTerm(double cutoffFactor = 2.5)
+    : m_cutoffFactor(cutoffFactor)
+  {
+  }
+
+  std::string name() const override { return "pairPotential"; }
+  bool higherIsBetter() const override { return false; }
+  using FitnessTerm::evaluate;
+  double evaluate(const Molecule& mol) const override;
+
+private:
+  double m_cutoffFactor;
+};
+}
+
+#endif // GLOBALSEARCH_PAIR_POTENTIAL_TERM_H
@@ -0,0 +1,277 @@
+/**********************************************************************
+  ParetoSelector - Ranks structures by Pareto fronts over any number of
+                   objectives and selects parents from them
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ ***********************************************************************/
+
+#include <globalsearch/fitness/paretoselector.h>
+
+#include <globalsearch/random.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_set>
+
+namespace GlobalSearch {
+
+static const double INF = std::numeric_limits<double>::infinity();
+
+// Does @p a dominate @p b? Both must have the same size.
+static bool dominates(const std::vector<double>& a,
+                      const std::vector<double>& b)
+{
+  bool better = false;
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (a[i] > b[i])
+      return false;
+    if (a[i] < b[i])
+      better = true;
+  }
+  return better;
+}
+
+ParetoSelector::ParetoSelector() : m_populationSize(0), m_dirty(false)
+{
+}
+
+void ParetoSelector::update(Structure* s, const std::vector<double>& objectives)
+{
+  std::vector<double> values(objectives);
+  for (auto& value : values) {
+    if (std::isnan(value))
+      value = INF;
+  }
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  Entry& entry = m_entries[s];
+  if (entry.front != -1 && entry.objectives == values)
+    return;
+
+  entry.objectives.swap(values);
+  entry.front = -1;
+  m_dirty = true;
+}
+
+void ParetoSelector::remove(Structure* s)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (m_entries.erase(s) != 0)
+    m_dirty = true;
+}
+
+void ParetoSelector::sync(const std::vector<Structure*>& structures,
+                          const std::vector<std::vector<double>>& objectives)
+{
+  for (size_t i = 0; i < structures.size() && i < objectives.size(); ++i)
+    update(structures[i], objectives[i]);
+
+  std::unordered_set<Structure*> keep(structures.begin(), structures.end());
+  std::unique_lock<std::mutex> lock(m_mutex);
+  for (auto it = m_entries.begin(); it != m_entries.end();) {
+    if (keep.count(it->first) == 0) {
+      it = m_entries.erase(it);
+      m_dirty = true;
+    } else {
+      ++it;
+    }
+  }
+}
+
+void ParetoSelector::clear()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_entries.clear();
+  m_ordered.clear();
+  m_frontSizes.clear();
+  m_dirty = false;
+}
+
+size_t ParetoSelector::size() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_entries.size();
+}
+
+size_t ParetoSelector::populationSize() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_populationSize;
+}
+
+void ParetoSelector::setPopulationSize(size_t size)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_populationSize = size;
+}
+
+long long ParetoSelector::front(Structure* s) const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  updateFrontsLocked();
+  auto it = m_entries.find(s);
+  return it == m_entries.end() ? -1 : it->second.front;
+}
+
+double ParetoSelector::crowdingDistance(Structure* s) const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  updateFrontsLocked();
+  auto it = m_entries.find(s);
+  return it == m_entries.end() ? -1.0 : it->second.crowding;
+}
+
+std::vector<std::vector<Structure*>> ParetoSelector::fronts() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  updateFrontsLocked();
+
+  std::vector<std::vector<Structure*>> ret;
+  auto it = m_ordered.begin();
+  for (size_t frontSize : m_frontSizes) {
+    ret.push_back(std::vector<Structure*>(it, it + frontSize));
+    it += frontSize;
+  }
+  return ret;
+}
+
+Structure* ParetoSelector::select(double r1, double r2) const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  updateFrontsLocked();
+  if (m_ordered.empty())
+    return nullptr;
+
+  size_t n = m_ordered.size();
+  if (m_populationSize != 0 && m_populationSize < n)
+    n = m_populationSize;
+
+  // The population is in order of preference, so the lower index wins
+  size_t i = std::min(static_cast<size_t>(r1 * n), n - 1);
+  size_t j = std::min(static_cast<size_t>(r2 * n), n - 1);
+  return m_ordered[std::min(i, j)];
+}
+
+Structure* ParetoSelector::select() const
+{
+  double r1 = getRandDouble();
+  double r2 = getRandDouble();
+  return select(r1, r2);
+}
+
+void ParetoSelector::updateFrontsLocked() const
+{
+  if (!m_dirty)
+    return;
+  m_dirty = false;
+
+  std::vector<std::pair<Structure*, Entry*>> points;
+  points.reserve(m_entries.size());
+  for (auto& entry : m_entries)
+    points.push_back(std::make_pair(entry.first, &entry.second));
+
+  // Sorting lexicographically means that no point can be dominated by a
+  // point after it
+  std::sort(points.begin(), points.end(),
+            [](const std::pair<Structure*, Entry*>& a,
+               const std::pair<Structure*, Entry*>& b) {
+              return a.second->objectives < b.second->objectives;
+            });
+
+  // Each front is kept in the order its points were added
+  std::vector<std::vector<Entry*>> fronts;
+  std::vector<std::vector<Structure*>> frontStructures;
+  for (const auto& point : points) {
+    const std::vector<double>& objectives = point.second->objectives;
+
+    // Is the point dominated by anything in front k? Check the last
+    // points first since they are the most likely to dominate it.
+    auto dominatedBy = [&](size_t k) {
+      const std::vector<Entry*>& front = fronts[k];
+      // With two objectives, the last point in the front has the smallest
+      // second objective, so it is the only one that needs to be checked
+      if (objectives.size() == 2)
+        return dominates(front.back()->objectives, objectives);
+      for (auto it = front.rbegin(); it != front.rend(); ++it) {
+        if (dominates((*it)->objectives, objectives))
+          return true;
+      }
+      return false;
+    };
+
+    // If a point is dominated by something in front k, it is dominated by
+    // something in every front before k. So the fronts may be bisected.
+    size_t low = 0, high = fronts.size();
+    while (low < high) {
+      size_t mid = low + (high - low) / 2;
+      if (dominatedBy(mid))
+        low = mid + 1;
+      else
+        high = mid;
+    }
+
+    if (low == fronts.size()) {
+      fronts.push_back(std::vector<Entry*>());
+      frontStructures.push_back(std::vector<Structure*>());
+    }
+    fronts[low].push_back(point.second);
+    frontStructures[low].push_back(point.first);
+    point.second->front = low;
+  }
+
+  m_ordered.clear();
+  m_frontSizes.clear();
+  for (size_t k = 0; k < fronts.size(); ++k) {
+    std::vector<Entry*>& front = fronts[k];
+    const size_t size = front.size();
+    for (Entry* entry : front)
+      entry->crowding = 0.0;
+
+    // Sum the normalized distances between the neighbors of each point in
+    // each objective
+    const size_t numObjectives = front[0]->objectives.size();
+    std::vector<size_t> order(size);
+    for (size_t m = 0; m < numObjectives; ++m) {
+      for (size_t i = 0; i < size; ++i)
+        order[i] = i;
+      std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return front[a]->objectives[m] < front[b]->objectives[m];
+      });
+
+      front[order.front()]->crowding = INF;
+      front[order.back()]->crowding = INF;
+      const double spread = front[order.back()]->objectives[m] -
+                            front[order.front()]->objectives[m];
+      if (spread <= 0.0 || !std::isfinite(spread))
+        continue;
+
+      for (size_t i = 1; i + 1 < size; ++i) {
+        front[order[i]]->crowding += (front[order[i + 1]]->objectives[m] -
+                                      front[order[i - 1]]->objectives[m]) /
+                                     spread;
+      }
+    }
+
+    // Less crowded points come first
+    std::vector<size_t> byCrowding(size);
+    for (size_t i = 0; i < size; ++i)
+      byCrowding[i] = i;
+    std::stable_sort(byCrowding.begin(), byCrowding.end(),
+                     [&](size_t a, size_t b) {
+                       return front[a]->crowding > front[b]->crowding;
+                     });
+    for (size_t i : byCrowding)
+      m_ordered.push_back(frontStructures[k][i]);
+    m_frontSizes.push_back(size);
+  }
+}
+}
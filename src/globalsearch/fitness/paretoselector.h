@@ -0,0 +1,144 @@
+/**********************************************************************
+  ParetoSelector - Ranks structures by Pareto fronts over any number of
+                   objectives and selects parents from them
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ ***********************************************************************/
+
+#ifndef GLOBALSEARCH_PARETO_SELECTOR_H
+#define GLOBALSEARCH_PARETO_SELECTOR_H
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace GlobalSearch {
+class Structure;
+
+/**
+ * @class ParetoSelector paretoselector.h
+ *        <globalsearch/fitness/paretoselector.h>
+ * @brief Keeps the non-dominated fronts and crowding distances of a set of
+ *        structures, and draws parents from them by binary tournament.
+ *
+ * Each structure has a vector of objectives, all of which are minimized.
+ * Negate an objective that should be maximized. Structure a dominates
+ * structure b if a is no worse in every objective and better in at least
+ * one. Front 0 holds the structures that nothing dominates, front 1 those
+ * that only front 0 dominates, and so on.
+ *
+ * The fronts are sorted with the efficient non-dominated sort with binary
+ * search (ENS-BS). It takes O(N log N) for two objectives. The fronts are
+ * only sorted again when an objective actually changed, and only when they
+ * are next needed. Structures that finish between two selections cost one
+ * sort. Repeated selections from an unchanged set cost nothing more.
+ *
+ * The population is the best populationSize() structures. They are ordered
+ * by front, and then by larger crowding distance within a front, as in
+ * NSGA-II. select() runs a binary tournament in that population in
+ * constant time.
+ *
+ * All functions are thread safe.
+ */
+class ParetoSelector
+{
+public:
+  ParetoSelector();
+
+  /**
+   * Set the objectives of @p s, adding it if it is new. NaN is treated as
+   * the worst possible value.
+   */
+  void update(Structure* s, const std::vector<double>& objectives);
+
+  /**
+   * Remove @p s. Does nothing if it is not here.
+   */
+  void remove(Structure* s);
+
+  /**
+   * Make the set of structures match @p structures, with the objectives
+   * at the same indices in @p objectives. Structures that are not listed
+   * are removed.
+   */
+  void sync(const std::vector<Structure*>& structures,
+            const std::vector<std::vector<double>>& objectives);
+
+  /**
+   * Remove all structures.
+   */
+  void clear();
+
+  size_t size() const;
+
+  /**
+   * The number of structures that select() draws from. 0 means all of
+   * them.
+   */
+  size_t populationSize() const;
+  void setPopulationSize(size_t size);
+
+  /**
+   * The front of @p s, starting from 0. -1 if @p s is not here.
+   */
+  long long front(Structure* s) const;
+
+  /**
+   * The crowding distance of @p s in its front. The structures at the ends
+   * of a front have an infinite distance. -1 if @p s is not here.
+   */
+  double crowdingDistance(Structure* s) const;
+
+  /**
+   * The structures in each front, ordered by decreasing crowding distance.
+   */
+  std::vector<std::vector<Structure*>> fronts() const;
+
+  /**
+   * Draw a parent from the population by binary tournament. @p r1 and
+   * @p r2 pick the two contestants and should be random numbers in [0, 1).
+   * The better one by front and crowding distance wins.
+   *
+   * @return The parent, or nullptr if there are no structures.
+   */
+  Structure* select(double r1, double r2) const;
+
+  /**
+   * Same as select(double, double), using the random number generator of
+   * libglobalsearch.
+   */
+  Structure* select() const;
+
+private:
+  struct Entry
+  {
+    std::vector<double> objectives;
+    long long front = -1;
+    double crowding = 0.0;
+  };
+
+  // Sort the fronts again if anything changed. m_mutex must be locked.
+  void updateFrontsLocked() const;
+
+  mutable std::mutex m_mutex;
+  mutable std::unordered_map<Structure*, Entry> m_entries;
+  size_t m_populationSize;
+
+  // Set when an objective changed since the fronts were last sorted
+  mutable bool m_dirty;
+  // The structures ordered by front, and then by decreasing crowding
+  mutable std::vector<Structure*> m_ordered;
+  // The number of structures in each front
+  mutable std::vector<size_t> m_frontSizes;
+};
+}
+
+#endif // GLOBALSEARCH_PARETO_SELECTOR_H
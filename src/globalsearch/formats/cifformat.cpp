@@ -0,0 +1,421 @@
+/**********************************************************************
+  CifFormat -- A simple reader and writer for the CIF format.
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ ***********************************************************************/
+
+#include "cifformat.h"
+
+#include <globalsearch/eleminfo.h>
+#include <globalsearch/structure.h>
+#include <globalsearch/utilities/utilityfunctions.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+namespace GlobalSearch {
+
+namespace {
+
+// A loop_ of the data block. The values are in row-major order.
+struct CifLoop
+{
+  vector<string> tags;
+  vector<string> values;
+
+  // The column of @p tag, or -1 if it is not here
+  int column(const string& tag) const
+  {
+    for (size_t i = 0; i < tags.size(); ++i) {
+      if (tags[i] == tag)
+        return static_cast<int>(i);
+    }
+    return -1;
+  }
+
+  size_t numRows() const
+  {
+    return tags.empty() ? 0 : values.size() / tags.size();
+  }
+
+  const string& value(size_t row, int col) const
+  {
+    return values[row * tags.size() + col];
+  }
+};
+
+string toLower(string s)
+{
+  std::transform(s.begin(), s.end(), s.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return s;
+}
+
+// Splits the first data block of a CIF into tokens. Quoted strings and
+// semicolon text fields are single tokens, and comments are dropped.
+vector<string> tokenize(std::istream& in)
+{
+  vector<string> tokens;
+  bool inBlock = false;
+  string line;
+  while (std::getline(in, line)) {
+    if (!line.empty() && line.back() == '\r')
+      line.pop_back();
+
+    // Semicolon text field
+    if (!line.empty() && line[0] == ';') {
+      string text = line.substr(1);
+      while (std::getline(in, line) && (line.empty() || line[0] != ';'))
+        text += "\n" + line;
+      tokens.push_back(text);
+      continue;
+    }
+
+    size_t i = 0;
+    while (i < line.size()) {
+      if (std::isspace(static_cast<unsigned char>(line[i]))) {
+        ++i;
+        continue;
+      }
+      if (line[i] == '#')
+        break;
+
+      string token;
+      if (line[i] == '\'' || line[i] == '"') {
+        // A quote only ends a token if whitespace follows it
+        const char quote = line[i];
+        size_t end = i + 1;
+        while (end < line.size() &&
+               !(line[end] == quote &&
+                 (end + 1 == line.size() ||
+                  std::isspace(static_cast<unsigned char>(line[end + 1])))))
+          ++end;
+        token = line.substr(i + 1, end - i - 1);
+        i = end + 1;
+      } else {
+        size_t end = i;
+        while (end < line.size() &&
+               !std::isspace(static_cast<unsigned char>(line[end])))
+          ++end;
+        token = line.substr(i, end - i);
+        i = end;
+
+        if (toLower(token.substr(0, 5)) == "data_") {
+          // Only read the first data block
+          if (inBlock)
+            return tokens;
+          inBlock = true;
+          continue;
+        }
+      }
+      tokens.push_back(token);
+    }
+  }
+  return tokens;
+}
+
+// A number without its standard uncertainty, as in "2.5221(3)"
+double toDouble(const string& s)
+{
+  return atof(s.substr(0, s.find('(')).c_str());
+}
+
+// Parses a symmetry operation such as "-x+1/2,y,z" into a rotation and a
+// translation in fractional coordinates
+bool parseSymmetryOperation(const string& op, Matrix3& rot, Vector3& trans)
+{
+  vector<string> rows = split(removeSpaces(toLower(op)), ',');
+  if (rows.size() != 3)
+    return false;
+
+  rot.setZero();
+  trans.setZero();
+  for (size_t i = 0; i < 3; ++i) {
+    const string& row = rows[i];
+    size_t pos = 0;
+    while (pos < row.size()) {
+      double sign = 1.0;
+      if (row[pos] == '+' || row[pos] == '-') {
+        sign = (row[pos] == '-') ? -1.0 : 1.0;
+        ++pos;
+      }
+      if (pos >= row.size())
+        return false;
+
+      if (row[pos] >= 'x' && row[pos] <= 'z') {
+        rot(i, row[pos] - 'x') += sign;
+        ++pos;
+        continue;
+      }
+
+      // A number, possibly a fraction
+      size_t end = pos;
+      while (end < row.size() && (std::isdigit(row[end]) || row[end] == '.'))
+        ++end;
+      if (end == pos)
+        return false;
+      double value = atof(row.substr(pos, end - pos).c_str());
+      pos = end;
+      if (pos < row.size() && row[pos] == '/') {
+        ++pos;
+        end = pos;
+        while (end < row.size() && std::isdigit(row[end]))
+          ++end;
+        const double denom = atof(row.substr(pos, end - pos).c_str());
+        if (end == pos || denom == 0.0)
+          return false;
+        value /= denom;
+        pos = end;
+      }
+
+      // A coefficient, as in "2x"
+      if (pos < row.size() && row[pos] >= 'x' && row[pos] <= 'z') {
+        rot(i, row[pos] - 'x') += sign * value;
+        ++pos;
+      } else {
+        trans[i] += sign * value;
+      }
+    }
+  }
+  return true;
+}
+
+// The element of an atom site label or type symbol such as "Ti1" or "O2-"
+unsigned int atomicNumberFromLabel(const string& label)
+{
+  string symbol;
+  for (char c : label) {
+    if (!std::isalpha(static_cast<unsigned char>(c)) || symbol.size() == 2)
+      break;
+    symbol += c;
+  }
+
+  while (!symbol.empty()) {
+    unsigned int atomicNum = ElemInfo::getAtomicNum(symbol);
+    if (atomicNum != 0)
+      return atomicNum;
+    symbol.pop_back();
+  }
+  return 0;
+}
+
+double wrap(double x)
+{
+  x -= std::floor(x);
+  return x >= 1.0 ? 0.0 : x;
+}
+}
+
+bool CifFormat::read(Structure& s, std::istream& in)
+{
+  s.clear();
+  s.resetEnergy();
+  s.resetEnthalpy();
+
+  vector<string> tokens = tokenize(in);
+
+  std::map<string, string> items;
+  vector<CifLoop> loops;
+  for (size_t i = 0; i < tokens.size();) {
+    if (toLower(tokens[i]) == "loop_") {
+      CifLoop loop;
+      ++i;
+      while (i < tokens.size() && tokens[i][0] == '_')
+        loop.tags.push_back(toLower(tokens[i++]));
+      while (i < tokens.size() && tokens[i][0] != '_' &&
+             toLower(tokens[i]) != "loop_") {
+        loop.values.push_back(tokens[i++]);
+      }
+      if (!loop.tags.empty() && loop.values.size() % loop.tags.size() != 0) {
+        std::cerr << "Error reading CIF: a loop has an incomplete row\n";
+        return false;
+      }
+      loops.push_back(loop);
+    } else if (tokens[i][0] == '_' && i + 1 < tokens.size()) {
+      items[toLower(tokens[i])] = tokens[i + 1];
+      i += 2;
+    } else {
+      ++i;
+    }
+  }
+
+  // Unit cell
+  const char* cellTags[] = { "_cell_length_a",    "_cell_length_b",
+                             "_cell_length_c",    "_cell_angle_alpha",
+                             "_cell_angle_beta",  "_cell_angle_gamma" };
+  double params[6];
+  for (size_t i = 0; i < 6; ++i) {
+    auto it = items.find(cellTags[i]);
+    if (it == items.end()) {
+      std::cerr << "Error reading CIF: " << cellTags[i] << " is missing\n";
+      return false;
+    }
+    params[i] = toDouble(it->second);
+  }
+  s.unitCell().setCellParameters(params[0], params[1], params[2], params[3],
+                                 params[4], params[5]);
+  if (!s.hasUnitCell()) {
+    std::cerr << "Error reading CIF: the unit cell is invalid\n";
+    return false;
+  }
+
+  // Symmetry operations. Without any, the structure is in P1.
+  vector<std::pair<Matrix3, Vector3>> ops;
+  for (const auto& loop : loops) {
+    int col = loop.column("_symmetry_equiv_pos_as_xyz");
+    if (col < 0)
+      col = loop.column("_space_group_symop_operation_xyz");
+    if (col < 0)
+      continue;
+    for (size_t row = 0; row < loop.numRows(); ++row) {
+      Matrix3 rot;
+      Vector3 trans;
+      if (!parseSymmetryOperation(loop.value(row, col), rot, trans)) {
+        std::cerr << "Error reading CIF: cannot read the symmetry operation "
+                  << loop.value(row, col) << "\n";
+        return false;
+      }
+      ops.push_back(std::make_pair(rot, trans));
+    }
+    break;
+  }
+  if (ops.empty())
+    ops.push_back(std::make_pair(Matrix3::Identity(), Vector3::Zero()));
+
+  // Atom sites
+  const CifLoop* sites = nullptr;
+  for (const auto& loop : loops) {
+    if (loop.column("_atom_site_fract_x") >= 0) {
+      sites = &loop;
+      break;
+    }
+  }
+  if (!sites) {
+    std::cerr << "Error reading CIF: no fractional atom sites were found\n";
+    return false;
+  }
+
+  const int xCol = sites->column("_atom_site_fract_x");
+  const int yCol = sites->column("_atom_site_fract_y");
+  const int zCol = sites->column("_atom_site_fract_z");
+  int typeCol = sites->column("_atom_site_type_symbol");
+  if (typeCol < 0)
+    typeCol = sites->column("_atom_site_label");
+  if (yCol < 0 || zCol < 0 || typeCol < 0) {
+    std::cerr << "Error reading CIF: the atom sites are incomplete\n";
+    return false;
+  }
+
+  // Two images of a site closer than this are the same atom
+  const double tol = 1.0e-3;
+  for (size_t row = 0; row < sites->numRows(); ++row) {
+    const unsigned int atomicNum =
+      atomicNumberFromLabel(sites->value(row, typeCol));
+    if (atomicNum == 0) {
+      std::cerr << "Error reading CIF: unknown element in "
+                << sites->value(row, typeCol) << "\n";
+      return false;
+    }
+
+    const Vector3 site(toDouble(sites->value(row, xCol)),
+                       toDouble(sites->value(row, yCol)),
+                       toDouble(sites->value(row, zCol)));
+
+    vector<Vector3> images;
+    for (const auto& op : ops) {
+      Vector3 image = op.first * site + op.second;
+      for (size_t i = 0; i < 3; ++i)
+        image[i] = wrap(image[i]);
+
+      bool duplicate = false;
+      for (const auto& other : images) {
+        Vector3 diff = image - other;
+        for (size_t i = 0; i < 3; ++i)
+          diff[i] -= std::round(diff[i]);
+        if (diff.cwiseAbs().maxCoeff() < tol) {
+          duplicate = true;
+          break;
+        }
+      }
+      if (duplicate)
+        continue;
+
+      images.push_back(image);
+      s.addAtom(atomicNum, s.unitCell().toCartesian(image));
+    }
+  }
+
+  return true;
+}
+
+bool CifFormat::write(const Structure& s, std::ostream& out)
+{
+  const UnitCell& cell = s.unitCell();
+  if (!cell.isValid()) {
+    std::cerr << "Error writing CIF: the structure has no unit cell\n";
+    return false;
+  }
+
+  // The formula, by element symbol
+  std::map<string, size_t> counts;
+  for (const auto& atom : s.atoms())
+    ++counts[ElemInfo::getAtomicSymbol(atom.atomicNumber())];
+  string formula;
+  for (const auto& count : counts)
+    formula += count.first + std::to_string(count.second);
+
+  char buffer[256];
+  out << "# CIF file generated by XtalOpt\n"
+      << "data_I\n"
+      << "_chemical_name_common '" << formula << "'\n";
+  snprintf(buffer, sizeof(buffer),
+           "_cell_length_a %.6f\n_cell_length_b %.6f\n_cell_length_c %.6f\n"
+           "_cell_angle_alpha %.6f\n_cell_angle_beta %.6f\n"
+           "_cell_angle_gamma %.6f\n",
+           cell.a(), cell.b(), cell.c(), cell.alpha(), cell.beta(),
+           cell.gamma());
+  out << buffer
+      << "_space_group_name_H-M_alt 'P 1'\n"
+      << "_space_group_name_Hall 'P 1'\n"
+      << "loop_\n"
+      << "    _symmetry_equiv_pos_as_xyz\n"
+      << "    x,y,z\n"
+      << "loop_\n"
+      << "    _atom_site_label\n"
+      << "    _atom_site_type_symbol\n"
+      << "    _atom_site_fract_x\n"
+      << "    _atom_site_fract_y\n"
+      << "    _atom_site_fract_z\n"
+      << "    _atom_site_occupancy\n";
+
+  for (size_t i = 0; i < s.numAtoms(); ++i) {
+    const Atom& atom = s.atom(i);
+    const string symbol = ElemInfo::getAtomicSymbol(atom.atomicNumber());
+    const string label = symbol + std::to_string(i);
+    const Vector3 frac = cell.toFractional(atom.pos());
+    snprintf(buffer, sizeof(buffer),
+             "    %-7s %-4s %9.5f %9.5f %9.5f %7.3f\n", label.c_str(),
+             symbol.c_str(), frac.x(), frac.y(), frac.z(), 1.0);
+    out << buffer;
+  }
+
+  return static_cast<bool>(out);
+}
+}
@@ -0,0 +1,44 @@
+/**********************************************************************
+  CifFormat -- A simple reader and writer for the CIF format.
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ ***********************************************************************/
+
+#ifndef GLOBALSEARCH_CIF_FORMAT_H
+#define GLOBALSEARCH_CIF_FORMAT_H
+
+#include <istream>
+#include <ostream>
+
+namespace GlobalSearch {
+class Structure;
+
+/**
+ * @class CifFormat cifformat.h
+ * @brief Implementation of the Crystallographic Information File format.
+ *
+ * Only the first data block is read. The cell, the symmetry operations
+ * (as "x,y,z" expressions) and the fractional coordinates of the atom
+ * sites are used. Atoms that the symmetry operations place on top of each
+ * other are only added once.
+ *
+ * The writer writes the structure in P1, in the same layout as Open
+ * Babel, which is what genXrdPattern has always been given.
+ */
+class CifFormat
+{
+public:
+  static bool read(Structure& s, std::istream& in);
+  static bool write(const Structure& s, std::ostream& out);
+};
+}
+
+#endif // GLOBALSEARCH_CIF_FORMAT_H
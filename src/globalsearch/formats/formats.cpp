@@ -16,12 +16,14 @@
 #include <globalsearch/utilities/utilityfunctions.h>
 
 #include <globalsearch/formats/castepformat.h>
+#include <globalsearch/formats/cifformat.h>
 #include <globalsearch/formats/cmlformat.h>
 #include <globalsearch/formats/formats.h>
 #include <globalsearch/formats/genericformat.h>
 #include <globalsearch/formats/gulpformat.h>
 #include <globalsearch/formats/poscarformat.h>
 #include <globalsearch/formats/pwscfformat.h>
+#include <globalsearch/formats/sdfformat.h>
 #include <globalsearch/formats/siestaformat.h>
 #include <globalsearch/formats/vaspformat.h>
 #include <globalsearch/formats/xyzformat.h>
@@ -39,15 +41,17 @@ using std::string;
 using std::vector;
 
 // The list of possible formats
-static const vector<string> _formats = { "CASTEP", "CML",   "GULP",
-                                         "POSCAR", "PWSCF", "SIESTA",
-                                         "VASP",   "XYZ",   "ZMATRIX" };
+static const vector<string> _formats = { "CASTEP", "CIF",    "CML",
+                                         "GULP",   "POSCAR", "PWSCF",
+                                         "SDF",    "SIESTA", "VASP",
+                                         "XYZ",    "ZMATRIX" };
 
 // The map of the formats and their extensions
 static const vector<pair<string, string>> _formatExtensions = {
-  make_pair("castep", "CASTEP"), make_pair("cml", "CML"),
-  make_pair("got", "GULP"), make_pair("gout", "GULP"),
-  make_pair("xyz", "XYZ")
+  make_pair("castep", "CASTEP"), make_pair("cif", "CIF"),
+  make_pair("cml", "CML"),       make_pair("got", "GULP"),
+  make_pair("gout", "GULP"),     make_pair("mol", "SDF"),
+  make_pair("sdf", "SDF"),       make_pair("xyz", "XYZ")
 };
 
 namespace GlobalSearch {
@@ -82,6 +86,15 @@ bool Formats::read(Structure* s, const QString& filename, const QString& format)
   if (format.toUpper() == QString("CASTEP"))
     return CastepFormat::read(s, filename);
 
+  if (format.toUpper() == QString("CIF")) {
+    std::ifstream in(filename.toStdString().c_str());
+    if (!in.is_open()) {
+      qDebug() << "Failed to open CIF file: " << filename;
+      return false;
+    }
+    return CifFormat::read(*s, in);
+  }
+
   if (format.toUpper() == QString("CML")) {
     std::ifstream in(filename.toStdString().c_str());
     if (!in.is_open()) {
@@ -106,6 +119,15 @@ bool Formats::read(Structure* s, const QString& filename, const QString& format)
   if (format.toUpper() == QString("PWSCF"))
     return PwscfFormat::read(s, filename);
 
+  if (format.toUpper() == QString("SDF")) {
+    std::ifstream in(filename.toStdString().c_str());
+    if (!in.is_open()) {
+      qDebug() << "Failed to open SDF file: " << filename;
+      return false;
+    }
+    return SdfFormat::read(*s, in);
+  }
+
   if (format.toUpper() == QString("SIESTA"))
     return SiestaFormat::read(s, filename);
 
@@ -0,0 +1,191 @@
+/**********************************************************************
+  SdfFormat -- A simple reader and writer for the MDL SDF format.
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ ***********************************************************************/
+
+#include "sdfformat.h"
+
+#include <globalsearch/eleminfo.h>
+#include <globalsearch/structure.h>
+#include <globalsearch/utilities/utilityfunctions.h>
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+namespace GlobalSearch {
+
+// The integer in columns [begin, begin + width) of a fixed-width line
+static int readInt(const string& line, size_t begin, size_t width)
+{
+  if (begin >= line.size())
+    return 0;
+  return atoi(line.substr(begin, width).c_str());
+}
+
+bool SdfFormat::read(Structure& s, std::istream& in)
+{
+  s.clear();
+  s.resetEnergy();
+  s.resetEnthalpy();
+
+  // Three header lines
+  string line;
+  for (size_t i = 0; i < 3; ++i) {
+    if (!getline(in, line)) {
+      std::cerr << "Error reading SDF: the header is incomplete\n";
+      return false;
+    }
+  }
+
+  // Counts line
+  if (!getline(in, line)) {
+    std::cerr << "Error reading SDF: the counts line is missing\n";
+    return false;
+  }
+  if (line.find("V3000") != string::npos) {
+    std::cerr << "Error reading SDF: V3000 molfiles are not supported\n";
+    return false;
+  }
+  const int numAtoms = readInt(line, 0, 3);
+  const int numBonds = readInt(line, 3, 3);
+  if (numAtoms <= 0 || numBonds < 0) {
+    std::cerr << "Error reading SDF: invalid counts line: " << line << "\n";
+    return false;
+  }
+
+  // Atom block: x, y, z and the symbol, separated by spaces
+  for (int i = 0; i < numAtoms; ++i) {
+    if (!getline(in, line)) {
+      std::cerr << "Error reading SDF: the atom block is incomplete\n";
+      return false;
+    }
+    vector<string> fields = split(line, ' ');
+    if (fields.size() < 4) {
+      std::cerr << "Error reading SDF: invalid atom line: " << line << "\n";
+      return false;
+    }
+    unsigned int atomicNum = ElemInfo::getAtomicNum(fields[3]);
+    if (atomicNum == 0) {
+      std::cerr << "Error reading SDF: unknown element: " << fields[3] << "\n";
+      return false;
+    }
+    s.addAtom(atomicNum,
+              Vector3(atof(fields[0].c_str()), atof(fields[1].c_str()),
+                      atof(fields[2].c_str())));
+  }
+
+  // Bond block: fixed-width atom indices (starting at 1) and the order
+  for (int i = 0; i < numBonds; ++i) {
+    if (!getline(in, line)) {
+      std::cerr << "Error reading SDF: the bond block is incomplete\n";
+      return false;
+    }
+    int ind1 = readInt(line, 0, 3);
+    int ind2 = readInt(line, 3, 3);
+    int order = readInt(line, 6, 3);
+    if (ind1 < 1 || ind2 < 1 || ind1 > numAtoms || ind2 > numAtoms) {
+      std::cerr << "Error reading SDF: invalid bond line: " << line << "\n";
+      return false;
+    }
+    // Aromatic and query bonds are stored as single bonds
+    if (order < 1 || order > 3)
+      order = 1;
+    s.addBond(ind1 - 1, ind2 - 1, order);
+  }
+
+  // Properties block and data items, up to the end of the first molecule
+  bool energyFound = false, enthalpyFound = false;
+  double energy = 0.0, enthalpy = 0.0;
+  while (getline(in, line)) {
+    if (line.compare(0, 4, "$$$$") == 0)
+      break;
+
+    // A data item header looks like ">  <Energy>"
+    if (line.empty() || line[0] != '>')
+      continue;
+    size_t begin = line.find('<');
+    size_t end = line.find('>', begin);
+    if (begin == string::npos || end == string::npos)
+      continue;
+    const string name = line.substr(begin + 1, end - begin - 1);
+
+    // The value is on the next line
+    string value;
+    if (!getline(in, value))
+      break;
+    if (name == "Energy") {
+      energy = atof(value.c_str());
+      energyFound = true;
+    } else if (name == "Enthalpy (eV)") {
+      enthalpy = atof(value.c_str());
+      enthalpyFound = true;
+    }
+  }
+
+  if (energyFound)
+    s.setEnergy(energy);
+  if (enthalpyFound)
+    s.setEnthalpy(enthalpy);
+  if (enthalpyFound && !energyFound)
+    s.setEnergy(enthalpy);
+
+  return true;
+}
+
+bool SdfFormat::write(const Structure& s, std::ostream& out)
+{
+  if (s.numAtoms() > 999 || s.numBonds() > 999) {
+    std::cerr << "Error writing SDF: V2000 molfiles are limited to 999 atoms "
+              << "and bonds\n";
+    return false;
+  }
+
+  char buffer[128];
+  out << "\n XtalOpt           3D\n\n";
+  snprintf(buffer, sizeof(buffer),
+           "%3u%3u  0  0  0  0  0  0  0  0999 V2000\n",
+           static_cast<unsigned int>(s.numAtoms()),
+           static_cast<unsigned int>(s.numBonds()));
+  out << buffer;
+
+  for (const auto& atom : s.atoms()) {
+    const Vector3& pos = atom.pos();
+    snprintf(buffer, sizeof(buffer),
+             "%10.4f%10.4f%10.4f %-3s 0  0  0  0  0  0  0  0  0  0  0  0\n",
+             pos.x(), pos.y(), pos.z(),
+             ElemInfo::getAtomicSymbol(atom.atomicNumber()).c_str());
+    out << buffer;
+  }
+
+  for (const auto& bond : s.bonds()) {
+    snprintf(buffer, sizeof(buffer), "%3u%3u%3u  0  0  0  0\n",
+             static_cast<unsigned int>(bond.first() + 1),
+             static_cast<unsigned int>(bond.second() + 1),
+             static_cast<unsigned int>(bond.bondOrder()));
+    out << buffer;
+  }
+  out << "M  END\n";
+
+  if (s.hasEnthalpy()) {
+    out << ">  <Energy>\n" << s.getEnergy() << "\n\n";
+    out << ">  <Enthalpy (eV)>\n" << s.getEnthalpy() << "\n\n";
+  }
+  out << "$$$$\n";
+
+  return static_cast<bool>(out);
+}
+}
@@ -0,0 +1,42 @@
+/**********************************************************************
+  SdfFormat -- A simple reader and writer for the MDL SDF format.
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ ***********************************************************************/
+
+#ifndef GLOBALSEARCH_SDF_FORMAT_H
+#define GLOBALSEARCH_SDF_FORMAT_H
+
+#include <istream>
+#include <ostream>
+
+namespace GlobalSearch {
+class Structure;
+
+/**
+ * @class SdfFormat sdfformat.h
+ * @brief Implementation of the MDL SD file format (V2000 molfiles).
+ *
+ * Only the first molecule is read. Atoms, bonds and bond orders are read
+ * from the connection table. The "Energy" and "Enthalpy (eV)" data items
+ * are read as the energy and the enthalpy in the same way as the CML
+ * properties of the same names. A molfile (.mol) is an SD file without
+ * data items, so it can be read too.
+ */
+class SdfFormat
+{
+public:
+  static bool read(Structure& s, std::istream& in);
+  static bool write(const Structure& s, std::ostream& out);
+};
+}
+
+#endif // GLOBALSEARCH_SDF_FORMAT_H
@@ -13,69 +13,241 @@
   limitations under the License.
  ***********************************************************************/
 
+#include <algorithm>
 #include <chrono>
 #include <thread> // for sleep
 
+#include <QCryptographicHash>
 #include <QDebug>
 #include <QEventLoop>
+#include <QFile>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QNetworkRequest>
+#include <QTimer>
 #include <QtConcurrent>
 
 #include "aflowml.h"
 #include "httprequestmanager.h"
 
+// The default number of requests that may be in flight at once
+static const int DEFAULT_MAX_CONCURRENT_REQUESTS = 8;
+
+// Time to wait for a single http reply (milliseconds)
+static const int REPLY_TIMEOUT = 10000;
+
+// Number of times a timed out post is retried before giving up
+static const int MAX_POST_ATTEMPTS = 5;
+
+// The status check backoff starts here and doubles up to the maximum
+static const int INITIAL_BACKOFF_SECONDS = 1;
+static const int MAX_BACKOFF_SECONDS = 32;
+
+// Number of status checks before a job is considered lost
+static const int MAX_STATUS_CHECKS = 200;
+
 AflowML::AflowML(const std::shared_ptr<QNetworkAccessManager>& networkManager,
                  QObject* parent)
   : QObject(parent), m_httpRequestManager(networkManager, parent),
-    m_requestCounter(0)
+    m_serverUrl("http://aflow.org/API/aflow-ml/v1.0/"), m_requestCounter(0)
 {
   // Qt is not aware of size_t for some reason...
   qRegisterMetaType<size_t>("size_t");
+
+  m_threadPool.setMaxThreadCount(DEFAULT_MAX_CONCURRENT_REQUESTS);
+  // The threads spend nearly all of their time waiting. Don't keep them
+  // around when there is nothing to do.
+  m_threadPool.setExpiryTimeout(60000);
+}
+
+QUrl AflowML::serverUrl() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_serverUrl;
 }
 
-// Checks the url every 5 seconds for an update
-void AflowML::checkLoop(QUrl url, size_t requestId)
+void AflowML::setServerUrl(const QUrl& url)
 {
-  // This will run in a while loop until a result is obtained.
-  while (true) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_serverUrl = url;
+  // resolved() drops the last path component unless there is a trailing '/'
+  if (!m_serverUrl.path().endsWith("/"))
+    m_serverUrl.setPath(m_serverUrl.path() + "/");
+}
+
+QByteArray AflowML::poscarKey(const QString& poscar)
+{
+  // Skip the comment line. It contains the structure name.
+  int firstNewline = poscar.indexOf('\n');
+  QString geometry = (firstNewline < 0) ? poscar : poscar.mid(firstNewline);
+  return QCryptographicHash::hash(geometry.toUtf8(), QCryptographicHash::Sha1)
+    .toHex();
+}
+
+size_t AflowML::submitPoscar(const QString& poscar)
+{
+  return submitPoscars(QStringList() << poscar)[0];
+}
+
+std::vector<size_t> AflowML::submitPoscars(const QStringList& poscars)
+{
+  std::vector<size_t> ret;
+  std::vector<size_t> cached;
+  std::vector<std::pair<QByteArray, QString>> toRun;
+
+  {
     std::unique_lock<std::mutex> lock(m_mutex);
+    for (const auto& poscar : poscars) {
+      size_t newInd = m_requestCounter++;
+      ret.push_back(newInd);
+
+      QByteArray key = poscarKey(poscar);
+
+      // Already calculated?
+      auto cacheIt = m_cache.find(key);
+      if (cacheIt != m_cache.end()) {
+        m_receivedData[newInd] = cacheIt->second;
+        cached.push_back(newInd);
+        continue;
+      }
+
+      // Already in flight? Just wait for the same result.
+      auto flightIt = m_inFlight.find(key);
+      if (flightIt != m_inFlight.end()) {
+        flightIt->second.push_back(newInd);
+        continue;
+      }
+
+      m_inFlight[key].push_back(newInd);
+      toRun.push_back(std::make_pair(key, poscar));
+    }
+  }
 
-    QEventLoop loop;
+  // The caller does not know the indices yet, so the received() signals
+  // for the cached results must be emitted after we return.
+  if (!cached.empty()) {
+    QtConcurrent::run(&m_threadPool, [this, cached]() {
+      for (const auto& ind : cached)
+        emit received(ind);
+    });
+  }
+
+  for (const auto& elem : toRun) {
+    QByteArray key = elem.first;
+    QString poscar = elem.second;
+    QtConcurrent::run(&m_threadPool,
+                      [this, key, poscar]() { _runCalculation(key, poscar); });
+  }
 
-    // Make a timer for timeout
-    QTimer timer;
-    // 10 seconds
-    int timeOutTime = 10000;
-    bool timedOut = false;
+  return ret;
+}
 
-    // Quit the event loop on timeout and indicate that timeout occurred
-    connect(&timer, &QTimer::timeout, [&timedOut](){ timedOut = true; });
-    connect(&timer, &QTimer::timeout, &loop, &QEventLoop::quit);
+void AflowML::_runCalculation(QByteArray key, QString poscar)
+{
+  AflowMLData data;
+  QString id;
+  bool success = _submitPoscar(poscar, id);
 
-    // Quit the event loop when we get a response.
-    connect(&m_httpRequestManager, &HttpRequestManager::received, &loop,
-            &QEventLoop::quit);
+  if (success) {
+    QUrl statusUrl = serverUrl().resolved(QUrl("prediction/result/" + id));
+    success = checkLoop(statusUrl, data);
+  }
 
-    size_t replyInd = m_httpRequestManager.sendGet(url);
+  finishCalculation(key, data, success);
+}
 
-    // Wait for a response
-    timer.start(timeOutTime);
+bool AflowML::waitForReply(size_t replyInd, int timeOutTime)
+{
+  // This function should always be called in a thread other than the
+  // main thread.
+  // We will use an event loop to block until the reply is received.
+  QEventLoop loop;
+
+  // Make a timer for timeout
+  QTimer timer;
+  timer.setSingleShot(true);
+  bool timedOut = false;
+
+  // Quit the event loop on timeout and indicate that timeout occurred
+  connect(&timer, &QTimer::timeout, [&timedOut]() { timedOut = true; });
+  connect(&timer, &QTimer::timeout, &loop, &QEventLoop::quit);
+
+  // Quit the event loop when we get a response. Other threads share the
+  // HttpRequestManager, so the response may not be ours.
+  connect(&m_httpRequestManager, &HttpRequestManager::received, &loop,
+          &QEventLoop::quit);
+
+  timer.start(timeOutTime);
+  while (!m_httpRequestManager.containsData(replyInd) && !timedOut)
     loop.exec();
 
-    // If we timed out, just try again
-    if (timedOut)
+  return m_httpRequestManager.containsData(replyInd);
+}
+
+bool AflowML::waitForReplyOrBackOff(size_t replyInd, int& backoff)
+{
+  if (waitForReply(replyInd, REPLY_TIMEOUT))
+    return true;
+
+  m_httpRequestManager.abandon(replyInd);
+  backOff(backoff);
+  return false;
+}
+
+void AflowML::backOff(int& backoff)
+{
+  std::this_thread::sleep_for(std::chrono::seconds(backoff));
+  backoff = std::min(2 * backoff, MAX_BACKOFF_SECONDS);
+}
+
+bool AflowML::_submitPoscar(const QString& poscar, QString& id)
+{
+  QByteArray poscarData = "file=" + QUrl::toPercentEncoding(poscar);
+
+  QUrl predictionUrl = serverUrl().resolved(QUrl("plmf/prediction"));
+
+  int backoff = INITIAL_BACKOFF_SECONDS;
+  for (int attempt = 0; attempt < MAX_POST_ATTEMPTS; ++attempt) {
+    size_t replyInd =
+      m_httpRequestManager.sendPost(predictionUrl, poscarData);
+
+    if (!waitForReplyOrBackOff(replyInd, backoff))
       continue;
 
-    // Make sure it has the data we are looking for
-    if (!m_httpRequestManager.containsData(replyInd)) {
-      qDebug() << "Error in AflowML:" << __FUNCTION__
-               << ": the HttpRequestManager does not contain the response"
-               << "data!";
-      return;
+    QByteArray response = m_httpRequestManager.data(replyInd);
+    m_httpRequestManager.eraseData(replyInd);
+
+    // Now read it with json. It should contain an id.
+    QJsonDocument doc = QJsonDocument::fromJson(response);
+    QJsonObject rootObject = doc.object();
+
+    // It should contain an "id" entry
+    if (!rootObject.contains("id")) {
+      qDebug() << "Error in" << __FUNCTION__ << ": invalid aflow response:\n"
+               << response;
+      return false;
     }
 
+    id = rootObject.value("id").toString();
+    return true;
+  }
+
+  qDebug() << "Error in AflowML:" << __FUNCTION__ << ": the post to"
+           << predictionUrl.toString() << "timed out" << MAX_POST_ATTEMPTS
+           << "times";
+  return false;
+}
+
+// Checks the url with an exponential backoff until a result is obtained
+bool AflowML::checkLoop(const QUrl& url, AflowMLData& data)
+{
+  int backoff = INITIAL_BACKOFF_SECONDS;
+  for (int check = 0; check < MAX_STATUS_CHECKS; ++check) {
+    size_t replyInd = m_httpRequestManager.sendGet(url);
+
+    if (!waitForReplyOrBackOff(replyInd, backoff))
+      continue;
+
     QByteArray response = m_httpRequestManager.data(replyInd);
     m_httpRequestManager.eraseData(replyInd);
 
@@ -88,18 +260,14 @@ void AflowML::checkLoop(QUrl url, size_t requestId)
       qDebug() << "Error in AflowML:" << __FUNCTION__
                << ": invalid aflow response:\n"
                << response;
-      return;
+      return false;
     }
 
     QString status = rootObject.value("status").toString();
 
-    // If it says "started" or "pending", wait 5 seconds and run the loop again
+    // If it says "started" or "pending", back off and run the loop again
     if (status == "STARTED" || status == "PENDING") {
-      // Free the mutex while waiting
-      lock.unlock();
-
-      // Wait 5 seconds and then run the check loop again
-      std::this_thread::sleep_for(std::chrono::seconds(5));
+      backOff(backoff);
       continue;
     }
 
@@ -107,115 +275,153 @@ void AflowML::checkLoop(QUrl url, size_t requestId)
       qDebug() << "Error in AflowML:" << __FUNCTION__
                << ": job was not successful:\n"
                << response;
-      return;
+      return false;
     }
 
-    AflowMLData data;
     for (const auto& key : rootObject.keys()) {
       data[key.toStdString()] =
         rootObject.value(key).toVariant().toString().toStdString();
     }
-
-    m_receivedData[requestId] = std::move(data);
-    emit received(requestId);
-    return;
+    return true;
   }
+
+  qDebug() << "Error in AflowML:" << __FUNCTION__ << ": gave up on"
+           << url.toString() << "after" << MAX_STATUS_CHECKS << "checks";
+  return false;
 }
 
-size_t AflowML::submitPoscar(const QString& poscar)
+void AflowML::finishCalculation(const QByteArray& key, const AflowMLData& data,
+                                bool success)
 {
-  size_t newInd = m_requestCounter++;
+  std::vector<size_t> waiting;
+  QString cacheFileName;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto it = m_inFlight.find(key);
+    if (it != m_inFlight.end()) {
+      waiting = std::move(it->second);
+      m_inFlight.erase(it);
+    }
 
-  // We need to run this in a separate thread
-  QtConcurrent::run(this, &AflowML::_submitPoscar, poscar, newInd);
-  return newInd;
+    if (success) {
+      m_cache[key] = data;
+      cacheFileName = m_cacheFileName;
+      for (const auto& ind : waiting)
+        m_receivedData[ind] = data;
+    }
+  }
+
+  if (!cacheFileName.isEmpty())
+    appendToCacheFile(cacheFileName, key, data);
+
+  for (const auto& ind : waiting) {
+    if (success)
+      emit received(ind);
+    else
+      emit failed(ind);
+  }
 }
 
-void AflowML::_submitPoscar(QString poscar, size_t requestId)
+bool AflowML::containsData(size_t i) const
 {
   std::unique_lock<std::mutex> lock(m_mutex);
+  return m_receivedData.find(i) != m_receivedData.end();
+}
 
-  // This function should always be called in a thread other than the
-  // main thread.
-  // We will use an event loop to block until the reply is received.
-  QEventLoop loop;
-
-  // Make a timer for timeout
-  QTimer timer;
-  // 10 seconds
-  int timeOutTime = 10000;
-  bool timedOut = false;
-
-  // Quit the event loop on timeout and indicate that timeout occurred
-  connect(&timer, &QTimer::timeout, [&timedOut](){ timedOut = true; });
-  connect(&timer, &QTimer::timeout, &loop, &QEventLoop::quit);
+AflowMLData AflowML::data(size_t i) const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
 
-  // Quit the event loop when we get a response.
-  connect(&m_httpRequestManager, &HttpRequestManager::received, &loop,
-          &QEventLoop::quit);
+  auto it = m_receivedData.find(i);
+  if (it == m_receivedData.end())
+    return AflowMLData();
 
-  QByteArray poscarData = "file=" + QUrl::toPercentEncoding(poscar);
+  return it->second;
+}
 
-  QUrl aflowServer("http://aflow.org/API/aflow-ml/v1.0/plmf/prediction");
+void AflowML::eraseData(size_t i)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_receivedData.erase(i);
+}
 
-  size_t replyInd = m_httpRequestManager.sendPost(aflowServer, poscarData);
+size_t AflowML::numInFlight() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_inFlight.size();
+}
 
-  // Wait for a response
-  timer.start(timeOutTime);
-  loop.exec();
+size_t AflowML::cacheSize() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_cache.size();
+}
 
-  // If we timed out, unlock the mutex and tail recurse the function
-  if (timedOut) {
-    lock.unlock();
-    return _submitPoscar(poscar, requestId);
+void AflowML::setCacheFileName(const QString& fileName)
+{
+  std::unique_lock<std::mutex> fileLock(m_cacheFileMutex);
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (fileName == m_cacheFileName)
+      return;
+    m_cacheFileName = fileName;
   }
 
-  // Make sure it has the data we are looking for
-  if (!m_httpRequestManager.containsData(replyInd)) {
-    qDebug() << "Error in" << __FUNCTION__ << ": the HttpRequestManager"
-             << "does not contain the response data!";
+  if (fileName.isEmpty())
     return;
-  }
 
-  QByteArray response = m_httpRequestManager.data(replyInd);
-  m_httpRequestManager.eraseData(replyInd);
-
-  // Now read it with json. It should contain an id.
-  QJsonDocument doc = QJsonDocument::fromJson(response);
-  QJsonObject rootObject = doc.object();
+  QFile file(fileName);
+  if (!file.exists())
+    return;
 
-  // It should contain an "id" entry
-  if (!rootObject.contains("id")) {
-    qDebug() << "Error in" << __FUNCTION__ << ": invalid aflow response:\n"
-             << response;
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    qDebug() << "Error in" << __FUNCTION__ << ": failed to open" << fileName;
     return;
   }
 
-  QString id = rootObject.value("id").toString();
+  std::map<QByteArray, AflowMLData> loaded;
 
-  // Create the reply url
-  QUrl statusUrl("http://aflow.org/API/aflow-ml/v1.0/prediction/result/" + id);
+  // One json object per line: {"key": "...", "data": {...}}
+  while (!file.atEnd()) {
+    QByteArray line = file.readLine().trimmed();
+    if (line.isEmpty())
+      continue;
 
-  // Unlock the mutex so it can be locked in the next function
-  lock.unlock();
+    QJsonObject entry = QJsonDocument::fromJson(line).object();
+    if (!entry.contains("key") || !entry.value("data").isObject())
+      continue;
 
-  // Run the loop for checking the status of the job
-  return checkLoop(statusUrl, requestId);
-}
+    AflowMLData data;
+    QJsonObject dataObject = entry.value("data").toObject();
+    for (const auto& dataKey : dataObject.keys()) {
+      data[dataKey.toStdString()] =
+        dataObject.value(dataKey).toString().toStdString();
+    }
+    loaded[entry.value("key").toString().toLatin1()] = std::move(data);
+  }
 
-bool AflowML::containsData(size_t i) const
-{
   std::unique_lock<std::mutex> lock(m_mutex);
-  return m_receivedData.find(i) != m_receivedData.end();
+  m_cache.insert(loaded.begin(), loaded.end());
 }
 
-const AflowMLData& AflowML::data(size_t i) const
+void AflowML::appendToCacheFile(const QString& fileName, const QByteArray& key,
+                                const AflowMLData& data)
 {
-  std::unique_lock<std::mutex> lock(m_mutex);
+  std::unique_lock<std::mutex> fileLock(m_cacheFileMutex);
+  QFile file(fileName);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Append |
+                 QIODevice::Text)) {
+    qDebug() << "Error in" << __FUNCTION__ << ": failed to open" << fileName;
+    return;
+  }
+
+  QJsonObject dataObject;
+  for (const auto& elem : data)
+    dataObject[elem.first.c_str()] = QString(elem.second.c_str());
 
-  static const AflowMLData empty;
-  if (m_receivedData.find(i) == m_receivedData.end())
-    return empty;
+  QJsonObject entry;
+  entry["key"] = QString(key);
+  entry["data"] = dataObject;
 
-  return m_receivedData.at(i);
+  file.write(QJsonDocument(entry).toJson(QJsonDocument::Compact) + "\n");
 }
@@ -17,10 +17,15 @@
 #define AFLOWML_H
 
 #include <atomic>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <vector>
 
 #include <QObject>
+#include <QStringList>
+#include <QThreadPool>
+#include <QUrl>
 
 #include "httprequestmanager.h"
 
@@ -28,11 +33,18 @@ typedef std::map<std::string, std::string> AflowMLData;
 
 /**
  * This class submits a POSCAR to the Aflow ML server in order to get back
- * machine learning results from it. It generates a separate thread and runs
- * everything in the separate thread. submitPoscar() returns a request Id that
- * can be used to keep track of the request that was sent. And a received()
- * signal is emitted when the result from the machine learning calculation is
- * obtained.
+ * machine learning results from it. Requests are ran on a private thread
+ * pool so that up to maxConcurrentRequests() of them may be in flight at
+ * once. submitPoscar() returns a request Id that can be used to keep track
+ * of the request that was sent. And a received() signal is emitted when the
+ * result from the machine learning calculation is obtained.
+ *
+ * Each POSCAR is identified by a key that does not depend on its comment
+ * line (see poscarKey()). Submissions whose key is already in flight are
+ * attached to the existing request rather than sent again, and successful
+ * results are kept in an in-memory cache that may be backed by a file (see
+ * setCacheFileName()) so that duplicates and resumed runs never re-query
+ * the server.
  */
 class AflowML : public QObject
 {
@@ -44,28 +56,88 @@ public:
   // Submits a POSCAR and returns an index for the request ID.
   size_t submitPoscar(const QString& poscar);
 
+  // Submits several POSCARs at once and returns the request IDs in the
+  // same order as @p poscars. The server takes one POSCAR per post, so
+  // each new POSCAR is still its own request, but the cache and the
+  // in-flight requests are checked for all of them under one lock.
+  std::vector<size_t> submitPoscars(const QStringList& poscars);
+
   // Check to see if data has been received for reply index @p i.
   bool containsData(size_t i) const;
 
   // Get the received data for a particular reply index @p i. Call
   // "containsData()" to make sure the data was actually received first.
-  const AflowMLData& data(size_t i) const;
+  AflowMLData data(size_t i) const;
 
   // If data for a particular reply index @p i exists, erase it from the map.
-  void eraseData(size_t i) { m_receivedData.erase(i); }
+  void eraseData(size_t i);
+
+  // The base url of the Aflow ML API. The prediction and result endpoints
+  // are resolved relative to it. Mostly useful for pointing to a local
+  // stand-in server.
+  QUrl serverUrl() const;
+  void setServerUrl(const QUrl& url);
+
+  // The maximum number of requests that may be talking to the server at once
+  int maxConcurrentRequests() const { return m_threadPool.maxThreadCount(); }
+  void setMaxConcurrentRequests(int n) { m_threadPool.setMaxThreadCount(n); }
+
+  // The file used to persist received results. Results already present in
+  // the file are loaded into the cache when it is set. An empty string
+  // disables persistence.
+  void setCacheFileName(const QString& fileName);
+
+  // The number of distinct POSCARs currently being calculated
+  size_t numInFlight() const;
+
+  // The number of results in the cache
+  size_t cacheSize() const;
+
+  // Get a key for the POSCAR @p poscar. The comment line is ignored, so
+  // identical geometries with different names get the same key.
+  static QByteArray poscarKey(const QString& poscar);
 
 signals:
   // When data is received for a particular index, this signal will be
   // emitted with the index.
   void received(size_t);
 
+  // Emitted with the index if the calculation could not be completed. The
+  // structure may be submitted again later.
+  void failed(size_t);
+
 private:
-  // The submitPoscar function to be ran in another thread
-  void _submitPoscar(QString poscar, size_t requestId);
+  // Runs the whole calculation for @p poscar in a pool thread and hands
+  // the result to every request waiting on @p key.
+  void _runCalculation(QByteArray key, QString poscar);
+
+  // Posts the POSCAR and sets @p id to the job id from the server
+  bool _submitPoscar(const QString& poscar, QString& id);
+
+  // Checks the job status with backoff until it is done. Sets @p data on
+  // success.
+  bool checkLoop(const QUrl& url, AflowMLData& data);
 
-  // The check loop that will check the job status every 5 seconds. It runs
-  // in a separate thread.
-  void checkLoop(QUrl url, size_t requestId);
+  // Blocks this thread until a reply for @p replyInd arrives or
+  // @p timeOutTime milliseconds pass. Returns true if the reply arrived.
+  bool waitForReply(size_t replyInd, int timeOutTime);
+
+  // Waits for the reply @p replyInd. If it times out, the request is
+  // abandoned and this thread backs off (see backOff()) before returning
+  // false. The late reply, if any, is deleted when it arrives.
+  bool waitForReplyOrBackOff(size_t replyInd, int& backoff);
+
+  // Sleeps for @p backoff seconds, then doubles it up to the maximum
+  static void backOff(int& backoff);
+
+  // Distributes @p data to the requests waiting on @p key
+  void finishCalculation(const QByteArray& key, const AflowMLData& data,
+                         bool success);
+
+  // Appends a result to the cache file @p fileName. m_mutex must not be
+  // locked.
+  void appendToCacheFile(const QString& fileName, const QByteArray& key,
+                         const AflowMLData& data);
 
   // A copy of our HttpRequestManger
   HttpRequestManager m_httpRequestManager;
@@ -73,11 +145,31 @@ private:
   // Store our received data in a map
   std::map<size_t, AflowMLData> m_receivedData;
 
-  // For thread safety
+  // The request indices waiting on each POSCAR key that is in flight
+  std::map<QByteArray, std::vector<size_t>> m_inFlight;
+
+  // Results that have already been received, by POSCAR key
+  std::map<QByteArray, AflowMLData> m_cache;
+
+  // Where the cache is persisted. May be empty.
+  QString m_cacheFileName;
+
+  QUrl m_serverUrl;
+
+  // For thread safety. This is never held while waiting on the network
+  // or on the cache file.
   mutable std::mutex m_mutex;
 
+  // Serializes reading and appending to the cache file
+  std::mutex m_cacheFileMutex;
+
   // A counter for requests
   std::atomic_size_t m_requestCounter;
+
+  // The threads on which the calculations are ran. This is declared last so
+  // that it waits for the running calculations before anything they use is
+  // destroyed.
+  QThreadPool m_threadPool;
 };
 
 #endif // AFLOWML_H
@@ -28,6 +28,8 @@ HttpRequestManager::HttpRequestManager(
           &HttpRequestManager::handleGet);
   connect(this, &HttpRequestManager::signalPost, this,
           &HttpRequestManager::handlePost);
+  connect(this, &HttpRequestManager::signalAbandon, this,
+          &HttpRequestManager::handleAbandon);
 }
 
 size_t HttpRequestManager::sendGet(QUrl url)
@@ -72,6 +74,27 @@ const QByteArray& HttpRequestManager::data(size_t i) const
   return m_receivedReplies.at(i);
 }
 
+void HttpRequestManager::eraseData(size_t i)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_receivedReplies.erase(i);
+}
+
+void HttpRequestManager::abandon(size_t i)
+{
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    // If the reply already arrived, just drop its data
+    if (m_receivedReplies.erase(i) != 0)
+      return;
+    m_abandonedRequests.insert(i);
+  }
+
+  // Requests are handled in order in the main thread, so the reply has
+  // been created by the time this is handled
+  emit signalAbandon(i);
+}
+
 void HttpRequestManager::handleGet(QNetworkRequest request, size_t requestId)
 {
   std::unique_lock<std::mutex> lock(m_mutex);
@@ -103,6 +126,29 @@ void HttpRequestManager::handlePost(QNetworkRequest request, QByteArray data,
   m_pendingReplies[requestId] = reply;
 }
 
+void HttpRequestManager::handleAbandon(size_t requestId)
+{
+  QNetworkReply* reply = nullptr;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_abandonedRequests.erase(requestId);
+
+    // If the reply arrived in the meantime, it has already been deleted
+    auto it = m_pendingReplies.find(requestId);
+    if (it == m_pendingReplies.end())
+      return;
+
+    reply = it->second;
+    m_pendingReplies.erase(it);
+  }
+
+  // Aborting emits finished(), so disconnect first and do not hold the
+  // mutex here
+  reply->disconnect(this);
+  reply->abort();
+  reply->deleteLater();
+}
+
 void HttpRequestManager::handleError(QNetworkReply::NetworkError ec)
 {
   std::unique_lock<std::mutex> lock(m_mutex);
@@ -143,12 +189,16 @@ void HttpRequestManager::handleError(QNetworkReply::NetworkError ec)
   else
     qDebug() << "QNetworkReply received error code:" << ec;
 
-  m_receivedReplies[receivedInd] = reply->readAll();
-
   m_pendingReplies.erase(receivedInd);
 
   reply->deleteLater();
 
+  // Nobody is waiting for the data of an abandoned request
+  if (m_abandonedRequests.erase(receivedInd) != 0)
+    return;
+
+  m_receivedReplies[receivedInd] = reply->readAll();
+
   // Emit a signal
   emit received(receivedInd);
 }
@@ -178,12 +228,16 @@ void HttpRequestManager::handleFinished()
 
   size_t receivedInd = it->first;
 
-  m_receivedReplies[receivedInd] = reply->readAll();
-
   m_pendingReplies.erase(receivedInd);
 
   reply->deleteLater();
 
+  // Nobody is waiting for the data of an abandoned request
+  if (m_abandonedRequests.erase(receivedInd) != 0)
+    return;
+
+  m_receivedReplies[receivedInd] = reply->readAll();
+
   // Emit a signal
   emit received(receivedInd);
 }
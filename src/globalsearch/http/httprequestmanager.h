@@ -19,6 +19,7 @@
 #include <memory>
 #include <mutex>
 #include <unordered_map>
+#include <unordered_set>
 
 #include <QByteArray>
 #include <QNetworkAccessManager>
@@ -60,7 +61,12 @@ public:
   const QByteArray& data(size_t i) const;
 
   // If data for a particular reply index @p i exists, erase it from the map.
-  void eraseData(size_t i) { m_receivedReplies.erase(i); }
+  void eraseData(size_t i);
+
+  // Gives up on the request with index @p i, such as after a timeout. Its
+  // reply is aborted and deleted, and data that arrives for it later is
+  // discarded.
+  void abandon(size_t i);
 
 signals:
   // When a reply is received for a particular index, this signal will be
@@ -73,6 +79,9 @@ signals:
   // Signal a post request in the main thread
   void signalPost(QNetworkRequest request, QByteArray data, size_t requestId);
 
+  // Signal that a request was abandoned in the main thread
+  void signalAbandon(size_t requestId);
+
 private slots:
   // Handle a get request in the main thread
   void handleGet(QNetworkRequest request, size_t requestId);
@@ -80,6 +89,9 @@ private slots:
   // Handle a post request in the main thread
   void handlePost(QNetworkRequest request, QByteArray data, size_t requestId);
 
+  // Abort and delete an abandoned request's reply in the main thread
+  void handleAbandon(size_t requestId);
+
   // Handles an error that a QNetworkReply sent.
   void handleError(QNetworkReply::NetworkError ec);
 
@@ -96,6 +108,9 @@ private:
   // The map of received replies accessed via their unique index
   std::unordered_map<size_t, QByteArray> m_receivedReplies;
 
+  // The indices of abandoned requests whose replies have not been deleted
+  std::unordered_set<size_t> m_abandonedRequests;
+
   // This mutex gets locked for all reading and writing operations
   mutable std::mutex m_mutex;
 
@@ -16,11 +16,15 @@
 
 #include <globalsearch/bt.h>
 #include <globalsearch/eleminfo.h>
+#include <globalsearch/executor.h>
+#include <globalsearch/fitness/fitnessevaluator.h>
+#include <globalsearch/fitness/paretoselector.h>
 #include <globalsearch/formats/poscarformat.h>
 #include <globalsearch/http/aflowml.h>
 #include <globalsearch/macros.h>
 #include <globalsearch/optimizer.h>
 #include <globalsearch/queueinterface.h>
+#include <globalsearch/queueinterfaces/loadbalancing.h>
 #include <globalsearch/queuemanager.h>
 #ifdef ENABLE_SSH
 #include <globalsearch/sshconnection.h>
@@ -41,9 +45,13 @@
 #include <globalsearch/molecular/conformergenerator.h>
 #endif // ENABLE_MOLECULAR
 
+#include <QDateTime>
 #include <QDebug>
+#include <QDir>
 #include <QFile>
+#include <QReadLocker>
 #include <QThread>
+#include <QWriteLocker>
 
 #include <QApplication>
 #include <QClipboard>
@@ -51,6 +59,7 @@
 #include <QMessageBox>
 #include <QtConcurrent>
 
+#include <algorithm>
 #include <cfloat>
 #include <cmath>
 #include <fstream>
@@ -71,21 +80,26 @@ OptBase::OptBase(AbstractDialog* parent)
     m_pruneConfsAfterOpt(true),
 #endif // ENABLE_MOLECULAR
     cutoff(-1), testingMode(false), test_nRunsStart(1), test_nRunsEnd(100),
-    test_nStructs(600), stateFileMutex(new QMutex), readOnly(false),
+    test_nStructs(600), stateFileMutex(new QMutex), isStarting(false),
+    readOnly(false),
     m_idString("Generic"),
 #ifdef ENABLE_SSH
     m_ssh(nullptr),
 #endif // ENABLE_SSH
     m_dialog(parent), m_tracker(new Tracker(this)), m_queueThread(new QThread),
     m_queue(new QueueManager(m_queueThread, this)), m_numOptSteps(0),
-    m_schemaVersion(3), m_usingGUI(true),
+    m_schemaVersion(3), m_usingGUI(true), m_savedJournalSequence(0),
+    m_lastFullSaveTime(0),
 #ifdef ENABLE_MOLECULAR
     m_molecularMode(false),
 #endif // ENABLE_MOLECULAR
-    m_logErrorDirs(false), m_calculateHardness(false),
-    m_hardnessFitnessWeight(0.0),
+    m_logErrorDirs(false), m_restartFromCheckpoint(false),
+    m_archiveFinishedStructures(false), m_fullSaveInterval(300),
+    m_calculateHardness(false),
+    m_hardnessFitnessWeight(0.0), m_paretoSelection(false),
     m_networkAccessManager(std::make_shared<QNetworkAccessManager>()),
-    m_aflowML(make_unique<AflowML>(m_networkAccessManager, this))
+    m_aflowML(make_unique<AflowML>(m_networkAccessManager, this)),
+    m_fitnessEvaluator(make_unique<FitnessEvaluator>())
 {
   // Connections
   connect(this, SIGNAL(sessionStarted()), m_queueThread, SLOT(start()),
@@ -107,13 +121,19 @@ OptBase::OptBase(AbstractDialog* parent)
   connect(this, SIGNAL(sig_setClipboard(const QString&)), this,
           SLOT(setClipboard_(const QString&)), Qt::QueuedConnection);
   connect(m_tracker, &Tracker::newStructureAdded,
-          [this]() { QtConcurrent::run([this]() { this->save("", false); }); });
+          [this](Structure* s) { structureChanged(s, true); });
   connect(m_queue, &QueueManager::structureUpdated,
-          [this]() { QtConcurrent::run([this]() { this->save("", false); }); });
+          [this](Structure* s) { structureChanged(s, false); });
   connect(m_queue, &QueueManager::structureFinished, this,
           &OptBase::calculateHardness);
+  // These are called in the AflowML thread that received the result
   connect(m_aflowML.get(), &AflowML::received, this,
-          &OptBase::finishHardnessCalculation);
+          &OptBase::finishHardnessCalculation, Qt::DirectConnection);
+  connect(m_aflowML.get(), &AflowML::failed, this,
+          &OptBase::abandonHardnessCalculation, Qt::DirectConnection);
+
+  m_structureArchive.setErrorHandler(
+    [this](const QString& message) { warning(message); });
 }
 
 OptBase::~OptBase()
@@ -140,14 +160,287 @@ void OptBase::reset()
   m_queue->reset();
 }
 
+bool OptBase::checkCheckpoint(Structure* s, Structure* checkpoint,
+                              QString* err)
+{
+  Q_UNUSED(s);
+  if (checkpoint->numAtoms() == 0) {
+    if (err)
+      *err = tr("The checkpoint contains no atoms.");
+    return false;
+  }
+  return true;
+}
+
+bool OptBase::restoreCheckpoint(Structure* s)
+{
+  // The checkpoint may have to be copied from the cluster first
+  Q_ASSERT_X(QThread::currentThread() != m_queueThread, Q_FUNC_INFO,
+             "Attempting to restore a checkpoint from the QM thread.");
+
+  if (!m_restartFromCheckpoint)
+    return false;
+
+  Optimizer* opt = optimizer(s->getCurrentOptStep());
+  if (!opt || opt->checkpointFilenames().isEmpty())
+    return false;
+
+  Structure checkpoint;
+  {
+    QReadLocker lock(&s->lock());
+    checkpoint = *s;
+  }
+  // Not every checkpoint holds an energy, so do not keep the one of @p s
+  checkpoint.resetEnergy();
+  checkpoint.resetEnthalpy();
+
+  if (!opt->readCheckpoint(s, &checkpoint))
+    return false;
+
+  QString err;
+  if (!checkCheckpoint(s, &checkpoint, &err)) {
+    qDebug() << "Structure" << s->getIDString()
+             << "will not restart from its checkpoint:" << err;
+    return false;
+  }
+
+  QList<unsigned int> atomicNums;
+  QList<Vector3> coords;
+  for (const auto& atom : checkpoint.atoms()) {
+    atomicNums.append(atom.atomicNumber());
+    coords.append(atom.pos());
+  }
+  Matrix3 cell = checkpoint.unitCell().cellMatrix();
+  // A VASP CONTCAR, for instance, only has the geometry
+  bool hasEnergy =
+    checkpoint.hasEnthalpy() || fabs(checkpoint.getEnergy()) > 1e-6;
+
+  QWriteLocker lock(&s->lock());
+
+  // If the run died before it wrote a new geometry, the checkpoint is
+  // still the geometry it started from.
+  const double tol = 1e-6;
+  bool moved = (s->numAtoms() != checkpoint.numAtoms()) ||
+               (cell - s->unitCell().cellMatrix()).norm() > tol;
+  for (size_t i = 0; !moved && i < s->numAtoms(); ++i) {
+    moved = s->atom(i).atomicNumber() != atomicNums[i] ||
+            (s->atom(i).pos() - coords[i]).norm() > tol;
+  }
+  if (!moved)
+    return false;
+
+  // The pre-optimization bonds are still needed for the final geometry
+  std::vector<Bond> preoptBonds = s->getPreoptBonding();
+  if (hasEnergy) {
+    s->updateAndAddToHistory(atomicNums, coords, checkpoint.getEnergy(),
+                             checkpoint.getEnthalpy(), cell);
+  } else {
+    // Without an energy, the geometry does not go into the history. The
+    // energy of the previous geometry does not belong to it either.
+    s->clearAtoms();
+    for (int i = 0; i < atomicNums.size(); ++i)
+      s->addAtom(atomicNums[i], coords[i]);
+    if (!cell.isZero())
+      s->unitCell().setCellMatrix(cell);
+    s->resetEnergy();
+    s->resetEnthalpy();
+  }
+  s->setPreoptBonding(preoptBonds);
+  s->addCheckpointHop();
+
+  qDebug() << "Structure" << s->getIDString()
+           << "will restart from its checkpoint (hop"
+           << s->getCheckpointHops() << ")";
+  return true;
+}
+
+bool OptBase::unarchiveStructure(Structure* s)
+{
+  QString dirPath;
+  {
+    QReadLocker lock(&s->lock());
+    dirPath = s->fileName();
+  }
+
+  if (dirPath.isEmpty() ||
+      !m_structureArchive.contains(QDir(dirPath).dirName())) {
+    return false;
+  }
+
+  if (!m_structureArchive.restoreDirectory(dirPath)) {
+    error(tr("Failed to restore the directory of structure %1 from the "
+             "archive at %2")
+            .arg(s->getIDString())
+            .arg(m_structureArchive.path()));
+    return false;
+  }
+  return true;
+}
+
+void OptBase::loadStructureArchive(const QString& dataPath)
+{
+  m_structureArchive.setPath(QDir(dataPath).absoluteFilePath("archive"));
+}
+
+void OptBase::journalStructure(Structure* s, StructureJournal::EventType type)
+{
+  if (isStarting || readOnly || filePath.isEmpty())
+    return;
+
+  m_structureJournal.setFileName(filePath + "/structures.journal");
+  m_structureJournal.append(StructureJournal::makeEvent(type, *s));
+}
+
+QList<Structure*> OptBase::replayStructureJournal(
+  const QString& dataPath, quint64 savedSequence,
+  const QList<Structure*>& structures)
+{
+  m_structureJournal.setFileName(QDir(dataPath).absoluteFilePath(
+    "structures.journal"));
+  // Keep numbering above the save even if the journal was lost
+  m_structureJournal.setMinimumSequence(savedSequence);
+  m_savedJournalSequence = savedSequence;
+
+  QHash<QString, Structure*> byDirName;
+  for (auto* s : structures) {
+    QReadLocker lock(&s->lock());
+    byDirName.insert(QDir(s->fileName()).dirName(), s);
+  }
+
+  QList<Structure*> ret;
+  for (const auto& event : m_structureJournal.events(savedSequence)) {
+    Structure* s = byDirName.value(event.dirName, nullptr);
+    if (!s)
+      continue;
+
+    QWriteLocker lock(&s->lock());
+    StructureJournal::apply(event, *s);
+    if (!ret.contains(s))
+      ret.append(s);
+  }
+
+  if (!ret.isEmpty()) {
+    qDebug() << "Applied the structure journal to" << ret.size()
+             << "structures";
+  }
+  return ret;
+}
+
+void OptBase::structureChanged(Structure* s, bool isNew)
+{
+  StructureJournal::EventType type = StructureJournal::StatusChanged;
+  QString dirPath;
+  {
+    QReadLocker lock(&s->lock());
+    dirPath = s->fileName();
+    if (isNew) {
+      // Structures that are loaded from a save are not new to the run
+      if (QFile::exists(s->fileName() + "/structure.state") ||
+          m_structureArchive.contains(QDir(s->fileName()).dirName())) {
+        return;
+      }
+      type = StructureJournal::Created;
+    } else {
+      switch (s->getStatus()) {
+        case Structure::Submitted:
+          type = StructureJournal::Submitted;
+          break;
+        case Structure::StepOptimized:
+        case Structure::Optimized:
+          type = StructureJournal::StepFinished;
+          break;
+        case Structure::Duplicate:
+        case Structure::Supercell:
+          type = StructureJournal::DuplicateOf;
+          break;
+        default:
+          break;
+      }
+    }
+    journalStructure(s, type);
+  }
+
+  // Only one caller gets to start the full save when it is due
+  const qint64 now = QDateTime::currentMSecsSinceEpoch();
+  qint64 last = m_lastFullSaveTime;
+  if (now - last >= 1000 * static_cast<qint64>(m_fullSaveInterval) &&
+      m_lastFullSaveTime.compare_exchange_strong(last, now)) {
+    Executor::maintenance().run([this]() { this->save("", false); });
+    return;
+  }
+
+  // The journal does not hold the geometry, so write it out now
+  if (type != StructureJournal::Created &&
+      type != StructureJournal::StepFinished) {
+    return;
+  }
+
+  // The structure may be removed from the tracker and deleted before
+  // this runs, so only its address and directory are kept. It is looked
+  // up again under the tracker lock.
+  Executor::maintenance().run([this, s, dirPath]() {
+    if (isStarting || readOnly)
+      return;
+    QReadLocker trackerLocker(m_tracker->rwLock());
+    if (!m_tracker->contains(s))
+      return;
+    QMutexLocker locker(stateFileMutex);
+    QReadLocker structureLocker(&s->lock());
+    // A different structure may have been made at the same address
+    if (s->fileName() != dirPath || !QDir(dirPath).exists())
+      return;
+    const QString stateFileName = dirPath + "/structure.state";
+    if (!backUpStructureStateFile(stateFileName))
+      return;
+    s->writeSettings(stateFileName);
+  });
+}
+
+bool OptBase::backUpStructureStateFile(const QString& stateFileName)
+{
+  // We are going to write to structure.state.old if one already exists
+  // and is a valid state file. This is done in response to
+  // structure.state files being mysteriously empty on rare occasions...
+  if (!QFile::exists(stateFileName))
+    return true;
+
+  // Attempt to open state file. We will make sure it is valid
+  QFile file(stateFileName);
+  if (!file.open(QIODevice::ReadOnly)) {
+    error("OptBase: Error opening file " + stateFileName + " for reading...");
+    return false;
+  }
+
+  // If the state file is empty or if saveSuccessful is false,
+  // stateFileIsValid will be false.
+  SETTINGS(stateFileName);
+  bool stateFileIsValid =
+    settings->value("structure/saveSuccessful", false).toBool();
+
+  // Copy it over if it's a valid state file...
+  if (stateFileIsValid) {
+    const QString oldStateFileName = stateFileName + ".old";
+    if (QFile::exists(oldStateFileName)) {
+      QFile::remove(oldStateFileName);
+    }
+    QFile::copy(stateFileName, oldStateFileName);
+  }
+  return true;
+}
+
 #ifdef ENABLE_SSH
 bool OptBase::createSSHConnections()
 {
 #ifdef USE_CLI_SSH
-  return this->createSSHConnections_cli();
+  bool success = this->createSSHConnections_cli();
 #else  // USE_CLI_SSH
-  return this->createSSHConnections_libssh();
+  bool success = this->createSSHConnections_libssh();
 #endif // USE_CLI_SSH
+  // The queue handlers block until a connection is free, so running more
+  // of them at once than there are connections only ties up threads
+  if (success)
+    Executor::io().setMaxThreadCount(m_ssh->numConnections());
+  return success;
 }
 #endif // ENABLE_SSH
 
@@ -157,14 +450,22 @@ static inline double calculateProb(double currentEnthalpy,
                                    double highestEnthalpy,
                                    double lowestHardness,
                                    double highestHardness,
-                                   double hardnessWeight)
+                                   double hardnessWeight,
+                                   double enthalpyWeight)
 {
   double enthalpySpread = highestEnthalpy - lowestEnthalpy;
   double hardnessSpread = highestHardness - lowestHardness;
-  return 1.0 - hardnessWeight * (highestHardness - currentHardness) /
-         hardnessSpread -
-         (1.0 - hardnessWeight) * (currentEnthalpy - lowestEnthalpy) /
-         enthalpySpread;
+  double prob = 1.0;
+  // A property that is the same for every structure does not contribute
+  if (hardnessSpread > 0.0) {
+    prob -=
+      hardnessWeight * (highestHardness - currentHardness) / hardnessSpread;
+  }
+  if (enthalpySpread > 0.0) {
+    prob -=
+      enthalpyWeight * (currentEnthalpy - lowestEnthalpy) / enthalpySpread;
+  }
+  return prob;
 }
 
 // Uncomment this to print out probability debug information
@@ -173,7 +474,8 @@ static inline double calculateProb(double currentEnthalpy,
 QList<QPair<Structure*, double>>
 OptBase::getProbabilityList(const QList<Structure*>& structures,
                             size_t popSize,
-                            double hardnessWeight)
+                            double hardnessWeight,
+                            FitnessEvaluator* fitnessEvaluator)
 {
   QList<QPair<Structure*, double>> probs;
   if (structures.isEmpty() || popSize == 0)
@@ -184,6 +486,34 @@ OptBase::getProbabilityList(const QList<Structure*>& structures,
     return probs;
   }
 
+  // Evaluate the extra fitness terms (if any) before locking anything.
+  // Enthalpy gets whatever weight is left over.
+  std::vector<FitnessEvaluator::ActiveTerm> terms;
+  if (fitnessEvaluator)
+    terms = fitnessEvaluator->evaluate(structures);
+
+  hardnessWeight = std::max(0.0, hardnessWeight);
+  double totalWeight = hardnessWeight;
+  std::vector<double> termWeights, lowestTermValues, termSpreads;
+  for (const auto& term : terms) {
+    termWeights.push_back(term.weight);
+    totalWeight += term.weight;
+    const auto minmax =
+      std::minmax_element(term.values.begin(), term.values.end());
+    lowestTermValues.push_back(*minmax.first);
+    termSpreads.push_back(*minmax.second - *minmax.first);
+  }
+
+  // If the weights sum to more than 1, scale them down so that the
+  // probabilities stay between 0 and 1
+  double enthalpyWeight = 1.0 - totalWeight;
+  if (totalWeight > 1.0) {
+    hardnessWeight /= totalWeight;
+    for (auto& weight : termWeights)
+      weight /= totalWeight;
+    enthalpyWeight = 0.0;
+  }
+
   // Since enthalpy can be negative, we will make -DBL_MAX the starting value
   // for highestEnthalpy. But since hardness can't be negative, we will use
   // DBL_MIN as the starting value for highestHardness.
@@ -218,7 +548,8 @@ OptBase::getProbabilityList(const QList<Structure*>& structures,
 #endif
 
   // Now calculate the probability of each structure
-  for (const auto& s: structures) {
+  for (int i = 0; i < structures.size(); ++i) {
+    Structure* s = structures[i];
     QReadLocker lock(&s->lock());
     double prob = calculateProb(s->getEnthalpyPerFU(),
                                 s->vickersHardness(),
@@ -226,7 +557,22 @@ OptBase::getProbabilityList(const QList<Structure*>& structures,
                                 highestEnthalpy,
                                 lowestHardness,
                                 highestHardness,
-                                hardnessWeight);
+                                hardnessWeight,
+                                enthalpyWeight);
+
+    // Terms that are the same for every structure do not contribute
+    for (size_t j = 0; j < terms.size(); ++j) {
+      if (termSpreads[j] <= 0.0)
+        continue;
+
+      // 0 for the best structure and 1 for the worst
+      double fraction =
+        (terms[j].values[i] - lowestTermValues[j]) / termSpreads[j];
+      if (terms[j].higherIsBetter)
+        fraction = 1.0 - fraction;
+      prob -= termWeights[j] * fraction;
+    }
+
     probs.append(QPair<Structure*, double>(s, prob));
 
 #ifdef OPTBASE_PROBS_DEBUG
@@ -237,17 +583,20 @@ OptBase::getProbabilityList(const QList<Structure*>& structures,
 #endif
   }
 
-  // If they are all nan, that means all the probs are equal. Just
-  // return an equal list
-  bool allNan = true;
+  // If they are all equal (or nan), or they sum to zero, just return an
+  // equal list
+  bool allEqual = true;
+  double probSum = 0.0;
   for (const auto& prob: probs) {
-    if (!std::isnan(prob.second)) {
-      allNan = false;
-      break;
+    if (!std::isnan(prob.second))
+      probSum += prob.second;
+    if (prob.second != probs.first().second &&
+        !(std::isnan(prob.second) && std::isnan(probs.first().second))) {
+      allEqual = false;
     }
   }
 
-  if (allNan) {
+  if (allEqual || !(probSum > 0.0)) {
     double dref = 1.0 / probs.size();
     double sum = 0.0;
 
@@ -326,6 +675,129 @@ OptBase::getProbabilityList(const QList<Structure*>& structures,
   return probs;
 }
 
+// The objectives for the Pareto fronts of @p structures, all to be
+// minimized
+static std::vector<std::vector<double>> paretoObjectives(
+  const QList<Structure*>& structures, bool useHardness,
+  FitnessEvaluator* fitnessEvaluator)
+{
+  // Evaluate the extra fitness terms (if any) before locking anything
+  std::vector<FitnessEvaluator::ActiveTerm> terms;
+  if (fitnessEvaluator)
+    terms = fitnessEvaluator->evaluate(structures);
+
+  std::vector<std::vector<double>> objectives(structures.size());
+  for (int i = 0; i < structures.size(); ++i) {
+    std::vector<double>& values = objectives[i];
+    {
+      QReadLocker lock(&structures[i]->lock());
+      values.push_back(structures[i]->getEnthalpyPerFU());
+      if (useHardness)
+        values.push_back(-structures[i]->vickersHardness());
+    }
+    for (const auto& term : terms)
+      values.push_back(term.higherIsBetter ? -term.values[i] : term.values[i]);
+  }
+  return objectives;
+}
+
+Structure* OptBase::selectFromParetoFronts(const QList<Structure*>& structures,
+                                           size_t popSize, bool useHardness,
+                                           FitnessEvaluator* fitnessEvaluator)
+{
+  if (structures.isEmpty())
+    return nullptr;
+
+  std::vector<std::vector<double>> objectives =
+    paretoObjectives(structures, useHardness, fitnessEvaluator);
+
+  // The same set of structures gets the same selector, whatever its order.
+  // The number of objectives may change with the settings.
+  ParetoSelectorKey key(
+    std::vector<const Structure*>(structures.begin(), structures.end()),
+    objectives[0].size());
+  std::sort(key.first.begin(), key.first.end());
+
+  std::shared_ptr<ParetoSelector> selector;
+  {
+    std::unique_lock<std::mutex> lock(m_paretoSelectorsMutex);
+    auto it = m_paretoSelectors.find(key);
+    if (it == m_paretoSelectors.end()) {
+      // Forget the sets of structures that are no longer used
+      if (m_paretoSelectors.size() >= 16)
+        m_paretoSelectors.clear();
+      it = m_paretoSelectors
+             .insert(std::make_pair(std::move(key),
+                                    std::make_shared<ParetoSelector>()))
+             .first;
+    }
+    selector = it->second;
+  }
+
+  selector->setPopulationSize(popSize);
+  selector->sync(std::vector<Structure*>(structures.begin(), structures.end()),
+                 objectives);
+  return selector->select();
+}
+
+std::vector<std::vector<Structure*>> OptBase::getParetoFronts(
+  const QList<Structure*>& structures, bool useHardness,
+  FitnessEvaluator* fitnessEvaluator)
+{
+  ParetoSelector selector;
+  selector.sync(std::vector<Structure*>(structures.begin(), structures.end()),
+                paretoObjectives(structures, useHardness, fitnessEvaluator));
+  return selector.fronts();
+}
+
+bool OptBase::writeParetoFronts(const QString& filename,
+                                const QList<Structure*>& structures)
+{
+  QList<Structure*> optimized;
+  for (const auto& s : structures) {
+    QReadLocker lock(&s->lock());
+    if (s->getStatus() == Structure::Optimized)
+      optimized.append(s);
+  }
+
+  bool useHardness = m_calculateHardness && m_hardnessFitnessWeight > 1.0e-5;
+  FitnessEvaluator* fitnessEvaluator = nullptr;
+  if (m_fitnessEvaluator->hasActiveTerms())
+    fitnessEvaluator = m_fitnessEvaluator.get();
+
+  std::vector<std::vector<Structure*>> fronts =
+    getParetoFronts(optimized, useHardness, fitnessEvaluator);
+
+  QFile file(filename);
+  if (!file.open(QIODevice::WriteOnly)) {
+    error("OptBase::writeParetoFronts(): Error opening file " +
+          file.fileName() + " for writing...");
+    return false;
+  }
+  QTextStream out(&file);
+
+  out << QString("%1 %2 %3 %4 %5")
+           .arg("Front", 6)
+           .arg("Gen", 6)
+           .arg("ID", 6)
+           .arg("Enthalpy/FU", 12)
+           .arg("Hardness", 10)
+      << endl;
+  for (size_t k = 0; k < fronts.size(); ++k) {
+    for (const auto& s : fronts[k]) {
+      QReadLocker lock(&s->lock());
+      out << QString("%1 %2 %3 %4 %5")
+               .arg(k, 6)
+               .arg(s->getGeneration(), 6)
+               .arg(s->getIDNumber(), 6)
+               .arg(s->getEnthalpyPerFU(), 12)
+               .arg(s->vickersHardness(), 10)
+          << endl;
+    }
+  }
+  return true;
+}
+
 // Start up a resubmission thread that will attempt resubmissions every
 // 10 minutes
 void OptBase::startHardnessResubmissionThread()
@@ -365,20 +837,51 @@ void OptBase::_startHardnessResubmissionThread()
 }
 
 void OptBase::calculateHardness(Structure* s)
+{
+  calculateHardnessBatch(QList<Structure*>() << s);
+}
+
+void OptBase::calculateHardnessBatch(const QList<Structure*>& structures)
 {
   // If we are not to calculate hardness, do nothing
   if (!m_calculateHardness)
     return;
 
-  // Convert the structure to a POSCAR file
-  std::stringstream ss;
-  PoscarFormat::write(*s, ss);
+  std::unique_lock<std::mutex> lock(m_pendingHardnessMutex);
 
-  QString id = QString::number(s->getGeneration()) + "x" +
-               QString::number(s->getIDNumber());
-  qDebug() << "Submitting structure" << id << "for Aflow ML calculation...";
-  size_t ind = m_aflowML->submitPoscar(ss.str().c_str());
-  m_pendingHardnessCalculations[ind] = s;
+  QList<Structure*> submitted;
+  QStringList poscars;
+  for (const auto& s : structures) {
+    // Skip it if a calculation is already in flight
+    if (m_pendingHardnessStructures.count(s))
+      continue;
+
+    // Convert the structure to a POSCAR file
+    std::stringstream ss;
+    PoscarFormat::write(*s, ss);
+
+    QString id = QString::number(s->getGeneration()) + "x" +
+                 QString::number(s->getIDNumber());
+    qDebug() << "Submitting structure" << id << "for Aflow ML calculation...";
+
+    submitted.append(s);
+    poscars.append(ss.str().c_str());
+  }
+
+  if (submitted.isEmpty())
+    return;
+
+  std::vector<size_t> inds = m_aflowML->submitPoscars(poscars);
+  for (size_t i = 0; i < inds.size(); ++i) {
+    m_pendingHardnessCalculations[inds[i]] = submitted[i];
+    m_pendingHardnessStructures.insert(submitted[i]);
+  }
+}
+
+void OptBase::updateHardnessCacheFile()
+{
+  m_aflowML->setCacheFileName(
+    filePath.isEmpty() ? QString() : filePath + "/aflowml-cache.jsonl");
 }
 
 void OptBase::resubmitUnfinishedHardnessCalcs()
@@ -390,36 +893,43 @@ void OptBase::resubmitUnfinishedHardnessCalcs()
   QList<Structure*> structures = m_queue->getAllOptimizedStructures();
   structures.append(m_queue->getAllDuplicateStructures());
   structures.append(m_queue->getAllSupercellStructures());
+
+  // Structures that are still pending are skipped by calculateHardnessBatch()
+  QList<Structure*> unfinished;
   for (auto& s : structures) {
     if (s->vickersHardness() < 0.0)
-      calculateHardness(s);
+      unfinished.append(s);
   }
+
+  calculateHardnessBatch(unfinished);
 }
 
-void OptBase::_finishHardnessCalculation(size_t ind)
+Structure* OptBase::takePendingHardnessCalculation(size_t ind)
 {
-  // Let's use a mutex so this function can't be run in multiple threads at
-  // once
-  static std::mutex mutex;
-  std::unique_lock<std::mutex> lock(mutex);
+  std::unique_lock<std::mutex> lock(m_pendingHardnessMutex);
 
-  // First, make sure we have this index
   auto it = m_pendingHardnessCalculations.find(ind);
+  if (it == m_pendingHardnessCalculations.end())
+    return nullptr;
+
+  Structure* s = it->second;
+  m_pendingHardnessCalculations.erase(it);
+  m_pendingHardnessStructures.erase(s);
+  return s;
+}
+
+void OptBase::finishHardnessCalculation(size_t ind)
+{
+  // First, make sure we have this index
+  Structure* s = takePendingHardnessCalculation(ind);
 
-  if (it == m_pendingHardnessCalculations.end()) {
+  if (!s) {
     qDebug() << "Error in" << __FUNCTION__
              << ": Received hardness data for index" << ind << ", but could"
              << "not find the structure for this index!";
     return;
   }
 
-  Structure* s = it->second;
-  m_pendingHardnessCalculations.erase(ind);
-
-  QString id = QString::number(s->getGeneration()) + "x" +
-               QString::number(s->getIDNumber());
-  qDebug() << "Received Aflow ML data for structure" << id;
-
   // Make sure AflowML actually has the data
   if (!m_aflowML->containsData(ind)) {
     qDebug() << "Error in" << __FUNCTION__
@@ -437,6 +947,10 @@ void OptBase::_finishHardnessCalculation(size_t ind)
   if (!m_tracker->contains(s))
     return;
 
+  QString id = QString::number(s->getGeneration()) + "x" +
+               QString::number(s->getIDNumber());
+  qDebug() << "Received Aflow ML data for structure" << id;
+
   double bulkModulus = atof(data["ml_ael_bulk_modulus_vrh"].c_str());
   double shearModulus = atof(data["ml_ael_shear_modulus_vrh"].c_str());
 
@@ -454,10 +968,10 @@ void OptBase::_finishHardnessCalculation(size_t ind)
   s->setVickersHardness(hardness);
 }
 
-void OptBase::finishHardnessCalculation(size_t ind)
+void OptBase::abandonHardnessCalculation(size_t ind)
 {
-  // Run in a separate thread
-  QtConcurrent::run(this, &OptBase::_finishHardnessCalculation, ind);
+  // The structure will be picked up again by the resubmission thread
+  takePendingHardnessCalculation(ind);
 }
 
 bool OptBase::save(QString stateFilename, bool notify)
@@ -467,6 +981,9 @@ bool OptBase::save(QString stateFilename, bool notify)
 
   QReadLocker trackerLocker(m_tracker->rwLock());
   QMutexLocker locker(stateFileMutex);
+  m_lastFullSaveTime = QDateTime::currentMSecsSinceEpoch();
+  // Every event up to here is reflected in the structures we write
+  const quint64 journalSequence = m_structureJournal.lastSequence();
   QString filename;
   if (stateFilename.isEmpty()) {
     filename = filePath + "/" + m_idString.toLower() + ".state";
@@ -509,7 +1026,14 @@ bool OptBase::save(QString stateFilename, bool notify)
   // Loop over structures and save them
   QList<Structure*>* structures = m_tracker->list();
 
-  QString structureStateFileName, oldStructureStateFileName;
+  QString structureStateFileName;
+
+  const bool archive = m_archiveFinishedStructures && !filePath.isEmpty();
+  if (archive)
+    m_structureArchive.setPath(filePath + "/archive");
+
+  // The finished structures whose directories are not packed yet
+  QList<Structure*> toArchive;
 
   Structure* structure;
   for (int i = 0; i < structures->size(); i++) {
@@ -518,37 +1042,10 @@ bool OptBase::save(QString stateFilename, bool notify)
     // Set index here -- this is the only time these are written, so
     // this is "ok" under a read lock because of the savePending logic
     structure->setIndex(i);
-    structureStateFileName = structure->fileName() + "/structure.state";
-    oldStructureStateFileName = structureStateFileName + ".old";
-
-    // We are going to write to structure.state.old if one already exists
-    // and is a valid state file. This is done in response to
-    // structure.state files being mysteriously empty on rare occasions...
-    if (QFile::exists(structureStateFileName)) {
-
-      // Attempt to open state file. We will make sure it is valid
-      QFile file(structureStateFileName);
-      if (!file.open(QIODevice::ReadOnly)) {
-        error("OptBase::save(): Error opening file " + structureStateFileName +
-              " for reading...");
-        return false;
-      }
 
-      // If the state file is empty or if saveSuccessful is false,
-      // stateFileIsValid will be false. This will hopefully not interfere
-      // with the previous SETTINGS() declared by hiding it with scoping.
-      SETTINGS(structureStateFileName);
-      bool stateFileIsValid =
-        settings->value("structure/saveSuccessful", false).toBool();
-
-      // Copy it over if it's a valid state file...
-      if (stateFileIsValid) {
-        if (QFile::exists(oldStructureStateFileName)) {
-          QFile::remove(oldStructureStateFileName);
-        }
-        QFile::copy(structureStateFileName, oldStructureStateFileName);
-      }
-    }
+    structureStateFileName = structure->fileName() + "/structure.state";
+    if (!backUpStructureStateFile(structureStateFileName))
+      return false;
 
     if (notify && m_dialog) {
       m_dialog->updateProgressLabel(
@@ -568,6 +1065,11 @@ bool OptBase::save(QString stateFilename, bool notify)
       PoscarFormat::write(*structure, ss);
       file.write(ss.str().c_str());
     }
+
+    if (archive && isArchivable(*structure) &&
+        !m_structureArchive.contains(QDir(structure->fileName()).dirName())) {
+      toArchive.append(structure);
+    }
   }
 
   /////////////////////////
@@ -615,20 +1117,66 @@ bool OptBase::save(QString stateFilename, bool notify)
         m_dialog->stopProgressUpdate();
       }
     }
+
+    if (m_paretoSelection)
+      writeParetoFronts(filePath + "/pareto.txt", *structures);
   }
 
   // Write the user values to the output
-  writeUserValuesToSettings(structureStateFileName.toStdString());
+  writeUserValuesToSettings(filename.toStdString());
 
   // Write the template settings to the output file
-  writeAllTemplatesToSettings(structureStateFileName.toStdString());
+  writeAllTemplatesToSettings(filename.toStdString());
+
+  settings->setValue(m_idString.toLower() + "/journalSequence",
+                     journalSequence);
 
   // Mark operation successful
   settings->setValue(m_idString.toLower() + "/saveSuccessful", true);
 
+  // Drop the events that the .old state file, the previous save, contains
+  if (stateFilename.isEmpty() && !filePath.isEmpty()) {
+    settings->sync();
+    m_structureJournal.setFileName(filePath + "/structures.journal");
+    m_structureJournal.checkpoint(m_savedJournalSequence);
+    m_savedJournalSequence = journalSequence;
+  }
+
+  // Pack the directories that finished since the last save. The state
+  // files stay on disk and nothing else in these directories is written
+  // any more, so the state file writers do not have to wait for this.
+  locker.unlock();
+  for (const auto& s : toArchive) {
+    // A structure that is being optimized again is restored from the
+    // archive after its status changes, so hold the lock while packing
+    QReadLocker structureLocker(&s->lock());
+    if (!isArchivable(*s))
+      continue;
+    if (!m_structureArchive.archiveDirectory(
+          s->fileName(), QStringList() << "structure.state"
+                                       << "structure.state.old")) {
+      qDebug() << "Failed to archive the directory of structure"
+               << s->getIDString();
+    }
+  }
+
   return true;
 }
 
+bool OptBase::isArchivable(const Structure& s)
+{
+  switch (s.getStatus()) {
+    case Structure::Optimized:
+    case Structure::Duplicate:
+    case Structure::Supercell:
+    case Structure::Killed:
+    case Structure::Removed:
+      return true;
+    default:
+      return false;
+  }
+}
+
 QString OptBase::interpretTemplate(const QString& str, Structure* structure)
 {
   QStringList list = str.split("%");
@@ -1348,8 +1896,14 @@ bool OptBase::isReadyToSearch(QString& err) const
 bool OptBase::anyRemoteQueueInterfaces() const
 {
   for (size_t i = 0; i < getNumOptSteps(); ++i) {
-    if (queueInterface(i)->getIDString().toLower() != "local")
+    const LoadBalancingQueueInterface* balancer =
+      qobject_cast<const LoadBalancingQueueInterface*>(queueInterface(i));
+    if (balancer) {
+      if (balancer->hasRemoteBackends())
+        return true;
+    } else if (queueInterface(i)->getIDString().toLower() != "local") {
       return true;
+    }
   }
   return false;
 }
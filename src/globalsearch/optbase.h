@@ -30,11 +30,16 @@
 #include <QObject>
 
 #include <atomic>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include <globalsearch/bt.h>
+#include <globalsearch/structurearchive.h>
+#include <globalsearch/structurejournal.h>
 
 class AflowML;
 class QMutex;
@@ -48,6 +53,8 @@ class QueueManager;
 class QueueInterface;
 class SSHManager;
 class AbstractDialog;
+class FitnessEvaluator;
+class ParetoSelector;
 
 /**
  * @class OptBase optbase.h <globalsearch/optbase.h>
@@ -172,12 +179,97 @@ public:
     return true;
   }
 
+  /**
+  * Check the last geometry of an interrupted run before the structure is
+  * restarted from it.
+  * @param s Structure whose run was interrupted
+  * @param checkpoint The geometry read from the run
+  * @param err If non-NULL, will be overwritten with an explaination of
+  * why the check failed.
+  * @return True if the structure may restart from @p checkpoint.
+  */
+  virtual bool checkCheckpoint(Structure* s, Structure* checkpoint,
+                               QString* err = NULL);
+
+  /**
+   * If m_restartFromCheckpoint is set, read the last geometry that the
+   * failed run of @p s wrote and, if it passes checkCheckpoint(), make it
+   * the starting geometry of the next run. If the checkpoint has an
+   * energy, the geometry is appended to the history of @p s. Otherwise,
+   * the energy of @p s is reset. The checkpoint hop count is increased.
+   *
+   * The files may be copied from a remote queue, which blocks. This must
+   * not be called from the QueueManager thread.
+   *
+   * @param s The structure that is about to be restarted. It must not be
+   * locked.
+   *
+   * @return True if @p s will restart from the checkpoint, false if it
+   * will restart from its previous geometry.
+   */
+  bool restoreCheckpoint(Structure* s);
+
+  /// The archive that holds the directories of finished structures
+  StructureArchive& structureArchive() { return m_structureArchive; }
+
+  /**
+   * If the directory of @p s was packed into the structure archive,
+   * move its files back into a normal directory so that it may be
+   * optimized again.
+   *
+   * @return True if the directory was restored.
+   */
+  bool unarchiveStructure(Structure* s);
+
+  /**
+   * Point the structure archive at the run in @p dataPath. The state files
+   * of archived structures are not archived, so they are loaded from
+   * their directories as usual.
+   */
+  void loadStructureArchive(const QString& dataPath);
+
+  /// Whether the directory of @p s may be packed into the archive, i.e.,
+  /// whether its status is final. @p s must be locked.
+  static bool isArchivable(const Structure& s);
+
+  /// The journal of structure events since the last full save
+  StructureJournal& structureJournal() { return m_structureJournal; }
+
+  /**
+   * Record an event for @p s in the structure journal. Nothing is recorded
+   * while starting, in read-only mode, or before the run has a directory.
+   *
+   * @param s The structure. It must be locked by the caller.
+   * @param type The type of the event.
+   */
+  void journalStructure(Structure* s, StructureJournal::EventType type);
+
+  /**
+   * Apply the journal of the run in @p dataPath to @p structures. Only
+   * the events after @p savedSequence, the last event that the state file
+   * being loaded contains, are applied. Structures are matched by the name
+   * of their directory, and events of structures that are not in
+   * @p structures are skipped.
+   *
+   * @return The structures that were changed.
+   */
+  QList<Structure*> replayStructureJournal(
+    const QString& dataPath, quint64 savedSequence,
+    const QList<Structure*>& structures);
+
   /**
    * In CLI mode, read the runtime file to update options.
    * If the runtime file is not found, this should do nothing.
    */
   virtual void readRuntimeOptions() = 0;
 
+  /**
+   * The runtime file read by readRuntimeOptions(). The QueueManager
+   * watches it and calls readRuntimeOptions() when it changes. An empty
+   * string means that there is no runtime file.
+   */
+  virtual QString CLIRuntimeFile() const { return QString(); }
+
   /**
    * Generate a sorted, trimmed, cumulative probability list for selecting a
    * structure.
@@ -204,6 +296,13 @@ public:
    * high hardness is favored. A value closer to 0 puts more importance on low
    * enthalpy, and a value closer to 1 puts more importance on high hardness.
    *
+   * If @p fitnessEvaluator has active terms, each term k adds
+   * - wk (Xk - Xbest) / (Xworst - Xbest) inside the brackets, and the
+   * enthalpy weight becomes (1 - w - sum(wk)). If w + sum(wk) is greater
+   * than 1, w and the wk are scaled so that they sum to 1 and the enthalpy
+   * is not considered. A property that is the same for every structure
+   * does not contribute.
+   *
    * @param structures The list of structures to consider (if the hardness
    *                   weight is greater than 0, do not include structures
    *                   whose hardness isn't set (i. e., less than 0)).
@@ -214,6 +313,8 @@ public:
    *                       be between 0 and 1. 0 means no hardness
    *                       consideration, and 1 means only
    *                       hardness consideration.
+   * @param fitnessEvaluator Evaluates additional weighted fitness terms.
+   *                         Optional.
    *
    * @return A list of pairs with a structure pointer and a double (the
    *         probability). This list will be trimmed so that it is not greater
@@ -225,7 +326,55 @@ public:
   static QList<QPair<Structure*, double>>
   getProbabilityList(const QList<Structure*>& structures,
                      size_t popSize,
-                     double hardnessWeight);
+                     double hardnessWeight,
+                     FitnessEvaluator* fitnessEvaluator = nullptr);
+
+  /**
+   * Select a parent from @p structures by a binary tournament on their
+   * Pareto fronts. This is used instead of getProbabilityList() when
+   * m_paretoSelection is set.
+   *
+   * The objectives are the enthalpy per formula unit (lower is better),
+   * the Vickers hardness if @p useHardness is true (higher is better), and
+   * each active term of @p fitnessEvaluator. Their weights are not used.
+   *
+   * The fronts are kept for each set of structures that is selected from,
+   * and they are only sorted again when one of the structures changed or
+   * the set changed. The best @p popSize structures by front and crowding
+   * distance take part in the tournament.
+   *
+   * @param structures The structures to select from (if @p useHardness is
+   *                   true, do not include structures whose hardness isn't
+   *                   set).
+   * @param popSize The size of the population.
+   * @param useHardness Whether hardness is one of the objectives.
+   * @param fitnessEvaluator Evaluates additional objectives. Optional.
+   *
+   * @return The selected structure, or nullptr if @p structures is empty.
+   */
+  Structure* selectFromParetoFronts(const QList<Structure*>& structures,
+                                    size_t popSize, bool useHardness,
+                                    FitnessEvaluator* fitnessEvaluator =
+                                      nullptr);
+
+  /**
+   * The Pareto fronts of @p structures with the objectives described in
+   * selectFromParetoFronts(). Front 0 is the non-dominated front. Within a
+   * front, the structures are ordered by decreasing crowding distance.
+   */
+  static std::vector<std::vector<Structure*>> getParetoFronts(
+    const QList<Structure*>& structures, bool useHardness,
+    FitnessEvaluator* fitnessEvaluator = nullptr);
+
+  /**
+   * Write the Pareto fronts of the optimized structures in @p structures
+   * to @p filename, with the objectives used by selectFromParetoFronts().
+   * Called by save() when m_paretoSelection is set.
+   *
+   * @return True on success.
+   */
+  bool writeParetoFronts(const QString& filename,
+                         const QList<Structure*>& structures);
 
   /**
    * Use Aflow machine learning to calculate the hardness of structure
@@ -237,6 +386,13 @@ public:
    */
   void calculateHardness(Structure* s);
 
+  /**
+   * Same as calculateHardness() except that all of @param structures are
+   * submitted at once. Structures that already have a calculation in
+   * flight are skipped.
+   */
+  void calculateHardnessBatch(const QList<Structure*>& structures);
+
   /**
    * In a separate thread, resubmit incomplete hardness calculations every
    * 10 minutes if m_calculateHardness is true.
@@ -245,10 +401,18 @@ public:
 
   /**
    * Run calculateHardness() on any structure that does not yet have
-   * vickersHardness info (i. e., vickersHardness() < 0.0).
+   * vickersHardness info (i. e., vickersHardness() < 0.0) and that is
+   * not already pending.
    */
   void resubmitUnfinishedHardnessCalcs();
 
+  /**
+   * Keep the received hardness results in filePath, next to the state
+   * file, so that a resumed run does not have to ask the server again.
+   * Call this once filePath is set for a new or loaded search.
+   */
+  void updateHardnessCacheFile();
+
   /**
    * Save the current search. If filename is omitted, default to
    * m_filePath + "/[search name].state". Will only save once at a time.
@@ -539,10 +703,10 @@ public:
   std::mutex saveMutex;
 
   /// True if a session is starting or being loaded
-  bool isStarting;
+  std::atomic<bool> isStarting;
 
   /// Whether readOnly mode is enabled (e.g. no connection to server)
-  bool readOnly;
+  std::atomic<bool> readOnly;
 
 signals:
   /**
@@ -1154,16 +1318,28 @@ protected slots:
   /**
    * This should be called when the aflow calculation is completed for
    * @param ind. It will obtain the data from Aflow and set the data to
-   * the structure. It will run in a separate thread.
+   * the structure. It runs in the thread that emitted the signal.
    *
    * @param ind The AflowML index to be updated.
    */
   void finishHardnessCalculation(size_t ind);
 
   /**
-   * Same as above except runs in the current thread.
+   * This should be called when the aflow calculation failed for @param ind.
+   * The structure is no longer considered pending, so it will be
+   * submitted again by the resubmission thread.
    */
-  void _finishHardnessCalculation(size_t ind);
+  void abandonHardnessCalculation(size_t ind);
+
+  /**
+   * Record a change of @p s in the structure journal, and either run a
+   * full save or write only the state file of @p s if it has a new
+   * geometry. It runs in the thread that emitted the signal.
+   *
+   * @param s The structure. It must not be locked.
+   * @param isNew Whether @p s was just added to the tracker.
+   */
+  void structureChanged(Structure* s, bool isNew);
 
 #ifdef ENABLE_SSH
 #ifndef USE_CLI_SSH
@@ -1182,6 +1358,16 @@ protected slots:
 #endif // not USE_CLI_SSH
 #endif // ENABLE_SSH
 protected:
+  /**
+   * Copy the structure state file @p stateFileName to
+   * @p stateFileName.old if it is a complete save, so that a write that
+   * is interrupted never leaves a structure without a valid state file.
+   * The caller must hold stateFileMutex.
+   *
+   * @return False if @p stateFileName exists but could not be opened.
+   */
+  bool backUpStructureStateFile(const QString& stateFileName);
+
   /// String that uniquely identifies the derived OptBase
   /// @sa getIDString
   QString m_idString;
@@ -1243,6 +1429,28 @@ protected:
   /// Whether or not to clean remote directories after completion
   bool m_cleanRemoteOnStop;
 
+  /// Holds the directories of finished structures when
+  /// m_archiveFinishedStructures is set
+  StructureArchive m_structureArchive;
+
+  /// Records structure events between full saves
+  StructureJournal m_structureJournal;
+
+  /// The journal sequence the state file was saved at. The events after it
+  /// are kept at the next save so that the .old state file may be resumed.
+  quint64 m_savedJournalSequence;
+
+  /// When the last full save was started, in ms since the epoch
+  std::atomic<qint64> m_lastFullSaveTime;
+
+  /// The Pareto fronts kept by selectFromParetoFronts() for each set of
+  /// structures, keyed by the sorted set and the number of objectives. A
+  /// caller keeps its selector alive while another one evicts it.
+  typedef std::pair<std::vector<const Structure*>, size_t> ParetoSelectorKey;
+  std::map<ParetoSelectorKey, std::shared_ptr<ParetoSelector>>
+    m_paretoSelectors;
+  std::mutex m_paretoSelectorsMutex;
+
 #ifdef ENABLE_MOLECULAR
   /// Whether or not we are in molecular mode
   bool m_molecularMode;
@@ -1252,21 +1460,49 @@ public:
   /// Log error directories?
   bool m_logErrorDirs;
 
+  /// Restart failed jobs from the last geometry they wrote?
+  bool m_restartFromCheckpoint;
+
+  /// Pack the directories of finished structures into archive files?
+  bool m_archiveFinishedStructures;
+
+  /// The minimum time in seconds between full saves. Changes in between
+  /// are written to the structure journal and to the state file of the
+  /// changed structure only. 0 saves after every change.
+  int m_fullSaveInterval;
+
   /// Calculate hardness using Aflow machine learning? (Requires internet)
   std::atomic<bool> m_calculateHardness;
 
   /// What is the weight of the hardness fitness?
   std::atomic<double> m_hardnessFitnessWeight;
 
+  /// Select parents from the Pareto fronts of the objectives instead of
+  /// from a weighted sum of them. Also writes pareto.txt when saving.
+  std::atomic<bool> m_paretoSelection;
+
   /// Only one QNetworkAccessManager is needed for a whole program
   std::shared_ptr<QNetworkAccessManager> m_networkAccessManager;
 
   /// For performing Aflow ML calculations
   std::unique_ptr<AflowML> m_aflowML;
 
+  /// The in-process fitness terms used in addition to enthalpy and hardness
+  std::unique_ptr<FitnessEvaluator> m_fitnessEvaluator;
+
+  /// Remove the pending hardness calculation for AflowML index @p ind and
+  /// return its structure (or nullptr if there is none).
+  Structure* takePendingHardnessCalculation(size_t ind);
+
   /// A map of the AflowML indicies to their pending hardness calculations
   std::unordered_map<size_t, Structure*> m_pendingHardnessCalculations;
 
+  /// The structures in m_pendingHardnessCalculations
+  std::unordered_set<Structure*> m_pendingHardnessStructures;
+
+  /// Guards the pending hardness containers
+  std::mutex m_pendingHardnessMutex;
+
   /// Should we cancel the job if a number of hours are exceeded?
   /// This is primarily implemented because some optimizers have
   /// bugs that cause them to run forever. But also because XtalOpt
@@ -221,6 +221,22 @@ bool Optimizer::checkForSuccessfulOutput(Structure* s, bool* success)
   return true;
 }
 
+bool Optimizer::checkCompletion(Structure* s, bool* exists, bool* success)
+{
+  return m_opt->queueInterface(s->getCurrentOptStep())
+    ->checkCompletion(s, m_completionFilename, m_completionStrings, exists,
+                      success);
+}
+
+bool Optimizer::checkCompletionStepwise(Structure* s, bool* exists,
+                                        bool* success)
+{
+  *success = false;
+  if (!checkIfOutputFileExists(s, exists))
+    return false;
+  return !*exists || checkForSuccessfulOutput(s, success);
+}
+
 bool Optimizer::update(Structure* structure)
 {
   // lock structure
@@ -298,6 +314,29 @@ bool Optimizer::read(Structure* structure, const QString& filename)
   return true;
 }
 
+bool Optimizer::readCheckpoint(Structure* structure, Structure* checkpoint)
+{
+  if (m_checkpointFilenames.isEmpty())
+    return false;
+
+  // Copy remote files over
+  if (!m_opt->queueInterface(structure->getCurrentOptStep())
+         ->prepareForStructureUpdate(structure)) {
+    m_opt->warning(tr("Optimizer::readCheckpoint: Error while copying the "
+                      "files of structure %1")
+                     .arg(structure->getIDString()));
+    return false;
+  }
+
+  for (int i = 0; i < m_checkpointFilenames.size(); i++) {
+    if (read(checkpoint,
+             structure->fileName() + "/" + m_checkpointFilenames.at(i))) {
+      return true;
+    }
+  }
+  return false;
+}
+
 bool Optimizer::setData(const QString& identifier, const QVariant& data)
 {
   Q_ASSERT(m_data.contains(identifier));
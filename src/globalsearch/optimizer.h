@@ -138,6 +138,22 @@ public:
    */
   virtual bool checkForSuccessfulOutput(Structure* s, bool* success);
 
+  /**
+   * Check whether m_completionFilename exists for Structure \a s and,
+   * if it does, whether it contains any of the m_completionStrings.
+   * This gives the same results as checkIfOutputFileExists() followed
+   * by checkForSuccessfulOutput(), but the queue interface may do it in
+   * one step (one command on a remote server instead of one for each
+   * check).
+   *
+   * @note Optimizers that override checkIfOutputFileExists() or
+   * checkForSuccessfulOutput() must override this to call
+   * checkCompletionStepwise().
+   *
+   * @return True if the test encountered no errors, false otherwise.
+   */
+  virtual bool checkCompletion(Structure* s, bool* exists, bool* success);
+
   /**
    * Copy the files from the Structure's remote path to the local
    * path, and then update the Structure based on the optimization
@@ -175,6 +191,26 @@ public:
    */
   virtual bool read(Structure* structure, const QString& filename);
 
+  /**
+   * Copy the files of an interrupted or failed run from the Structure's
+   * remote path to the local path, and read the last geometry that the
+   * run wrote into \a checkpoint.
+   *
+   * @param structure Structure whose run was interrupted.
+   * @param checkpoint Structure to read the geometry into.
+   *
+   * @return True if a geometry was read, false otherwise (e.g. the
+   * optimizer does not write checkpoints).
+   * @sa checkpointFilenames
+   */
+  virtual bool readCheckpoint(Structure* structure, Structure* checkpoint);
+
+  /**
+   * @return The files that hold the last geometry of a run that did not
+   * finish. Empty if the optimizer does not write any.
+   */
+  QStringList checkpointFilenames() const { return m_checkpointFilenames; }
+
   /**
    * Get generic data associated with the optimizer.
    *
@@ -327,6 +363,12 @@ protected:
    */
   virtual void writeDataToSettings(const QString& filename = "");
 
+  /**
+   * checkIfOutputFileExists() followed by checkForSuccessfulOutput() if
+   * the file exists. See checkCompletion().
+   */
+  bool checkCompletionStepwise(Structure* s, bool* exists, bool* success);
+
   /**
    * Store generic data types. This is not commonly used, see
    * XtalOpt's VASPOptimizer for an example where it is used to
@@ -358,6 +400,12 @@ protected:
    */
   QStringList m_outputFilenames;
 
+  /**
+   * List of filenames that hold the last geometry of an interrupted
+   * run (will be checked in order of index).
+   */
+  QStringList m_checkpointFilenames;
+
   /**
    * Commandline instruction to run this program locally
    *
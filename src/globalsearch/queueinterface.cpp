@@ -30,4 +30,41 @@ bool QueueInterface::writeInputFiles(Structure* s) const
     s, m_opt->optimizer(s->getCurrentOptStep())->getInterpretedTemplates(s));
 }
 
+bool QueueInterface::checkCompletion(Structure* s, const QString& filename,
+                                     const QStringList& completionStrings,
+                                     bool* exists, bool* success)
+{
+  *success = false;
+  if (!checkIfFileExists(s, filename, exists))
+    return false;
+  if (!*exists)
+    return true;
+
+  for (const QString& completionString : completionStrings) {
+    int ec;
+    if (!grepFile(s, completionString, filename, 0, &ec))
+      return false;
+    if (ec == 0) {
+      *success = true;
+      return true;
+    }
+  }
+  return true;
+}
+
+QString QueueInterface::settingsIndex() const
+{
+  if (m_owner) {
+    QString ownerIndex = m_owner->settingsIndex();
+    if (ownerIndex.isEmpty())
+      return ownerIndex;
+    return ownerIndex + "/backends/" + QString::number(m_ownerIndex);
+  }
+
+  int optInd = m_opt->queueInterfaceIndex(this);
+  if (optInd < 0)
+    return QString();
+  return QString::number(optInd);
+}
+
 } // end namespace GlobalSearch
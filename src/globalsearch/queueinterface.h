@@ -50,7 +50,8 @@ public:
    * @param settingFile Filename from which to initialize settings.
    */
   explicit QueueInterface(OptBase* parent, const QString& settingFile = "")
-    : QObject(parent), m_opt(parent), m_hasDialog(false), m_dialog(0){};
+    : QObject(parent), m_opt(parent), m_hasDialog(false), m_dialog(0),
+      m_owner(nullptr), m_ownerIndex(0){};
 
   /**
    * Destructor
@@ -242,6 +243,25 @@ public slots:
                         int* exitcode = 0,
                         const bool caseSensitive = true) const = 0;
 
+  /**
+   * Check if the file \a filename exists in the working directory of
+   * Structure \a s and, if it does, whether it contains any of
+   * \a completionStrings. This is the same as calling checkIfFileExists()
+   * and then grepFile() for each string, which is what this default
+   * implementation does. Remote interfaces check both with one command.
+   *
+   * @param s Structure of interest
+   * @param filename Name of the file to check
+   * @param completionStrings Text to match, as with grepFile()
+   * @param exists Whether the file exists (return)
+   * @param success Whether the file contains any of the strings (return)
+   *
+   * @return True if the check encountered no errors, false otherwise.
+   */
+  virtual bool checkCompletion(Structure* s, const QString& filename,
+                               const QStringList& completionStrings,
+                               bool* exists, bool* success);
+
   /**
    * @return The name of the queue interface (e.g. "Local", "PBS",
    * etc)
@@ -266,6 +286,14 @@ public slots:
     return m_templates.contains(name);
   }
 
+  /**
+   * @return The name of the settings group for this interface's opt step.
+   * This is the opt step itself for an interface that is used directly, or
+   * "<optStep>/backends/<i>" for the i'th backend of a
+   * LoadBalancingQueueInterface. Empty if the interface is not in use.
+   */
+  QString settingsIndex() const;
+
   /**
    * Get the current optimizer being used for a particular structure.
    */
@@ -307,6 +335,13 @@ protected:
 
   /// Pointer to configuration dialog (may be nullptr)
   QDialog* m_dialog;
+
+  /// The load balancer this is a backend of (may be nullptr)
+  /// @sa settingsIndex
+  const QueueInterface* m_owner;
+  int m_ownerIndex;
+
+  friend class LoadBalancingQueueInterface;
 };
 }
 
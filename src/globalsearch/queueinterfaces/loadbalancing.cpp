@@ -0,0 +1,569 @@
+/**********************************************************************
+  LoadBalancingQueueInterface - Spread the jobs of one optimization step
+                                over several queue interfaces
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ ***********************************************************************/
+
+#include <globalsearch/queueinterfaces/loadbalancing.h>
+
+#include <globalsearch/macros.h>
+#include <globalsearch/optbase.h>
+#include <globalsearch/optimizer.h>
+#include <globalsearch/structure.h>
+
+#include <QDebug>
+#include <QSettings>
+
+namespace GlobalSearch {
+
+// The weight of the newest sample in the average queue wait
+static const double QUEUE_WAIT_SMOOTHING = 0.3;
+
+double LoadBalancingQueueInterface::BackendStats::failureRate() const
+{
+  size_t numFinished = numSucceeded + numFailed;
+  if (numFinished == 0)
+    return 0.0;
+  return static_cast<double>(numFailed) / numFinished;
+}
+
+double LoadBalancingQueueInterface::BackendStats::throughput() const
+{
+  if (!firstSubmission.isValid())
+    return 0.0;
+  double hours =
+    firstSubmission.secsTo(QDateTime::currentDateTime()) / 3600.0;
+  if (hours <= 0.0)
+    return 0.0;
+  return numSucceeded / hours;
+}
+
+LoadBalancingQueueInterface::LoadBalancingQueueInterface(
+  OptBase* parent, const QString& settingsFile)
+  : QueueInterface(parent, settingsFile)
+{
+  m_idString = "LoadBalancing";
+
+  readSettings(settingsFile);
+}
+
+LoadBalancingQueueInterface::~LoadBalancingQueueInterface()
+{
+}
+
+QueueInterface* LoadBalancingQueueInterface::addBackend(
+  std::unique_ptr<QueueInterface> backend, size_t maxJobs)
+{
+  if (!backend)
+    return nullptr;
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  backend->m_owner = this;
+  backend->m_ownerIndex = m_backends.size();
+
+  for (const auto& name : backend->getTemplateFileNames()) {
+    if (!m_templates.contains(name))
+      m_templates.append(name);
+  }
+
+  BackendStats stats;
+  stats.maxJobs = maxJobs;
+  m_stats.push_back(stats);
+  m_backends.push_back(std::move(backend));
+  return m_backends.back().get();
+}
+
+void LoadBalancingQueueInterface::clearBackends()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_backends.clear();
+  m_stats.clear();
+  m_assignments.clear();
+  m_templates.clear();
+}
+
+size_t LoadBalancingQueueInterface::numBackends() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_backends.size();
+}
+
+QueueInterface* LoadBalancingQueueInterface::backend(size_t i) const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return i < m_backends.size() ? m_backends[i].get() : nullptr;
+}
+
+LoadBalancingQueueInterface::BackendStats
+LoadBalancingQueueInterface::backendStats(size_t i) const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return i < m_stats.size() ? m_stats[i] : BackendStats();
+}
+
+QueueInterface* LoadBalancingQueueInterface::backendOf(Structure* s) const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  auto it = m_assignments.find(s);
+  if (it == m_assignments.end())
+    return nullptr;
+  return m_backends[it->second.backend].get();
+}
+
+bool LoadBalancingQueueInterface::hasRemoteBackends() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  for (const auto& backend : m_backends) {
+    if (backend->getIDString().toLower() != "local")
+      return true;
+  }
+  return false;
+}
+
+QString LoadBalancingQueueInterface::statisticsString() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  QString ret;
+  for (size_t i = 0; i < m_backends.size(); ++i) {
+    const BackendStats& stats = m_stats[i];
+    ret += QString("%1 %2: active %3/%4, submitted %5, succeeded %6, "
+                   "failed %7 (%8%), queue wait %9 s, %10 per hour\n")
+             .arg(i)
+             .arg(m_backends[i]->getIDString())
+             .arg(stats.numActive)
+             .arg(stats.maxJobs == 0 ? QString("inf")
+                                     : QString::number(stats.maxJobs))
+             .arg(stats.numSubmitted)
+             .arg(stats.numSucceeded)
+             .arg(stats.numFailed)
+             .arg(stats.failureRate() * 100.0, 0, 'f', 1)
+             .arg(stats.averageQueueWait, 0, 'f', 1)
+             .arg(stats.throughput(), 0, 'f', 2);
+  }
+  return ret;
+}
+
+bool LoadBalancingQueueInterface::isReadyToSearch(QString* err)
+{
+  if (numBackends() == 0) {
+    *err = tr("No backends are set for the load balancing queue interface.");
+    return false;
+  }
+
+  for (size_t i = 0; i < numBackends(); ++i) {
+    if (!backend(i)->isReadyToSearch(err))
+      return false;
+  }
+
+  *err = "";
+  return true;
+}
+
+void LoadBalancingQueueInterface::readSettings(const QString& filename)
+{
+  QString optInd = settingsIndex();
+  if (optInd.isEmpty())
+    return;
+
+  QStringList names;
+  QList<QVariant> maxJobs;
+  {
+    SETTINGS(filename);
+
+    settings->beginGroup(m_opt->getIDString().toLower());
+    settings->beginGroup("queueinterface/loadbalancingqueueinterface");
+    settings->beginGroup(optInd);
+
+    names = settings->value("backends").toStringList();
+    maxJobs = settings->value("maxJobs").toList();
+
+    QStringList assignedFiles = settings->value("assignedFiles").toStringList();
+    QList<QVariant> assignedBackends =
+      settings->value("assignedBackends").toList();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_savedAssignments.clear();
+    for (int i = 0; i < assignedFiles.size() && i < assignedBackends.size();
+         ++i) {
+      m_savedAssignments[assignedFiles[i]] = assignedBackends[i].toInt();
+    }
+
+    settings->endGroup();
+    settings->endGroup();
+    settings->endGroup();
+  }
+
+  // Only rebuild the backends if the list has changed
+  QStringList currentNames;
+  for (size_t i = 0; i < numBackends(); ++i)
+    currentNames.append(backend(i)->getIDString().toLower());
+
+  if (!names.isEmpty() && names != currentNames) {
+    clearBackends();
+    for (int i = 0; i < names.size(); ++i) {
+      std::unique_ptr<QueueInterface> qi =
+        m_opt->createQueueInterface(names[i].toStdString());
+      if (!qi) {
+        qDebug() << "Error in" << __FUNCTION__ << ": unknown backend"
+                 << names[i];
+        continue;
+      }
+      addBackend(std::move(qi),
+                 i < maxJobs.size() ? maxJobs[i].toUInt() : 0);
+    }
+  }
+
+  for (size_t i = 0; i < numBackends(); ++i) {
+    backend(i)->readSettings(filename);
+    if (static_cast<int>(i) < maxJobs.size()) {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_stats[i].maxJobs = maxJobs[i].toUInt();
+    }
+  }
+}
+
+void LoadBalancingQueueInterface::writeSettings(const QString& filename)
+{
+  QString optInd = settingsIndex();
+  if (optInd.isEmpty())
+    return;
+
+  {
+    SETTINGS(filename);
+
+    settings->beginGroup(m_opt->getIDString().toLower());
+    settings->beginGroup("queueinterface/loadbalancingqueueinterface");
+    settings->beginGroup(optInd);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    QStringList names;
+    QList<QVariant> maxJobs;
+    for (size_t i = 0; i < m_backends.size(); ++i) {
+      names.append(m_backends[i]->getIDString().toLower());
+      maxJobs.append(static_cast<uint>(m_stats[i].maxJobs));
+    }
+    settings->setValue("backends", names);
+    settings->setValue("maxJobs", maxJobs);
+
+    QHash<QString, int> assignments = m_savedAssignments;
+    for (const auto& assignment : m_assignments) {
+      assignments[assignment.first->fileName()] =
+        static_cast<int>(assignment.second.backend);
+    }
+    QStringList assignedFiles;
+    QList<QVariant> assignedBackends;
+    for (auto it = assignments.constBegin(); it != assignments.constEnd();
+         ++it) {
+      assignedFiles.append(it.key());
+      assignedBackends.append(it.value());
+    }
+    settings->setValue("assignedFiles", assignedFiles);
+    settings->setValue("assignedBackends", assignedBackends);
+
+    settings->endGroup();
+    settings->endGroup();
+    settings->endGroup();
+  }
+
+  for (size_t i = 0; i < numBackends(); ++i)
+    backend(i)->writeSettings(filename);
+}
+
+bool LoadBalancingQueueInterface::writeInputFiles(Structure* s) const
+{
+  // The templates do not depend on the backend. The backend is picked in
+  // writeFiles(), and a structure whose previous job has finished may be
+  // sent to a different one than before.
+  QHash<QString, QString> files =
+    m_opt->optimizer(s->getCurrentOptStep())->getInterpretedTemplates(s);
+  return writeFiles(s, files);
+}
+
+bool LoadBalancingQueueInterface::writeFiles(
+  Structure* s, const QHash<QString, QString>& files) const
+{
+  QueueInterface* qi = assignedBackend(s);
+  if (!qi)
+    return false;
+  return qi->writeFiles(s, files);
+}
+
+bool LoadBalancingQueueInterface::startJob(Structure* s)
+{
+  QueueInterface* qi = assignedBackend(s);
+  if (!qi)
+    return false;
+
+  bool ok = qi->startJob(s);
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  auto it = m_assignments.find(s);
+  if (it == m_assignments.end())
+    it = m_assignments.insert(std::make_pair(s, Assignment())).first;
+  Assignment& assignment = it->second;
+  BackendStats& stats = m_stats[assignment.backend];
+  if (!ok) {
+    ++stats.numFailed;
+    if (!assignment.active)
+      forgetLocked(it);
+    return false;
+  }
+
+  assignment.submitted = QDateTime::currentDateTime();
+  assignment.seenRunning = false;
+  if (!assignment.active) {
+    assignment.active = true;
+    ++stats.numActive;
+  }
+  ++stats.numSubmitted;
+  if (!stats.firstSubmission.isValid())
+    stats.firstSubmission = assignment.submitted;
+  return true;
+}
+
+bool LoadBalancingQueueInterface::stopJob(Structure* s)
+{
+  QueueInterface* qi = knownBackend(s);
+  if (!qi)
+    return false;
+
+  bool ok = qi->stopJob(s);
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  auto it = m_assignments.find(s);
+  if (it != m_assignments.end()) {
+    if (it->second.active)
+      --m_stats[it->second.backend].numActive;
+    forgetLocked(it);
+  }
+  return ok;
+}
+
+QueueInterface::QueueStatus LoadBalancingQueueInterface::getStatus(
+  Structure* s) const
+{
+  QueueInterface* qi = knownBackend(s);
+  if (!qi)
+    return QueueInterface::Unknown;
+
+  QueueInterface::QueueStatus status = qi->getStatus(s);
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  auto it = m_assignments.find(s);
+  if (it == m_assignments.end()) {
+    // The job has finished and was already counted, or it finished before
+    // the search was resumed.
+    if (status == QueueInterface::Success || status == QueueInterface::Error)
+      return status;
+
+    // This job was started before the search was resumed. We do not know
+    // how long it waited.
+    Assignment assignment;
+    assignment.backend = qi->m_ownerIndex;
+    assignment.seenRunning = true;
+    assignment.active = true;
+    ++m_stats[assignment.backend].numActive;
+    it = m_assignments.insert(std::make_pair(s, assignment)).first;
+  }
+
+  Assignment& assignment = it->second;
+  BackendStats& stats = m_stats[assignment.backend];
+  switch (status) {
+    case QueueInterface::Running:
+    case QueueInterface::Started:
+      if (!assignment.seenRunning) {
+        assignment.seenRunning = true;
+        if (assignment.submitted.isValid()) {
+          double wait =
+            assignment.submitted.msecsTo(QDateTime::currentDateTime()) /
+            1000.0;
+          if (stats.numWaitSamples == 0) {
+            stats.averageQueueWait = wait;
+          } else {
+            stats.averageQueueWait =
+              (1.0 - QUEUE_WAIT_SMOOTHING) * stats.averageQueueWait +
+              QUEUE_WAIT_SMOOTHING * wait;
+          }
+          ++stats.numWaitSamples;
+        }
+      }
+      break;
+    case QueueInterface::Success:
+      finishLocked(assignment, true);
+      forgetLocked(it);
+      break;
+    case QueueInterface::Error:
+      finishLocked(assignment, false);
+      forgetLocked(it);
+      break;
+    default:
+      break;
+  }
+
+  return status;
+}
+
+bool LoadBalancingQueueInterface::prepareForStructureUpdate(
+  Structure* s) const
+{
+  QueueInterface* qi = knownBackend(s);
+  return qi && qi->prepareForStructureUpdate(s);
+}
+
+bool LoadBalancingQueueInterface::checkIfFileExists(Structure* s,
+                                                    const QString& filename,
+                                                    bool* exists)
+{
+  QueueInterface* qi = knownBackend(s);
+  return qi && qi->checkIfFileExists(s, filename, exists);
+}
+
+bool LoadBalancingQueueInterface::fetchFile(Structure* s,
+                                            const QString& filename,
+                                            QString* contents) const
+{
+  QueueInterface* qi = knownBackend(s);
+  return qi && qi->fetchFile(s, filename, contents);
+}
+
+bool LoadBalancingQueueInterface::grepFile(Structure* s,
+                                           const QString& matchText,
+                                           const QString& filename,
+                                           QStringList* matches,
+                                           int* exitcode,
+                                           const bool caseSensitive) const
+{
+  QueueInterface* qi = knownBackend(s);
+  return qi &&
+         qi->grepFile(s, matchText, filename, matches, exitcode, caseSensitive);
+}
+
+bool LoadBalancingQueueInterface::checkCompletion(
+  Structure* s, const QString& filename, const QStringList& completionStrings,
+  bool* exists, bool* success)
+{
+  QueueInterface* qi = knownBackend(s);
+  return qi &&
+         qi->checkCompletion(s, filename, completionStrings, exists, success);
+}
+
+size_t LoadBalancingQueueInterface::selectBackendLocked() const
+{
+  const QDateTime now = QDateTime::currentDateTime();
+
+  // Jobs that are still waiting count towards the observed wait, so a
+  // jammed queue stops getting jobs before any of them start.
+  std::vector<double> observedWait(m_backends.size(), 0.0);
+  for (size_t i = 0; i < m_stats.size(); ++i)
+    observedWait[i] = m_stats[i].averageQueueWait;
+  for (const auto& assignment : m_assignments) {
+    const Assignment& a = assignment.second;
+    if (a.active && !a.seenRunning && a.submitted.isValid()) {
+      double wait = a.submitted.msecsTo(now) / 1000.0;
+      if (wait > observedWait[a.backend])
+        observedWait[a.backend] = wait;
+    }
+  }
+
+  size_t best = 0;
+  bool bestHasCapacity = false;
+  double bestWait = 0.0;
+  for (size_t i = 0; i < m_backends.size(); ++i) {
+    const BackendStats& stats = m_stats[i];
+    bool hasCapacity = stats.maxJobs == 0 || stats.numActive < stats.maxJobs;
+    // Each failure costs another wait in the queue
+    double successRate = (stats.numSucceeded + 1.0) /
+                         (stats.numSucceeded + stats.numFailed + 1.0);
+    double expectedWait = observedWait[i] / successRate;
+
+    bool better;
+    if (i == 0)
+      better = true;
+    else if (hasCapacity != bestHasCapacity)
+      better = hasCapacity;
+    else if (expectedWait != bestWait)
+      better = expectedWait < bestWait;
+    else if (stats.failureRate() != m_stats[best].failureRate())
+      better = stats.failureRate() < m_stats[best].failureRate();
+    else
+      better = stats.numActive < m_stats[best].numActive;
+
+    if (better) {
+      best = i;
+      bestHasCapacity = hasCapacity;
+      bestWait = expectedWait;
+    }
+  }
+  return best;
+}
+
+QueueInterface* LoadBalancingQueueInterface::assignedBackend(Structure* s) const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (m_backends.empty())
+    return nullptr;
+
+  auto it = m_assignments.find(s);
+  if (it != m_assignments.end() && it->second.active)
+    return m_backends[it->second.backend].get();
+
+  Assignment assignment;
+  assignment.backend = selectBackendLocked();
+  assignment.seenRunning = false;
+  assignment.active = false;
+  m_assignments[s] = assignment;
+  return m_backends[assignment.backend].get();
+}
+
+QueueInterface* LoadBalancingQueueInterface::knownBackend(Structure* s) const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (m_backends.empty())
+    return nullptr;
+
+  auto it = m_assignments.find(s);
+  if (it != m_assignments.end())
+    return m_backends[it->second.backend].get();
+
+  int saved = m_savedAssignments.value(s->fileName(), 0);
+  if (saved < 0 || saved >= static_cast<int>(m_backends.size()))
+    saved = 0;
+  return m_backends[saved].get();
+}
+
+void LoadBalancingQueueInterface::forgetLocked(
+  std::map<const Structure*, Assignment>::iterator it) const
+{
+  // The output files are still fetched from the backend after the job
+  // finishes, so it is remembered by file name like the assignments that
+  // are read from the state file.
+  m_savedAssignments[it->first->fileName()] =
+    static_cast<int>(it->second.backend);
+  m_assignments.erase(it);
+}
+
+void LoadBalancingQueueInterface::finishLocked(Assignment& assignment,
+                                               bool success) const
+{
+  if (!assignment.active)
+    return;
+
+  assignment.active = false;
+  BackendStats& stats = m_stats[assignment.backend];
+  --stats.numActive;
+  if (success)
+    ++stats.numSucceeded;
+  else
+    ++stats.numFailed;
+}
+}
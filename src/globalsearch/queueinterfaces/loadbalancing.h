@@ -0,0 +1,190 @@
+/**********************************************************************
+  LoadBalancingQueueInterface - Spread the jobs of one optimization step
+                                over several queue interfaces
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ ***********************************************************************/
+
+#ifndef LOADBALANCINGQUEUEINTERFACE_H
+#define LOADBALANCINGQUEUEINTERFACE_H
+
+#include <globalsearch/queueinterface.h>
+
+#include <QDateTime>
+#include <QHash>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace GlobalSearch {
+
+/**
+ * @class LoadBalancingQueueInterface loadbalancing.h
+ * <globalsearch/queueinterfaces/loadbalancing.h>
+ *
+ * @brief A queue interface that dispatches each job to one of several
+ * backend queue interfaces.
+ *
+ * When an opt step is bound to a single queue and that queue is jammed,
+ * every structure waits there even if another allocation is idle. This
+ * interface holds several backends (for instance, two SLURM clusters
+ * selected with different submit commands and a local pool) and sends
+ * each job to the backend with free capacity and the shortest expected
+ * wait.
+ *
+ * The expected wait of a backend is its observed queue wait (the time
+ * between submission and the job first being seen running, or the age
+ * of the oldest job that is still queued if that is longer) divided by
+ * its success rate, since each failure costs another submission.
+ *
+ * The backend of each structure is remembered so that the status checks
+ * and file transfers go to the right place. Once a job finishes or is
+ * stopped, only its backend index is kept (by file name), so the output
+ * can still be fetched. It is also written to the state file so that a
+ * resumed search can find its running jobs.
+ *
+ * The backends are created with OptBase::createQueueInterface() from the
+ * "backends" list in the settings, or added with addBackend().
+ */
+class LoadBalancingQueueInterface : public QueueInterface
+{
+  Q_OBJECT
+
+public:
+  /// Statistics that are kept for each backend
+  struct BackendStats
+  {
+    BackendStats()
+      : maxJobs(0), numSubmitted(0), numActive(0), numSucceeded(0),
+        numFailed(0), averageQueueWait(0.0), numWaitSamples(0)
+    {
+    }
+
+    /// The maximum number of jobs at once, or 0 for no limit
+    size_t maxJobs;
+    size_t numSubmitted;
+    /// The number of jobs that are submitted and not yet finished
+    size_t numActive;
+    size_t numSucceeded;
+    size_t numFailed;
+    /// Exponential moving average of the queue wait in seconds
+    double averageQueueWait;
+    size_t numWaitSamples;
+    QDateTime firstSubmission;
+
+    /// Failed jobs divided by finished jobs
+    double failureRate() const;
+
+    /// Succeeded jobs per hour since the first submission
+    double throughput() const;
+  };
+
+  explicit LoadBalancingQueueInterface(OptBase* parent,
+                                       const QString& settingsFile = "");
+
+  virtual ~LoadBalancingQueueInterface() override;
+
+  /**
+   * Add a backend.
+   *
+   * @param backend The queue interface to take ownership of.
+   * @param maxJobs The maximum number of jobs to run on it at once, or 0
+   *                for no limit.
+   *
+   * @return The backend.
+   */
+  QueueInterface* addBackend(std::unique_ptr<QueueInterface> backend,
+                             size_t maxJobs = 0);
+
+  /// Remove all of the backends and forget the assignments
+  void clearBackends();
+
+  size_t numBackends() const;
+  QueueInterface* backend(size_t i) const;
+  BackendStats backendStats(size_t i) const;
+
+  /// The backend that @p s is assigned to, or nullptr if it is not
+  /// assigned to one.
+  QueueInterface* backendOf(Structure* s) const;
+
+  /// True if any of the backends is not a local queue interface
+  bool hasRemoteBackends() const;
+
+  /// One line for each backend with its statistics
+  QString statisticsString() const;
+
+  virtual bool isReadyToSearch(QString* err) override;
+
+public slots:
+  void readSettings(const QString& filename = "") override;
+  void writeSettings(const QString& filename = "") override;
+
+  /// Picks a backend for @p s and writes the input files there
+  bool writeInputFiles(Structure* s) const override;
+  bool writeFiles(Structure* s,
+                  const QHash<QString, QString>& files) const override;
+  bool startJob(Structure* s) override;
+  bool stopJob(Structure* s) override;
+  QueueInterface::QueueStatus getStatus(Structure* s) const override;
+  bool prepareForStructureUpdate(Structure* s) const override;
+  bool checkIfFileExists(Structure* s, const QString& filename,
+                         bool* exists) override;
+  bool fetchFile(Structure* s, const QString& filename,
+                 QString* contents) const override;
+  bool grepFile(Structure* s, const QString& matchText,
+                const QString& filename, QStringList* matches = 0,
+                int* exitcode = 0,
+                const bool caseSensitive = true) const override;
+  bool checkCompletion(Structure* s, const QString& filename,
+                       const QStringList& completionStrings, bool* exists,
+                       bool* success) override;
+
+private:
+  struct Assignment
+  {
+    size_t backend;
+    QDateTime submitted;
+    bool seenRunning;
+    bool active;
+  };
+
+  // Picks the backend that a new job should go to. m_mutex must be locked.
+  size_t selectBackendLocked() const;
+
+  // The backend of @p s, assigning one if there is none
+  QueueInterface* assignedBackend(Structure* s) const;
+
+  // Returns the backend @p s was assigned to, falling back to the
+  // assignments read from the settings and then to the first backend.
+  // Returns nullptr only if there are no backends.
+  QueueInterface* knownBackend(Structure* s) const;
+
+  // Marks the job of @p s as finished. m_mutex must be locked.
+  void finishLocked(Assignment& assignment, bool success) const;
+
+  // Drops the assignment of a job that has finished or was stopped, and
+  // keeps its backend in m_savedAssignments. m_mutex must be locked.
+  void forgetLocked(
+    std::map<const Structure*, Assignment>::iterator it) const;
+
+  std::vector<std::unique_ptr<QueueInterface>> m_backends;
+  mutable std::vector<BackendStats> m_stats;
+  mutable std::map<const Structure*, Assignment> m_assignments;
+  // Backend indices by structure file name, read from the state file or
+  // kept when a job finishes
+  mutable QHash<QString, int> m_savedAssignments;
+  mutable std::mutex m_mutex;
+};
+}
+
+#endif // LOADBALANCINGQUEUEINTERFACE_H
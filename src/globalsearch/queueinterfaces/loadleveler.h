@@ -24,8 +24,6 @@
 #include <globalsearch/queueinterfaces/loadlevelerdialog.h>
 #include <globalsearch/queueinterfaces/remote.h>
 
-#include <QDateTime>
-#include <QReadWriteLock>
 #include <QString>
 #include <QStringList>
 
@@ -59,14 +57,6 @@ protected:
   // Unit test these:
   QString parseStatus(const QStringList& statusList, unsigned int jobId) const;
   unsigned int parseJobId(const QString& submissionOutput, bool* ok) const;
-  // Fetches the queue from the server
-  QStringList getQueueList() const;
-  // Cached queue data
-  QStringList m_queueData;
-  // Limits queue checks to once per second
-  QDateTime m_queueTimeStamp;
-  // Locks for m_queueData;
-  QReadWriteLock m_queueMutex;
 };
 }
 
@@ -24,8 +24,6 @@
 #include <globalsearch/queueinterfaces/pbsdialog.h>
 #include <globalsearch/queueinterfaces/remote.h>
 
-#include <QDateTime>
-#include <QReadWriteLock>
 #include <QString>
 #include <QStringList>
 
@@ -52,16 +50,6 @@ public slots:
   bool startJob(Structure* s) override;
   bool stopJob(Structure* s) override;
   QueueInterface::QueueStatus getStatus(Structure* s) const override;
-
-protected:
-  // Fetches the queue from the server
-  QStringList getQueueList() const;
-  // Cached queue data
-  QStringList m_queueData;
-  // Limits queue checks to once per second
-  QDateTime m_queueTimeStamp;
-  // Locks for m_queueData;
-  QReadWriteLock m_queueMutex;
 };
 }
 
@@ -16,11 +16,13 @@
 #ifndef GLOBALSEARCH_QUEUEINTERFACES_H
 #define GLOBALSEARCH_QUEUEINTERFACES_H
 
+#include <globalsearch/queueinterfaces/loadbalancing.h>
 #include <globalsearch/queueinterfaces/loadleveler.h>
 #include <globalsearch/queueinterfaces/local.h>
 #include <globalsearch/queueinterfaces/lsf.h>
 #include <globalsearch/queueinterfaces/pbs.h>
 #include <globalsearch/queueinterfaces/sge.h>
+#include <globalsearch/queueinterfaces/simulated.h>
 #include <globalsearch/queueinterfaces/slurm.h>
 
 #endif
@@ -16,6 +16,7 @@
 
 #include <globalsearch/queueinterfaces/remote.h>
 
+#include <globalsearch/executor.h>
 #include <globalsearch/sshconnection.h>
 #include <globalsearch/sshmanager.h>
 #include <globalsearch/structure.h>
@@ -26,15 +27,143 @@
 
 namespace GlobalSearch {
 
+// Quotes @p str so that the shell passes it on as one argument
+static QString shellQuote(const QString& str)
+{
+  return "'" + QString(str).replace("'", "'\\''") + "'";
+}
+
 RemoteQueueInterface::RemoteQueueInterface(OptBase* parent,
                                            const QString& settingFile)
-  : QueueInterface(parent)
+  : QueueInterface(parent), m_queueRefreshing(false)
 {
   m_idString = "AbstractRemote";
 }
 
 RemoteQueueInterface::~RemoteQueueInterface()
 {
+  // A background refresh uses this object
+  std::unique_lock<std::mutex> lock(m_queueFetchMutex);
+  m_queueFetched.wait(lock, [this]() { return !m_queueRefreshing; });
+}
+
+std::shared_ptr<const RemoteQueueInterface::QueueSnapshot>
+RemoteQueueInterface::getQueueSnapshot() const
+{
+  std::shared_ptr<const QueueSnapshot> snapshot =
+    std::atomic_load(&m_queueSnapshot);
+
+  // There is nothing to return yet. The first thread fetches the queue
+  // now, and the others wait for it.
+  if (!snapshot) {
+    bool expected = false;
+    if (m_queueRefreshing.compare_exchange_strong(expected, true)) {
+      snapshot = fetchQueueSnapshot(queueListCommand(), queueListHasHeader());
+      finishQueueFetch();
+      return snapshot;
+    }
+
+    std::unique_lock<std::mutex> lock(m_queueFetchMutex);
+    m_queueFetched.wait(lock, [this, &snapshot]() {
+      snapshot = std::atomic_load(&m_queueSnapshot);
+      return snapshot != nullptr;
+    });
+    return snapshot;
+  }
+
+  if (snapshot->timeStamp.msecsTo(QDateTime::currentDateTime()) <=
+      1000 * m_opt->queueRefreshInterval()) {
+    return snapshot;
+  }
+
+  // The snapshot is stale. The first thread to notice starts a refresh,
+  // and everyone keeps using the stale snapshot until it is replaced.
+  // This is often called from an io() task, so it must not use submit(),
+  // which would run the refresh in the calling thread.
+  bool expected = false;
+  if (m_queueRefreshing.compare_exchange_strong(expected, true)) {
+    QString command = queueListCommand();
+    bool hasHeader = queueListHasHeader();
+    Executor::io().run(
+      [this, command, hasHeader]() {
+        fetchQueueSnapshot(command, hasHeader);
+        finishQueueFetch();
+      },
+      Executor::HighPriority);
+  }
+
+  return snapshot;
+}
+
+void RemoteQueueInterface::finishQueueFetch() const
+{
+  // Waiters check their condition under this lock, so none of them can
+  // miss the notification. Notifying before unlocking keeps the
+  // destructor from finishing while m_queueFetched is still in use.
+  std::lock_guard<std::mutex> lock(m_queueFetchMutex);
+  m_queueRefreshing = false;
+  m_queueFetched.notify_all();
+}
+
+QString RemoteQueueInterface::queueListCommand() const
+{
+  return m_statusCommand + " -u " + m_opt->username;
+}
+
+std::shared_ptr<const RemoteQueueInterface::QueueSnapshot>
+RemoteQueueInterface::fetchQueueSnapshot(const QString& command,
+                                         bool hasHeader) const
+{
+  std::shared_ptr<const QueueSnapshot> oldSnapshot =
+    std::atomic_load(&m_queueSnapshot);
+  std::shared_ptr<QueueSnapshot> snapshot =
+    std::make_shared<QueueSnapshot>();
+
+  SSHConnection* ssh = m_opt->ssh()->getFreeConnection();
+
+  if (ssh == nullptr) {
+    m_opt->warning(tr("Cannot connect to ssh server"));
+    snapshot->queueData << "CommError";
+    snapshot->timeStamp = QDateTime::currentDateTime();
+    std::atomic_store(&m_queueSnapshot,
+                      std::shared_ptr<const QueueSnapshot>(snapshot));
+    return snapshot;
+  }
+
+  // Execute
+  QString stdout_str;
+  QString stderr_str;
+  int ec = 0;
+  bool ok = ssh->execute(command, stdout_str, stderr_str, ec);
+  m_opt->ssh()->unlockConnection(ssh);
+
+  if (hasHeader) {
+    // stdout_str should never be empty for a successful execution
+    // There will always be column info at the beginning if nothing else.
+    ok = ok && ec == 0 && !stdout_str.isEmpty();
+  } else {
+    // Valid exit codes for grep: (0) matches found, execution successful
+    //                            (1) no matches found, execution successful
+    //                            (2) execution unsuccessful
+    ok = ok && (ec == 0 || ec == 1);
+  }
+
+  if (ok) {
+    snapshot->queueData = stdout_str.split("\n", QString::SkipEmptyParts);
+  } else {
+    m_opt->warning(tr("Error executing %1: (%2) %3\n\t"
+                      "Using cached queue data.")
+                     .arg(command)
+                     .arg(QString::number(ec))
+                     .arg(stderr_str));
+    if (oldSnapshot)
+      snapshot->queueData = oldSnapshot->queueData;
+  }
+
+  snapshot->timeStamp = QDateTime::currentDateTime();
+  std::atomic_store(&m_queueSnapshot,
+                    std::shared_ptr<const QueueSnapshot>(snapshot));
+  return snapshot;
 }
 
 bool RemoteQueueInterface::writeFiles(
@@ -249,6 +378,56 @@ bool RemoteQueueInterface::grepFile(Structure* s, const QString& matchText,
   return true;
 }
 
+bool RemoteQueueInterface::checkCompletion(Structure* s,
+                                           const QString& filename,
+                                           const QStringList& completionStrings,
+                                           bool* exists, bool* success)
+{
+  // Prints 0 if the file is missing, 2 if it contains any of the
+  // completion strings, and 1 otherwise.
+  const QString file = shellQuote(s->getRempath() + "/" + filename);
+  QString command = "if [ ! -e " + file + " ]; then echo 0; ";
+  if (!completionStrings.isEmpty()) {
+    command += "elif grep -q";
+    for (const QString& completionString : completionStrings)
+      command += " -e " + shellQuote(completionString);
+    command += " " + file + "; then echo 2; ";
+  }
+  command += "else echo 1; fi";
+
+  SSHConnection* ssh = m_opt->ssh()->getFreeConnection();
+
+  if (ssh == nullptr) {
+    m_opt->warning(tr("Cannot connect to ssh server"));
+    return false;
+  }
+
+  QString stdout_str;
+  QString stderr_str;
+  int ec = 0;
+  if (!ssh->execute(command, stdout_str, stderr_str, ec) || ec != 0) {
+    m_opt->warning(tr("Error executing %1: (%2) %3")
+                     .arg(command)
+                     .arg(QString::number(ec))
+                     .arg(stderr_str));
+    m_opt->ssh()->unlockConnection(ssh);
+    return false;
+  }
+  m_opt->ssh()->unlockConnection(ssh);
+
+  const QString result = stdout_str.trimmed();
+  if (result != "0" && result != "1" && result != "2") {
+    m_opt->warning(tr("Unexpected output from %1: %2")
+                     .arg(command)
+                     .arg(stdout_str));
+    return false;
+  }
+
+  *exists = (result != "0");
+  *success = (result == "2");
+  return true;
+}
+
 bool RemoteQueueInterface::createRemoteDirectory(Structure* structure,
                                                  SSHConnection* ssh) const
 {
@@ -19,6 +19,14 @@
 
 #include <globalsearch/queueinterface.h>
 
+#include <QDateTime>
+#include <QStringList>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
 namespace GlobalSearch {
 class SSHConnection;
 
@@ -208,7 +216,64 @@ public slots:
                         int* exitcode = 0,
                         const bool caseSensitive = true) const override;
 
+  /**
+   * Check if the file \a filename exists in the working directory of
+   * Structure \a s and whether it contains any of \a completionStrings
+   * with a single command on the server.
+   *
+   * @sa QueueInterface::checkCompletion
+   */
+  virtual bool checkCompletion(Structure* s, const QString& filename,
+                               const QStringList& completionStrings,
+                               bool* exists, bool* success) override;
+
 protected:
+  /**
+   * The lines printed by the status command and the time at which they
+   * were fetched. A snapshot is never modified after it is published.
+   */
+  struct QueueSnapshot
+  {
+    QStringList queueData;
+    QDateTime timeStamp;
+  };
+
+  /**
+   * Get the latest snapshot of the queue without waiting for the server.
+   *
+   * If the snapshot is older than OptBase::queueRefreshInterval(), one
+   * refresh is started in the background and the old snapshot is
+   * returned until the new one is published. Only the first call, when
+   * there is no snapshot yet, fetches the queue in the calling thread.
+   * Other calls made before that first snapshot is published wait for it.
+   * Only one fetch runs at a time.
+   *
+   * If the server cannot be reached, the queue data contains a single
+   * string, "CommError".
+   *
+   * @return The snapshot. It is never null.
+   */
+  std::shared_ptr<const QueueSnapshot> getQueueSnapshot() const;
+
+  /**
+   * @return The queue data of getQueueSnapshot().
+   */
+  QStringList getQueueList() const { return getQueueSnapshot()->queueData; }
+
+  /**
+   * @return The command that lists this user's jobs. By default, this is
+   * the status command followed by "-u <username>".
+   */
+  virtual QString queueListCommand() const;
+
+  /**
+   * @return True if the queue list command always prints a header. If it
+   * does, only an exit code of 0 with some output is accepted. Otherwise,
+   * the exit codes of grep are accepted: 0 (matches found) and 1 (no
+   * matches found).
+   */
+  virtual bool queueListHasHeader() const { return false; }
+
   /**
    * Create a working directory for \a structure on the remote
    * cluster.
@@ -263,6 +328,28 @@ protected:
 
   // Status command. For example, on slurm, this may be 'squeue'.
   QString m_statusCommand;
+
+private:
+  // Runs @p command on the server and publishes the result as the new
+  // snapshot. The command and header flag are looked up by the caller so
+  // that a background refresh does not call into a derived class.
+  std::shared_ptr<const QueueSnapshot> fetchQueueSnapshot(
+    const QString& command, bool hasHeader) const;
+
+  // Clears m_queueRefreshing after a fetch and wakes the threads that are
+  // waiting for it
+  void finishQueueFetch() const;
+
+  // See getQueueSnapshot(). Only accessed with
+  // std::atomic_load/atomic_store.
+  mutable std::shared_ptr<const QueueSnapshot> m_queueSnapshot;
+  // True while a fetch is queued or running. Whoever sets it runs the
+  // fetch, so there is never more than one.
+  mutable std::atomic<bool> m_queueRefreshing;
+  // Signaled when a fetch finishes. Waited on for the first snapshot and
+  // by the destructor, since a background refresh uses this object.
+  mutable std::mutex m_queueFetchMutex;
+  mutable std::condition_variable m_queueFetched;
 };
 }
 
@@ -0,0 +1,338 @@
+/**********************************************************************
+  SchedulerSimulator - A batch scheduler that runs in virtual time
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ ***********************************************************************/
+
+#include <globalsearch/queueinterfaces/schedulersimulator.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace GlobalSearch {
+
+SchedulerSimulator::SchedulerSimulator(unsigned int seed)
+  : m_generator(seed), m_seed(seed), m_numNodes(1), m_failureProbability(0.0),
+    m_outputDelay(0.0), m_timeOffset(0.0), m_timeScale(0.0),
+    m_realStart(std::chrono::steady_clock::now()), m_scheduleTime(0.0),
+    m_nextId(1), m_numSubmitted(0), m_numStatusQueries(0), m_numCompleted(0),
+    m_numFailed(0), m_numCancelled(0)
+{
+}
+
+size_t SchedulerSimulator::numNodes() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_numNodes;
+}
+
+void SchedulerSimulator::setNumNodes(size_t n)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  updateLocked();
+  m_numNodes = n;
+  updateLocked();
+}
+
+SchedulerSimulator::Distribution SchedulerSimulator::queueWait() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_queueWait;
+}
+
+void SchedulerSimulator::setQueueWait(const Distribution& d)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_queueWait = d;
+}
+
+SchedulerSimulator::Distribution SchedulerSimulator::runTime() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_runTime;
+}
+
+void SchedulerSimulator::setRunTime(const Distribution& d)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_runTime = d;
+}
+
+double SchedulerSimulator::failureProbability() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_failureProbability;
+}
+
+void SchedulerSimulator::setFailureProbability(double p)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_failureProbability = p;
+}
+
+double SchedulerSimulator::outputDelay() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_outputDelay;
+}
+
+void SchedulerSimulator::setOutputDelay(double seconds)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_outputDelay = seconds;
+}
+
+double SchedulerSimulator::timeScale() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_timeScale;
+}
+
+void SchedulerSimulator::setTimeScale(double scale)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  // Keep the virtual time continuous
+  m_timeOffset = nowLocked();
+  m_realStart = std::chrono::steady_clock::now();
+  m_timeScale = scale;
+}
+
+unsigned int SchedulerSimulator::seed() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_seed;
+}
+
+void SchedulerSimulator::setSeed(unsigned int seed)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_generator.seed(seed);
+  m_seed = seed;
+}
+
+double SchedulerSimulator::now() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return nowLocked();
+}
+
+void SchedulerSimulator::advance(double seconds)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_timeOffset += seconds;
+  updateLocked();
+}
+
+unsigned long SchedulerSimulator::submit()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  updateLocked();
+
+  Job job;
+  job.state = Queued;
+  job.submitTime = m_scheduleTime;
+  job.eligibleTime = job.submitTime + sampleLocked(m_queueWait);
+  job.runTime = sampleLocked(m_runTime);
+  job.startTime = -1.0;
+  job.endTime = -1.0;
+  job.willFail = std::uniform_real_distribution<double>(0.0, 1.0)(
+                   m_generator) < m_failureProbability;
+
+  unsigned long id = m_nextId++;
+  m_jobs[id] = job;
+  m_queued.insert(std::make_pair(job.eligibleTime, id));
+  ++m_numSubmitted;
+
+  // It may be able to start right away
+  updateLocked();
+  return id;
+}
+
+bool SchedulerSimulator::cancel(unsigned long id)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  updateLocked();
+
+  auto it = m_jobs.find(id);
+  if (it == m_jobs.end())
+    return false;
+
+  Job& job = it->second;
+  if (job.state == Queued) {
+    m_queued.erase(std::make_pair(job.eligibleTime, id));
+  } else if (job.state == Running) {
+    m_running.erase(std::make_pair(job.endTime, id));
+  } else {
+    return false;
+  }
+
+  job.state = Cancelled;
+  job.endTime = m_scheduleTime;
+  ++m_numCancelled;
+
+  // A node may have been freed
+  updateLocked();
+  return true;
+}
+
+SchedulerSimulator::JobState SchedulerSimulator::state(unsigned long id)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  ++m_numStatusQueries;
+  updateLocked();
+
+  auto it = m_jobs.find(id);
+  if (it == m_jobs.end())
+    return UnknownJob;
+  return it->second.state;
+}
+
+bool SchedulerSimulator::outputReady(unsigned long id)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  updateLocked();
+
+  auto it = m_jobs.find(id);
+  if (it == m_jobs.end() || it->second.state != Completed)
+    return false;
+  return m_scheduleTime >= it->second.endTime + m_outputDelay;
+}
+
+size_t SchedulerSimulator::numQueued()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  updateLocked();
+  return m_queued.size();
+}
+
+size_t SchedulerSimulator::numRunning()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  updateLocked();
+  return m_running.size();
+}
+
+size_t SchedulerSimulator::numSubmitted() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_numSubmitted;
+}
+
+size_t SchedulerSimulator::numStatusQueries() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_numStatusQueries;
+}
+
+size_t SchedulerSimulator::numCompleted() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_numCompleted;
+}
+
+size_t SchedulerSimulator::numFailed() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_numFailed;
+}
+
+size_t SchedulerSimulator::numCancelled() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_numCancelled;
+}
+
+void SchedulerSimulator::resetCounters()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_numSubmitted = 0;
+  m_numStatusQueries = 0;
+  m_numCompleted = 0;
+  m_numFailed = 0;
+  m_numCancelled = 0;
+}
+
+void SchedulerSimulator::clear()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_jobs.clear();
+  m_queued.clear();
+  m_running.clear();
+}
+
+double SchedulerSimulator::nowLocked() const
+{
+  if (m_timeScale == 0.0)
+    return m_timeOffset;
+
+  std::chrono::duration<double> elapsed =
+    std::chrono::steady_clock::now() - m_realStart;
+  return m_timeOffset + elapsed.count() * m_timeScale;
+}
+
+double SchedulerSimulator::sampleLocked(const Distribution& d)
+{
+  switch (d.type) {
+    case Distribution::Uniform:
+      return std::uniform_real_distribution<double>(d.a, d.b)(m_generator);
+    case Distribution::Exponential:
+      if (d.a <= 0.0)
+        return 0.0;
+      return std::exponential_distribution<double>(1.0 / d.a)(m_generator);
+    case Distribution::Constant:
+    default:
+      return d.a;
+  }
+}
+
+void SchedulerSimulator::updateLocked()
+{
+  const double target = std::max(nowLocked(), m_scheduleTime);
+  const double never = std::numeric_limits<double>::infinity();
+
+  while (true) {
+    double nextEnd = m_running.empty() ? never : m_running.begin()->first;
+    double nextStart = never;
+    if (m_running.size() < m_numNodes && !m_queued.empty())
+      nextStart = std::max(m_queued.begin()->first, m_scheduleTime);
+
+    double next = std::min(nextEnd, nextStart);
+    if (next > target)
+      break;
+
+    m_scheduleTime = next;
+
+    // Finish jobs before starting new ones so their nodes are reused
+    if (nextEnd <= nextStart) {
+      unsigned long id = m_running.begin()->second;
+      m_running.erase(m_running.begin());
+      Job& job = m_jobs[id];
+      if (job.willFail) {
+        job.state = Failed;
+        ++m_numFailed;
+      } else {
+        job.state = Completed;
+        ++m_numCompleted;
+      }
+    } else {
+      unsigned long id = m_queued.begin()->second;
+      m_queued.erase(m_queued.begin());
+      Job& job = m_jobs[id];
+      job.state = Running;
+      job.startTime = m_scheduleTime;
+      job.endTime = job.startTime + job.runTime;
+      m_running.insert(std::make_pair(job.endTime, id));
+    }
+  }
+
+  m_scheduleTime = target;
+}
+}
@@ -0,0 +1,213 @@
+/**********************************************************************
+  SchedulerSimulator - A batch scheduler that runs in virtual time
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ ***********************************************************************/
+
+#ifndef GLOBALSEARCH_SCHEDULER_SIMULATOR_H
+#define GLOBALSEARCH_SCHEDULER_SIMULATOR_H
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <random>
+#include <set>
+
+namespace GlobalSearch {
+
+/**
+ * @class SchedulerSimulator schedulersimulator.h
+ * <globalsearch/queueinterfaces/schedulersimulator.h>
+ *
+ * @brief A simulated batch scheduler with a fixed number of nodes.
+ *
+ * Each submitted job waits in the queue for at least a time drawn from
+ * queueWait() and until a node is free, runs for a time drawn from
+ * runTime(), and then leaves the queue. Its output appears outputDelay()
+ * seconds after it leaves the queue, unless it was chosen to fail with
+ * probability failureProbability(), in which case it writes no output.
+ *
+ * All of the random numbers for a job are drawn when it is submitted,
+ * so the schedule only depends on the seed and on the times of the
+ * submissions and cancellations, and not on how often the status is
+ * polled.
+ *
+ * The times are in virtual seconds. Virtual time passes timeScale() times
+ * faster than real time, and can also be moved forward with advance().
+ * A time scale of zero makes the time only move with advance(), which is
+ * useful for deterministic tests.
+ *
+ * All functions are thread safe.
+ */
+class SchedulerSimulator
+{
+public:
+  /// A distribution of times
+  struct Distribution
+  {
+    enum Type
+    {
+      /// Always @p a
+      Constant,
+      /// Uniform between @p a and @p b
+      Uniform,
+      /// Exponential with a mean of @p a
+      Exponential
+    };
+
+    Distribution(Type t = Constant, double a_ = 0.0, double b_ = 0.0)
+      : type(t), a(a_), b(b_)
+    {
+    }
+
+    static Distribution constant(double value)
+    {
+      return Distribution(Constant, value);
+    }
+    static Distribution uniform(double min, double max)
+    {
+      return Distribution(Uniform, min, max);
+    }
+    static Distribution exponential(double mean)
+    {
+      return Distribution(Exponential, mean);
+    }
+
+    Type type;
+    double a;
+    double b;
+  };
+
+  enum JobState
+  {
+    /// The job id was never submitted
+    UnknownJob = 0,
+    Queued,
+    Running,
+    /// The job left the queue and will write its output
+    Completed,
+    /// The job left the queue without writing any output
+    Failed,
+    Cancelled
+  };
+
+  explicit SchedulerSimulator(unsigned int seed = 0);
+
+  /// The number of jobs that may run at once
+  size_t numNodes() const;
+  void setNumNodes(size_t n);
+
+  Distribution queueWait() const;
+  void setQueueWait(const Distribution& d);
+
+  Distribution runTime() const;
+  void setRunTime(const Distribution& d);
+
+  double failureProbability() const;
+  void setFailureProbability(double p);
+
+  /// The time between a job leaving the queue and its output appearing
+  double outputDelay() const;
+  void setOutputDelay(double seconds);
+
+  /// Virtual seconds per real second
+  double timeScale() const;
+  void setTimeScale(double scale);
+
+  /// The seed the random number generator was last seeded with
+  unsigned int seed() const;
+  /// Reseed the random number generator. Only affects future submissions.
+  void setSeed(unsigned int seed);
+
+  /// The current virtual time in seconds
+  double now() const;
+
+  /// Move the virtual time forward by @p seconds
+  void advance(double seconds);
+
+  /// Submit a job and return its id. Ids start at 1.
+  unsigned long submit();
+
+  /// Cancel a job. Returns false if it already left the queue.
+  bool cancel(unsigned long id);
+
+  /// The state of job @p id at the current virtual time
+  JobState state(unsigned long id);
+
+  /// True if job @p id completed and its output has appeared
+  bool outputReady(unsigned long id);
+
+  /// The number of jobs that are waiting and running
+  size_t numQueued();
+  size_t numRunning();
+
+  /// Counters since construction or resetCounters()
+  size_t numSubmitted() const;
+  size_t numStatusQueries() const;
+  size_t numCompleted() const;
+  size_t numFailed() const;
+  size_t numCancelled() const;
+  void resetCounters();
+
+  /// Forget every job
+  void clear();
+
+private:
+  struct Job
+  {
+    JobState state;
+    double submitTime;
+    double eligibleTime;
+    double runTime;
+    double startTime;
+    double endTime;
+    bool willFail;
+  };
+
+  double nowLocked() const;
+  double sampleLocked(const Distribution& d);
+
+  // Runs the schedule forward to the current time. m_mutex must be locked.
+  void updateLocked();
+
+  mutable std::mutex m_mutex;
+  std::mt19937 m_generator;
+  unsigned int m_seed;
+
+  size_t m_numNodes;
+  Distribution m_queueWait;
+  Distribution m_runTime;
+  double m_failureProbability;
+  double m_outputDelay;
+
+  // The virtual time at m_realStart plus the time added with advance()
+  double m_timeOffset;
+  double m_timeScale;
+  std::chrono::steady_clock::time_point m_realStart;
+  // The virtual time the schedule has been run up to
+  double m_scheduleTime;
+
+  unsigned long m_nextId;
+  std::map<unsigned long, Job> m_jobs;
+  // Queued jobs sorted by the time they may start
+  std::set<std::pair<double, unsigned long>> m_queued;
+  // Running jobs sorted by the time they end
+  std::set<std::pair<double, unsigned long>> m_running;
+
+  size_t m_numSubmitted;
+  size_t m_numStatusQueries;
+  size_t m_numCompleted;
+  size_t m_numFailed;
+  size_t m_numCancelled;
+};
+}
+
+#endif // GLOBALSEARCH_SCHEDULER_SIMULATOR_H
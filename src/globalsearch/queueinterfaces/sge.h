@@ -24,8 +24,6 @@
 #include <globalsearch/queueinterfaces/remote.h>
 #include <globalsearch/queueinterfaces/sgedialog.h>
 
-#include <QDateTime>
-#include <QReadWriteLock>
 #include <QString>
 #include <QStringList>
 
@@ -54,14 +52,7 @@ public slots:
   QueueInterface::QueueStatus getStatus(Structure* s) const override;
 
 protected:
-  // Fetches the queue from the server
-  QStringList getQueueList() const;
-  // Cached queue data
-  QStringList m_queueData;
-  // Limits queue checks to once per second
-  QDateTime m_queueTimeStamp;
-  // Locks for m_queueData;
-  QReadWriteLock m_queueMutex;
+  QString queueListCommand() const override;
 };
 }
 
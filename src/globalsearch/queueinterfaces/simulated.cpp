@@ -0,0 +1,260 @@
+/**********************************************************************
+  SimulatedQueueInterface - A queue interface backed by a simulated
+                            batch scheduler
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ ***********************************************************************/
+
+#include <globalsearch/queueinterfaces/simulated.h>
+
+#include <globalsearch/macros.h>
+#include <globalsearch/optbase.h>
+#include <globalsearch/optimizer.h>
+#include <globalsearch/structure.h>
+
+#include <QReadLocker>
+#include <QWriteLocker>
+
+namespace GlobalSearch {
+
+SimulatedQueueInterface::SimulatedQueueInterface(OptBase* parent,
+                                                 const QString& settingsFile)
+  : LocalQueueInterface(parent, settingsFile),
+    m_simulator(new SchedulerSimulator)
+{
+  m_idString = "Simulated";
+  m_hasDialog = false;
+}
+
+SimulatedQueueInterface::~SimulatedQueueInterface()
+{
+}
+
+QHash<QString, QString> SimulatedQueueInterface::outputFiles() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_outputFiles;
+}
+
+void SimulatedQueueInterface::setOutputFiles(
+  const QHash<QString, QString>& files)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_outputFiles = files;
+}
+
+void SimulatedQueueInterface::readSettings(const QString& filename)
+{
+  SETTINGS(filename);
+
+  // Figure out what opt index this is.
+  QString optInd = settingsIndex();
+  if (optInd.isEmpty())
+    return;
+
+  settings->beginGroup(m_opt->getIDString().toLower());
+  settings->beginGroup("queueinterface/simulatedqueueinterface");
+  settings->beginGroup(optInd);
+
+  SchedulerSimulator& sim = *m_simulator;
+  sim.setSeed(settings->value("seed", 0).toUInt());
+  sim.setNumNodes(settings->value("numNodes", 1).toUInt());
+  sim.setQueueWait(SchedulerSimulator::Distribution(
+    static_cast<SchedulerSimulator::Distribution::Type>(
+      settings->value("queueWait/type", 0).toInt()),
+    settings->value("queueWait/a", 0.0).toDouble(),
+    settings->value("queueWait/b", 0.0).toDouble()));
+  sim.setRunTime(SchedulerSimulator::Distribution(
+    static_cast<SchedulerSimulator::Distribution::Type>(
+      settings->value("runTime/type", 0).toInt()),
+    settings->value("runTime/a", 0.0).toDouble(),
+    settings->value("runTime/b", 0.0).toDouble()));
+  sim.setFailureProbability(
+    settings->value("failureProbability", 0.0).toDouble());
+  sim.setOutputDelay(settings->value("outputDelay", 0.0).toDouble());
+  sim.setTimeScale(settings->value("timeScale", 1.0).toDouble());
+
+  QHash<QString, QString> files;
+  settings->beginGroup("outputFiles");
+  for (const auto& key : settings->childKeys())
+    files.insert(key, settings->value(key).toString());
+  settings->endGroup();
+  setOutputFiles(files);
+
+  settings->endGroup();
+  settings->endGroup();
+  settings->endGroup();
+}
+
+void SimulatedQueueInterface::writeSettings(const QString& filename)
+{
+  SETTINGS(filename);
+
+  const int version = 0;
+
+  // Figure out what opt index this is.
+  QString optInd = settingsIndex();
+  if (optInd.isEmpty())
+    return;
+
+  settings->beginGroup(m_opt->getIDString().toLower());
+  settings->beginGroup("queueinterface/simulatedqueueinterface");
+  settings->beginGroup(optInd);
+  settings->setValue("version", version);
+
+  const SchedulerSimulator& sim = *m_simulator;
+  settings->setValue("seed", sim.seed());
+  settings->setValue("numNodes", static_cast<unsigned int>(sim.numNodes()));
+  SchedulerSimulator::Distribution wait = sim.queueWait();
+  settings->setValue("queueWait/type", static_cast<int>(wait.type));
+  settings->setValue("queueWait/a", wait.a);
+  settings->setValue("queueWait/b", wait.b);
+  SchedulerSimulator::Distribution run = sim.runTime();
+  settings->setValue("runTime/type", static_cast<int>(run.type));
+  settings->setValue("runTime/a", run.a);
+  settings->setValue("runTime/b", run.b);
+  settings->setValue("failureProbability", sim.failureProbability());
+  settings->setValue("outputDelay", sim.outputDelay());
+  settings->setValue("timeScale", sim.timeScale());
+
+  QHash<QString, QString> files = outputFiles();
+  settings->remove("outputFiles");
+  settings->beginGroup("outputFiles");
+  for (auto it = files.constBegin(); it != files.constEnd(); ++it)
+    settings->setValue(it.key(), it.value());
+  settings->endGroup();
+
+  settings->endGroup();
+  settings->endGroup();
+  settings->endGroup();
+}
+
+bool SimulatedQueueInterface::startJob(Structure* s)
+{
+  QWriteLocker wLocker(&s->lock());
+
+  if (s->getJobID() != 0) {
+    m_opt->warning(tr("SimulatedQueueInterface::startJob: Attempting to "
+                      "start job for structure %1, but a JobID is already "
+                      "set (%2).")
+                     .arg(s->getIDString())
+                     .arg(s->getJobID()));
+    return false;
+  }
+
+  s->setJobID(m_simulator->submit());
+  s->startOptTimer();
+  return true;
+}
+
+bool SimulatedQueueInterface::stopJob(Structure* s)
+{
+  QWriteLocker wLocker(&s->lock());
+
+  unsigned long jobID = static_cast<unsigned long>(s->getJobID());
+  if (jobID == 0) {
+    // The job is not running, so just return
+    return true;
+  }
+
+  m_simulator->cancel(jobID);
+  s->setJobID(0);
+  s->stopOptTimer();
+  return true;
+}
+
+QueueInterface::QueueStatus SimulatedQueueInterface::getStatus(
+  Structure* s) const
+{
+  // lock structure
+  QWriteLocker locker(&s->lock());
+  unsigned long jobID = static_cast<unsigned long>(s->getJobID());
+
+  // If jobID = 0 and structure is not in "Submitted" state, return an error.
+  if (!jobID && s->getStatus() != Structure::Submitted) {
+    return QueueInterface::Error;
+  }
+
+  SchedulerSimulator::JobState state = m_simulator->state(jobID);
+  bool inQueue = (state == SchedulerSimulator::Queued ||
+                  state == SchedulerSimulator::Running);
+  if (!inQueue)
+    writeOutputIfReady(s, jobID);
+
+  // Same as the remote queue interfaces: a submitted job that is not in
+  // the queue is pending until its output appears.
+  if (s->getStatus() == Structure::Submitted) {
+    if (inQueue)
+      return QueueInterface::Started;
+    locker.unlock();
+    bool exists;
+    if (!getCurrentOptimizer(s)->checkIfOutputFileExists(s, &exists)) {
+      return QueueInterface::CommunicationError;
+    }
+    return exists ? QueueInterface::Started : QueueInterface::Pending;
+  }
+
+  if (state == SchedulerSimulator::Running) {
+    return QueueInterface::Running;
+  } else if (state == SchedulerSimulator::Queued) {
+    return QueueInterface::Queued;
+  }
+
+  // Entry is missing from the queue. Were the output files written?
+  locker.unlock();
+  bool outputFileExists;
+  if (!getCurrentOptimizer(s)->checkIfOutputFileExists(s,
+                                                       &outputFileExists)) {
+    return QueueInterface::CommunicationError;
+  }
+
+  if (outputFileExists) {
+    // Did the job finish successfully?
+    bool success;
+    if (!getCurrentOptimizer(s)->checkForSuccessfulOutput(s, &success)) {
+      return QueueInterface::CommunicationError;
+    }
+    return success ? QueueInterface::Success : QueueInterface::Error;
+  }
+
+  // A completed job whose output delay has not passed yet is still
+  // finishing up
+  if (state == SchedulerSimulator::Completed &&
+      !m_simulator->outputReady(jobID)) {
+    return QueueInterface::Running;
+  }
+
+  m_opt->debug(tr("Structure %1 with jobID %2 is missing "
+                  "from the queue and has not written any output.")
+                 .arg(s->getIDString())
+                 .arg(jobID));
+  return QueueInterface::Error;
+}
+
+void SimulatedQueueInterface::writeOutputIfReady(Structure* s,
+                                                 unsigned long jobID) const
+{
+  QHash<QString, QString> files;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_writtenOutputs.count(jobID) || !m_simulator->outputReady(jobID))
+      return;
+    m_writtenOutputs.insert(jobID);
+    files = m_outputFiles;
+  }
+
+  QString id = QString::number(jobID);
+  for (auto it = files.begin(); it != files.end(); ++it)
+    it.value().replace("%jobid%", id);
+
+  writeFiles(s, files);
+}
+}
@@ -0,0 +1,87 @@
+/**********************************************************************
+  SimulatedQueueInterface - A queue interface backed by a simulated
+                            batch scheduler
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ ***********************************************************************/
+
+#ifndef SIMULATEDQUEUEINTERFACE_H
+#define SIMULATEDQUEUEINTERFACE_H
+
+#include <globalsearch/queueinterfaces/local.h>
+#include <globalsearch/queueinterfaces/schedulersimulator.h>
+
+#include <memory>
+#include <mutex>
+#include <set>
+
+namespace GlobalSearch {
+
+/**
+ * @class SimulatedQueueInterface simulated.h
+ * <globalsearch/queueinterfaces/simulated.h>
+ *
+ * @brief A queue interface for scaling and stress tests that needs no
+ * scheduler and no ssh server.
+ *
+ * Jobs are submitted to a SchedulerSimulator instead of being ran. The
+ * status checks follow the same rules as the remote queue interfaces: a
+ * submitted job that is not in the queue is pending until its output
+ * appears, and a job that left the queue is a success or an error
+ * depending on its output files. When the simulator says that a job's
+ * output has appeared, the files set with setOutputFiles() are written
+ * to the structure's working directory. Jobs chosen to fail write
+ * nothing.
+ *
+ * With an accelerated time scale on the simulator, the whole
+ * QueueManager state machine can be driven through many job lifecycles
+ * quickly. The simulator counters then give the polling overhead and the
+ * throughput of the head node code.
+ */
+class SimulatedQueueInterface : public LocalQueueInterface
+{
+  Q_OBJECT
+
+public:
+  explicit SimulatedQueueInterface(OptBase* parent,
+                                   const QString& settingsFile = "");
+
+  virtual ~SimulatedQueueInterface() override;
+
+  SchedulerSimulator& simulator() { return *m_simulator; }
+
+  /// The files, by name, that a successful job writes. Each "%jobid%"
+  /// in the text is replaced by the job id.
+  QHash<QString, QString> outputFiles() const;
+  void setOutputFiles(const QHash<QString, QString>& files);
+
+  QDialog* dialog() override { return nullptr; }
+
+public slots:
+  void readSettings(const QString& filename = "") override;
+  void writeSettings(const QString& filename = "") override;
+  bool startJob(Structure* s) override;
+  bool stopJob(Structure* s) override;
+  QueueInterface::QueueStatus getStatus(Structure* s) const override;
+
+private:
+  // Writes the output files of job @p jobID for @p s if they have
+  // appeared and were not written yet.
+  void writeOutputIfReady(Structure* s, unsigned long jobID) const;
+
+  std::unique_ptr<SchedulerSimulator> m_simulator;
+  QHash<QString, QString> m_outputFiles;
+  mutable std::set<unsigned long> m_writtenOutputs;
+  mutable std::mutex m_mutex;
+};
+}
+
+#endif // SIMULATEDQUEUEINTERFACE_H
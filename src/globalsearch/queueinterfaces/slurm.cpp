@@ -34,8 +34,7 @@ namespace GlobalSearch {
 
 SlurmQueueInterface::SlurmQueueInterface(OptBase* parent,
                                          const QString& settingsFile)
-  : RemoteQueueInterface(parent, settingsFile),
-    m_queueMutex(QReadWriteLock::Recursive)
+  : RemoteQueueInterface(parent, settingsFile)
 {
   m_idString = "SLURM";
   m_templates.append("job.slurm");
@@ -152,13 +151,13 @@ void SlurmQueueInterface::readSettings(const QString& filename)
   SETTINGS(filename);
 
   // Figure out what opt index this is.
-  int optInd = m_opt->queueInterfaceIndex(this);
-  if (optInd < 0)
+  QString optInd = settingsIndex();
+  if (optInd.isEmpty())
     return;
 
   settings->beginGroup(m_opt->getIDString().toLower());
   settings->beginGroup("queueinterface/slurmqueueinterface");
-  settings->beginGroup(QString::number(optInd));
+  settings->beginGroup(optInd);
   int loadedVersion = settings->value("version", 0).toInt();
   settings->beginGroup("paths");
 
@@ -186,13 +185,13 @@ void SlurmQueueInterface::writeSettings(const QString& filename)
   const int version = 0;
 
   // Figure out what opt index this is.
-  int optInd = m_opt->queueInterfaceIndex(this);
-  if (optInd < 0)
+  QString optInd = settingsIndex();
+  if (optInd.isEmpty())
     return;
 
   settings->beginGroup(m_opt->getIDString().toLower());
   settings->beginGroup("queueinterface/slurmqueueinterface");
-  settings->beginGroup(QString::number(optInd));
+  settings->beginGroup(optInd);
   settings->setValue("version", version);
   settings->beginGroup("paths");
 
@@ -401,19 +400,15 @@ QueueInterface::QueueStatus SlurmQueueInterface::getStatus(Structure* s) const
   } else if (status.isEmpty()) { // Entry is missing from queue. Were the output
                                  // files written?
     locker.unlock();
-    bool outputFileExists;
-    if (!getCurrentOptimizer(s)->checkIfOutputFileExists(s,
-                                                         &outputFileExists)) {
+    bool outputFileExists, success;
+    if (!getCurrentOptimizer(s)->checkCompletion(s, &outputFileExists,
+                                                 &success)) {
       return QueueInterface::CommunicationError;
     }
     locker.relock();
 
     if (outputFileExists) {
       // Did the job finish successfully?
-      bool success;
-      if (!getCurrentOptimizer(s)->checkForSuccessfulOutput(s, &success)) {
-        return QueueInterface::CommunicationError;
-      }
       if (success) {
         return QueueInterface::Success;
       } else {
@@ -441,96 +436,6 @@ QueueInterface::QueueStatus SlurmQueueInterface::getStatus(Structure* s) const
     return QueueInterface::Unknown;
   }
 }
-
-QStringList SlurmQueueInterface::getQueueList() const
-{
-  // recast queue mutex as mutable for safe access:
-  QReadWriteLock& queueMutex = const_cast<QReadWriteLock&>(m_queueMutex);
-
-  queueMutex.lockForRead();
-
-  // Limit queries to once per second
-  if (m_queueTimeStamp.isValid() &&
-// QDateTime::msecsTo is not implemented until Qt 4.7
-#if QT_VERSION >= 0x040700
-      m_queueTimeStamp.msecsTo(QDateTime::currentDateTime()) <=
-        1000 * m_opt->queueRefreshInterval()
-#else
-      // Check if day is the same. If not, refresh. Otherwise check
-      // msecsTo current time
-      (m_queueTimeStamp.date() == QDate::currentDate() &&
-       m_queueTimeStamp.time().msecsTo(QTime::currentTime()) <=
-         1000 * m_opt->queueRefreshInterval())
-#endif // QT_VERSION >= 4.7
-        ) {
-    // If the cache is valid, return it
-    QStringList ret(m_queueData);
-    queueMutex.unlock();
-    return ret;
-  }
-
-  // Otherwise, store a copy of the current timestamp and switch
-  // queuemutex to writelock
-  QDateTime oldTimeStamp(m_queueTimeStamp);
-  queueMutex.unlock();
-
-  // Relock mutex
-  QWriteLocker queueLocker(&queueMutex);
-
-  // Non-fatal assert: Check current timestamp against the
-  // oldTimeStamp from earlier. If they don't match, another thread
-  // has already updated the queueData, so tail-recurse this
-  // function and try again.
-  if (m_queueTimeStamp.time().msecsTo(oldTimeStamp.time()) != 0) {
-    queueLocker.unlock();
-    return this->getQueueList();
-  }
-
-  // Queue will be updated -- cast queue cache and timestamp as
-  // mutable
-  QStringList& queueData = const_cast<QStringList&>(m_queueData);
-  QDateTime& queueTimeStamp = const_cast<QDateTime&>(m_queueTimeStamp);
-
-  // Get SSH connection
-  SSHConnection* ssh = m_opt->ssh()->getFreeConnection();
-
-  if (ssh == nullptr) {
-    m_opt->warning(tr("Cannot connect to ssh server"));
-    queueTimeStamp = QDateTime::currentDateTime();
-    queueData.clear();
-    queueData << "CommError";
-    QStringList ret(m_queueData);
-    return ret;
-  }
-
-  QString command = m_statusCommand + " -u " + m_opt->username;
-
-  // Execute
-  QString stdout_str;
-  QString stderr_str;
-  int ec;
-  // stdout_str should never be empty for a successful execution
-  // There will always be column info at the beginning if nothing else.
-  if (!ssh->execute(command, stdout_str, stderr_str, ec) || (ec != 0) ||
-      (stdout_str.isEmpty())) {
-    m_opt->ssh()->unlockConnection(ssh);
-    m_opt->warning(tr("Error executing %1: (%2) %3\n\t"
-                      "Using cached queue data.")
-                     .arg(command)
-                     .arg(QString::number(ec))
-                     .arg(stderr_str));
-    queueTimeStamp = QDateTime::currentDateTime();
-    QStringList ret(m_queueData);
-    return ret;
-  }
-  m_opt->ssh()->unlockConnection(ssh);
-
-  queueData = stdout_str.split("\n", QString::SkipEmptyParts);
-
-  QStringList ret(m_queueData);
-  queueTimeStamp = QDateTime::currentDateTime();
-  return ret;
-}
 }
 
 /// @endcond
@@ -24,8 +24,6 @@
 #include <globalsearch/queueinterfaces/remote.h>
 #include <globalsearch/queueinterfaces/slurmdialog.h>
 
-#include <QDateTime>
-#include <QReadWriteLock>
 #include <QString>
 #include <QStringList>
 
@@ -55,14 +53,7 @@ public slots:
   QueueInterface::QueueStatus getStatus(Structure* s) const override;
 
 protected:
-  // Fetches the queue from the server
-  QStringList getQueueList() const;
-  // Cached queue data
-  QStringList m_queueData;
-  // Limits queue checks to once per second
-  QDateTime m_queueTimeStamp;
-  // Locks for m_queueData;
-  QReadWriteLock m_queueMutex;
+  bool queueListHasHeader() const override { return true; }
 };
 }
 
@@ -14,6 +14,7 @@
 
 #include <globalsearch/queuemanager.h>
 
+#include <globalsearch/executor.h>
 #include <globalsearch/macros.h>
 #include <globalsearch/optbase.h>
 #include <globalsearch/optimizer.h>
@@ -24,8 +25,10 @@
 
 #include <QDateTime>
 #include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
 #include <QTimer>
-#include <QtConcurrent>
 
 // A couple helper functions/classes -- disable doxygen parsing:
 /// \cond
@@ -66,7 +69,9 @@ namespace GlobalSearch {
 QueueManager::QueueManager(QThread* thread, OptBase* opt)
   : QObject(), m_opt(opt), m_thread(thread), m_tracker(opt->tracker()),
     m_requestedStructures(0), m_isDestroying(false),
-    m_lastSubmissionTimeStamp(new QDateTime(QDateTime::currentDateTime()))
+    m_lastSubmissionTimeStamp(new QDateTime(QDateTime::currentDateTime())),
+    m_runtimeOptionsWatcher(nullptr), m_runtimeOptionsTimer(nullptr),
+    m_runtimeOptionsModified(-1), m_runtimeOptionsSize(-1)
 {
   moveToQMThread();
 }
@@ -129,6 +134,10 @@ void QueueManager::setupConnections()
   // opt connections
   connect(this, SIGNAL(needNewStructure()), m_opt, SLOT(generateNewStructure()),
           Qt::QueuedConnection);
+  // Some CLI settings are over-written while the session starts, so the
+  // runtime file is read again once it has started
+  connect(m_opt, SIGNAL(sessionStarted()), this, SLOT(readRuntimeOptions()),
+          Qt::QueuedConnection);
 
   // re-emit connections
   connect(this, SIGNAL(structureStarted(GlobalSearch::Structure*)), this,
@@ -191,8 +200,15 @@ void QueueManager::checkLoop()
   // Update runtime options by reading a file if we are not using the GUI
   // This needs to be here first because sometimes, our CLI settings are
   // over-written from somewhere else when starting.
-  if (!m_opt->usingGUI())
-    m_opt->readRuntimeOptions();
+  // After the first time, the file is only read when it changes. The
+  // watcher usually reports that, but it is also checked here since file
+  // watching does not work on every file system (e.g., NFS).
+  if (!m_opt->usingGUI()) {
+    if (!m_runtimeOptionsWatcher)
+      readRuntimeOptions();
+    else
+      checkRuntimeOptionsFile();
+  }
 
   if (!m_opt->readOnly && !m_opt->isStarting) {
     checkPopulation();
@@ -202,6 +218,74 @@ void QueueManager::checkLoop()
   QTimer::singleShot(1000, this, SLOT(checkLoop()));
 }
 
+void QueueManager::readRuntimeOptions()
+{
+  if (m_opt->usingGUI())
+    return;
+
+  QString fileName = m_opt->CLIRuntimeFile();
+  if (fileName.isEmpty())
+    return;
+
+  if (!m_runtimeOptionsWatcher) {
+    m_runtimeOptionsTimer = new QTimer(this);
+    m_runtimeOptionsTimer->setSingleShot(true);
+    m_runtimeOptionsTimer->setInterval(500);
+    connect(m_runtimeOptionsTimer, SIGNAL(timeout()), this,
+            SLOT(readRuntimeOptions()));
+
+    m_runtimeOptionsWatcher = new QFileSystemWatcher(this);
+    connect(m_runtimeOptionsWatcher, SIGNAL(fileChanged(const QString&)),
+            m_runtimeOptionsTimer, SLOT(start()));
+    // Structure directories are created here too, so only a change to the
+    // runtime file itself counts
+    connect(m_runtimeOptionsWatcher, SIGNAL(directoryChanged(const QString&)),
+            this, SLOT(checkRuntimeOptionsFile()));
+  }
+
+  // Editors often replace the file instead of writing to it, which drops
+  // it from the watcher, so it is added again every time. The directory is
+  // watched so that a replaced or new file is noticed.
+  QFileInfo info(fileName);
+  QString dir = info.absolutePath();
+
+  // The file moves if the working directory is set after we started
+  QStringList stale =
+    m_runtimeOptionsWatcher->files() + m_runtimeOptionsWatcher->directories();
+  stale.removeAll(fileName);
+  stale.removeAll(dir);
+  if (!stale.isEmpty())
+    m_runtimeOptionsWatcher->removePaths(stale);
+
+  if (info.exists() && !m_runtimeOptionsWatcher->files().contains(fileName))
+    m_runtimeOptionsWatcher->addPath(fileName);
+  if (QDir(dir).exists() &&
+      !m_runtimeOptionsWatcher->directories().contains(dir)) {
+    m_runtimeOptionsWatcher->addPath(dir);
+  }
+
+  m_runtimeOptionsModified =
+    info.exists() ? info.lastModified().toMSecsSinceEpoch() : -1;
+  m_runtimeOptionsSize = info.exists() ? info.size() : -1;
+
+  m_opt->readRuntimeOptions();
+}
+
+void QueueManager::checkRuntimeOptionsFile()
+{
+  if (m_opt->usingGUI() || !m_runtimeOptionsTimer)
+    return;
+
+  QFileInfo info(m_opt->CLIRuntimeFile());
+  qint64 modified =
+    info.exists() ? info.lastModified().toMSecsSinceEpoch() : -1;
+  qint64 size = info.exists() ? info.size() : -1;
+  if (modified != m_runtimeOptionsModified || size != m_runtimeOptionsSize) {
+    if (!m_runtimeOptionsTimer->isActive())
+      m_runtimeOptionsTimer->start();
+  }
+}
+
 void QueueManager::checkPopulation()
 {
   // Count jobs
@@ -407,7 +491,7 @@ void QueueManager::handleInProcessStructure(Structure* s)
   if (!m_inProcessTracker.append(s)) {
     return;
   }
-  QtConcurrent::run(this, &QueueManager::handleInProcessStructure_, s);
+  Executor::io().run([this, s]() { handleInProcessStructure_(s); });
 }
 
 // Doxygen skip:
@@ -464,7 +548,7 @@ void QueueManager::handleOptimizedStructure(Structure* s)
   if (!m_newlyOptimizedTracker.append(s)) {
     return;
   }
-  QtConcurrent::run(this, &QueueManager::handleOptimizedStructure_, s);
+  Executor::io().run([this, s]() { handleOptimizedStructure_(s); });
 }
 
 // Doxygen skip:
@@ -495,7 +579,7 @@ void QueueManager::handleStepOptimizedStructure(Structure* s)
 {
   QWriteLocker locker(m_stepOptimizedTracker.rwLock());
   m_stepOptimizedTracker.append(s);
-  QtConcurrent::run(this, &QueueManager::handleStepOptimizedStructure_, s);
+  Executor::io().run([this, s]() { handleStepOptimizedStructure_(s); });
 }
 
 // Doxygen skip:
@@ -588,7 +672,7 @@ void QueueManager::handleErrorStructure(Structure* s)
   if (!m_errorTracker.append(s)) {
     return;
   }
-  QtConcurrent::run(this, &QueueManager::handleErrorStructure_, s);
+  Executor::io().run([this, s]() { handleErrorStructure_(s); });
 }
 
 // Doxygen skip:
@@ -598,6 +682,12 @@ void QueueManager::handleErrorStructure_(Structure* s)
   Q_ASSERT(trackerContainsStructure(s, &m_errorTracker));
   removeFromTrackerWhenScopeEnds popper(s, &m_errorTracker);
 
+  // Stopping the job and restoring the checkpoint go to the cluster, so
+  // this may not block the QM thread.
+  Q_ASSERT_X(QThread::currentThread() != m_thread, Q_FUNC_INFO,
+             "Attempting to run QueueManager::handleErrorStructure_ "
+             "from the QM thread.");
+
   if (s->getStatus() != Structure::Error) {
     return;
   }
@@ -623,6 +713,9 @@ void QueueManager::handleErrorStructure_(Structure* s)
       case OptBase::FA_DoNothing:
       default:
         // resubmit job
+        locker.unlock();
+        m_opt->restoreCheckpoint(s);
+        locker.relock();
         s->setStatus(Structure::Restart);
         emit structureUpdated(s);
         return;
@@ -649,6 +742,9 @@ void QueueManager::handleErrorStructure_(Structure* s)
   }
   // Resubmit job if failure limit hasn't been reached
   else {
+    locker.unlock();
+    m_opt->restoreCheckpoint(s);
+    locker.relock();
     s->setStatus(Structure::Restart);
     emit structureUpdated(s);
     return;
@@ -662,7 +758,7 @@ void QueueManager::handleSubmittedStructure(Structure* s)
   if (!m_submittedTracker.append(s)) {
     return;
   }
-  QtConcurrent::run(this, &QueueManager::handleSubmittedStructure_, s);
+  Executor::io().run([this, s]() { handleSubmittedStructure_(s); });
 }
 
 // Doxygen skip:
@@ -709,7 +805,7 @@ void QueueManager::handleKilledStructure(Structure* s)
   if (!m_newlyKilledTracker.append(s)) {
     return;
   }
-  QtConcurrent::run(this, &QueueManager::handleKilledStructure_, s);
+  Executor::io().run([this, s]() { handleKilledStructure_(s); });
 }
 
 // Doxygen skip:
@@ -747,7 +843,7 @@ void QueueManager::handleDuplicateStructure(Structure* s)
   if (!m_newDuplicateTracker.append(s)) {
     return;
   }
-  QtConcurrent::run(this, &QueueManager::handleDuplicateStructure_, s);
+  Executor::io().run([this, s]() { handleDuplicateStructure_(s); });
 }
 
 // Doxygen skip:
@@ -777,7 +873,7 @@ void QueueManager::handleSupercellStructure(Structure* s)
   if (!m_newSupercellTracker.append(s)) {
     return;
   }
-  QtConcurrent::run(this, &QueueManager::handleSupercellStructure_, s);
+  Executor::io().run([this, s]() { handleSupercellStructure_(s); });
 }
 
 // Doxygen skip:
@@ -807,7 +903,7 @@ void QueueManager::handleRestartStructure(Structure* s)
   if (!m_restartTracker.append(s)) {
     return;
   }
-  QtConcurrent::run(this, &QueueManager::handleRestartStructure_, s);
+  Executor::io().run([this, s]() { handleRestartStructure_(s); });
 }
 
 // Doxygen skip:
@@ -873,8 +969,8 @@ void QueueManager::addStructureToSubmissionQueue(Structure* s, int optStep)
     return;
   }
 
-  QtConcurrent::run(this, &QueueManager::addStructureToSubmissionQueue_, s,
-                    optStep);
+  Executor::io().run(
+    [this, s, optStep]() { addStructureToSubmissionQueue_(s, optStep); });
 }
 
 // Doxygen skip:
@@ -894,6 +990,10 @@ void QueueManager::addStructureToSubmissionQueue_(Structure* s, int optStep)
   }
   s->lock().unlock();
 
+  // A finished structure that is being optimized again may have been
+  // packed into the archive
+  m_opt->unarchiveStructure(s);
+
   // Perform writing
   m_opt->queueInterface(s->getCurrentOptStep())->writeInputFiles(s);
 
@@ -1097,7 +1197,8 @@ void QueueManager::unlockForNaming(Structure* s)
 #if QT_VERSION == 0x040603
   emit newStructureQueued();
 #else  // QT_VERSION == 4.6.3
-  QtConcurrent::run(this, &QueueManager::unlockForNaming_);
+  Executor::cpu().run([this]() { unlockForNaming_(); },
+                      Executor::HighPriority);
 #endif // QT_VERSION == 4.6.3
 }
 
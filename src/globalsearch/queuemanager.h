@@ -18,6 +18,8 @@
 #include <globalsearch/tracker.h>
 
 class QDateTime;
+class QFileSystemWatcher;
+class QTimer;
 
 namespace GlobalSearch {
 class OptBase;
@@ -279,6 +281,18 @@ protected slots:
    */
   void checkLoop();
 
+  /**
+   * Calls OptBase::readRuntimeOptions() and starts watching the runtime
+   * file if it is not watched yet. Only used in CLI mode.
+   */
+  void readRuntimeOptions();
+
+  /**
+   * Schedules readRuntimeOptions() if the modification time or size of
+   * the runtime file changed since it was last read.
+   */
+  void checkRuntimeOptionsFile();
+
   /**
    * Writes the input files for the optimization process and queues
    * the Structure to be submitted for optimization.
@@ -476,7 +490,7 @@ protected:
   void handleRestartStructure(Structure* s);
 
   // These run in the background and are called by the above
-  // functions via QtConcurrent::run.
+  // functions via Executor::io().
   /// @cond
   void handleOptimizedStructure_(Structure* s);
   void handleStepOptimizedStructure_(Structure* s);
@@ -533,6 +547,17 @@ protected:
 
   /// Used to throttle job submissions
   QDateTime* m_lastSubmissionTimeStamp;
+
+  /// Watches the runtime file and its directory in CLI mode
+  QFileSystemWatcher* m_runtimeOptionsWatcher;
+
+  /// Delays reading the runtime file until it has stopped changing
+  QTimer* m_runtimeOptionsTimer;
+
+  /// The modification time (ms since epoch) and size of the runtime file
+  /// when it was last read, or -1 if it did not exist
+  qint64 m_runtimeOptionsModified;
+  qint64 m_runtimeOptionsSize;
 };
 
 } // end namespace GlobalSearch
@@ -17,6 +17,7 @@
 #ifndef GLOBALSEARCH_RANDOM_H
 #define GLOBALSEARCH_RANDOM_H
 
+#include <climits>
 #include <random>
 
 namespace GlobalSearch {
@@ -38,6 +38,26 @@ void SSHConnection::setLoginDetails(const QString& host, const QString& user,
   m_port = port;
 }
 
+bool SSHConnection::executeMany(const QStringList& commands,
+                                QStringList& stdout_strs,
+                                QStringList& stderr_strs,
+                                QList<int>& exitcodes, bool printWarning)
+{
+  stdout_strs.clear();
+  stderr_strs.clear();
+  exitcodes.clear();
+  for (const auto& command : commands) {
+    QString stdout_str, stderr_str;
+    int exitcode = -1;
+    if (!execute(command, stdout_str, stderr_str, exitcode, printWarning))
+      return false;
+    stdout_strs.append(stdout_str);
+    stderr_strs.append(stderr_str);
+    exitcodes.append(exitcode);
+  }
+  return true;
+}
+
 } // end namespace GlobalSearch
 
 #endif // ENABLE_SSH
@@ -17,8 +17,10 @@
 
 #ifdef ENABLE_SSH
 
+#include <QList>
 #include <QObject>
 #include <QString>
+#include <QStringList>
 
 namespace GlobalSearch {
 class OptBase;
@@ -99,6 +101,22 @@ public slots:
                        QString& stderr_str, int& exitcode,
                        bool printWarning = true) = 0;
 
+  /**
+   * Execute several commands on the connected host. Implementations may
+   * run them at the same time; the default runs them one after another.
+   *
+   * @param commands Commands to execute
+   * @param stdout_strs (return) standard output of each command
+   * @param stderr_strs (return) standard error of each command
+   * @param exitcodes (return) exit code of each command
+   * @param printWarning Prints warnings with qWarning() if an error occurs
+   *
+   * @return True if every command was executed.
+   */
+  virtual bool executeMany(const QStringList& commands,
+                           QStringList& stdout_strs, QStringList& stderr_strs,
+                           QList<int>& exitcodes, bool printWarning = true);
+
   /**
    * Copy a file to the remote host
    *
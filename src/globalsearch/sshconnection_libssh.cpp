@@ -19,12 +19,20 @@
 #include <globalsearch/macros.h>
 #include <globalsearch/sshmanager_libssh.h>
 
+extern "C" {
+#include <libssh/callbacks.h>
+}
+
 #include <QDebug>
 #include <QDir>
+#include <QElapsedTimer>
 
+#include <cstring>
 #include <fcntl.h>
 #include <fstream>
+#include <memory>
 #include <sstream>
+#include <vector>
 
 using namespace std;
 
@@ -384,72 +392,226 @@ bool SSHConnectionLibSSH::execute(const QString& command, QString& stdout_str,
   return _execute(command, stdout_str, stderr_str, exitcode, printWarning);
 }
 
+bool SSHConnectionLibSSH::executeMany(const QStringList& commands,
+                                      QStringList& stdout_strs,
+                                      QStringList& stderr_strs,
+                                      QList<int>& exitcodes,
+                                      bool printWarning)
+{
+  QMutexLocker locker(&m_lock);
+  return _executeMany(commands, stdout_strs, stderr_strs, exitcodes,
+                      printWarning);
+}
+
 // No need to document this:
 /// @cond
 bool SSHConnectionLibSSH::_execute(const QString& command, QString& stdout_str,
                                    QString& stderr_str, int& exitcode,
                                    bool printWarning)
 {
-  START;
-#ifdef SSH_CONNECTION_LIBSSH_DEBUG
-  qDebug() << "The following command is being executed:" << command;
-#endif
-  // Open new channel for exec
-  ssh_channel channel = channel_new(m_session);
-  if (!channel) {
-    if (printWarning)
-      qWarning() << "SSH error: " << ssh_get_error(m_session);
-    return false;
-  }
-  if (channel_open_session(channel) != SSH_OK) {
-    if (printWarning)
-      qWarning() << "SSH error: " << ssh_get_error(m_session);
-    channel_free(channel);
+  QStringList stdout_strs, stderr_strs;
+  QList<int> exitcodes;
+  if (!_executeMany(QStringList(command), stdout_strs, stderr_strs, exitcodes,
+                    printWarning)) {
     return false;
   }
 
-  // Execute command
-  int ssh_exit = channel_request_exec(channel, command.toStdString().c_str());
+  stdout_str = stdout_strs.first();
+  stderr_str = stderr_strs.first();
+  exitcode = exitcodes.first();
+  return true;
+}
 
-  if (ssh_exit != SSH_OK) {
-    channel_close(channel);
-    channel_free(channel);
+namespace {
+// How long to wait for the exit status once a command's output has ended
+const qint64 EXIT_STATUS_TIMEOUT_MS = 15000;
+
+// How often to check the connection while waiting for output
+const int POLL_TIMEOUT_MS = 1000;
+
+// A command running on its own channel. The channel callbacks fill it in
+// as the packets arrive.
+struct ExecChannel
+{
+  int index;
+  ssh_channel channel;
+  std::string stdoutData;
+  std::string stderrData;
+  int exitStatus;
+  bool exitStatusReceived;
+  bool eof;
+  bool closed;
+  QElapsedTimer sinceEof;
+  struct ssh_channel_callbacks_struct callbacks;
+};
+
+int execChannelData(ssh_session, ssh_channel, void* data, uint32_t len,
+                    int is_stderr, void* userdata)
+{
+  ExecChannel* exec = static_cast<ExecChannel*>(userdata);
+  std::string& out = is_stderr ? exec->stderrData : exec->stdoutData;
+  out.append(static_cast<const char*>(data), len);
+  return static_cast<int>(len);
+}
+
+void execChannelEof(ssh_session, ssh_channel, void* userdata)
+{
+  ExecChannel* exec = static_cast<ExecChannel*>(userdata);
+  exec->eof = true;
+  exec->sinceEof.start();
+}
+
+void execChannelClose(ssh_session, ssh_channel, void* userdata)
+{
+  static_cast<ExecChannel*>(userdata)->closed = true;
+}
+
+void execChannelExitStatus(ssh_session, ssh_channel, int exit_status,
+                           void* userdata)
+{
+  ExecChannel* exec = static_cast<ExecChannel*>(userdata);
+  exec->exitStatus = exit_status;
+  exec->exitStatusReceived = true;
+}
+
+bool execChannelFinished(const ExecChannel& exec)
+{
+  if (exec.closed || (exec.eof && exec.exitStatusReceived))
+    return true;
+
+  // Some servers never send the exit status
+  return exec.eof && exec.sinceEof.elapsed() > EXIT_STATUS_TIMEOUT_MS;
+}
+}
+
+bool SSHConnectionLibSSH::_executeMany(const QStringList& commands,
+                                       QStringList& stdout_strs,
+                                       QStringList& stderr_strs,
+                                       QList<int>& exitcodes,
+                                       bool printWarning)
+{
+  START;
+  stdout_strs.clear();
+  stderr_strs.clear();
+  exitcodes.clear();
+  for (int i = 0; i < commands.size(); ++i) {
+    stdout_strs.append(QString());
+    stderr_strs.append(QString());
+    exitcodes.append(-1);
+  }
+
+  if (!m_session || !ssh_is_connected(m_session)) {
+    if (printWarning)
+      qWarning() << "SSH error: the session is not connected.";
     return false;
   }
 
-  // Create string streams
-  ostringstream ossout, osserr;
+  if (commands.isEmpty())
+    return true;
 
-  // Read output
-  char buffer[LIBSSH_BUFFER_SIZE];
-  int len;
-  while ((len = channel_read(channel, buffer, sizeof(buffer), 0)) > 0) {
-    ossout.write(buffer, len);
-  }
-  stdout_str = QString(ossout.str().c_str());
-  while ((len = channel_read(channel, buffer, sizeof(buffer), 1)) > 0) {
-    osserr.write(buffer, len);
+  ssh_event event = ssh_event_new();
+  if (!event || ssh_event_add_session(event, m_session) != SSH_OK) {
+    if (printWarning)
+      qWarning() << "SSH error: could not create an event for the session.";
+    if (event)
+      ssh_event_free(event);
+    return false;
   }
-  stderr_str = QString(osserr.str().c_str());
 
-  channel_send_eof(channel);
-  channel_close(channel);
+  std::vector<std::unique_ptr<ExecChannel>> running;
+  int next = 0;
+  bool success = true;
 
-  // 5 second timeout
-  int timeout = 15;
-  while (channel_get_exit_status(channel) == -1 && timeout >= 0) {
+  while (success && (next < commands.size() || !running.empty())) {
+    // Keep as many commands running as the server allows
+    while (next < commands.size() && running.size() < MAX_EXEC_CHANNELS) {
 #ifdef SSH_CONNECTION_LIBSSH_DEBUG
-    qDebug() << "Waiting for server to close channel...";
+      qDebug() << "The following command is being executed:"
+               << commands[next];
 #endif
-    GS_SLEEP(1);
-    timeout--;
+      std::unique_ptr<ExecChannel> exec(new ExecChannel);
+      exec->index = next;
+      exec->exitStatus = -1;
+      exec->exitStatusReceived = false;
+      exec->eof = false;
+      exec->closed = false;
+      exec->stdoutData.reserve(LIBSSH_BUFFER_SIZE);
+
+      exec->channel = ssh_channel_new(m_session);
+      if (!exec->channel) {
+        if (printWarning)
+          qWarning() << "SSH error: " << ssh_get_error(m_session);
+        success = false;
+        break;
+      }
+
+      // The callbacks must be in place before any data can arrive
+      memset(&exec->callbacks, 0, sizeof(exec->callbacks));
+      exec->callbacks.userdata = exec.get();
+      exec->callbacks.channel_data_function = execChannelData;
+      exec->callbacks.channel_eof_function = execChannelEof;
+      exec->callbacks.channel_close_function = execChannelClose;
+      exec->callbacks.channel_exit_status_function = execChannelExitStatus;
+      ssh_callbacks_init(&exec->callbacks);
+      ssh_set_channel_callbacks(exec->channel, &exec->callbacks);
+
+      if (ssh_channel_open_session(exec->channel) != SSH_OK ||
+          ssh_channel_request_exec(exec->channel,
+                                   commands[next].toStdString().c_str()) !=
+            SSH_OK) {
+        if (printWarning)
+          qWarning() << "SSH error: " << ssh_get_error(m_session);
+        ssh_channel_free(exec->channel);
+        success = false;
+        break;
+      }
+
+      running.push_back(std::move(exec));
+      ++next;
+    }
+
+    if (!success || running.empty())
+      break;
+
+    // Wait for any of the channels to receive something
+    if (ssh_event_dopoll(event, POLL_TIMEOUT_MS) == SSH_ERROR ||
+        !ssh_is_connected(m_session)) {
+      if (printWarning)
+        qWarning() << "SSH error: " << ssh_get_error(m_session);
+      success = false;
+      break;
+    }
+
+    for (auto it = running.begin(); it != running.end();) {
+      ExecChannel& exec = **it;
+      if (!execChannelFinished(exec)) {
+        ++it;
+        continue;
+      }
+
+      stdout_strs[exec.index] = QString::fromStdString(exec.stdoutData);
+      stderr_strs[exec.index] = QString::fromStdString(exec.stderrData);
+      exitcodes[exec.index] = exec.exitStatus;
+
+      if (!exec.closed) {
+        ssh_channel_send_eof(exec.channel);
+        ssh_channel_close(exec.channel);
+      }
+      ssh_channel_free(exec.channel);
+      it = running.erase(it);
+    }
   }
 
-  exitcode = channel_get_exit_status(channel);
+  // Only left over if something went wrong
+  for (const auto& exec : running) {
+    ssh_channel_close(exec->channel);
+    ssh_channel_free(exec->channel);
+  }
 
-  channel_free(channel);
+  ssh_event_remove_session(event, m_session);
+  ssh_event_free(event);
   END;
-  return true;
+  return success;
 }
 /// @endcond
 
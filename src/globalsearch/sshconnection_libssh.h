@@ -29,6 +29,10 @@ extern "C" {
 
 #define LIBSSH_BUFFER_SIZE 20480
 
+// The number of commands that executeMany() runs at once. OpenSSH allows
+// ten channels per connection by default, and the shell and sftp use two.
+#define MAX_EXEC_CHANNELS 8
+
 namespace GlobalSearch {
 class SSHManagerLibSSH;
 
@@ -82,6 +86,27 @@ public slots:
                        QString& stderr_str, int& exitcode,
                        bool printWarning = true) override;
 
+  /**
+   * Execute several commands on the connected host at the same time,
+   * each on its own channel. Up to MAX_EXEC_CHANNELS commands run at
+   * once.
+   *
+   * @param commands Commands to execute
+   * @param stdout_strs (return) standard output of each command
+   * @param stderr_strs (return) standard error of each command
+   * @param exitcodes (return) exit code of each command, or -1 if the
+   * server did not send one
+   * @param printWarning Prints warnings with qWarning() if an error occurs
+   *
+   * @return True if every command was executed. On failure, the lists
+   * still have one entry per command, and the commands that did not
+   * finish have empty output and an exit code of -1.
+   */
+  virtual bool executeMany(const QStringList& commands,
+                           QStringList& stdout_strs, QStringList& stderr_strs,
+                           QList<int>& exitcodes,
+                           bool printWarning = true) override;
+
   /**
    * Copy a file to the remote host
    *
@@ -254,6 +279,9 @@ protected:
   sftp_session _openSFTP();
   bool _execute(const QString& command, QString& stdout_err,
                 QString& stderr_err, int& exitcode, bool printWarning = true);
+  bool _executeMany(const QStringList& commands, QStringList& stdout_strs,
+                    QStringList& stderr_strs, QList<int>& exitcodes,
+                    bool printWarning = true);
   bool _copyFileToServer(const QString& localpath, const QString& remotepath);
   bool _copyFileFromServer(const QString& remotepath, const QString& localpath);
   bool _readRemoteFile(const QString& filename, QString& contents);
@@ -66,6 +66,9 @@ public:
   /// Get the currently set port
   int getPort() { return m_port; };
 
+  /// Get the maximum number of simultaneous connections
+  virtual unsigned int numConnections() const = 0;
+
 public slots:
   /**
    * Returns a free connection from the pool and locks it.
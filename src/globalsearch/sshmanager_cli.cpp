@@ -21,7 +21,7 @@ namespace GlobalSearch {
 
 SSHManagerCLI::SSHManagerCLI(unsigned int connections, OptBase* parent)
   : SSHManager(parent), m_conn(new SSHConnectionCLI()),
-    m_semaphore(new QSemaphore(connections))
+    m_semaphore(new QSemaphore(connections)), m_connections(connections)
 {
 }
 
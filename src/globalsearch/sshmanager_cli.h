@@ -57,6 +57,8 @@ public:
   void makeConnections(const QString& host, const QString& user,
                        const QString& pass, unsigned int port) override;
 
+  unsigned int numConnections() const override { return m_connections; };
+
 public slots:
   /**
    * Returns a free connection from the pool and locks it.
@@ -73,6 +75,7 @@ public slots:
 protected:
   SSHConnectionCLI* m_conn;
   QSemaphore* m_semaphore;
+  unsigned int m_connections;
 };
 
 } // end namespace GlobalSearch
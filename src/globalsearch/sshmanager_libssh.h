@@ -67,6 +67,8 @@ public:
    */
   bool isValid() { return m_isValid; };
 
+  unsigned int numConnections() const override { return m_connections; };
+
 public slots:
   /**
    * Returns a free connection from the pool and locks it.
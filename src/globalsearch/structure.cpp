@@ -38,9 +38,9 @@ Structure::Structure(QObject* parent)
   : Molecule(), m_hasEnthalpy(false), m_updatedSinceDupChecked(true),
     m_primitiveChecked(false), m_skippedOptimization(false),
     m_supercellGenerationChecked(false), m_histogramGenerationPending(false),
-    m_generation(0), m_id(0), m_rank(0), m_jobID(0), m_energy(0), m_enthalpy(0),
-    m_PV(0), m_optStart(QDateTime()), m_optEnd(QDateTime()), m_index(-1),
-    m_lock(QReadWriteLock::Recursive),
+    m_generation(0), m_id(0), m_rank(0), m_jobID(0), m_checkpointHops(0),
+    m_energy(0), m_enthalpy(0), m_PV(0), m_optStart(QDateTime()),
+    m_optEnd(QDateTime()), m_index(-1), m_lock(QReadWriteLock::Recursive),
 #ifdef ENABLE_MOLECULAR
     m_zValue(-1),
 #endif // ENABLE_MOLECULAR
@@ -56,8 +56,9 @@ Structure::Structure(const Structure& other)
   : Molecule(other), m_updatedSinceDupChecked(true), m_primitiveChecked(false),
     m_skippedOptimization(false), m_supercellGenerationChecked(false),
     m_histogramGenerationPending(false), m_generation(0), m_id(0), m_rank(0),
-    m_jobID(0), m_energy(0), m_enthalpy(0), m_PV(0), m_optStart(QDateTime()),
-    m_optEnd(QDateTime()), m_index(-1), m_lock(QReadWriteLock::Recursive),
+    m_jobID(0), m_checkpointHops(0), m_energy(0), m_enthalpy(0), m_PV(0),
+    m_optStart(QDateTime()), m_optEnd(QDateTime()), m_index(-1),
+    m_lock(QReadWriteLock::Recursive),
 #ifdef ENABLE_MOLECULAR
     m_zValue(-1),
 #endif // ENABLE_MOLECULAR
@@ -76,8 +77,9 @@ Structure::Structure(const GlobalSearch::Molecule& other)
   : Molecule(other), m_updatedSinceDupChecked(true), m_primitiveChecked(false),
     m_skippedOptimization(false), m_supercellGenerationChecked(false),
     m_histogramGenerationPending(false), m_generation(0), m_id(0), m_rank(0),
-    m_jobID(0), m_energy(0), m_enthalpy(0), m_PV(0), m_optStart(QDateTime()),
-    m_optEnd(QDateTime()), m_index(-1), m_lock(QReadWriteLock::Recursive),
+    m_jobID(0), m_checkpointHops(0), m_energy(0), m_enthalpy(0), m_PV(0),
+    m_optStart(QDateTime()), m_optEnd(QDateTime()), m_index(-1),
+    m_lock(QReadWriteLock::Recursive),
 #ifdef ENABLE_MOLECULAR
     m_zValue(-1),
 #endif // ENABLE_MOLECULAR
@@ -122,6 +124,7 @@ Structure& Structure::operator=(const Structure& other)
     m_jobID = other.m_jobID;
     m_currentOptStep = other.m_currentOptStep;
     m_failCount = other.m_failCount;
+    m_checkpointHops = other.m_checkpointHops;
     m_parents = other.m_parents;
     m_dupString = other.m_dupString;
     m_rempath = other.m_rempath;
@@ -166,6 +169,7 @@ Structure& Structure::operator=(Structure&& other) noexcept
     m_jobID = std::move(other.m_jobID);
     m_currentOptStep = std::move(other.m_currentOptStep);
     m_failCount = std::move(other.m_failCount);
+    m_checkpointHops = std::move(other.m_checkpointHops);
     m_parents = std::move(other.m_parents);
     m_dupString = std::move(other.m_dupString);
     m_rempath = std::move(other.m_rempath);
@@ -221,6 +225,7 @@ void Structure::writeStructureSettings(const QString& filename)
   settings->setValue("fileName", fileName());
   settings->setValue("status", int(getStatus()));
   settings->setValue("failCount", getFailCount());
+  settings->setValue("checkpointHops", getCheckpointHops());
   settings->setValue("startTime", getOptTimerStart().toString());
   settings->setValue("endTime", getOptTimerEnd().toString());
   settings->beginWriteArray("copyFiles");
@@ -359,6 +364,7 @@ void Structure::readStructureSettings(const QString& filename,
       setCurrentOptStep(getCurrentOptStep() - 1);
 
     setFailCount(settings->value("failCount", 0).toInt());
+    setCheckpointHops(settings->value("checkpointHops", 0).toUInt());
     setParents(settings->value("parents", "").toString());
     setRempath(settings->value("rempath", "").toString());
     setFileName(settings->value("fileName", m_fileName).toString());
@@ -323,7 +323,7 @@ public:
   /** @return The current optimization step of the Structure.
    * @sa setCurrentOptStep
    */
-  uint getCurrentOptStep() { return m_currentOptStep; };
+  uint getCurrentOptStep() const { return m_currentOptStep; };
 
   /** @return The number of times this Structure has failed the
    * current optimization step.
@@ -333,6 +333,13 @@ public:
    */
   uint getFailCount() { return m_failCount; };
 
+  /** @return The number of times this Structure was restarted from the
+   * last geometry of an interrupted run instead of from scratch.
+   * @sa addCheckpointHop
+   * @sa setCheckpointHops
+   */
+  uint getCheckpointHops() const { return m_checkpointHops; };
+
   // Calculate and return the number of formula units
   uint getFormulaUnits() const;
 
@@ -1263,6 +1270,21 @@ public slots:
    */
   void addFailure() { setFailCount(getFailCount() + 1); };
 
+  /** @param hops The number of times this Structure was restarted from
+   * a checkpoint.
+   * @sa getCheckpointHops
+   * @sa addCheckpointHop
+   */
+  void setCheckpointHops(uint hops) { m_checkpointHops = hops; };
+
+  /** Increase the number of times this Structure was restarted from a
+   * checkpoint by one.
+   *
+   * @sa getCheckpointHops
+   * @sa setCheckpointHops
+   */
+  void addCheckpointHop() { setCheckpointHops(getCheckpointHops() + 1); };
+
   /** @param s A string naming the Structure that this Structure is a
    * duplicate of.
    * @sa getDuplicateString
@@ -1429,7 +1451,7 @@ protected:
     m_skippedOptimization, m_supercellGenerationChecked;
   bool m_histogramGenerationPending;
   uint m_generation, m_id, m_rank, m_jobID, m_currentOptStep, m_failCount,
-    m_fixCount;
+    m_fixCount, m_checkpointHops;
   QString m_parents, m_dupString, m_supString, m_rempath, m_fileName;
   double m_energy, m_enthalpy, m_PV;
   std::atomic<State> m_status;
@@ -0,0 +1,628 @@
+/**********************************************************************
+  StructureArchive - Pack structure directories into a few large files
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ ***********************************************************************/
+
+#include <globalsearch/structurearchive.h>
+
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+
+#include <algorithm>
+
+namespace GlobalSearch {
+
+namespace {
+// "XOAR"
+const quint32 RECORD_MAGIC = 0x584F4152;
+
+enum RecordType : quint8
+{
+  FileRecord = 0,
+  RemovedRecord = 1
+};
+
+// Batches are compacted automatically once they waste more than this
+const qint64 MIN_AUTO_COMPACT_BYTES = 1 << 20;
+
+// The record layout is:
+//   quint32 magic
+//   quint8  type
+//   quint32 size, then the directory name in UTF-8
+//   quint32 size, then the file name in UTF-8
+//   quint64 size, then the file contents
+QByteArray makeRecord(quint8 type, const QString& dirName,
+                      const QString& fileName, const QByteArray& data,
+                      qint64* dataOffset)
+{
+  QByteArray dir = dirName.toUtf8();
+  QByteArray file = fileName.toUtf8();
+
+  QByteArray record;
+  QDataStream out(&record, QIODevice::WriteOnly);
+  out << RECORD_MAGIC << type;
+  out << static_cast<quint32>(dir.size());
+  out.writeRawData(dir.constData(), dir.size());
+  out << static_cast<quint32>(file.size());
+  out.writeRawData(file.constData(), file.size());
+  out << static_cast<quint64>(data.size());
+  *dataOffset = record.size();
+  out.writeRawData(data.constData(), data.size());
+  return record;
+}
+
+// Reads a size-prefixed name. Returns false if it runs past @p limit.
+bool readName(QDataStream& in, QFile& file, qint64 limit, QString* name)
+{
+  quint32 size = 0;
+  in >> size;
+  if (in.status() != QDataStream::Ok || file.pos() + size > limit)
+    return false;
+  QByteArray bytes(static_cast<int>(size), '\0');
+  if (in.readRawData(bytes.data(), size) != static_cast<int>(size))
+    return false;
+  *name = QString::fromUtf8(bytes);
+  return true;
+}
+
+bool isFinalDirectoryName(const QString& name)
+{
+  return !name.isEmpty() && !name.contains('/');
+}
+}
+
+StructureArchive::StructureArchive(const QString& path)
+  : m_path(path), m_batchSize(256), m_loaded(false)
+{
+}
+
+QString StructureArchive::path() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_path;
+}
+
+void StructureArchive::setPath(const QString& path)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (QDir::cleanPath(path) == QDir::cleanPath(m_path))
+    return;
+
+  m_path = path;
+  m_loaded = false;
+  m_batches.clear();
+  m_index.clear();
+}
+
+void StructureArchive::setErrorHandler(const ErrorHandler& handler)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_errorHandler = handler;
+}
+
+size_t StructureArchive::batchSize() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_batchSize;
+}
+
+void StructureArchive::setBatchSize(size_t n)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_batchSize = std::max<size_t>(n, 1);
+}
+
+bool StructureArchive::contains(const QString& dirName) const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  loadLocked();
+  return m_index.contains(dirName);
+}
+
+QStringList StructureArchive::directories() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  loadLocked();
+  QStringList ret = m_index.keys();
+  ret.sort();
+  return ret;
+}
+
+QStringList StructureArchive::files(const QString& dirName) const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  loadLocked();
+  QStringList ret = m_index.value(dirName).keys();
+  ret.sort();
+  return ret;
+}
+
+bool StructureArchive::readFile(const QString& dirName,
+                                const QString& fileName,
+                                QByteArray* data) const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  loadLocked();
+
+  auto dir = m_index.constFind(dirName);
+  if (dir == m_index.constEnd())
+    return false;
+  auto loc = dir->constFind(fileName);
+  if (loc == dir->constEnd())
+    return false;
+
+  return readLocked(*loc, data);
+}
+
+bool StructureArchive::extractFile(const QString& dirName,
+                                   const QString& fileName,
+                                   const QString& destination) const
+{
+  QByteArray data;
+  if (!readFile(dirName, fileName, &data))
+    return false;
+
+  QFile file(destination);
+  if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size()) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    reportErrorLocked(
+      QString("StructureArchive: failed to write %1").arg(destination));
+    return false;
+  }
+  return true;
+}
+
+bool StructureArchive::writeFile(const QString& dirName,
+                                 const QString& fileName,
+                                 const QByteArray& data)
+{
+  if (!isFinalDirectoryName(dirName) || fileName.isEmpty())
+    return false;
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  loadLocked();
+
+  // Don't grow the archive if nothing changed
+  auto dir = m_index.constFind(dirName);
+  if (dir != m_index.constEnd()) {
+    auto loc = dir->constFind(fileName);
+    if (loc != dir->constEnd() && loc->size == data.size()) {
+      QByteArray current;
+      if (readLocked(*loc, &current) && current == data)
+        return true;
+    }
+  }
+
+  int batch = batchForLocked(dirName);
+  if (batch < 0 || !appendLocked(batch, dirName, fileName, data))
+    return false;
+
+  const Batch& b = m_batches[batch];
+  if (b.wastedBytes > MIN_AUTO_COMPACT_BYTES && b.wastedBytes > b.liveBytes)
+    compactBatchLocked(batch);
+  return true;
+}
+
+bool StructureArchive::archiveDirectory(const QString& dirPath,
+                                        const QStringList& keepFileNames)
+{
+  QDir dir(dirPath);
+  QString dirName = dir.dirName();
+  if (!dir.exists() || !isFinalDirectoryName(dirName))
+    return false;
+
+  QStringList fileNames =
+    dir.entryList(QDir::Files | QDir::Hidden | QDir::System, QDir::Name);
+  for (const auto& keep : keepFileNames)
+    fileNames.removeAll(keep);
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  loadLocked();
+
+  int batch = batchForLocked(dirName);
+  if (batch < 0)
+    return false;
+
+  for (const auto& fileName : fileNames) {
+    if (fileName.endsWith(".old"))
+      continue;
+
+    QFile file(dir.absoluteFilePath(fileName));
+    if (!file.open(QIODevice::ReadOnly)) {
+      reportErrorLocked(
+        QString("StructureArchive: failed to read %1").arg(file.fileName()));
+      return false;
+    }
+    if (!appendLocked(batch, dirName, fileName, file.readAll()))
+      return false;
+  }
+
+  // Everything is in the archive. Remove the directory unless something
+  // was kept in it.
+  for (const auto& fileName : fileNames)
+    dir.remove(fileName);
+  QDir parent(dir.absolutePath());
+  if (parent.cdUp())
+    parent.rmdir(dirName);
+  return true;
+}
+
+bool StructureArchive::restoreDirectory(const QString& dirPath)
+{
+  QDir dir(dirPath);
+  QString dirName = dir.dirName();
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  loadLocked();
+
+  auto it = m_index.find(dirName);
+  if (it == m_index.end())
+    return false;
+
+  if (!dir.mkpath(dir.absolutePath())) {
+    reportErrorLocked(QString("StructureArchive: failed to create %1")
+                        .arg(dir.absolutePath()));
+    return false;
+  }
+
+  QHash<QString, Location> files = *it;
+  for (auto file = files.constBegin(); file != files.constEnd(); ++file) {
+    QByteArray data;
+    if (!readLocked(file.value(), &data))
+      return false;
+    QFile out(dir.absoluteFilePath(file.key()));
+    if (!out.open(QIODevice::WriteOnly) || out.write(data) != data.size()) {
+      reportErrorLocked(
+        QString("StructureArchive: failed to write %1").arg(out.fileName()));
+      return false;
+    }
+  }
+
+  // The files are back on disk. Remove them from the archive.
+  for (auto file = files.constBegin(); file != files.constEnd(); ++file) {
+    if (!appendLocked(file.value().batch, dirName, file.key(), QByteArray(),
+                      true)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool StructureArchive::compact(double maxWaste)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  loadLocked();
+
+  bool ok = true;
+  for (size_t i = 0; i < m_batches.size(); ++i) {
+    const Batch& b = m_batches[i];
+    if (b.wastedBytes > 0 && b.wastedBytes >= maxWaste * b.liveBytes)
+      ok = compactBatchLocked(static_cast<int>(i)) && ok;
+  }
+  return ok;
+}
+
+qint64 StructureArchive::size() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  loadLocked();
+  qint64 ret = 0;
+  for (const auto& b : m_batches)
+    ret += b.end;
+  return ret;
+}
+
+qint64 StructureArchive::wastedBytes() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  loadLocked();
+  qint64 ret = 0;
+  for (const auto& b : m_batches)
+    ret += b.wastedBytes;
+  return ret;
+}
+
+void StructureArchive::loadLocked() const
+{
+  if (m_loaded)
+    return;
+  m_loaded = true;
+
+  if (m_path.isEmpty())
+    return;
+
+  QDir dir(m_path);
+  QStringList batchFiles =
+    dir.entryList(QStringList("batch-*.xoar"), QDir::Files, QDir::Name);
+  for (const auto& batchFile : batchFiles)
+    loadBatchLocked(dir.absoluteFilePath(batchFile));
+}
+
+void StructureArchive::loadBatchLocked(const QString& fileName) const
+{
+  int batch = static_cast<int>(m_batches.size());
+  m_batches.push_back(Batch());
+  Batch& b = m_batches.back();
+  b.fileName = fileName;
+  b.end = 0;
+  b.liveBytes = 0;
+  b.wastedBytes = 0;
+
+  QFile file(fileName);
+  if (!file.open(QIODevice::ReadOnly)) {
+    reportErrorLocked(
+      QString("StructureArchive: failed to read %1").arg(fileName));
+    return;
+  }
+
+  const qint64 fileSize = file.size();
+  QDataStream in(&file);
+  while (file.pos() < fileSize) {
+    const qint64 start = file.pos();
+
+    quint32 magic = 0;
+    quint8 type = 0;
+    in >> magic >> type;
+    if (in.status() != QDataStream::Ok || magic != RECORD_MAGIC)
+      break;
+
+    QString dirName, name;
+    if (!readName(in, file, fileSize, &dirName) ||
+        !readName(in, file, fileSize, &name)) {
+      break;
+    }
+
+    quint64 size = 0;
+    in >> size;
+    const qint64 offset = file.pos();
+    if (in.status() != QDataStream::Ok ||
+        size > static_cast<quint64>(fileSize - offset)) {
+      // The last record was cut short
+      break;
+    }
+    if (!file.seek(offset + static_cast<qint64>(size)))
+      break;
+
+    const qint64 recordSize = file.pos() - start;
+    b.end = file.pos();
+
+    QHash<QString, Location>& files = m_index[dirName];
+    auto old = files.find(name);
+    if (old != files.end()) {
+      Batch& oldBatch = m_batches[old->batch];
+      oldBatch.liveBytes -= old->recordSize;
+      oldBatch.wastedBytes += old->recordSize;
+      files.erase(old);
+    }
+
+    if (!b.directories.contains(dirName))
+      b.directories.append(dirName);
+
+    if (type == RemovedRecord) {
+      b.wastedBytes += recordSize;
+      if (files.isEmpty())
+        m_index.remove(dirName);
+      continue;
+    }
+
+    Location loc;
+    loc.batch = batch;
+    loc.offset = offset;
+    loc.size = static_cast<qint64>(size);
+    loc.recordSize = recordSize;
+    files.insert(name, loc);
+    b.liveBytes += recordSize;
+  }
+
+  if (b.end != fileSize) {
+    reportErrorLocked(QString("StructureArchive: ignoring %1 bytes of "
+                              "incomplete records at the end of %2")
+                        .arg(fileSize - b.end)
+                        .arg(fileName));
+  }
+}
+
+bool StructureArchive::readLocked(const Location& loc, QByteArray* data) const
+{
+  QFile file(m_batches[loc.batch].fileName);
+  if (!file.open(QIODevice::ReadOnly) || !file.seek(loc.offset)) {
+    reportErrorLocked(
+      QString("StructureArchive: failed to read %1").arg(file.fileName()));
+    return false;
+  }
+
+  *data = file.read(loc.size);
+  if (data->size() != loc.size) {
+    reportErrorLocked(QString("StructureArchive: %1 ends in the middle of "
+                              "a record")
+                        .arg(file.fileName()));
+    return false;
+  }
+  return true;
+}
+
+bool StructureArchive::appendLocked(int batch, const QString& dirName,
+                                    const QString& fileName,
+                                    const QByteArray& data, bool removed)
+{
+  Batch& b = m_batches[batch];
+
+  qint64 dataOffset = 0;
+  QByteArray record =
+    makeRecord(removed ? RemovedRecord : FileRecord, dirName, fileName,
+               removed ? QByteArray() : data, &dataOffset);
+
+  QFile file(b.fileName);
+  if (!file.open(QIODevice::ReadWrite)) {
+    reportErrorLocked(
+      QString("StructureArchive: failed to open %1").arg(b.fileName));
+    return false;
+  }
+
+  // Drop anything after the last complete record
+  if (file.size() != b.end && !file.resize(b.end)) {
+    reportErrorLocked(
+      QString("StructureArchive: failed to truncate %1").arg(b.fileName));
+    return false;
+  }
+
+  if (!file.seek(b.end) || file.write(record) != record.size() ||
+      !file.flush()) {
+    reportErrorLocked(
+      QString("StructureArchive: failed to write to %1").arg(b.fileName));
+    // Whatever was written is ignored and dropped by the next write
+    return false;
+  }
+
+  const qint64 start = b.end;
+  b.end += record.size();
+
+  QHash<QString, Location>& files = m_index[dirName];
+  auto old = files.find(fileName);
+  if (old != files.end()) {
+    Batch& oldBatch = m_batches[old->batch];
+    oldBatch.liveBytes -= old->recordSize;
+    oldBatch.wastedBytes += old->recordSize;
+    files.erase(old);
+  }
+
+  if (removed) {
+    b.wastedBytes += record.size();
+    if (files.isEmpty())
+      m_index.remove(dirName);
+    return true;
+  }
+
+  Location loc;
+  loc.batch = batch;
+  loc.offset = start + dataOffset;
+  loc.size = data.size();
+  loc.recordSize = record.size();
+  files.insert(fileName, loc);
+  b.liveBytes += record.size();
+  return true;
+}
+
+int StructureArchive::batchForLocked(const QString& dirName)
+{
+  // Keep a directory's files together
+  auto dir = m_index.constFind(dirName);
+  if (dir != m_index.constEnd() && !dir->isEmpty())
+    return dir->constBegin()->batch;
+
+  for (size_t i = 0; i < m_batches.size(); ++i) {
+    if (m_batches[i].directories.contains(dirName))
+      return static_cast<int>(i);
+  }
+
+  if (!m_batches.empty() &&
+      static_cast<size_t>(m_batches.back().directories.size()) <
+        m_batchSize) {
+    m_batches.back().directories.append(dirName);
+    return static_cast<int>(m_batches.size() - 1);
+  }
+
+  if (m_path.isEmpty())
+    return -1;
+  if (!QDir().mkpath(m_path)) {
+    reportErrorLocked(
+      QString("StructureArchive: failed to create %1").arg(m_path));
+    return -1;
+  }
+
+  Batch b;
+  b.fileName = QDir(m_path).absoluteFilePath(
+    QString("batch-%1.xoar")
+      .arg(static_cast<int>(m_batches.size()), 5, 10, QChar('0')));
+  b.end = 0;
+  b.liveBytes = 0;
+  b.wastedBytes = 0;
+  b.directories.append(dirName);
+  m_batches.push_back(b);
+  return static_cast<int>(m_batches.size() - 1);
+}
+
+bool StructureArchive::compactBatchLocked(int batch)
+{
+  Batch& b = m_batches[batch];
+
+  QSaveFile out(b.fileName);
+  if (!out.open(QIODevice::WriteOnly)) {
+    reportErrorLocked(
+      QString("StructureArchive: failed to open %1").arg(b.fileName));
+    return false;
+  }
+
+  // The new locations are only used once the new file is in place
+  QHash<QString, QHash<QString, Location>> moved;
+  QStringList directories;
+  qint64 end = 0;
+  for (auto dir = m_index.constBegin(); dir != m_index.constEnd(); ++dir) {
+    for (auto file = dir->constBegin(); file != dir->constEnd(); ++file) {
+      if (file->batch != batch)
+        continue;
+
+      QByteArray data;
+      if (!readLocked(file.value(), &data)) {
+        out.cancelWriting();
+        return false;
+      }
+
+      qint64 dataOffset = 0;
+      QByteArray record =
+        makeRecord(FileRecord, dir.key(), file.key(), data, &dataOffset);
+      if (out.write(record) != record.size()) {
+        out.cancelWriting();
+        reportErrorLocked(
+          QString("StructureArchive: failed to write to %1").arg(b.fileName));
+        return false;
+      }
+
+      Location loc = file.value();
+      loc.offset = end + dataOffset;
+      loc.recordSize = record.size();
+      moved[dir.key()].insert(file.key(), loc);
+      end += record.size();
+    }
+    if (moved.contains(dir.key()))
+      directories.append(dir.key());
+  }
+
+  if (!out.commit()) {
+    reportErrorLocked(
+      QString("StructureArchive: failed to replace %1").arg(b.fileName));
+    return false;
+  }
+
+  for (auto dir = moved.constBegin(); dir != moved.constEnd(); ++dir) {
+    for (auto file = dir->constBegin(); file != dir->constEnd(); ++file)
+      m_index[dir.key()][file.key()] = file.value();
+  }
+
+  b.end = end;
+  b.liveBytes = end;
+  b.wastedBytes = 0;
+  b.directories = directories;
+  return true;
+}
+
+void StructureArchive::reportErrorLocked(const QString& message) const
+{
+  if (m_errorHandler)
+    m_errorHandler(message);
+  else
+    qDebug() << message;
+}
+}
@@ -0,0 +1,190 @@
+/**********************************************************************
+  StructureArchive - Pack structure directories into a few large files
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ ***********************************************************************/
+
+#ifndef GLOBALSEARCH_STRUCTUREARCHIVE_H
+#define GLOBALSEARCH_STRUCTUREARCHIVE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace GlobalSearch {
+
+/**
+ * @class StructureArchive structurearchive.h
+ * <globalsearch/structurearchive.h>
+ *
+ * @brief Stores the directories of finished structures in a few indexed
+ * archive files instead of hundreds of thousands of small files.
+ *
+ * The archive is a directory of batch files. Each batch holds the files
+ * of up to batchSize() structure directories as a sequence of records,
+ * and a file is read by seeking straight to its record. Records are only
+ * ever appended: writing a file again appends a new version, and removing
+ * a directory appends markers. A record that was cut short by a crash is
+ * ignored, so the previous version of the file is still used. Batches
+ * are rewritten without the replaced records once those take up more
+ * space than the current ones.
+ *
+ * Directories are identified by their name (e.g., "00002x00013"), not by
+ * their full path, so the run directory may be moved.
+ *
+ * All functions are thread safe.
+ */
+class StructureArchive
+{
+public:
+  /// Receives a message when a batch file cannot be read or written
+  typedef std::function<void(const QString&)> ErrorHandler;
+
+  /**
+   * Constructor.
+   *
+   * @param path The directory that holds the batch files. It is created
+   *             when the first directory is archived.
+   */
+  explicit StructureArchive(const QString& path = QString());
+
+  QString path() const;
+
+  /// Change the archive directory. The batch files there are read again.
+  void setPath(const QString& path);
+
+  /**
+   * Set the function that read and write failures are reported to. It is
+   * called with the archive locked, so it may not use the archive. By
+   * default, the failures are printed with qDebug().
+   */
+  void setErrorHandler(const ErrorHandler& handler);
+
+  /// The maximum number of structure directories in one batch file
+  size_t batchSize() const;
+  void setBatchSize(size_t n);
+
+  /// True if directory @p dirName has any files in the archive
+  bool contains(const QString& dirName) const;
+
+  /// The names of the archived directories
+  QStringList directories() const;
+
+  /// The names of the files in archived directory @p dirName
+  QStringList files(const QString& dirName) const;
+
+  /**
+   * Read a file from the archive.
+   *
+   * @return True if the file exists and was read.
+   */
+  bool readFile(const QString& dirName, const QString& fileName,
+                QByteArray* data) const;
+
+  /// Copy a file from the archive to @p destination
+  bool extractFile(const QString& dirName, const QString& fileName,
+                   const QString& destination) const;
+
+  /// Add or replace a file. Nothing is written if it did not change.
+  bool writeFile(const QString& dirName, const QString& fileName,
+                 const QByteArray& data);
+
+  /**
+   * Move the files of the directory at @p dirPath into the archive and
+   * delete the directory. Backup files ending in ".old" are not kept,
+   * since an interrupted write to the archive leaves the previous version
+   * in place. The files in @p keepFileNames are left where they are.
+   * They, and subdirectories, which are not archived either, keep the
+   * directory from being deleted.
+   *
+   * @return True if all of the files were archived.
+   */
+  bool archiveDirectory(const QString& dirPath,
+                        const QStringList& keepFileNames = QStringList());
+
+  /**
+   * Move the files of the archived directory with the same name as
+   * @p dirPath back into it, creating it if needed.
+   *
+   * @return True if the directory was archived and was restored.
+   */
+  bool restoreDirectory(const QString& dirPath);
+
+  /// Rewrite the batches whose replaced records take up more space than
+  /// @p maxWaste times their current records.
+  bool compact(double maxWaste = 1.0);
+
+  /// The total size of the batch files in bytes
+  qint64 size() const;
+
+  /// The bytes taken up by replaced or removed records
+  qint64 wastedBytes() const;
+
+private:
+  struct Location
+  {
+    int batch;
+    // The position and size of the file's data in the batch
+    qint64 offset;
+    qint64 size;
+    // The size of the whole record
+    qint64 recordSize;
+  };
+
+  struct Batch
+  {
+    QString fileName;
+    // The end of the last complete record
+    qint64 end;
+    qint64 liveBytes;
+    qint64 wastedBytes;
+    QStringList directories;
+  };
+
+  // Reads the batch files if they have not been read. m_mutex must be
+  // locked.
+  void loadLocked() const;
+  void loadBatchLocked(const QString& fileName) const;
+
+  bool readLocked(const Location& loc, QByteArray* data) const;
+
+  // Appends one record. If @p removed is true, the record marks the file
+  // as removed and @p data is ignored.
+  bool appendLocked(int batch, const QString& dirName,
+                    const QString& fileName, const QByteArray& data,
+                    bool removed = false);
+
+  // The batch that new files of @p dirName go to, creating one if needed
+  int batchForLocked(const QString& dirName);
+
+  bool compactBatchLocked(int batch);
+
+  // Passes @p message to m_errorHandler. m_mutex must be locked.
+  void reportErrorLocked(const QString& message) const;
+
+  mutable std::mutex m_mutex;
+  QString m_path;
+  size_t m_batchSize;
+  ErrorHandler m_errorHandler;
+
+  mutable bool m_loaded;
+  mutable std::vector<Batch> m_batches;
+  // Directory name -> file name -> record
+  mutable QHash<QString, QHash<QString, Location>> m_index;
+};
+}
+
+#endif // GLOBALSEARCH_STRUCTUREARCHIVE_H
@@ -0,0 +1,403 @@
+/**********************************************************************
+  StructureJournal - Append-only journal of structure events
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ ***********************************************************************/
+
+#include <globalsearch/structurejournal.h>
+
+#include <globalsearch/structure.h>
+
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <chrono>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace GlobalSearch {
+
+namespace {
+// "XOJR"
+const quint32 RECORD_MAGIC = 0x584F4A52;
+
+// Marks the sequence number a checkpoint was taken at. It is not an event.
+const quint8 CHECKPOINT_RECORD = 0xFF;
+
+// The record layout is:
+//   quint32 magic
+//   quint8  type
+//   quint64 sequence
+//   quint32 size, then the directory name in UTF-8
+//   qint32  status
+//   quint32 optimization step
+//   quint32 job ID
+//   double  energy
+//   quint8  has enthalpy
+//   double  enthalpy
+//   quint32 size, then the text in UTF-8
+QByteArray makeRecord(quint8 type, const StructureJournal::Event& e)
+{
+  QByteArray dir = e.dirName.toUtf8();
+  QByteArray text = e.text.toUtf8();
+
+  QByteArray record;
+  QDataStream out(&record, QIODevice::WriteOnly);
+  out << RECORD_MAGIC << type << e.sequence;
+  out << static_cast<quint32>(dir.size());
+  out.writeRawData(dir.constData(), dir.size());
+  out << static_cast<qint32>(e.status) << static_cast<quint32>(e.optStep)
+      << static_cast<quint32>(e.jobID) << e.energy
+      << static_cast<quint8>(e.hasEnthalpy) << e.enthalpy;
+  out << static_cast<quint32>(text.size());
+  out.writeRawData(text.constData(), text.size());
+  return record;
+}
+
+// Reads a size-prefixed string. Returns false if it runs past the data.
+bool readString(QDataStream& in, QString* str)
+{
+  quint32 size = 0;
+  in >> size;
+  if (in.status() != QDataStream::Ok ||
+      size > static_cast<quint64>(in.device()->bytesAvailable())) {
+    return false;
+  }
+  QByteArray bytes(static_cast<int>(size), '\0');
+  if (in.readRawData(bytes.data(), size) != static_cast<int>(size))
+    return false;
+  *str = QString::fromUtf8(bytes);
+  return true;
+}
+
+// Reads the records in @p data. @p end is set to the end of the last
+// complete record, and @p lastSequence to the largest sequence number.
+std::vector<StructureJournal::Event> readRecords(const QByteArray& data,
+                                                 qint64* end,
+                                                 quint64* lastSequence)
+{
+  std::vector<StructureJournal::Event> ret;
+  *end = 0;
+  *lastSequence = 0;
+
+  QDataStream in(data);
+  while (!in.atEnd()) {
+    quint32 magic = 0;
+    quint8 type = 0;
+    StructureJournal::Event e;
+    in >> magic >> type >> e.sequence;
+    if (in.status() != QDataStream::Ok || magic != RECORD_MAGIC)
+      break;
+
+    if (!readString(in, &e.dirName))
+      break;
+
+    qint32 status = 0;
+    quint32 optStep = 0, jobID = 0;
+    quint8 hasEnthalpy = 0;
+    in >> status >> optStep >> jobID >> e.energy >> hasEnthalpy >>
+      e.enthalpy;
+    if (in.status() != QDataStream::Ok || !readString(in, &e.text))
+      break;
+
+    *end = in.device()->pos();
+    *lastSequence = std::max(*lastSequence, e.sequence);
+    if (type == CHECKPOINT_RECORD)
+      continue;
+
+    e.type = static_cast<StructureJournal::EventType>(type);
+    e.status = status;
+    e.optStep = optStep;
+    e.jobID = jobID;
+    e.hasEnthalpy = hasEnthalpy != 0;
+    ret.push_back(e);
+  }
+  return ret;
+}
+
+bool syncFile(QFile& file)
+{
+  if (!file.flush())
+    return false;
+#ifdef _WIN32
+  return _commit(file.handle()) == 0;
+#else
+  return fsync(file.handle()) == 0;
+#endif
+}
+}
+
+StructureJournal::StructureJournal(const QString& fileName)
+  : m_stop(false), m_fileName(fileName), m_syncInterval(500),
+    m_lastSequence(0), m_end(0)
+{
+  std::unique_lock<std::mutex> writeLock(m_writeMutex);
+  loadLocked();
+}
+
+StructureJournal::~StructureJournal()
+{
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_cv.notify_all();
+  if (m_syncThread.joinable())
+    m_syncThread.join();
+
+  flush();
+}
+
+QString StructureJournal::fileName() const
+{
+  std::unique_lock<std::mutex> writeLock(m_writeMutex);
+  return m_fileName;
+}
+
+void StructureJournal::setFileName(const QString& fileName)
+{
+  std::unique_lock<std::mutex> writeLock(m_writeMutex);
+  if (QDir::cleanPath(fileName) == QDir::cleanPath(m_fileName))
+    return;
+
+  flushLocked();
+  m_file.close();
+  m_fileName = fileName;
+  loadLocked();
+}
+
+int StructureJournal::syncInterval() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_syncInterval;
+}
+
+void StructureJournal::setSyncInterval(int ms)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_syncInterval = std::max(ms, 0);
+}
+
+void StructureJournal::setMinimumSequence(quint64 sequence)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_lastSequence = std::max(m_lastSequence, sequence);
+}
+
+quint64 StructureJournal::append(Event event)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  event.sequence = ++m_lastSequence;
+  m_buffer.append(makeRecord(event.type, event));
+
+  if (!m_syncThread.joinable() && !m_stop)
+    m_syncThread = std::thread(&StructureJournal::syncLoop, this);
+  lock.unlock();
+
+  m_cv.notify_all();
+  return event.sequence;
+}
+
+quint64 StructureJournal::lastSequence() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_lastSequence;
+}
+
+bool StructureJournal::flush()
+{
+  std::unique_lock<std::mutex> writeLock(m_writeMutex);
+  return flushLocked();
+}
+
+std::vector<StructureJournal::Event> StructureJournal::events(quint64 after)
+{
+  std::unique_lock<std::mutex> writeLock(m_writeMutex);
+  flushLocked();
+
+  QFile file(m_fileName);
+  if (m_fileName.isEmpty() || !file.open(QIODevice::ReadOnly))
+    return std::vector<Event>();
+
+  qint64 end = 0;
+  quint64 lastSequence = 0;
+  std::vector<Event> ret = readRecords(file.read(m_end), &end, &lastSequence);
+  ret.erase(std::remove_if(ret.begin(), ret.end(),
+                           [after](const Event& e) {
+                             return e.sequence <= after;
+                           }),
+            ret.end());
+  std::stable_sort(ret.begin(), ret.end(),
+                   [](const Event& a, const Event& b) {
+                     return a.sequence < b.sequence;
+                   });
+  return ret;
+}
+
+bool StructureJournal::checkpoint(quint64 sequence)
+{
+  std::unique_lock<std::mutex> writeLock(m_writeMutex);
+  if (!flushLocked())
+    return false;
+
+  QByteArray data;
+  {
+    QFile file(m_fileName);
+    if (file.open(QIODevice::ReadOnly))
+      data = file.read(m_end);
+  }
+
+  qint64 end = 0;
+  quint64 lastSequence = 0;
+  std::vector<Event> events = readRecords(data, &end, &lastSequence);
+
+  // The marker keeps the numbering going after the events are dropped
+  Event marker;
+  marker.sequence = std::max(lastSequence, sequence);
+  QByteArray newData = makeRecord(CHECKPOINT_RECORD, marker);
+  for (const auto& e : events) {
+    if (e.sequence > sequence)
+      newData.append(makeRecord(e.type, e));
+  }
+
+  m_file.close();
+  QFileInfo(m_fileName).dir().mkpath(".");
+  QSaveFile out(m_fileName);
+  if (!out.open(QIODevice::WriteOnly) ||
+      out.write(newData) != newData.size() || !out.commit()) {
+    qDebug() << "StructureJournal: failed to rewrite" << m_fileName;
+    return false;
+  }
+  m_end = newData.size();
+  return true;
+}
+
+StructureJournal::Event StructureJournal::makeEvent(EventType type,
+                                                    const Structure& s)
+{
+  Event e;
+  e.type = type;
+  e.dirName = QDir(s.fileName()).dirName();
+  e.status = s.getStatus();
+  e.optStep = s.getCurrentOptStep();
+  e.jobID = s.getJobID();
+  e.energy = s.getEnergy();
+  e.hasEnthalpy = s.hasEnthalpy();
+  e.enthalpy = e.hasEnthalpy ? s.getEnthalpy() : 0.0;
+  if (type == DuplicateOf) {
+    e.text = s.getStatus() == Structure::Supercell ? s.getSupercellString()
+                                                   : s.getDuplicateString();
+  }
+  return e;
+}
+
+void StructureJournal::apply(const Event& event, Structure& s)
+{
+  s.setStatus(static_cast<Structure::State>(event.status));
+  s.setCurrentOptStep(event.optStep);
+  s.setJobID(event.jobID);
+  s.setEnergy(event.energy);
+  if (event.hasEnthalpy)
+    s.setEnthalpy(event.enthalpy);
+  else
+    s.resetEnthalpy();
+
+  if (event.type == DuplicateOf) {
+    if (event.status == Structure::Supercell)
+      s.setSupercellString(event.text);
+    else
+      s.setDuplicateString(event.text);
+  }
+}
+
+void StructureJournal::loadLocked()
+{
+  m_end = 0;
+  quint64 lastSequence = 0;
+
+  QFile file(m_fileName);
+  if (!m_fileName.isEmpty() && file.open(QIODevice::ReadOnly)) {
+    const QByteArray data = file.readAll();
+    readRecords(data, &m_end, &lastSequence);
+    if (m_end != data.size()) {
+      qDebug() << "StructureJournal: ignoring" << data.size() - m_end
+               << "bytes of incomplete records at the end of" << m_fileName;
+    }
+  }
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_lastSequence = lastSequence;
+}
+
+bool StructureJournal::flushLocked()
+{
+  QByteArray buffer;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    buffer.swap(m_buffer);
+  }
+  if (buffer.isEmpty())
+    return true;
+
+  if (!m_file.isOpen()) {
+    QFileInfo(m_fileName).dir().mkpath(".");
+    m_file.setFileName(m_fileName);
+    if (m_fileName.isEmpty() || !m_file.open(QIODevice::ReadWrite)) {
+      qDebug() << "StructureJournal: failed to open" << m_fileName;
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_buffer.prepend(buffer);
+      return false;
+    }
+  }
+
+  // Drop anything after the last complete record
+  if ((m_file.size() != m_end && !m_file.resize(m_end)) ||
+      !m_file.seek(m_end) || m_file.write(buffer) != buffer.size() ||
+      !syncFile(m_file)) {
+    qDebug() << "StructureJournal: failed to write to" << m_fileName;
+    // Whatever was written is ignored and dropped by the next write.
+    // Keep the events so that they are written then.
+    m_file.close();
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_buffer.prepend(buffer);
+    return false;
+  }
+
+  m_end += buffer.size();
+  return true;
+}
+
+void StructureJournal::syncLoop()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (!m_stop) {
+    m_cv.wait(lock, [this]() { return m_stop || !m_buffer.isEmpty(); });
+    if (m_stop)
+      break;
+
+    // Let more events collect so that they share one sync
+    m_cv.wait_for(lock, std::chrono::milliseconds(m_syncInterval),
+                  [this]() { return m_stop; });
+
+    lock.unlock();
+    flush();
+    lock.lock();
+  }
+}
+}
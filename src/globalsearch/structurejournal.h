@@ -0,0 +1,167 @@
+/**********************************************************************
+  StructureJournal - Append-only journal of structure events
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ ***********************************************************************/
+
+#ifndef GLOBALSEARCH_STRUCTUREJOURNAL_H
+#define GLOBALSEARCH_STRUCTUREJOURNAL_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace GlobalSearch {
+class Structure;
+
+/**
+ * @class StructureJournal structurejournal.h
+ * <globalsearch/structurejournal.h>
+ *
+ * @brief A write-ahead journal of the events in the life of each structure,
+ * so that a run may be resumed from an older full save without losing
+ * anything.
+ *
+ * Each event is a small record that holds the fields of the structure
+ * that the event changed. Events are numbered in the order they were
+ * appended. append() only buffers the record: a background thread writes
+ * the buffer and syncs it to disk every syncInterval() milliseconds, so
+ * many events share one sync. A record that was cut short by a crash is
+ * ignored, and the next record is written in its place.
+ *
+ * After a full save, checkpoint() drops the events that the save
+ * contains. On resume, the events after the sequence number stored with
+ * the save are applied to the loaded structures with apply().
+ *
+ * Structures are identified by the name of their directory (e.g.,
+ * "00002x00013"), so the run directory may be moved.
+ *
+ * All functions are thread safe.
+ */
+class StructureJournal
+{
+public:
+  enum EventType : quint8
+  {
+    /// The structure was added to the tracker
+    Created = 0,
+    /// A job was submitted for the structure
+    Submitted,
+    /// An optimization step finished
+    StepFinished,
+    /// The status changed for any other reason
+    StatusChanged,
+    /// The structure was marked as a duplicate or a supercell
+    DuplicateOf
+  };
+
+  struct Event
+  {
+    EventType type = Created;
+    quint64 sequence = 0;
+    QString dirName;
+    int status = 0;
+    uint optStep = 0;
+    uint jobID = 0;
+    double energy = 0.0;
+    bool hasEnthalpy = false;
+    double enthalpy = 0.0;
+    // The duplicate or supercell string for DuplicateOf events
+    QString text;
+  };
+
+  /**
+   * Constructor.
+   *
+   * @param fileName The journal file. It is created when the first event
+   *                 is written.
+   */
+  explicit StructureJournal(const QString& fileName = QString());
+
+  /// Writes the buffered events and stops the sync thread
+  ~StructureJournal();
+
+  QString fileName() const;
+
+  /// Change the journal file. The buffered events are written to the
+  /// previous file first.
+  void setFileName(const QString& fileName);
+
+  /// The time in milliseconds between syncs of the buffered events
+  int syncInterval() const;
+  void setSyncInterval(int ms);
+
+  /// Make the events that are appended from now on be numbered above
+  /// @p sequence.
+  void setMinimumSequence(quint64 sequence);
+
+  /**
+   * Buffer an event. Its sequence number is assigned here.
+   *
+   * @return The sequence number of the event.
+   */
+  quint64 append(Event event);
+
+  /// The sequence number of the last event that was appended
+  quint64 lastSequence() const;
+
+  /// Write and sync the buffered events now
+  bool flush();
+
+  /// The events in the journal numbered above @p after, in order
+  std::vector<Event> events(quint64 after = 0);
+
+  /// Rewrite the journal without the events numbered @p sequence or lower
+  bool checkpoint(quint64 sequence);
+
+  /// Describe the current state of @p s as an event of type @p type.
+  /// @p s must be locked by the caller.
+  static Event makeEvent(EventType type, const Structure& s);
+
+  /// Set the fields of @p s that @p event recorded. @p s must be locked
+  /// for writing by the caller.
+  static void apply(const Event& event, Structure& s);
+
+private:
+  // Reads the journal file to find the end of the last complete record
+  // and the last sequence number. m_writeMutex must be locked.
+  void loadLocked();
+
+  // Writes the buffered events and syncs them. m_writeMutex must be locked.
+  bool flushLocked();
+
+  void syncLoop();
+
+  // Guards the buffer, the sequence numbers, and the sync thread
+  mutable std::mutex m_mutex;
+  // Guards the file. Lock this before m_mutex if both are needed.
+  mutable std::mutex m_writeMutex;
+  std::condition_variable m_cv;
+  std::thread m_syncThread;
+  bool m_stop;
+
+  QString m_fileName;
+  int m_syncInterval;
+  quint64 m_lastSequence;
+  QByteArray m_buffer;
+
+  // The end of the last complete record in the file
+  qint64 m_end;
+  QFile m_file;
+};
+}
+
+#endif // GLOBALSEARCH_STRUCTUREJOURNAL_H
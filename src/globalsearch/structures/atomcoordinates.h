@@ -0,0 +1,179 @@
+/**********************************************************************
+  AtomCoordinates - A copy of the atoms of a molecule as separate arrays.
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+ ***********************************************************************/
+
+#ifndef GLOBALSEARCH_ATOMCOORDINATES_H
+#define GLOBALSEARCH_ATOMCOORDINATES_H
+
+#include <globalsearch/structures/atom.h>
+#include <globalsearch/structures/unitcell.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <vector>
+
+namespace GlobalSearch {
+
+/**
+ * @class AtomCoordinates atomcoordinates.h
+ * @brief A copy of the positions and atomic numbers of a list of atoms,
+ *        stored as separate contiguous arrays so that loops over every
+ *        atom can be vectorized by the compiler.
+ *
+ * Molecule owns its atoms as a std::vector<Atom>. A copy made here does
+ * not follow later changes to them, so its owner has to move the atoms
+ * with setPos() itself, like XtalOpt::IADTracker does.
+ */
+class AtomCoordinates
+{
+public:
+  AtomCoordinates() = default;
+
+  /**
+   * Constructor.
+   *
+   * @param atoms The atoms whose positions and atomic numbers are copied.
+   */
+  explicit AtomCoordinates(const std::vector<Atom>& atoms) { assign(atoms); }
+
+  /**
+   * Replace the coordinates with those of @p atoms.
+   *
+   * @param atoms The atoms whose positions and atomic numbers are copied.
+   */
+  void assign(const std::vector<Atom>& atoms);
+
+  /**
+   * Move the atom at index @p ind to @p pos.
+   *
+   * @param ind The index of the atom.
+   * @param pos The new Cartesian position in Angstroms.
+   */
+  void setPos(size_t ind, const Vector3& pos)
+  {
+    m_x[ind] = pos[0];
+    m_y[ind] = pos[1];
+    m_z[ind] = pos[2];
+  }
+
+  /* The number of atoms. */
+  size_t size() const { return m_x.size(); }
+
+  const double* x() const { return m_x.data(); }
+  const double* y() const { return m_y.data(); }
+  const double* z() const { return m_z.data(); }
+  const unsigned char* atomicNumbers() const { return m_atomicNumbers.data(); }
+
+  /**
+   * Is the atom at index @p ind at @p pos with the atomic number
+   * @p atomicNum? This is the same as comparing the atoms with
+   * Atom::operator==().
+   */
+  bool isAtom(size_t ind, unsigned short atomicNum, const Vector3& pos) const
+  {
+    return m_atomicNumbers[ind] == atomicNum && m_x[ind] == pos[0] &&
+           m_y[ind] == pos[1] && m_z[ind] == pos[2];
+  }
+
+  /**
+   * For each atom, find the smallest squared distance between @p point and
+   * the atom translated by any of @p translations. If the zero vector is
+   * not one of the translations, the atom itself is not considered.
+   *
+   * @param point The point to measure the distances from.
+   * @param translations The translations to apply to the atoms.
+   * @param squaredDists Set to the squared distance for each atom. It is
+   *                     resized to size().
+   */
+  void minSquaredDistancesToPoint(const Vector3& point,
+                                  const std::vector<Vector3>& translations,
+                                  std::vector<double>& squaredDists) const;
+
+  /**
+   * The translations to the 27 images of an atom in @p cell and the cells
+   * around it. The first one is the zero vector.
+   */
+  static std::vector<Vector3> imageTranslations(const UnitCell& cell);
+
+private:
+  std::vector<double> m_x;
+  std::vector<double> m_y;
+  std::vector<double> m_z;
+  std::vector<unsigned char> m_atomicNumbers;
+};
+
+inline void AtomCoordinates::assign(const std::vector<Atom>& atoms)
+{
+  const size_t n = atoms.size();
+  m_x.resize(n);
+  m_y.resize(n);
+  m_z.resize(n);
+  m_atomicNumbers.resize(n);
+  for (size_t i = 0; i < n; ++i) {
+    const Vector3& pos = atoms[i].pos();
+    m_x[i] = pos[0];
+    m_y[i] = pos[1];
+    m_z[i] = pos[2];
+    m_atomicNumbers[i] = static_cast<unsigned char>(atoms[i].atomicNumber());
+  }
+}
+
+inline std::vector<Vector3> AtomCoordinates::imageTranslations(
+  const UnitCell& cell)
+{
+  const Vector3 aVec(cell.aVector());
+  const Vector3 bVec(cell.bVector());
+  const Vector3 cVec(cell.cVector());
+
+  std::vector<Vector3> ret;
+  ret.reserve(27);
+  ret.push_back(Vector3::Zero());
+  for (int s_1 = -1; s_1 <= 1; ++s_1) {
+    for (int s_2 = -1; s_2 <= 1; ++s_2) {
+      for (int s_3 = -1; s_3 <= 1; ++s_3) {
+        if (s_1 != 0 || s_2 != 0 || s_3 != 0)
+          ret.push_back(s_1 * aVec + s_2 * bVec + s_3 * cVec);
+      }
+    }
+  }
+  return ret;
+}
+
+inline void AtomCoordinates::minSquaredDistancesToPoint(
+  const Vector3& point, const std::vector<Vector3>& translations,
+  std::vector<double>& squaredDists) const
+{
+  const size_t n = size();
+  squaredDists.assign(n, DBL_MAX);
+
+  const double* x = m_x.data();
+  const double* y = m_y.data();
+  const double* z = m_z.data();
+  double* out = squaredDists.data();
+  for (const auto& t : translations) {
+    // Moving the point the other way is the same as translating the atoms
+    const double px = point[0] - t[0];
+    const double py = point[1] - t[1];
+    const double pz = point[2] - t[2];
+    for (size_t i = 0; i < n; ++i) {
+      const double dx = x[i] - px;
+      const double dy = y[i] - py;
+      const double dz = z[i] - pz;
+      out[i] = std::min(out[i], dx * dx + dy * dy + dz * dz);
+    }
+  }
+}
+}
+
+#endif
@@ -39,6 +39,8 @@ void UnitCell::setCellParameters(double a, double b, double c, double alpha,
     std::sqrt(1.0 - ((cosAlpha * cosAlpha) + (cosBeta * cosBeta) +
                      (cosGamma * cosGamma)) +
               (2.0 * cosAlpha * cosBeta * cosGamma));
+
+  updateFractionalMatrix();
 }
 
 Vector3 UnitCell::wrapFractional(const Vector3& frac) const
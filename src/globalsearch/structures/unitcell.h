@@ -39,7 +39,7 @@ public:
    * @param m The matrix with which the cell matrix will be set. The
    *          default cell matrix is the zero matrix.
    */
-  UnitCell(const Matrix3& m = Matrix3());
+  UnitCell(const Matrix3& m = Matrix3::Zero());
 
   /**
    * Constructor. This uses cell parameters to create the cell matrix.
@@ -109,7 +109,11 @@ public:
    *
    * @param mat The 3x3 cell matrix to be set in row vector form.
    */
-  void setCellMatrix(const Matrix3& mat) { m_cellMatrix = mat; };
+  void setCellMatrix(const Matrix3& mat)
+  {
+    m_cellMatrix = mat;
+    updateFractionalMatrix();
+  };
 
   /**
    * Get the cell matrix as row vectors.
@@ -125,26 +129,48 @@ public:
    */
   Matrix3 cellMatrixColForm() const { return m_cellMatrix.transpose(); };
 
+  /**
+   * Get the matrix that converts Cartesian coordinates into fractional
+   * coordinates. It is the inverse of cellMatrixColForm(), and it is only
+   * computed when the cell changes. It is the zero matrix while the cell
+   * is singular (e.g., the default empty cell).
+   *
+   * @return The Cartesian to fractional conversion matrix.
+   */
+  const Matrix3& fractionalMatrix() const { return m_fracMatrix; };
+
   /**
    * Set the A vector.
    *
    * @param v The vector with which to set A.
    */
-  void setAVector(const Vector3& v) { m_cellMatrix.row(0) = v; };
+  void setAVector(const Vector3& v)
+  {
+    m_cellMatrix.row(0) = v;
+    updateFractionalMatrix();
+  };
 
   /**
    * Set the B vector.
    *
    * @param v The vector with which to set B.
    */
-  void setBVector(const Vector3& v) { m_cellMatrix.row(1) = v; };
+  void setBVector(const Vector3& v)
+  {
+    m_cellMatrix.row(1) = v;
+    updateFractionalMatrix();
+  };
 
   /**
    * Set the C vector.
    *
    * @param v The vector with which to set C.
    */
-  void setCVector(const Vector3& v) { m_cellMatrix.row(2) = v; };
+  void setCVector(const Vector3& v)
+  {
+    m_cellMatrix.row(2) = v;
+    updateFractionalMatrix();
+  };
 
   /**
    * Set the cell vectors - a, b, and c.
@@ -255,7 +281,7 @@ public:
   /**
    * Zeroes the unit cell.
    */
-  void clear() { m_cellMatrix = Matrix3::Zero(); };
+  void clear() { setCellMatrix(Matrix3::Zero()); };
 
 private:
   /**
@@ -278,7 +304,13 @@ private:
    */
   static double angleDegrees(const Vector3& v1, const Vector3& v2);
 
+  /* Recompute m_fracMatrix after m_cellMatrix was changed */
+  void updateFractionalMatrix();
+
   Matrix3 m_cellMatrix;
+  // Cached inverse of the transposed cell matrix, or zero if the cell
+  // matrix is singular
+  Matrix3 m_fracMatrix;
 };
 
 // Make sure the move constructor is noexcept
@@ -291,17 +323,19 @@ static_assert(std::is_nothrow_move_assignable<UnitCell>::value,
 
 inline UnitCell::UnitCell(const Matrix3& m) : m_cellMatrix(m)
 {
+  updateFractionalMatrix();
 }
 
 inline UnitCell::UnitCell(double a, double b, double c, double alpha,
                           double beta, double gamma)
-  : m_cellMatrix(Matrix3())
+  : m_cellMatrix(Matrix3::Zero())
 {
   setCellParameters(a, b, c, alpha, beta, gamma);
 }
 
 inline UnitCell::UnitCell(UnitCell&& other) noexcept
-  : m_cellMatrix(std::move(other.m_cellMatrix))
+  : m_cellMatrix(std::move(other.m_cellMatrix)),
+    m_fracMatrix(std::move(other.m_fracMatrix))
 {
 }
 
@@ -309,6 +343,7 @@ inline UnitCell& UnitCell::operator=(UnitCell&& other) noexcept
 {
   if (this != &other) {
     m_cellMatrix = std::move(other.m_cellMatrix);
+    m_fracMatrix = std::move(other.m_fracMatrix);
   }
   return *this;
 }
@@ -316,9 +351,21 @@ inline UnitCell& UnitCell::operator=(UnitCell&& other) noexcept
 inline void UnitCell::setCellVectors(const Vector3& a, const Vector3& b,
                                      const Vector3& c)
 {
-  setAVector(a);
-  setBVector(b);
-  setCVector(c);
+  m_cellMatrix.row(0) = a;
+  m_cellMatrix.row(1) = b;
+  m_cellMatrix.row(2) = c;
+  updateFractionalMatrix();
+}
+
+inline void UnitCell::updateFractionalMatrix()
+{
+  // A singular cell has no inverse. Don't let inverse() fill the cache
+  // with infinities and NaNs.
+  if (m_cellMatrix.determinant() == 0.0) {
+    m_fracMatrix.setZero();
+    return;
+  }
+  m_fracMatrix = m_cellMatrix.transpose().inverse();
 }
 
 inline double UnitCell::volume() const
@@ -333,7 +380,7 @@ inline Vector3 UnitCell::toCartesian(const Vector3& frac) const
 
 inline Vector3 UnitCell::toFractional(const Vector3& cart) const
 {
-  return m_cellMatrix.transpose().inverse() * cart;
+  return m_fracMatrix * cart;
 }
 
 inline Vector3 UnitCell::wrapCartesian(const Vector3& cart) const
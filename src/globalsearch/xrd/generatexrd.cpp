@@ -22,8 +22,7 @@
 #include <QProcess>
 #include <QString>
 
-#include <globalsearch/formats/cmlformat.h>
-#include <globalsearch/formats/obconvert.h>
+#include <globalsearch/formats/cifformat.h>
 #include <globalsearch/structure.h>
 
 #include "generatexrd.h"
@@ -104,23 +103,15 @@ bool GenerateXrd::generateXrdPattern(const Structure& s, XrdData& results,
                                      double wavelength, double peakwidth,
                                      size_t numpoints, double max2theta)
 {
-  // First, write the structure in CML format
-  std::stringstream cml;
-
-  if (!CmlFormat::write(s, cml)) {
+  // First, write the structure in CIF format
+  std::stringstream cifStream;
+  if (!CifFormat::write(s, cifStream)) {
     qDebug() << "Error in" << __FUNCTION__ << ": failed to convert structure'"
-             << s.getGeneration() << "x" << s.getIDNumber() << "' to CML"
+             << s.getGeneration() << "x" << s.getIDNumber() << "' to CIF"
              << "format!";
     return false;
   }
-
-  // Then, convert to CIF format
-  QByteArray cif;
-  if (!OBConvert::convertFormat("cml", "cif", cml.str().c_str(), cif)) {
-    qDebug() << "Error in" << __FUNCTION__ << ": failed to convert CML"
-             << "format to CIF format with obabel";
-    return false;
-  }
+  QByteArray cif(cifStream.str().c_str());
 
   // Now, execute genXrdPattern with the given inputs
   QStringList args;
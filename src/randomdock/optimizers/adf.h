@@ -32,6 +32,13 @@ public:
                         const QString& filename = "");
 
   bool checkForSuccessfulOutput(GlobalSearch::Structure* s, bool* success);
+
+  // The completion strings are not used. See checkForSuccessfulOutput().
+  bool checkCompletion(GlobalSearch::Structure* s, bool* exists,
+                       bool* success) override
+  {
+    return checkCompletionStepwise(s, exists, success);
+  }
 };
 
 } // end namespace RandomDock
@@ -25,6 +25,7 @@
 #include <QString>
 
 #include <globalsearch/eleminfo.h>
+#include <globalsearch/fitness/fitnessevaluator.h>
 #include <globalsearch/queueinterfaces/queueinterfaces.h>
 #include <globalsearch/utilities/fileutils.h>
 #include <globalsearch/utilities/makeunique.h>
@@ -79,6 +80,8 @@ static const QStringList keywords = { "empiricalFormula",
                                       "maxNumStructures",
                                       "calculateHardness",
                                       "hardnessFitnessWeight",
+                                      "fitnessTermWeights",
+                                      "paretoSelection",
                                       "usingMitoticGrowth",
                                       "usingFormulaUnitCrossovers",
                                       "formulaUnitCrossoversGen",
@@ -103,6 +106,9 @@ static const QStringList keywords = { "empiricalFormula",
                                       "queueInterface",
                                       "localWorkingDirectory",
                                       "logErrorDirectories",
+                                      "restartFromCheckpoint",
+                                      "archiveFinishedStructures",
+                                      "fullSaveInterval",
                                       "autoCancelJobAfterTime",
                                       "hoursForAutoCancelJob",
                                       "autoCancelJobAfterStructures", //added
@@ -448,6 +454,13 @@ bool XtalOptCLIOptions::processOptions(const QHash<QString, QString>& options,
     toBool(options.value("calculateHardness", "false"));
   xtalopt.m_hardnessFitnessWeight =
     options.value("hardnessFitnessWeight", "0.5").toDouble();
+  if (!xtalopt.m_fitnessEvaluator->setWeightsFromString(
+        options.value("fitnessTermWeights", ""))) {
+    qDebug() << "Warning: fitnessTermWeights could not be read. Only"
+             << "enthalpy and hardness will be used for the fitness.";
+  }
+  xtalopt.m_paretoSelection =
+    toBool(options.value("paretoSelection", "false"));
   xtalopt.using_mitotic_growth =
     toBool(options.value("usingMitoticGrowth", "false"));
   xtalopt.using_FU_crossovers =
@@ -698,6 +711,15 @@ bool XtalOptCLIOptions::processOptions(const QHash<QString, QString>& options,
   xtalopt.m_logErrorDirs =
     toBool(options.value("logErrorDirectories", "false"));
 
+  xtalopt.m_restartFromCheckpoint =
+    toBool(options.value("restartFromCheckpoint", "false"));
+
+  xtalopt.m_archiveFinishedStructures =
+    toBool(options.value("archiveFinishedStructures", "false"));
+
+  xtalopt.m_fullSaveInterval =
+    options.value("fullSaveInterval", "300").toInt();
+
   xtalopt.m_cancelJobAfterTime =
     toBool(options.value("autoCancelJobAfterTime", "false"));
 
@@ -725,6 +747,7 @@ bool XtalOptCLIOptions::processOptions(const QHash<QString, QString>& options,
     xtalopt.rempath = options["remoteWorkingDirectory"];
   }
 
+  xtalopt.publishConstraints();
   return true;
 }
 
@@ -1286,6 +1309,14 @@ void XtalOptCLIOptions::writeInitialRuntimeFile(XtalOpt& xtalopt)
             QString::number(xtalopt.m_hardnessFitnessWeight) + "\n";
   }
 
+  if (xtalopt.m_fitnessEvaluator->hasActiveTerms()) {
+    text += QString("fitnessTermWeights = ") +
+            xtalopt.m_fitnessEvaluator->weightsString() + "\n";
+  }
+
+  text += QString("paretoSelection = ") +
+          fromBool(xtalopt.m_paretoSelection) + "\n";
+
   text += QString("usingMitoticGrowth = ") +
           fromBool(xtalopt.using_mitotic_growth) + "\n";
   text += QString("usingFormulaUnitCrossovers = ") +
@@ -1472,6 +1503,11 @@ void XtalOptCLIOptions::processRuntimeOptions(
       xtalopt.m_calculateHardness = toBool(options[option]);
     } else if (CICompare("hardnessFitnessWeight", option)) {
       xtalopt.m_hardnessFitnessWeight = options[option].toDouble();
+    } else if (CICompare("fitnessTermWeights", option)) {
+      if (!xtalopt.m_fitnessEvaluator->setWeightsFromString(options[option]))
+        qDebug() << "Ignoring change in fitnessTermWeights.";
+    } else if (CICompare("paretoSelection", option)) {
+      xtalopt.m_paretoSelection = toBool(options[option]);
     } else if (CICompare("usingMitoticGrowth", option)) {
       xtalopt.using_mitotic_growth = toBool(options[option]);
     } else if (CICompare("usingFormulaUnitCrossovers", option)) {
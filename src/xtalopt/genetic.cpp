@@ -181,17 +181,12 @@ Xtal* XtalOptGenetic::crossover(Xtal* xtal1, Xtal* xtal2,
   QList<QString> xtalAtoms = xtal1->getSymbols();
   QList<uint> xtalCounts = xtal1->getNumberOfAtomsAlpha();
   const std::vector<Atom>& atomList1 = xtal1->atoms();
-  QList<Vector3> fracCoordsList1;
-
-  for (int i = 0; i < atomList1.size(); i++)
-    fracCoordsList1.append(xtal1->cartToFrac(atomList1.at(i).pos()));
+  std::vector<Vector3> fracCoordsList1 = xtal1->getFracCoords();
   xtal1->lock().unlock();
 
   xtal2->lock().lockForRead();
   const std::vector<Atom>& atomList2 = xtal2->atoms();
-  QList<Vector3> fracCoordsList2;
-  for (int i = 0; i < atomList2.size(); i++)
-    fracCoordsList2.append(xtal2->cartToFrac(atomList2.at(i).pos()));
+  std::vector<Vector3> fracCoordsList2 = xtal2->getFracCoords();
   xtal2->lock().unlock();
 
   // Transform (reflect / rot)
@@ -514,7 +509,6 @@ Xtal* XtalOptGenetic::FUcrossover(Xtal* xtal1, Xtal* xtal2,
   QList<uint> xtalCounts1 = xtal1->getNumberOfAtomsAlpha();
   const std::vector<Atom> atomList1 = xtal1->atoms();
   uint xtal1FU = xtal1->getFormulaUnits();
-  QList<Vector3> fracCoordsList1;
   // qDebug() << "xtal1FU is " << QString::number(xtal1FU);
 
   // Obtain empirical formula
@@ -523,8 +517,7 @@ Xtal* XtalOptGenetic::FUcrossover(Xtal* xtal1, Xtal* xtal2,
     empiricalFormulaList.append(xtalCounts1.at(i) / xtal1FU);
   }
 
-  for (int i = 0; i < atomList1.size(); i++)
-    fracCoordsList1.append(xtal1->cartToFrac(atomList1.at(i).pos()));
+  const std::vector<Vector3> fracCoordsList1 = xtal1->getFracCoords();
   xtal1->lock().unlock();
 
   xtal2->lock().lockForRead();
@@ -533,10 +526,8 @@ Xtal* XtalOptGenetic::FUcrossover(Xtal* xtal1, Xtal* xtal2,
   Matrix3 cell2 = xtal2->unitCell().cellMatrix();
   double xtal2AVal = xtal2->getA();
   const std::vector<Atom> atomList2 = xtal2->atoms();
-  QList<Vector3> fracCoordsList2;
   // qDebug() << "xtal2FU is " << QString::number(xtal2->getFormulaUnits());
-  for (int i = 0; i < atomList2.size(); i++)
-    fracCoordsList2.append(xtal2->cartToFrac(atomList2.at(i).pos()));
+  const std::vector<Vector3> fracCoordsList2 = xtal2->getFracCoords();
   xtal2->lock().unlock();
 
   // Perform a few sanity checks
@@ -661,32 +652,29 @@ Xtal* XtalOptGenetic::FUcrossover(Xtal* xtal1, Xtal* xtal2,
   QWriteLocker nxtalLocker(&nxtal->lock());
 
   // Cut xtals and populate new one.
-  QList<Vector3> tempFracCoordsList1;
   for (int i = 0; i < fracCoordsList1.size(); i++) {
-    tempFracCoordsList1 = fracCoordsList1;
     if (fracCoordsList1.at(i)[0] <= cutVal1) {
       Atom& newAtom = nxtal->addAtom();
       newAtom.setAtomicNumber(atomList1.at(i).atomicNumber());
       // Correct for atom position distortion across the cutVal axis
-      tempFracCoordsList1[i][0] =
-        (xtal1AVal / nxtal->getA()) * fracCoordsList1.at(i)[0];
-      newAtom.setPos(nxtal->fracToCart(tempFracCoordsList1.at(i)));
+      Vector3 tempFracCoords = fracCoordsList1.at(i);
+      tempFracCoords[0] = (xtal1AVal / nxtal->getA()) * tempFracCoords[0];
+      newAtom.setPos(nxtal->fracToCart(tempFracCoords));
     }
   }
 
-  QList<Vector3> tempFracCoordsList2;
   for (int i = 0; i < fracCoordsList2.size(); i++) {
-    tempFracCoordsList2 = fracCoordsList2;
     if (fracCoordsList2.at(i)[0] <= cutVal2) {
       Atom& newAtom = nxtal->addAtom();
       newAtom.setAtomicNumber(atomList2.at(i).atomicNumber());
       // Correct for atom position distortion across the cutVal axis
-      tempFracCoordsList2[i][0] =
+      Vector3 tempFracCoords = fracCoordsList2.at(i);
+      tempFracCoords[0] =
         (xtal2AVal / nxtal->getA()) * fracCoordsList2.at(i)[0];
       // Reflect these atoms to the other side of the xtal via the plane
       // perpendicular to the cutVal axis
-      tempFracCoordsList2[i][0] = 1 - fracCoordsList2.at(i)[0];
-      newAtom.setPos(nxtal->fracToCart(tempFracCoordsList2.at(i)));
+      tempFracCoords[0] = 1 - fracCoordsList2.at(i)[0];
+      newAtom.setPos(nxtal->fracToCart(tempFracCoords));
     }
   }
 
@@ -971,9 +959,9 @@ Xtal* XtalOptGenetic::FUcrossover(Xtal* xtal1, Xtal* xtal2,
             Atom& newAtom = nxtal->addAtom();
             newAtom.setAtomicNumber(atomList2.at(j).atomicNumber());
             // Reflect across plane perpendicular to cutVal axis
-            QList<Vector3> tempFracCoordsList2 = fracCoordsList2;
-            tempFracCoordsList2[j][0] = 1 - fracCoordsList2.at(j)[0];
-            newAtom.setPos(nxtal->fracToCart(tempFracCoordsList2.at(j)));
+            Vector3 tempFracCoords = fracCoordsList2.at(j);
+            tempFracCoords[0] = 1 - tempFracCoords[0];
+            newAtom.setPos(nxtal->fracToCart(tempFracCoords));
             delta--;
             break;
           }
@@ -990,15 +978,6 @@ Xtal* XtalOptGenetic::FUcrossover(Xtal* xtal1, Xtal* xtal2,
     }
   }
 
-  QList<Vector3> nFracCoordsList;
-  const std::vector<Atom>& nAtomList = nxtal->atoms();
-  for (int i = 0; i < nAtomList.size(); i++) {
-    nFracCoordsList.append(nxtal->cartToFrac(nAtomList.at(i).pos()));
-    // qDebug() << nAtomList.at(i).atomicNumber() << " " <<
-    // nFracCoordsList.at(i)[0] << " " << nFracCoordsList.at(i)[1] << " " <<
-    // nFracCoordsList.at(i)[2];
-  }
-
   // Done!
   nxtal->wrapAtomsToCell();
   nxtal->setStatus(Xtal::WaitingForOptimization);
@@ -1158,18 +1137,8 @@ void XtalOptGenetic::strain(Xtal* xtal, double sigma_lattice)
     }
   }
 
-  // Store fractional coordinates
-  std::vector<Atom>& atomList = xtal->atoms();
-  QList<Vector3> fracCoordsList;
-  for (int i = 0; i < atomList.size(); i++)
-    fracCoordsList.append(xtal->cartToFrac(atomList.at(i).pos()));
-
-  // Apply strain
-  xtal->setCellInfo(xtal->unitCell().cellMatrix() * strainM);
-
-  // Reset coordinates
-  for (int i = 0; i < atomList.size(); i++)
-    atomList.at(i).setPos(xtal->fracToCart(fracCoordsList.at(i)));
+  // Apply strain. The atoms keep their fractional coordinates.
+  xtal->setCellInfoKeepFractional(xtal->unitCell().cellMatrix() * strainM);
 
   // Rescale volume
   xtal->setVolume(volume);
@@ -1205,11 +1174,7 @@ void XtalOptGenetic::ripple(Xtal* xtal, double rho, uint eta, uint mu)
       break;
   }
 
-  std::vector<Atom>& atoms = xtal->atoms();
-  QList<Vector3> fracCoordsList;
-
-  for (int i = 0; i < atoms.size(); i++)
-    fracCoordsList.append(xtal->cartToFrac(atoms.at(i).pos()));
+  std::vector<Vector3> fracCoordsList = xtal->getFracCoords();
 
   Vector3 v;
   double shift;
@@ -1223,10 +1188,7 @@ void XtalOptGenetic::ripple(Xtal* xtal, double rho, uint eta, uint mu)
     fracCoordsList[i] = v;
   }
 
-  for (int i = 0; i < atoms.size(); i++) {
-    Atom& atm = atoms.at(i);
-    atm.setPos(xtal->fracToCart(fracCoordsList.at(i)));
-  }
+  xtal->setFracCoords(fracCoordsList);
   xtal->wrapAtomsToCell();
 }
 
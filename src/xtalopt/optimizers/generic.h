@@ -41,6 +41,13 @@ public:
     return true;
   };
 
+  // See checkForSuccessfulOutput()
+  bool checkCompletion(GlobalSearch::Structure* s, bool* exists,
+                       bool* success) override
+  {
+    return checkCompletionStepwise(s, exists, success);
+  }
+
   // Override the read() function so we can produce an error in the case that
   // some parts were not set.
   bool read(GlobalSearch::Structure* structure,
@@ -54,6 +54,10 @@ VASPOptimizer::VASPOptimizer(OptBase* parent, const QString& filename)
   m_outputFilenames.append("CONTCAR");
   m_outputFilenames.append("POSCAR");
 
+  // VASP rewrites CONTCAR after every ionic step, so it holds the last
+  // geometry of a run that was killed at the walltime
+  m_checkpointFilenames.append("CONTCAR");
+
   // Set the name of the optimizer to be returned by getIDString()
   m_idString = "VASP";
 
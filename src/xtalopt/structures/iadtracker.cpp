@@ -0,0 +1,140 @@
+/**********************************************************************
+  IADTracker - Keep the interatomic distances of an xtal up to date
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ ***********************************************************************/
+
+#include <xtalopt/structures/iadtracker.h>
+
+#include <xtalopt/structures/xtal.h>
+#include <xtalopt/xtalopt.h>
+
+#include <cmath>
+
+using GlobalSearch::Atom;
+using GlobalSearch::AtomCoordinates;
+
+namespace XtalOpt {
+
+IADTracker::IADTracker(const Xtal& xtal,
+                       const QHash<QPair<int, int>, IAD>& limitsIAD)
+  : m_coords(xtal.atoms()),
+    m_translations(AtomCoordinates::imageTranslations(xtal.unitCell())),
+    m_numViolations(0)
+{
+  const size_t n = numAtoms();
+  m_squaredDists.resize(n * n);
+  m_minSquaredDists.resize(n * n);
+  m_violations.assign(n * n, 0);
+  m_rowViolations.assign(n, 0);
+
+  const unsigned char* atomicNums = m_coords.atomicNumbers();
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t j = 0; j < n; ++j) {
+      const double minDist =
+        limitsIAD.value(qMakePair<int, int>(atomicNums[i], atomicNums[j]))
+          .minIAD;
+      m_minSquaredDists[i * n + j] = minDist * minDist;
+    }
+  }
+
+  // Only the upper triangle needs to be measured
+  const std::vector<Atom>& atoms = xtal.atoms();
+  for (size_t i = 0; i < n; ++i) {
+    m_coords.minSquaredDistancesToPoint(atoms[i].pos(), m_translations,
+                                        m_rowDists);
+    for (size_t j = i; j < n; ++j) {
+      m_squaredDists[i * n + j] = m_rowDists[j];
+      m_squaredDists[j * n + i] = m_rowDists[j];
+    }
+  }
+
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t j = 0; j < n; ++j)
+      setViolation(i, j, isViolation(i, j));
+  }
+}
+
+void IADTracker::moveAtom(size_t ind, const Vector3& pos)
+{
+  const size_t n = numAtoms();
+  m_coords.setPos(ind, pos);
+  m_coords.minSquaredDistancesToPoint(pos, m_translations, m_rowDists);
+
+  for (size_t j = 0; j < n; ++j) {
+    m_squaredDists[ind * n + j] = m_rowDists[j];
+    m_squaredDists[j * n + ind] = m_rowDists[j];
+  }
+
+  for (size_t j = 0; j < n; ++j) {
+    setViolation(ind, j, isViolation(ind, j));
+    setViolation(j, ind, isViolation(j, ind));
+  }
+}
+
+bool IADTracker::check(int* atom1, int* atom2, double* IAD) const
+{
+  const size_t n = numAtoms();
+  for (size_t i = 0; m_numViolations != 0 && i < n; ++i) {
+    if (m_rowViolations[i] == 0)
+      continue;
+
+    for (size_t j = 0; j < n; ++j) {
+      if (!m_violations[i * n + j])
+        continue;
+
+      if (atom1 != nullptr && atom2 != nullptr) {
+        *atom1 = static_cast<int>(i);
+        *atom2 = static_cast<int>(j);
+        if (IAD != nullptr)
+          *IAD = sqrt(squaredDistance(i, j));
+      }
+      return false;
+    }
+  }
+
+  if (atom1 != nullptr && atom2 != nullptr) {
+    *atom1 = *atom2 = -1;
+    if (IAD != nullptr)
+      *IAD = 0.0;
+  }
+  return true;
+}
+
+bool IADTracker::isViolation(size_t i, size_t j) const
+{
+  const size_t n = numAtoms();
+  if (m_squaredDists[i * n + j] >= m_minSquaredDists[i * n + j])
+    return false;
+
+  // Xtal::checkMinIAD() skips atoms that are identical, so we do too
+  const unsigned char* atomicNums = m_coords.atomicNumbers();
+  return !m_coords.isAtom(
+    j, atomicNums[i],
+    Vector3(m_coords.x()[i], m_coords.y()[i], m_coords.z()[i]));
+}
+
+void IADTracker::setViolation(size_t i, size_t j, bool violation)
+{
+  unsigned char& current = m_violations[i * numAtoms() + j];
+  if (static_cast<bool>(current) == violation)
+    return;
+
+  current = violation;
+  if (violation) {
+    ++m_numViolations;
+    ++m_rowViolations[i];
+  } else {
+    --m_numViolations;
+    --m_rowViolations[i];
+  }
+}
+}
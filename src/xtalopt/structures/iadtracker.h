@@ -0,0 +1,122 @@
+/**********************************************************************
+  IADTracker - Keep the interatomic distances of an xtal up to date
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ ***********************************************************************/
+
+#ifndef XTALOPT_IADTRACKER_H
+#define XTALOPT_IADTRACKER_H
+
+#include <globalsearch/structures/atomcoordinates.h>
+
+#include <QHash>
+#include <QPair>
+
+#include <vector>
+
+namespace XtalOpt {
+struct IAD;
+class Xtal;
+
+using GlobalSearch::Vector3;
+
+/**
+ * @class IADTracker iadtracker.h
+ *
+ * @brief Keeps the shortest distance between every pair of atoms in an
+ * xtal, and which pairs are closer than their minimum IAD, while atoms are
+ * moved one at a time.
+ *
+ * Building the tracker measures every pair once. After that, moveAtom()
+ * only measures the pairs that contain the moved atom, and check() finds
+ * the first pair that is too close without measuring anything. This makes
+ * fixing up a structure by moving the offending atoms cost O(N) per move
+ * instead of O(N^2) per check.
+ *
+ * check() gives the same result as Xtal::checkMinIAD() on the xtal with
+ * the same moves applied.
+ */
+class IADTracker
+{
+public:
+  /**
+   * Constructor. Measures every pair of atoms in @p xtal.
+   *
+   * @param xtal The xtal. It is only read here: call moveAtom() whenever
+   *             one of its atoms is moved afterwards.
+   * @param limitsIAD The minimum distance for each pair of atomic numbers.
+   */
+  IADTracker(const Xtal& xtal, const QHash<QPair<int, int>, IAD>& limitsIAD);
+
+  /* The number of atoms. */
+  size_t numAtoms() const { return m_coords.size(); }
+
+  /**
+   * Update the distances after the atom at index @p ind was moved.
+   *
+   * @param ind The index of the atom.
+   * @param pos The new Cartesian position of the atom in Angstroms.
+   */
+  void moveAtom(size_t ind, const Vector3& pos);
+
+  /**
+   * The squared distance between the atoms at @p i and @p j, taking the
+   * closest periodic image.
+   */
+  double squaredDistance(size_t i, size_t j) const
+  {
+    return m_squaredDists[i * numAtoms() + j];
+  }
+
+  /* The number of ordered pairs of atoms that are too close together. */
+  size_t numViolations() const { return m_numViolations; }
+
+  /**
+   * Check the distances against the minimum IADs. Works the same way as
+   * Xtal::checkMinIAD().
+   *
+   * @param atom1 Set to the index of the first atom of the first pair
+   *              that is too close, or -1 if there is none.
+   * @param atom2 Set to the index of the second atom of that pair, or -1.
+   * @param IAD Set to the distance between the pair, or 0.
+   *
+   * @return True if no pair of atoms is too close together.
+   */
+  bool check(int* atom1 = nullptr, int* atom2 = nullptr,
+             double* IAD = nullptr) const;
+
+private:
+  // Is the ordered pair (i, j) too close? m_squaredDists must be current.
+  bool isViolation(size_t i, size_t j) const;
+
+  // Sets whether the ordered pair (i, j) is too close and updates the
+  // counts.
+  void setViolation(size_t i, size_t j, bool violation);
+
+  GlobalSearch::AtomCoordinates m_coords;
+  std::vector<Vector3> m_translations;
+
+  // Row-major N x N matrices
+  std::vector<double> m_squaredDists;
+  std::vector<double> m_minSquaredDists;
+  std::vector<unsigned char> m_violations;
+
+  // The number of pairs that are too close, in total and for each first
+  // atom
+  size_t m_numViolations;
+  std::vector<size_t> m_rowViolations;
+
+  // Reused for the distances from a moved atom
+  std::vector<double> m_rowDists;
+};
+}
+
+#endif // XTALOPT_IADTRACKER_H
@@ -0,0 +1,358 @@
+/**********************************************************************
+  SymmetryService - Memoized spglib symmetry analysis
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ ***********************************************************************/
+
+#include <xtalopt/structures/symmetryservice.h>
+
+extern "C" {
+#include <spglib/spglib.h>
+}
+
+#include <algorithm>
+#include <functional>
+
+namespace XtalOpt {
+
+static inline void hashCombine(size_t& seed, size_t value)
+{
+  seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+bool SymmetryService::Geometry::operator==(const Geometry& other) const
+{
+  return cellMatrix == other.cellMatrix && fcoords == other.fcoords &&
+         atomicNums == other.atomicNums;
+}
+
+SymmetryService::SymmetryService()
+  : m_maxSize(10000), m_numHits(0), m_numMisses(0)
+{
+}
+
+SymmetryService& SymmetryService::instance()
+{
+  static SymmetryService service;
+  return service;
+}
+
+size_t SymmetryService::hash(const Geometry& geometry, double prec)
+{
+  std::hash<double> doubleHash;
+  size_t seed = doubleHash(prec);
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j)
+      hashCombine(seed, doubleHash(geometry.cellMatrix(i, j)));
+  }
+  for (const auto& fcoord : geometry.fcoords) {
+    for (int i = 0; i < 3; ++i)
+      hashCombine(seed, doubleHash(fcoord[i]));
+  }
+  for (const auto& atomicNum : geometry.atomicNums)
+    hashCombine(seed, atomicNum);
+  return seed;
+}
+
+SymmetryService::Spacegroup SymmetryService::spacegroup(
+  const Geometry& geometry, double prec)
+{
+  size_t key = hash(geometry, prec);
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    Entry& e = entry(key, geometry, prec);
+    if (e.hasSpacegroup) {
+      ++m_numHits;
+      return e.spacegroup;
+    }
+    ++m_numMisses;
+  }
+
+  // Do not hold the lock while spglib runs. If another thread is doing the
+  // same geometry at the same time, we both get the same answer.
+  Spacegroup result = findSpacegroup(geometry, prec);
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  Entry& e = entry(key, geometry, prec);
+  e.spacegroup = result;
+  e.hasSpacegroup = true;
+  return result;
+}
+
+std::string SymmetryService::wyckoffLetters(const Geometry& geometry,
+                                            double prec)
+{
+  size_t key = hash(geometry, prec);
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    Entry& e = entry(key, geometry, prec);
+    if (e.hasWyckoffLetters) {
+      ++m_numHits;
+      return e.wyckoffLetters;
+    }
+    ++m_numMisses;
+  }
+
+  std::string result = findWyckoffLetters(geometry, prec);
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  Entry& e = entry(key, geometry, prec);
+  e.wyckoffLetters = result;
+  e.hasWyckoffLetters = true;
+  return result;
+}
+
+std::shared_ptr<const SymmetryService::Primitive> SymmetryService::primitive(
+  const Geometry& geometry, double prec)
+{
+  size_t key = hash(geometry, prec);
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    Entry& e = entry(key, geometry, prec);
+    if (e.primitive) {
+      ++m_numHits;
+      return e.primitive;
+    }
+    ++m_numMisses;
+  }
+
+  std::shared_ptr<const Primitive> result =
+    std::make_shared<const Primitive>(findPrimitive(geometry, prec));
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  Entry& e = entry(key, geometry, prec);
+  e.primitive = result;
+  return result;
+}
+
+size_t SymmetryService::size() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_entries.size();
+}
+
+size_t SymmetryService::numHits() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_numHits;
+}
+
+size_t SymmetryService::numMisses() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_numMisses;
+}
+
+size_t SymmetryService::maxSize() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_maxSize;
+}
+
+void SymmetryService::setMaxSize(size_t n)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_maxSize = std::max<size_t>(n, 1);
+  trim();
+}
+
+void SymmetryService::clear()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_entries.clear();
+  m_order.clear();
+  m_numHits = 0;
+  m_numMisses = 0;
+}
+
+SymmetryService::Entry& SymmetryService::entry(size_t key,
+                                               const Geometry& geometry,
+                                               double prec)
+{
+  auto it = m_entries.find(key);
+  if (it != m_entries.end()) {
+    if (it->second.prec == prec && it->second.geometry == geometry)
+      return it->second;
+
+    // Two geometries with the same hash. Keep the newer one.
+    it->second = Entry();
+    it->second.geometry = geometry;
+    it->second.prec = prec;
+    return it->second;
+  }
+
+  // Make room first so that the new entry is not the one dropped
+  while (m_entries.size() >= m_maxSize)
+    dropOldest();
+
+  Entry& e = m_entries[key];
+  e.geometry = geometry;
+  e.prec = prec;
+  m_order.push_back(key);
+  return e;
+}
+
+void SymmetryService::trim()
+{
+  while (m_entries.size() > m_maxSize)
+    dropOldest();
+}
+
+void SymmetryService::dropOldest()
+{
+  if (m_order.empty())
+    return;
+  m_entries.erase(m_order.front());
+  m_order.pop_front();
+}
+
+SymmetryService::Spacegroup SymmetryService::findSpacegroup(
+  const Geometry& geometry, double prec)
+{
+  Spacegroup result;
+  const int num = geometry.fcoords.size();
+  if (num == 0)
+    return result;
+
+  // This is the same layout Xtal::findSpaceGroup() has always used
+  const Matrix3& cell = geometry.cellMatrix;
+  double lattice[3][3] = { { cell(0, 0), cell(0, 1), cell(0, 2) },
+                           { cell(1, 0), cell(1, 1), cell(1, 2) },
+                           { cell(2, 0), cell(2, 1), cell(2, 2) } };
+
+  std::vector<double> positions(3 * num);
+  std::vector<int> types(num);
+  for (int i = 0; i < num; ++i) {
+    types[i] = geometry.atomicNums[i];
+    for (int j = 0; j < 3; ++j)
+      positions[3 * i + j] = geometry.fcoords[i][j];
+  }
+
+  char symbol[21];
+  int spg = spg_get_international(
+    symbol, lattice, reinterpret_cast<double(*)[3]>(positions.data()),
+    types.data(), num, prec);
+
+  if (spg <= 0 || spg > 230)
+    return result;
+
+  result.number = spg;
+  result.symbol = symbol;
+  result.symbol.erase(
+    std::remove(result.symbol.begin(), result.symbol.end(), ' '),
+    result.symbol.end());
+  return result;
+}
+
+std::string SymmetryService::findWyckoffLetters(const Geometry& geometry,
+                                                double prec)
+{
+  const int num = geometry.fcoords.size();
+  if (num == 0)
+    return "";
+
+  // The same layout as in findSpacegroup()
+  const Matrix3& cell = geometry.cellMatrix;
+  double lattice[3][3] = { { cell(0, 0), cell(0, 1), cell(0, 2) },
+                           { cell(1, 0), cell(1, 1), cell(1, 2) },
+                           { cell(2, 0), cell(2, 1), cell(2, 2) } };
+
+  std::vector<double> positions(3 * num);
+  std::vector<int> types(num);
+  for (int i = 0; i < num; ++i) {
+    types[i] = geometry.atomicNums[i];
+    for (int j = 0; j < 3; ++j)
+      positions[3 * i + j] = geometry.fcoords[i][j];
+  }
+
+  SpglibDataset* dataset =
+    spg_get_dataset(lattice, reinterpret_cast<double(*)[3]>(positions.data()),
+                    types.data(), num, prec);
+  if (!dataset)
+    return "";
+
+  std::string result;
+  if (dataset->spacegroup_number > 0 && dataset->n_atoms == num) {
+    result.resize(num);
+    for (int i = 0; i < num; ++i)
+      result[i] = 'a' + dataset->wyckoffs[i];
+  }
+  spg_free_dataset(dataset);
+  return result;
+}
+
+SymmetryService::Primitive SymmetryService::findPrimitive(
+  const Geometry& geometry, double prec)
+{
+  Primitive result;
+  const int numAtoms = geometry.fcoords.size();
+  if (numAtoms < 1)
+    return result;
+
+  // Spglib expects column vecs, so fill with transpose
+  const Matrix3& cell = geometry.cellMatrix;
+  double lattice[3][3] = { { cell(0, 0), cell(1, 0), cell(2, 0) },
+                           { cell(0, 1), cell(1, 1), cell(2, 1) },
+                           { cell(0, 2), cell(1, 2), cell(2, 2) } };
+
+  // Include space for 4*numAtoms for the cell refinement
+  std::vector<double> positionData(3 * 4 * numAtoms);
+  double(*positions)[3] =
+    reinterpret_cast<double(*)[3]>(positionData.data());
+  std::vector<int> types(4 * numAtoms);
+  for (int i = 0; i < numAtoms; ++i) {
+    types[i] = geometry.atomicNums[i];
+    for (int j = 0; j < 3; ++j)
+      positions[i][j] = geometry.fcoords[i][j];
+  }
+
+  char symbol[21];
+  int spg = spg_get_international(symbol, lattice, positions, types.data(),
+                                  numAtoms, prec);
+
+  // Refine the structure
+  int numBravaisAtoms =
+    spg_refine_cell(lattice, positions, types.data(), numAtoms, prec);
+  if (numBravaisAtoms <= 0)
+    return result;
+
+  // Find primitive cell. This updates lattice, positions, types
+  // to primitive
+  int numPrimitiveAtoms = spg_find_primitive(lattice, positions, types.data(),
+                                             numBravaisAtoms, prec);
+
+  // If the cell was already a primitive cell, reset numPrimitiveAtoms.
+  if (numPrimitiveAtoms == 0)
+    numPrimitiveAtoms = numBravaisAtoms;
+
+  if (numPrimitiveAtoms <= 0)
+    return result;
+
+  // Convert col vecs to row vecs
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j)
+      result.cellMatrix(i, j) = lattice[j][i];
+  }
+
+  result.fcoords.reserve(numPrimitiveAtoms);
+  result.atomicNums.reserve(numPrimitiveAtoms);
+  for (int i = 0; i < numPrimitiveAtoms; ++i) {
+    result.fcoords.push_back(Vector3(positions[i]));
+    result.atomicNums.push_back(types[i]);
+  }
+
+  if (spg > 230 || spg < 0)
+    spg = 0;
+  result.spacegroup = spg;
+  return result;
+}
+
+} // end namespace XtalOpt
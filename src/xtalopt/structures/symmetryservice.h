@@ -0,0 +1,147 @@
+/**********************************************************************
+  SymmetryService - Memoized spglib symmetry analysis
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ ***********************************************************************/
+
+#ifndef XTALOPT_SYMMETRY_SERVICE_H
+#define XTALOPT_SYMMETRY_SERVICE_H
+
+#include <globalsearch/matrix.h>
+#include <globalsearch/vector.h>
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace XtalOpt {
+
+using GlobalSearch::Matrix3;
+using GlobalSearch::Vector3;
+
+/**
+ * @class SymmetryService symmetryservice.h
+ *
+ * @brief Runs spglib on a geometry and remembers the results.
+ *
+ * The same geometry tends to be analyzed many times: after generation,
+ * when it is added, when a session is loaded, and again for primitive
+ * checks. The results are stored by a hash of the cell, the fractional
+ * coordinates, the atomic numbers and the tolerance, so asking again for
+ * an unchanged geometry is a lookup, and any change to the geometry
+ * misses the cache and is analyzed anew. Each part of the analysis is
+ * only computed when it is first asked for.
+ *
+ * All functions may be called from several threads at once.
+ */
+class SymmetryService
+{
+public:
+  struct Geometry
+  {
+    Matrix3 cellMatrix; // Row vectors
+    std::vector<Vector3> fcoords;
+    std::vector<unsigned int> atomicNums;
+
+    bool operator==(const Geometry& other) const;
+  };
+
+  struct Spacegroup
+  {
+    Spacegroup() : number(0) {}
+    unsigned int number; // 0 if the search failed
+    std::string symbol;  // International symbol without spaces
+  };
+
+  struct Primitive
+  {
+    Primitive() : spacegroup(0), cellMatrix(Matrix3::Zero()) {}
+    unsigned int spacegroup; // 0 if the reduction failed
+    Matrix3 cellMatrix;      // Row vectors
+    // Empty if the reduction failed
+    std::vector<Vector3> fcoords;
+    std::vector<unsigned int> atomicNums;
+  };
+
+  SymmetryService();
+
+  /// The service shared by all structures
+  static SymmetryService& instance();
+
+  /// Space group number and symbol
+  Spacegroup spacegroup(const Geometry& geometry, double prec);
+
+  /// The Wyckoff letter of each atom, in the same order as the atoms
+  std::string wyckoffLetters(const Geometry& geometry, double prec);
+
+  /// The primitive cell. See Primitive for how failures are reported.
+  std::shared_ptr<const Primitive> primitive(const Geometry& geometry,
+                                             double prec);
+
+  static size_t hash(const Geometry& geometry, double prec);
+
+  /// The number of geometries in the cache
+  size_t size() const;
+
+  /// The number of lookups answered from the cache
+  size_t numHits() const;
+
+  /// The number of lookups that needed spglib
+  size_t numMisses() const;
+
+  /// The oldest geometries are dropped when there are more than this
+  size_t maxSize() const;
+  void setMaxSize(size_t n);
+
+  void clear();
+
+private:
+  struct Entry
+  {
+    Entry() : hasSpacegroup(false), hasWyckoffLetters(false) {}
+    Geometry geometry;
+    double prec;
+    bool hasSpacegroup;
+    Spacegroup spacegroup;
+    bool hasWyckoffLetters;
+    std::string wyckoffLetters;
+    std::shared_ptr<const Primitive> primitive;
+  };
+
+  // Returns the entry for the geometry, adding it if needed. m_mutex must
+  // be locked.
+  Entry& entry(size_t key, const Geometry& geometry, double prec);
+
+  // Drops the oldest entries until there are at most m_maxSize.
+  // m_mutex must be locked.
+  void trim();
+  void dropOldest();
+
+  static Spacegroup findSpacegroup(const Geometry& geometry, double prec);
+  static std::string findWyckoffLetters(const Geometry& geometry,
+                                        double prec);
+  static Primitive findPrimitive(const Geometry& geometry, double prec);
+
+  mutable std::mutex m_mutex;
+  std::unordered_map<size_t, Entry> m_entries;
+  // The keys in the order they were added
+  std::deque<size_t> m_order;
+  size_t m_maxSize;
+  size_t m_numHits;
+  size_t m_numMisses;
+};
+
+} // end namespace XtalOpt
+
+#endif // XTALOPT_SYMMETRY_SERVICE_H
@@ -13,11 +13,13 @@
  ***********************************************************************/
 
 #include <xtalopt/structures/spghmnames.h>
+#include <xtalopt/structures/symmetryservice.h>
 #include <xtalopt/structures/xtal.h>
 
 #include <xtalopt/xtalopt.h>
 
 #include <globalsearch/eleminfo.h>
+#include <globalsearch/executor.h>
 #include <globalsearch/formats/cmlformat.h>
 #include <globalsearch/formats/poscarformat.h>
 #include <globalsearch/formats/zmatrixformat.h>
@@ -28,10 +30,6 @@
 #include <globalsearch/molecular/moltransformations.h>
 #endif
 
-extern "C" {
-#include <spglib/spglib.h>
-}
-
 #include <xtalcomp/xtalcomp.h>
 
 #include <QDebug>
@@ -55,6 +53,15 @@ using namespace GlobalSearch;
 
 namespace XtalOpt {
 
+namespace {
+// Atomic positions reused by Xtal::transformAtoms() on each thread
+Matrix3Xd& threadLocalPositions()
+{
+  static thread_local Matrix3Xd positions;
+  return positions;
+}
+}
+
 Xtal::Xtal(QObject* parent) : Structure(parent)
 {
 }
@@ -70,11 +77,16 @@ Xtal::Xtal(const Xtal& other)
   : Structure(other), m_spgNumber(other.m_spgNumber),
     m_spgSymbol(other.m_spgSymbol)
 {
+  std::unique_lock<std::mutex> lock(other.m_niggliMutex);
+  m_niggliReduction = other.m_niggliReduction;
 }
 
-Xtal::Xtal(Xtal&& other) noexcept : Structure(std::move(other)),
-                                    m_spgNumber(std::move(other.m_spgNumber)),
-                                    m_spgSymbol(std::move(other.m_spgSymbol))
+// Nothing else may use an xtal that is being moved from, so the moves do
+// not lock m_niggliMutex (which could also throw)
+Xtal::Xtal(Xtal&& other) noexcept
+  : Structure(std::move(other)), m_spgNumber(std::move(other.m_spgNumber)),
+    m_spgSymbol(std::move(other.m_spgSymbol)),
+    m_niggliReduction(std::move(other.m_niggliReduction))
 {
 }
 
@@ -85,6 +97,14 @@ Xtal& Xtal::operator=(const Xtal& other)
 
     m_spgNumber = other.m_spgNumber;
     m_spgSymbol = other.m_spgSymbol;
+
+    std::shared_ptr<const NiggliReduction> reduction;
+    {
+      std::unique_lock<std::mutex> lock(other.m_niggliMutex);
+      reduction = other.m_niggliReduction;
+    }
+    std::unique_lock<std::mutex> lock(m_niggliMutex);
+    m_niggliReduction = reduction;
   }
 
   return *this;
@@ -97,6 +117,7 @@ Xtal& Xtal::operator=(Xtal&& other) noexcept
 
     m_spgNumber = std::move(other.m_spgNumber);
     m_spgSymbol = std::move(other.m_spgSymbol);
+    m_niggliReduction = std::move(other.m_niggliReduction);
   }
 
   return *this;
@@ -112,19 +133,10 @@ void Xtal::setVolume(double Volume)
   // Get scaling factor
   double factor = pow(Volume / getVolume(), 1.0 / 3.0); // Cube root
 
-  // Store position of atoms in fractional units
-  std::vector<Atom>& atomList = atoms();
-  QList<Vector3> fracCoordsList;
-  for (int i = 0; i < atomList.size(); i++)
-    fracCoordsList.append(cartToFrac(atomList.at(i).pos()));
-
-  // Scale cell
-  setCellInfo(factor * getA(), factor * getB(), factor * getC(), getAlpha(),
-              getBeta(), getGamma());
-
-  // Recalculate coordinates:
-  for (int i = 0; i < atomList.size(); i++)
-    atomList.at(i).setPos(fracToCart(fracCoordsList.at(i)));
+  // Scale cell. The atoms keep their fractional coordinates.
+  UnitCell scaled(factor * getA(), factor * getB(), factor * getC(),
+                  getAlpha(), getBeta(), getGamma());
+  setCellInfoKeepFractional(scaled.cellMatrix());
 }
 
 void Xtal::rescaleCell(double a, double b, double c, double alpha, double beta,
@@ -137,10 +149,7 @@ void Xtal::rescaleCell(double a, double b, double c, double alpha, double beta,
   this->rotateCellAndCoordsToStandardOrientation();
 
   // Store position of atoms in fractional units
-  std::vector<Atom>& atomList = atoms();
-  QList<Vector3> fracCoordsList;
-  for (int i = 0; i < atomList.size(); i++)
-    fracCoordsList.append(cartToFrac(atomList.at(i).pos()));
+  const std::vector<Vector3> fcoords = getFracCoords();
 
   double nA = getA();
   double nB = getB();
@@ -222,19 +231,79 @@ void Xtal::rescaleCell(double a, double b, double c, double alpha, double beta,
   }
 
   // Recalculate coordinates:
-  for (int i = 0; i < atomList.size(); i++)
-    atomList.at(i).setPos(fracToCart(fracCoordsList.at(i)));
+  setFracCoords(fcoords);
 }
 
 bool Xtal::niggliReduce(const unsigned int iterations, double lenTol)
 {
+  std::shared_ptr<const NiggliReduction> reduction =
+    niggliReduction(iterations, lenTol);
+  if (!reduction->success)
+    return false;
+
+  // No change, already reduced. Just return.
+  if (!reduction->changed)
+    return true;
+
+  // Fractional coordinates in the reduced cell are cob^-1 times those in
+  // the current one. The atoms are converted, wrapped and rotated in one
+  // pass.
+  const Matrix3 toFrac =
+    reduction->cob.inverse() * unitCell().fractionalMatrix();
+  setCellInfo(reduction->cellMatrix);
+  transformAtoms(toFrac, unitCell().cellMatrixColForm(), true);
+
+  // Reducing the new cell would not change it, so remember that for the
+  // next caller
+  auto reduced = std::make_shared<NiggliReduction>(*reduction);
+  reduced->changed = false;
+  reduced->origCellMatrix = reduction->cellMatrix;
+  reduced->cob = Matrix3::Identity();
+  {
+    std::unique_lock<std::mutex> lock(m_niggliMutex);
+    m_niggliReduction = reduced;
+  }
+  return true;
+}
+
+std::shared_ptr<const Xtal::NiggliReduction> Xtal::niggliReduction(
+  const unsigned int iterations, double lenTol) const
+{
+  const Matrix3& cellMatrix = unitCell().cellMatrix();
+  {
+    std::unique_lock<std::mutex> lock(m_niggliMutex);
+    if (m_niggliReduction && m_niggliReduction->iterations == iterations &&
+        m_niggliReduction->lenTol == lenTol &&
+        m_niggliReduction->origCellMatrix == cellMatrix) {
+      return m_niggliReduction;
+    }
+  }
+
+  // Do not hold the lock while reducing
+  std::shared_ptr<const NiggliReduction> reduction =
+    std::make_shared<const NiggliReduction>(
+      computeNiggliReduction(cellMatrix, iterations, lenTol));
+
+  std::unique_lock<std::mutex> lock(m_niggliMutex);
+  m_niggliReduction = reduction;
+  return reduction;
+}
+
+Xtal::NiggliReduction Xtal::computeNiggliReduction(
+  const Matrix3& cellMatrix, const unsigned int iterations, double lenTol)
+{
+  NiggliReduction result;
+  result.origCellMatrix = cellMatrix;
+  result.iterations = iterations;
+  result.lenTol = lenTol;
+
   // Cache volume for later sanity checks
-  const double origVolume = getVolume();
+  const double origVolume = fabs(cellMatrix.determinant());
 
   // Grab lattice vectors
-  const Vector3& v1 = unitCell().aVector();
-  const Vector3& v2 = unitCell().bVector();
-  const Vector3& v3 = unitCell().cVector();
+  const Vector3 v1 = cellMatrix.row(0);
+  const Vector3 v2 = cellMatrix.row(1);
+  const Vector3 v3 = cellMatrix.row(2);
 
   // Compute characteristic (step 0)
   double A = v1.squaredNorm();
@@ -248,7 +317,7 @@ bool Xtal::niggliReduce(const unsigned int iterations, double lenTol)
   bool ret = false;
 
   // comparison tolerance
-  double tol = 0.001 * lenTol * pow(this->getVolume(), 2.0 / 3.0);
+  double tol = 0.001 * lenTol * pow(origVolume, 2.0 / 3.0);
 
   // Initialize change of basis matrices:
   //
@@ -362,7 +431,7 @@ bool Xtal::niggliReduce(const unsigned int iterations, double lenTol)
                        "tolerance) to the input lattices and try again. The "
                        "results of this comparison should not be relied upon."
                        "\n";
-          return false;
+          return result;
         }
         *p = -1;
       }
@@ -450,30 +519,35 @@ bool Xtal::niggliReduce(const unsigned int iterations, double lenTol)
     break;
   }
 
-  // No change, already reduced. Just return.
+  // No change, already reduced.
   if (iter == 0) {
-    return true;
+    result.success = true;
+    result.cellMatrix = cellMatrix;
+    return result;
   }
 
   // iterations exceeded
   if (!ret) {
-    return false;
+    return result;
   }
 
   Q_ASSERT_X(cob.determinant() == 1, Q_FUNC_INFO,
              "Determinant of change of basis matrix must be 1.");
 
-  // Update cell. This order is necessary for column vectors.
-  setCellInfo(cob.transpose() * unitCell().cellMatrix());
+  // Reduced cell. This order is necessary for column vectors.
+  const Matrix3 reduced(cob.transpose() * cellMatrix);
 
   // Check that volume has not changed
-  Q_ASSERT_X(StableComp::eq(origVolume, getVolume(), tol), Q_FUNC_INFO,
-             "Cell volume changed during Niggli reduction.");
-
-  // Rotate and wrap
-  rotateCellAndCoordsToStandardOrientation();
-  wrapAtomsToCell();
-  return true;
+  Q_ASSERT_X(StableComp::eq(origVolume, fabs(reduced.determinant()), tol),
+             Q_FUNC_INFO, "Cell volume changed during Niggli reduction.");
+
+  // Rotate it, unless that can't be done in a stable manner
+  const Matrix3 rotated(getCellMatrixInStandardOrientation(reduced));
+  result.success = true;
+  result.changed = true;
+  result.cob = cob;
+  result.cellMatrix = rotated.isZero() ? reduced : rotated;
+  return result;
 }
 
 bool Xtal::isNiggliReduced(double lenTol) const
@@ -548,172 +622,67 @@ bool Xtal::isNiggliReduced(const double a, const double b, const double c,
 
 bool Xtal::isPrimitive(const double cartTol)
 {
+  std::shared_ptr<const SymmetryService::Primitive> primitive =
+    SymmetryService::instance().primitive(symmetryGeometry(), cartTol);
 
-  // Cache fractional coordinates and atomic nums
-  QList<Vector3> fcoords;
-  QList<unsigned int> atomicNums;
-  for (std::vector<Atom>::const_iterator it = atoms().begin(),
-                                         it_end = atoms().end();
-       it != it_end; ++it) {
-    fcoords.append(cartToFrac((*it).pos()));
-    atomicNums.append((*it).atomicNumber());
-  }
-  size_t originalFCoordsSize = fcoords.size();
-
-  // Get unit cell
-  Matrix3 cellMatrix = this->unitCell().cellMatrix();
-
-  // Returns an unsigned int of the space group (in case we ever need it)
-  reduceToPrimitive(&fcoords, &atomicNums, &cellMatrix, cartTol);
-
-  if (originalFCoordsSize == fcoords.size())
-    return true;
-  else
-    return false;
+  // If the reduction failed, the xtal is treated as primitive
+  return primitive->fcoords.empty() ||
+         primitive->fcoords.size() == numAtoms();
 }
 
 bool Xtal::reduceToPrimitive(const double cartTol)
 {
+  std::shared_ptr<const SymmetryService::Primitive> primitive =
+    SymmetryService::instance().primitive(symmetryGeometry(), cartTol);
 
-  // Cache fractional coordinates and atomic nums
-  QList<Vector3> fcoords;
-  QList<unsigned int> atomicNums;
-  for (std::vector<Atom>::const_iterator it = atoms().begin(),
-                                         it_end = atoms().end();
-       it != it_end; ++it) {
-    fcoords.append(cartToFrac((*it).pos()));
-    atomicNums.append((*it).atomicNumber());
-  }
+  // spg == 0 implies that the reduction failed
+  if (primitive->spacegroup == 0)
+    return false;
 
-  // Get unit cell
-  Matrix3 cellMatrix = this->unitCell().cellMatrix();
+  setPrimitive(*primitive);
+  return true;
+}
 
-  unsigned int spg =
-    reduceToPrimitive(&fcoords, &atomicNums, &cellMatrix, cartTol);
+Xtal* Xtal::primitiveXtal(const double cartTol) const
+{
+  std::shared_ptr<const SymmetryService::Primitive> primitive =
+    SymmetryService::instance().primitive(symmetryGeometry(), cartTol);
 
-  // spg == 0 implies that reduceToPrimitive() failed
-  if (spg == 0)
-    return false;
+  // spg == 0 implies that the reduction failed
+  if (primitive->spacegroup == 0)
+    return nullptr;
+
+  Xtal* xtal = new Xtal;
+  xtal->setPrimitive(*primitive);
+  return xtal;
+}
 
-  setCellInfo(cellMatrix);
+void Xtal::setPrimitive(const SymmetryService::Primitive& primitive)
+{
+  setCellInfo(primitive.cellMatrix);
 
   // Remove all atoms to simplify the change
   clearAtoms();
 
   // Add the atoms in
-  for (size_t i = 0; i < fcoords.size(); i++) {
+  for (size_t i = 0; i < primitive.fcoords.size(); i++) {
     Atom& newAtom = this->addAtom();
-    newAtom.setAtomicNumber(atomicNums.at(i));
-    newAtom.setPos(fracToCart(fcoords.at(i)));
+    newAtom.setAtomicNumber(primitive.atomicNums.at(i));
+    newAtom.setPos(fracToCart(primitive.fcoords.at(i)));
   }
 
-  Q_ASSERT(fcoords.size() == atomicNums.size());
-  Q_ASSERT(this->atoms().size() == fcoords.size());
-
-  return true;
+  Q_ASSERT(this->atoms().size() == primitive.fcoords.size());
 }
 
-unsigned int Xtal::reduceToPrimitive(QList<Vector3>* fcoords,
-                                     QList<unsigned int>* atomicNums,
-                                     Matrix3* cellMatrix, const double cartTol)
+SymmetryService::Geometry Xtal::symmetryGeometry() const
 {
-  Q_ASSERT(fcoords->size() == atomicNums->size());
-
-  const int numAtoms = fcoords->size();
-
-  if (numAtoms < 1) {
-    qWarning() << "Cannot determine spacegroup of empty cell.";
-    return 0;
-  }
-
-  // Spglib expects column vecs, so fill with transpose
-  double lattice[3][3] = {
-    { (*cellMatrix)(0, 0), (*cellMatrix)(1, 0), (*cellMatrix)(2, 0) },
-    { (*cellMatrix)(0, 1), (*cellMatrix)(1, 1), (*cellMatrix)(2, 1) },
-    { (*cellMatrix)(0, 2), (*cellMatrix)(1, 2), (*cellMatrix)(2, 2) }
-  };
-
-  // Build position list. Include space for 4*numAtoms for the
-  // cell refinement
-  double(*positions)[3] = new double[4 * numAtoms][3];
-  int* types = new int[4 * numAtoms];
-  const Vector3* fracCoord;
-  for (int i = 0; i < numAtoms; ++i) {
-    fracCoord = &(*fcoords)[i];
-    types[i] = (*atomicNums)[i];
-    positions[i][0] = fracCoord->x();
-    positions[i][1] = fracCoord->y();
-    positions[i][2] = fracCoord->z();
-  }
-
-  // find spacegroup for return value
-  char symbol[21];
-  int spg =
-    spg_get_international(symbol, lattice, positions, types, numAtoms, cartTol);
-
-  // Refine the structure
-  int numBravaisAtoms =
-    spg_refine_cell(lattice, positions, types, numAtoms, cartTol);
-
-  // if spglib cannot refine the cell, return 0.
-  if (numBravaisAtoms <= 0) {
-    return 0;
-  }
-
-  // Find primitive cell. This updates lattice, positions, types
-  // to primitive
-  int numPrimitiveAtoms =
-    spg_find_primitive(lattice, positions, types, numBravaisAtoms, cartTol);
-
-  // If the cell was already a primitive cell, reset
-  // numPrimitiveAtoms.
-  if (numPrimitiveAtoms == 0) {
-    numPrimitiveAtoms = numBravaisAtoms;
-  }
-
-  // Bail if everything failed
-  if (numPrimitiveAtoms <= 0) {
-    return 0;
-  }
-
-  // Update passed objects
-  // convert col vecs to row vecs
-  (*cellMatrix)(0, 0) = lattice[0][0];
-  (*cellMatrix)(0, 1) = lattice[1][0];
-  (*cellMatrix)(0, 2) = lattice[2][0];
-  (*cellMatrix)(1, 0) = lattice[0][1];
-  (*cellMatrix)(1, 1) = lattice[1][1];
-  (*cellMatrix)(1, 2) = lattice[2][1];
-  (*cellMatrix)(2, 0) = lattice[0][2];
-  (*cellMatrix)(2, 1) = lattice[1][2];
-  (*cellMatrix)(2, 2) = lattice[2][2];
-
-  // Trim
-  while (fcoords->size() > numPrimitiveAtoms) {
-    fcoords->removeLast();
-    atomicNums->removeLast();
-  }
-  while (fcoords->size() < numPrimitiveAtoms) {
-    fcoords->append(Vector3());
-    atomicNums->append(0);
-  }
-
-  // Update
-  Q_ASSERT(fcoords->size() == atomicNums->size());
-  Q_ASSERT(fcoords->size() == numPrimitiveAtoms);
-  for (int i = 0; i < numPrimitiveAtoms; ++i) {
-    (*atomicNums)[i] = types[i];
-    (*fcoords)[i] = Vector3(positions[i]);
-  }
-
-  delete[] positions;
-  delete[] types;
-
-  if (spg > 230 || spg < 0) {
-    spg = 0;
-  }
-
-  return static_cast<unsigned int>(spg);
+  SymmetryService::Geometry geometry;
+  geometry.cellMatrix = unitCell().cellMatrix();
+  geometry.fcoords = getFracCoords();
+  geometry.atomicNums.reserve(numAtoms());
+  for (const auto& atom : atoms())
+    geometry.atomicNums.push_back(atom.atomicNumber());
+  return geometry;
 }
 
 QList<QString> Xtal::currentAtomicSymbols()
@@ -761,7 +730,7 @@ void Xtal::setCurrentFractionalCoords(const QList<QString>& ids,
                                       it_end = fcoords.constEnd();
        it != it_end; ++it) {
     // Convert to storage cartesian
-    coords.append(cartToFrac(*it));
+    coords.append(fracToCart(*it));
   }
 
   updateMolecule(ids, coords);
@@ -790,10 +759,7 @@ void Xtal::printAtomInfo() const
 {
   cout << "Frac coords info (blank if none):\n";
   const std::vector<Atom>& atoms = this->atoms();
-  QList<Vector3> fracCoords;
-
-  for (size_t i = 0; i < atoms.size(); i++)
-    fracCoords.append(cartToFrac(atoms.at(i).pos()));
+  const std::vector<Vector3> fracCoords = getFracCoords();
 
   for (size_t i = 0; i < atoms.size(); i++) {
     cout << "  For atomic num " << atoms.at(i).atomicNumber()
@@ -853,21 +819,14 @@ bool Xtal::compareCoordinates(const Xtal& other, const double lengthTol,
   thisTypes.reserve(this->numAtoms());
   otherCoords.reserve(other.numAtoms());
   otherTypes.reserve(other.numAtoms());
-  Vector3 pos;
-  for (std::vector<Atom>::const_iterator it = this->atoms().begin(),
-                                         it_end = this->atoms().end();
-       it != it_end; ++it) {
-    pos = this->cartToFrac((*it).pos());
+  for (const auto& pos : this->getFracCoords())
     thisCoords.push_back(XcVector(pos.x(), pos.y(), pos.z()));
-    thisTypes.push_back((*it).atomicNumber());
-  }
-  for (std::vector<Atom>::const_iterator it = other.atoms().begin(),
-                                         it_end = other.atoms().end();
-       it != it_end; ++it) {
-    pos = other.cartToFrac((*it).pos());
+  for (const auto& atom : this->atoms())
+    thisTypes.push_back(atom.atomicNumber());
+  for (const auto& pos : other.getFracCoords())
     otherCoords.push_back(XcVector(pos.x(), pos.y(), pos.z()));
-    otherTypes.push_back((*it).atomicNumber());
-  }
+  for (const auto& atom : other.atoms())
+    otherTypes.push_back(atom.atomicNumber());
 
   return XtalComp::compare(thisCellXc, thisTypes, thisCoords, otherCellXc,
                            otherTypes, otherCoords, nullptr, lengthTol,
@@ -2153,28 +2112,64 @@ bool Xtal::getIADHistogram(QList<double>* distance, QList<double>* frequency,
   return true;
 }
 
-void Xtal::wrapAtomsToCell()
+std::vector<Vector3> Xtal::getFracCoords() const
+{
+  const Matrix3& toFrac = unitCell().fractionalMatrix();
+  std::vector<Vector3> fcoords;
+  fcoords.reserve(numAtoms());
+  for (const auto& atom : atoms())
+    fcoords.push_back(toFrac * atom.pos());
+  return fcoords;
+}
+
+void Xtal::setFracCoords(const std::vector<Vector3>& fcoords)
 {
-  // qDebug() << "Xtal::wrapAtomsToCell() called";
-  // Store position of atoms in fractional units
   std::vector<Atom>& atomList = atoms();
-  QList<Vector3> fracCoordsList;
-  for (int i = 0; i < atomList.size(); i++)
-    fracCoordsList.append(cartToFrac(atomList.at(i).pos()));
+  Q_ASSERT(atomList.size() == fcoords.size());
+  const Matrix3 toCart = unitCell().cellMatrixColForm();
+  for (size_t i = 0; i < atomList.size(); ++i)
+    atomList[i].setPos(toCart * fcoords[i]);
+}
 
-  // wrap fractional coordinates to [0,1)
-  for (int i = 0; i < fracCoordsList.size(); i++) {
-    fracCoordsList[i][0] = fmod(fracCoordsList[i][0] + 100, 1);
-    fracCoordsList[i][1] = fmod(fracCoordsList[i][1] + 100, 1);
-    fracCoordsList[i][2] = fmod(fracCoordsList[i][2] + 100, 1);
-  }
+void Xtal::setCellInfoKeepFractional(const Matrix3& m, bool wrap)
+{
+  // Cartesian -> fractional in the old cell -> Cartesian in the new cell
+  const Matrix3 toFrac = unitCell().fractionalMatrix();
+  setCellInfo(m);
+  transformAtoms(toFrac, m.transpose(), wrap);
+}
 
-  // Recalculate cartesian coordinates:
-  Vector3 cartCoord;
-  for (int i = 0; i < atomList.size(); i++) {
-    cartCoord = fracToCart(fracCoordsList.at(i));
-    atomList.at(i).setPos(cartCoord);
+void Xtal::wrapAtomsToCell()
+{
+  transformAtoms(unitCell().fractionalMatrix(), unitCell().cellMatrixColForm(),
+                 true);
+}
+
+void Xtal::transformAtoms(const Matrix3& toFrac, const Matrix3& toCart,
+                          bool wrap)
+{
+  std::vector<Atom>& atomList = atoms();
+  const size_t n = atomList.size();
+
+  // Gather the positions as columns so that all of them are transformed by
+  // one matrix product
+  Matrix3Xd& positions = threadLocalPositions();
+  positions.resize(3, n);
+  for (size_t i = 0; i < n; ++i)
+    positions.col(i) = atomList[i].pos();
+
+  if (wrap) {
+    // wrap fractional coordinates to [0,1)
+    positions = toFrac * positions;
+    positions = positions.unaryExpr(
+      [](double x) { return fmod(x + 100, 1); });
+    positions = toCart * positions;
+  } else {
+    positions = (toCart * toFrac) * positions;
   }
+
+  for (size_t i = 0; i < n; ++i)
+    atomList[i].setPos(positions.col(i));
 }
 
 QHash<QString, QVariant> Xtal::getFingerprint()
@@ -2308,10 +2303,9 @@ void Xtal::findSpaceGroup(double prec)
   // reset space group to 0 so we can exit if needed
   m_spgNumber = 0;
   m_spgSymbol = "Unknown";
-  int num = numAtoms();
 
   // if no unit cell or atoms, exit
-  if (num == 0)
+  if (numAtoms() == 0)
     return;
   else if (!hasUnitCell()) {
     qWarning() << "Xtal::findSpaceGroup( " << prec
@@ -2319,42 +2313,62 @@ void Xtal::findSpaceGroup(double prec)
     return;
   }
 
-  // Get lattice matrix. Spglib expects column vectors.
-  const Matrix3& cell = unitCell().cellMatrix();
-  double lattice[3][3] = { { cell(0, 0), cell(0, 1), cell(0, 2) },
-                           { cell(1, 0), cell(1, 1), cell(1, 2) },
-                           { cell(2, 0), cell(2, 1), cell(2, 2) } };
+  setSpaceGroup(
+    SymmetryService::instance().spacegroup(symmetryGeometry(), prec));
+}
 
-  // Get atom info
-  double(*positions)[3] = new double[num][3];
-  int* types = new int[num];
-  std::vector<Atom>& atomList = atoms();
-  Vector3 fracCoords;
-  for (int i = 0; i < atomList.size(); i++) {
-    fracCoords = cartToFrac(atomList.at(i).pos());
-    types[i] = atomList.at(i).atomicNumber();
-    positions[i][0] = fracCoords.x();
-    positions[i][1] = fracCoords.y();
-    positions[i][2] = fracCoords.z();
+void Xtal::findSpaceGroups(const QList<Structure*>& structures, double prec)
+{
+  if (prec < 1e-5) {
+    qWarning() << "Xtal::findSpaceGroups called with a precision of " << prec
+               << ". This is likely an error. Resetting prec to " << 0.05
+               << ".";
+    prec = 0.05;
   }
 
-  // find spacegroup
-  char symbol[21];
-  m_spgNumber =
-    spg_get_international(symbol, lattice, positions, types, num, prec);
+  std::vector<Xtal*> xtals;
+  std::vector<std::future<SymmetryService::Spacegroup>> futures;
+  for (const auto& s : structures) {
+    Xtal* xtal = qobject_cast<Xtal*>(s);
+    if (!xtal)
+      continue;
 
-  delete[] positions;
-  delete[] types;
+    QWriteLocker locker(&xtal->lock());
+    xtal->m_spgNumber = 0;
+    xtal->m_spgSymbol = "Unknown";
+    if (xtal->numAtoms() == 0 || !xtal->hasUnitCell())
+      continue;
 
-  // Fail if m_spgNumber is still 0
-  if (m_spgNumber == 0) {
-    return;
+    SymmetryService::Geometry geometry = xtal->symmetryGeometry();
+    xtals.push_back(xtal);
+    futures.push_back(Executor::cpu().submit([geometry, prec]() {
+      return SymmetryService::instance().spacegroup(geometry, prec);
+    }));
   }
 
-  // Set and clean up the symbol string
-  m_spgSymbol = QString(symbol);
-  m_spgSymbol.remove(" ");
-  return;
+  for (size_t i = 0; i < xtals.size(); ++i) {
+    SymmetryService::Spacegroup spacegroup = futures[i].get();
+    QWriteLocker locker(&xtals[i]->lock());
+    xtals[i]->setSpaceGroup(spacegroup);
+  }
+}
+
+QString Xtal::getWyckoffLetters(double prec) const
+{
+  if (numAtoms() == 0 || !hasUnitCell())
+    return "";
+
+  return QString::fromStdString(
+    SymmetryService::instance().wyckoffLetters(symmetryGeometry(), prec));
+}
+
+void Xtal::setSpaceGroup(const SymmetryService::Spacegroup& spacegroup)
+{
+  m_spgNumber = spacegroup.number;
+  if (m_spgNumber == 0)
+    m_spgSymbol = "Unknown";
+  else
+    m_spgSymbol = QString::fromStdString(spacegroup.symbol);
 }
 
 void Xtal::getSpglibFormat() const
@@ -2421,24 +2435,13 @@ bool Xtal::rotateCellToStandardOrientation()
 
 bool Xtal::rotateCellAndCoordsToStandardOrientation()
 {
-  // Cache fractional coordinates
-  QList<Vector3> fcoords;
-  for (std::vector<Atom>::const_iterator it = atoms().begin(),
-                                         it_end = atoms().end();
-       it != it_end; ++it) {
-    fcoords.append(cartToFrac(it->pos()));
-  }
+  const Matrix3 newMat(getCellMatrixInStandardOrientation());
 
-  if (!rotateCellToStandardOrientation()) {
-    return false;
-  }
-
-  // Reset coords
-  Q_ASSERT(this->atoms().size() == fcoords.size());
-  for (int i = 0; i < atoms().size(); ++i) {
-    this->atom(i).setPos(this->fracToCart(fcoords[i]));
-  }
+  // Let rotateCellToStandardOrientation() report the problem
+  if (newMat.isZero())
+    return rotateCellToStandardOrientation();
 
+  setCellInfoKeepFractional(newMat);
   return true;
 }
 
@@ -2638,9 +2641,15 @@ Xtal* Xtal::getRandomRepresentation() const
     atom.setPos((*it).pos() + randTranslation);
   }
 
-  // rotate and wrap:
-  nxtal->rotateCellAndCoordsToStandardOrientation();
-  nxtal->wrapAtomsToCell();
+  // rotate and wrap in one pass:
+  const Matrix3 stdMat(nxtal->getCellMatrixInStandardOrientation());
+  if (stdMat.isZero()) {
+    // Reports the problem
+    nxtal->rotateCellToStandardOrientation();
+    nxtal->wrapAtomsToCell();
+  } else {
+    nxtal->setCellInfoKeepFractional(stdMat, true);
+  }
   return nxtal;
 }
 
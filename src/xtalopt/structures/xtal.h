@@ -17,11 +17,15 @@
 
 #include <globalsearch/structure.h>
 
+#include <xtalopt/structures/symmetryservice.h>
 #include <xtalopt/xtalopt.h>
 
 #include <QMutex>
 #include <QVector>
 
+#include <memory>
+#include <mutex>
+
 #define EV_TO_KCAL_PER_MOL 23.060538
 
 class QFile;
@@ -174,11 +178,32 @@ public:
   Vector3 fracToCart(const Vector3& v) const;
   Vector3 cartToFrac(const Vector3& v) const;
 
+  // Fractional coordinates of all atoms, in the order of atoms(). Prefer
+  // this and setFracCoords() over converting the atoms one at a time.
+  std::vector<Vector3> getFracCoords() const;
+
+  // Move the atoms to fractional coordinates @p fcoords, which must be in
+  // the order of atoms()
+  void setFracCoords(const std::vector<Vector3>& fcoords);
+
+  // Change the cell (row vectors) and carry the atoms along with it, so
+  // that their fractional coordinates stay the same. If @p wrap is true,
+  // the fractional coordinates are also wrapped to [0, 1).
+  void setCellInfoKeepFractional(const Matrix3& m, bool wrap = false);
+
   // Spacegroup
   uint getSpaceGroupNumber();
   QString getSpaceGroupSymbol();
   QString getHTMLSpaceGroupSymbol();
 
+  // Finds the space groups of the xtals in @p structures in parallel. Each
+  // xtal is locked while it is read and written.
+  static void findSpaceGroups(const QList<GlobalSearch::Structure*>& structures,
+                              double prec = 0.05);
+
+  // The Wyckoff letter of each atom, in order
+  QString getWyckoffLetters(double prec = 0.05) const;
+
   // Static function for getting a Hermann-Mauguin name from a spg number
   static QString getHMName(unsigned short spg);
 
@@ -191,6 +216,40 @@ public:
   // http://scripts.iucr.org/cgi-bin/paper?S010876730302186X [Accessed
   // November 24, 2010].
   bool niggliReduce(const unsigned int iterations = 100, double lenTol = 0.01);
+
+  // The result of a Niggli reduction of a cell
+  struct NiggliReduction
+  {
+    NiggliReduction()
+      : success(false), changed(false), cob(Matrix3::Identity()),
+        cellMatrix(Matrix3::Zero()), origCellMatrix(Matrix3::Zero()),
+        iterations(0), lenTol(0.0)
+    {
+    }
+    bool success; // false if the reduction failed
+    bool changed; // false if the cell was already reduced
+    // Change of basis. The reduced cell vectors are cob^T times the
+    // original ones, and the fractional coordinates are cob^-1 times them.
+    Matrix3 cob;
+    // The reduced cell (row vectors), rotated to the standard orientation
+    Matrix3 cellMatrix;
+    // What was reduced
+    Matrix3 origCellMatrix;
+    unsigned int iterations;
+    double lenTol;
+  };
+
+  // Reduce @p cellMatrix (row vectors) without touching any atoms.
+  static NiggliReduction computeNiggliReduction(
+    const Matrix3& cellMatrix, const unsigned int iterations = 100,
+    double lenTol = 0.01);
+
+  // The Niggli reduction of this cell. The result is kept until the cell
+  // changes, and copies of this xtal start with it, so repeated calls to
+  // niggliReduce() and fixAngles() do not reduce the cell again. Duplicate
+  // checks and the SymmetryService do not use it.
+  std::shared_ptr<const NiggliReduction> niggliReduction(
+    const unsigned int iterations = 100, double lenTol = 0.01) const;
   static bool isNiggliReduced(const double a, const double b, const double c,
                               const double alpha, const double beta,
                               const double gamma, double lenTol = 0.01);
@@ -200,6 +259,9 @@ public:
   // results in a smaller FU xtal, the function returns true
   bool isPrimitive(const double cartTol = 0.05);
   bool reduceToPrimitive(const double cartTol = 0.05);
+  // Returns a new xtal with the primitive cell of this one, or nullptr if
+  // the reduction failed. After isPrimitive(), this is a cache lookup.
+  Xtal* primitiveXtal(const double cartTol = 0.05) const;
 
   QList<QString> currentAtomicSymbols();
   inline void updateMolecule(const QList<QString>& ids,
@@ -274,7 +336,8 @@ public slots:
   bool fixAngles(int attempts = 100);
   void wrapAtomsToCell();
 
-  // Spacegroup
+  // Spacegroup. The results are memoized by the SymmetryService, so this
+  // is cheap when the geometry has not changed.
   void findSpaceGroup(double prec = 0.05);
 
   // Printing debug output
@@ -285,14 +348,24 @@ public slots:
 private slots:
 
 private:
-  // This function is called by the public overloaded function:
-  // bool reduceToPrimitive(const double cartTol = 0.05)
-  unsigned int reduceToPrimitive(QList<Vector3>* fcoords,
-                                 QList<unsigned int>* atomicNums,
-                                 Matrix3* cellMatrix,
-                                 const double cartTol = 0.05);
+  // The geometry in the form used by the SymmetryService
+  SymmetryService::Geometry symmetryGeometry() const;
+  void setSpaceGroup(const SymmetryService::Spacegroup& spacegroup);
+  // Replace the cell and atoms with those of @p primitive
+  void setPrimitive(const SymmetryService::Primitive& primitive);
+
+  // Convert the positions of all atoms to fractional coordinates with
+  // @p toFrac, optionally wrap them to [0, 1), and convert them back with
+  // @p toCart.
+  void transformAtoms(const Matrix3& toFrac, const Matrix3& toCart,
+                      bool wrap);
+
   unsigned short m_spgNumber;
   QString m_spgSymbol;
+
+  // The last result of niggliReduction()
+  mutable std::mutex m_niggliMutex;
+  mutable std::shared_ptr<const NiggliReduction> m_niggliReduction;
 };
 
 inline Vector3 Xtal::fracToCart(const Vector3& v) const
@@ -201,6 +201,8 @@ void TabMolecularInit::updateDimensions()
 
   xtalopt->using_fixed_volume = ui.cb_fixedVolume->isChecked();
   xtalopt->vol_fixed = ui.spin_fixedVolume->value();
+
+  xtalopt->publishConstraints();
 }
 
 void TabMolecularInit::updateMinRadii()
@@ -224,6 +226,7 @@ void TabMolecularInit::updateFormulaUnits()
   // If nothing valid was obtained, return 1
   if (formulaUnitsList.size() == 0) {
     xtalopt->formulaUnitsList.append(1);
+    xtalopt->publishConstraints();
     tmp = "1";
     ui.edit_formula_units->setText(tmp.trimmed());
     return;
@@ -240,6 +243,7 @@ void TabMolecularInit::updateFormulaUnits()
   }
 
   xtalopt->formulaUnitsList = formulaUnitsList;
+  xtalopt->publishConstraints();
 
   // Update the size of the lowestEnthalpyFUList
   while (xtalopt->lowestEnthalpyFUList.size() <= xtalopt->maxFU())
@@ -281,6 +285,7 @@ void TabMolecularInit::adjustVolumesToBePerFU(uint FU)
   xtalopt->vol_min = ui.spin_vol_min->value();
   xtalopt->vol_max = ui.spin_vol_max->value();
   xtalopt->vol_fixed = ui.spin_fixedVolume->value();
+  xtalopt->publishConstraints();
 }
 
 void TabMolecularInit::showConformerGeneratorDialog()
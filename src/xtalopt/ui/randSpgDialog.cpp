@@ -20,7 +20,7 @@
 #include <QSpinBox>
 
 #include "randSpgDialog.h"
-#include <randSpg/include/randSpg.h>
+#include <randSpg/include/randSpgContext.h>
 
 #include <xtalopt/structures/xtal.h>
 #include <xtalopt/xtalopt.h>
@@ -60,6 +60,9 @@ RandSpgDialog::RandSpgDialog(XtalOpt* p, QWidget* parent)
     }
   }
 
+  // The results are memoized, so they are reused when the search starts
+  std::shared_ptr<RandSpgContext> context = m_xtalopt->randSpgContext();
+
   // Let's investigate every spacegroup!
   for (size_t spg = 1; spg <= 230; spg++) {
     uint index = spg - 1;
@@ -75,7 +78,7 @@ RandSpgDialog::RandSpgDialog(XtalOpt* p, QWidget* parent)
         }
       }
       // Append each formula unit to the list followed by a comma
-      if (RandSpg::isSpgPossible(spg, tempAtoms)) {
+      if (context->isSpgPossible(spg, tempAtoms)) {
         FUPossible.append(QString::number(m_FUList.at(i)) + ",");
       }
     }
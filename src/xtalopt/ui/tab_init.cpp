@@ -342,6 +342,7 @@ void TabInit::getComposition(const QString& str)
 
   if (length == 0) {
     xtalopt->comp.clear();
+    xtalopt->publishConstraints();
     this->updateCompositionTable();
     return;
   }
@@ -447,6 +448,7 @@ void TabInit::getComposition(const QString& str)
 
   this->updateMinRadii();
   this->updateMinIAD();
+  xtalopt->publishConstraints();
   this->updateCompositionTable();
   this->updateNumDivisions();
 }
@@ -627,6 +629,8 @@ void TabInit::updateDimensions()
   if (xtalopt->using_checkStepOpt != ui.cb_checkStepOpt->isChecked()) {
     xtalopt->using_checkStepOpt = ui.cb_checkStepOpt->isChecked();
   }
+
+  xtalopt->publishConstraints();
 }
 
 void TabInit::updateMinRadii()
@@ -677,6 +681,8 @@ void TabInit::updateMinIAD()
       interComp[qMakePair<int, int>(atomicNum2, atomicNum1)].minIAD = minIAD;
     }
   }
+
+  xtalopt->publishConstraints();
 }
 
 void TabInit::updateFormulaUnits()
@@ -691,6 +697,7 @@ void TabInit::updateFormulaUnits()
   // If nothing valid was obtained, return 1
   if (formulaUnitsList.size() == 0) {
     xtalopt->formulaUnitsList.append(1);
+    xtalopt->publishConstraints();
     tmp = "1";
     ui.edit_formula_units->setText(tmp.trimmed());
     return;
@@ -720,6 +727,7 @@ void TabInit::updateFormulaUnits()
   }
 
   xtalopt->formulaUnitsList = formulaUnitsList;
+  xtalopt->publishConstraints();
 
   // Update the size of the lowestEnthalpyFUList
   while (xtalopt->lowestEnthalpyFUList.size() <= xtalopt->maxFU())
@@ -784,6 +792,7 @@ void TabInit::adjustVolumesToBePerFU(uint FU)
   xtalopt->vol_min = ui.spin_vol_min->value();
   xtalopt->vol_max = ui.spin_vol_max->value();
   xtalopt->vol_fixed = ui.spin_fixedVolume->value();
+  xtalopt->publishConstraints();
 }
 
 // Determine the possible number of divisions for mitosis and update combobox
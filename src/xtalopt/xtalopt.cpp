@@ -18,6 +18,7 @@
 #include <xtalopt/genetic.h>
 #include <xtalopt/optimizers/optimizers.h>
 #include <xtalopt/rpc/xtaloptrpc.h>
+#include <xtalopt/structures/iadtracker.h>
 #include <xtalopt/structures/xtal.h>
 #include <xtalopt/ui/dialog.h>
 #include <xtalopt/ui/randSpgDialog.h>
@@ -26,8 +27,9 @@
 
 #include <globalsearch/bt.h>
 #include <globalsearch/eleminfo.h>
-#include <globalsearch/formats/cmlformat.h>
-#include <globalsearch/formats/obconvert.h>
+#include <globalsearch/executor.h>
+#include <globalsearch/fitness/fitnessevaluator.h>
+#include <globalsearch/formats/sdfformat.h>
 #include <globalsearch/optbase.h>
 #include <globalsearch/optimizer.h>
 #include <globalsearch/queueinterface.h>
@@ -58,7 +60,9 @@
 #include <QtConcurrent>
 
 #include <randSpg/include/randSpg.h>
+#include <randSpg/include/randSpgContext.h>
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <mutex>
@@ -73,14 +77,17 @@ XtalOpt::XtalOpt(GlobalSearch::AbstractDialog* parent)
   : OptBase(parent), formulaUnitsList({ 1 }), lowestEnthalpyFUList({ 0, 0 }),
     using_randSpg(false), minXtalsOfSpgPerFU(QList<int>()),
     m_rpcClient(make_unique<XtalOptRpc>()),
-    m_initWC(new SlottedWaitCondition(this))
+    m_initWC(new SlottedWaitCondition(this)), m_numGenerationFailures(0),
+    m_randSpgContextScaleFactor(-1.0), m_randSpgContextMinRadius(-1.0)
 {
   xtalInitMutex = new QMutex;
   m_idString = "XtalOpt";
   m_schemaVersion = 3;
 
-  // Read the general settings
+  // Read the general settings. The constraints are published even if
+  // that fails so that there always is a snapshot.
   readSettings();
+  publishConstraints();
 
   // Connections
   connect(m_tracker, SIGNAL(newStructureAdded(GlobalSearch::Structure*)), this,
@@ -90,6 +97,16 @@ XtalOpt::XtalOpt(GlobalSearch::AbstractDialog* parent)
           SLOT(updateLowestEnthalpyFUList(GlobalSearch::Structure*)));
 
   connect(this, &OptBase::dialogSet, this, &XtalOpt::setupRpcConnections);
+
+  // Offspring are generated ahead of time so that a free slot in the queue
+  // does not have to wait for one. They are moved to the queue thread
+  // here since initializeAndAddXtal() runs in a different pool thread.
+  m_candidateBuffer.setProducer([this]() -> Structure* {
+    Xtal* xtal = generateOffspringXtal();
+    if (xtal)
+      xtal->moveToThread(m_queueThread);
+    return xtal;
+  });
 }
 
 XtalOpt::~XtalOpt()
@@ -97,6 +114,16 @@ XtalOpt::~XtalOpt()
   // The dialog should be gone, so make sure everywhere else knows
   m_dialog = nullptr;
 
+  // Stop generating candidates before anything they use is destroyed
+  m_candidateBuffer.stop();
+
+  {
+    std::unique_lock<std::mutex> lock(m_derivedXtalsMutex);
+    for (const auto& derived : m_derivedXtals)
+      delete derived.xtal;
+    m_derivedXtals.clear();
+  }
+
   // Save one last time
   qDebug() << "Saving XtalOpt settings...";
 
@@ -152,6 +179,9 @@ bool XtalOpt::startSearch()
     return false;
   }
 
+  // Generation and the structure checks use this snapshot from now on
+  publishConstraints();
+
   // Check if xtalopt data is already saved at the filePath
   // If we are in cli mode, we check it elsewhere
   if (QFile::exists(filePath + QDir::separator() + "xtalopt.state") &&
@@ -180,6 +210,8 @@ bool XtalOpt::startSearch()
     return false;
   }
 
+  updateHardnessCacheFile();
+
   // Warn user if runningJobLimit is 0
   if (limitRunningJobs && runningJobLimit == 0) {
     if (m_usingGUI) {
@@ -324,7 +356,7 @@ bool XtalOpt::startSearch()
           uint FU = formulaUnitsList.at(FU_ind);
 
           // If the spacegroup isn't possible for this FU, just continue
-          if (!RandSpg::isSpgPossible(spg, getStdVecOfAtoms(FU))) {
+          if (!randSpgContext()->isSpgPossible(spg, getStdVecOfAtoms(FU))) {
             numXtalsToBeGenerated--;
             continue;
           }
@@ -347,32 +379,57 @@ bool XtalOpt::startSearch()
       }
     }
     // If we still haven't generated enough xtals, pick a random FU and spg
-    // to be generated
+    // to be generated. The picks are made here, and the xtals are
+    // generated in parallel since the RandSpg context is thread-safe.
     while (newXtalCount < numInitial) {
       // Let's keep the progress bar updated
       updateProgressBar(numInitial, newXtalCount + failed, newXtalCount);
 
-      // Randomly select a formula unit
-      uint randomFU =
-        formulaUnitsList.at(rand() % int(formulaUnitsList.size()));
-      // Randomly select a possible spg
-      uint randomSpg =
-        pickRandomSpgFromPossibleOnes(); // pickRandomSpgFromPossibleOnes();
-      // If it isn't possible, try again
-      if (!RandSpg::isSpgPossible(randomSpg, getStdVecOfAtoms(randomFU)))
-        continue;
-      // Try it out
-      xtal = randSpgXtal(1, newXtalCount + 1, randomFU, randomSpg);
-      if (!checkXtal(xtal)) {
-        delete xtal;
-        qWarning() << "Failed to generate an xtal with spacegroup of"
-                   << QString::number(randomSpg) << "and FU of"
-                   << QString::number(randomFU);
-        failed++;
-      } else {
-        xtal->findSpaceGroup(tol_spg);
-        initializeAndAddXtal(xtal, 1, xtal->getParents());
-        newXtalCount++;
+      std::shared_ptr<RandSpgContext> context = randSpgContext();
+      std::vector<std::pair<uint, uint>> picks;
+      while (picks.size() < numInitial - newXtalCount) {
+        // Randomly select a formula unit
+        uint randomFU =
+          formulaUnitsList.at(rand() % int(formulaUnitsList.size()));
+        // Randomly select a possible spg
+        uint randomSpg = pickRandomSpgFromPossibleOnes();
+        // If it isn't possible, try again
+        if (!context->isSpgPossible(randomSpg, getStdVecOfAtoms(randomFU)))
+          continue;
+        picks.push_back(std::make_pair(randomFU, randomSpg));
+      }
+
+      // Try them out
+      std::vector<std::future<Xtal*>> futures;
+      for (const auto& pick : picks) {
+        uint FU = pick.first;
+        uint spg = pick.second;
+        futures.push_back(Executor::cpu().submit([this, FU, spg]() {
+          Xtal* xtal = randSpgXtal(1, 0, FU, spg);
+          if (!checkXtal(xtal)) {
+            delete xtal;
+            return static_cast<Xtal*>(nullptr);
+          }
+          xtal->findSpaceGroup(tol_spg);
+          // Objects may only be pushed to another thread from their own
+          xtal->moveToThread(m_queueThread);
+          return xtal;
+        }));
+      }
+
+      // Add them in order so that the IDs are assigned in order
+      for (size_t i = 0; i < futures.size(); ++i) {
+        xtal = futures[i].get();
+        if (!xtal) {
+          qWarning() << "Failed to generate an xtal with spacegroup of"
+                     << QString::number(picks[i].second) << "and FU of"
+                     << QString::number(picks[i].first);
+          failed++;
+        } else {
+          initializeAndAddXtal(xtal, 1, xtal->getParents());
+          newXtalCount++;
+        }
+        updateProgressBar(numInitial, newXtalCount + failed, newXtalCount);
       }
       // If we failed, shake it off and try again
     }
@@ -592,6 +649,11 @@ bool XtalOpt::save(QString filename, bool notify)
   settings->setValue("opt/hardnessFitnessWeight",
                      m_hardnessFitnessWeight.load());
 
+  // Other fitness terms
+  settings->setValue("opt/fitnessTermWeights",
+                     m_fitnessEvaluator->weightsString());
+  settings->setValue("opt/paretoSelection", m_paretoSelection.load());
+
   return true;
 }
 
@@ -623,6 +685,10 @@ bool XtalOpt::writeEditSettings(const QString& filename)
                        queueInterface(i)->getIDString().toLower());
   }
   settings->setValue("logErrorDirs", m_logErrorDirs);
+  settings->setValue("restartFromCheckpoint", m_restartFromCheckpoint);
+  settings->setValue("archiveFinishedStructures",
+                     m_archiveFinishedStructures);
+  settings->setValue("fullSaveInterval", m_fullSaveInterval);
   settings->endGroup();
 
   writeUserValuesToSettings(filename.toStdString());
@@ -643,6 +709,11 @@ bool XtalOpt::readEditSettings(const QString& filename)
   settings->beginGroup("xtalopt/edit");
   port = settings->value("remote/port", 22).toInt();
   m_logErrorDirs = settings->value("logErrorDirs", false).toBool();
+  m_restartFromCheckpoint =
+    settings->value("restartFromCheckpoint", false).toBool();
+  m_archiveFinishedStructures =
+    settings->value("archiveFinishedStructures", false).toBool();
+  m_fullSaveInterval = settings->value("fullSaveInterval", 300).toInt();
 
   int loadedVersion = settings->value("version", 0).toInt();
 
@@ -1145,8 +1216,14 @@ bool XtalOpt::readSettings(const QString& filename)
   m_hardnessFitnessWeight =
     settings->value("opt/hardnessFitnessWeight", 0.0).toDouble();
 
+  // Other fitness terms
+  m_fitnessEvaluator->setWeightsFromString(
+    settings->value("opt/fitnessTermWeights", "").toString());
+  m_paretoSelection = settings->value("opt/paretoSelection", false).toBool();
+
   settings->endGroup();
 
+  publishConstraints();
   return true;
 }
 
@@ -1218,7 +1295,7 @@ Structure* XtalOpt::replaceWithRandom(Structure* s, const QString& reason)
         // Randomly select a possible spg
         spg = pickRandomSpgFromPossibleOnes();
       }
-      while (!RandSpg::isSpgPossible(spg, getStdVecOfAtoms(FU)));
+      while (!randSpgContext()->isSpgPossible(spg, getStdVecOfAtoms(FU)));
 
       xtal = randSpgXtal(generation, id, FU, spg);
     } else {
@@ -1325,17 +1402,18 @@ Xtal* XtalOpt::randSpgXtal(uint generation, uint id, uint FU, uint spg,
   Xtal* xtal = nullptr;
 
   // Let's make the spg input
+  auto cons = constraints();
   latticeStruct latticeMins, latticeMaxes;
-  setLatticeMinsAndMaxes(latticeMins, latticeMaxes);
+  setLatticeMinsAndMaxes(*cons, latticeMins, latticeMaxes);
 
   // Create the input
   randSpgInput input(spg, getStdVecOfAtoms(FU), latticeMins, latticeMaxes);
 
   // Add various other input options
-  input.IADScalingFactor = scaleFactor;
-  input.minRadius = minRadius;
-  input.minVolume = vol_min * static_cast<double>(FU);
-  input.maxVolume = vol_max * static_cast<double>(FU);
+  input.IADScalingFactor = cons->scaleFactor;
+  input.minRadius = cons->minRadius;
+  input.minVolume = cons->vol_min * static_cast<double>(FU);
+  input.maxVolume = cons->vol_max * static_cast<double>(FU);
 
   input.maxAttempts = 10;
   input.verbosity = 'n';
@@ -1343,11 +1421,18 @@ Xtal* XtalOpt::randSpgXtal(uint generation, uint id, uint FU, uint spg,
   // but we will just check it with spglib
   input.forceMostGeneralWyckPos = false;
 
+  // The radii are taken from the context rather than the input
+  std::shared_ptr<RandSpgContext> context = randSpgContext();
+
   // Let's try this 3 times
   size_t numAttempts = 0;
   do {
     numAttempts++;
-    xtal = RandSpgXtalOptWrapper::randSpgXtal(input);
+    if (xtal) {
+      delete xtal;
+      xtal = nullptr;
+    }
+    xtal = RandSpgXtalOptWrapper::randSpgXtal(*context, input);
     // So that we don't crash the program, make sure the xtal exists
     // before attempting to get its spacegroup number
     if (xtal) {
@@ -1559,33 +1644,13 @@ Xtal* XtalOpt::generateRandomMolecularXtal(uint generation, uint id, uint FU,
     return nullptr;
   }
 
-  // Read the data
-  std::string sdfData{ std::istreambuf_iterator<char>(ifs),
-                       std::istreambuf_iterator<char>() };
-
-  // Use OBConvert to convert it to cml
-  QByteArray CMLData;
-  if (!GlobalSearch::OBConvert::convertFormat("sdf", "cml", sdfData.c_str(),
-                                              CMLData)) {
-    error(("XtalOpt::generateRandomMolecularXtal(): failed to convert the "
-           "SDF file " +
-           confFile + " to CML format with OBabel. Please "
-                      "make sure the file and the directory it is in are "
-                      "valid.")
-            .c_str());
-    return nullptr;
-  }
-
-  std::stringstream css(CMLData.data());
-
   // Now read it
   GlobalSearch::Structure conformer;
-  if (!GlobalSearch::CmlFormat::read(conformer, css)) {
-    error(("XtalOpt::generateRandomMolecularXtal(): failed to convert the "
-           "cml output from OBabel into a structure. Please make sure the "
-           "file," +
-           confFile + ", is valid, and that it is in a valid "
-                      "directory.")
+  if (!GlobalSearch::SdfFormat::read(conformer, ifs)) {
+    error(("XtalOpt::generateRandomMolecularXtal(): failed to read the "
+           "SDF file " +
+           confFile + ". Please make sure the file and the directory it is "
+                      "in are valid.")
             .c_str());
     return nullptr;
   }
@@ -1625,21 +1690,25 @@ Xtal* XtalOpt::generateRandomMolecularXtal(uint generation, uint id, uint FU,
 
 Xtal* XtalOpt::generateEmptyXtalWithLattice(uint FU)
 {
+  auto cons = constraints();
   Xtal* xtal = nullptr;
   do {
     delete xtal;
     xtal = nullptr;
-    double a = getRandDouble() * (a_max - a_min) + a_min;
-    double b = getRandDouble() * (b_max - b_min) + b_min;
-    double c = getRandDouble() * (c_max - c_min) + c_min;
-    double alpha = getRandDouble() * (alpha_max - alpha_min) + alpha_min;
-    double beta = getRandDouble() * (beta_max - beta_min) + beta_min;
-    double gamma = getRandDouble() * (gamma_max - gamma_min) + gamma_min;
+    double a = getRandDouble() * (cons->a_max - cons->a_min) + cons->a_min;
+    double b = getRandDouble() * (cons->b_max - cons->b_min) + cons->b_min;
+    double c = getRandDouble() * (cons->c_max - cons->c_min) + cons->c_min;
+    double alpha =
+      getRandDouble() * (cons->alpha_max - cons->alpha_min) + cons->alpha_min;
+    double beta =
+      getRandDouble() * (cons->beta_max - cons->beta_min) + cons->beta_min;
+    double gamma =
+      getRandDouble() * (cons->gamma_max - cons->gamma_min) + cons->gamma_min;
     xtal = new Xtal(a, b, c, alpha, beta, gamma);
   } while (!checkLattice(xtal, FU));
 
-  if (using_fixed_volume)
-    xtal->setVolume(vol_fixed * FU);
+  if (cons->using_fixed_volume)
+    xtal->setVolume(cons->vol_fixed * FU);
 
   return xtal;
 }
@@ -1653,6 +1722,8 @@ Xtal* XtalOpt::generateRandomXtal(uint generation, uint id, uint FU)
     return generateRandomMolecularXtal(generation, id, FU);
 #endif // ENABLE_MOLECULAR
 
+  auto cons = constraints();
+
   // Create a valid lattice first
   Xtal* xtal = generateEmptyXtalWithLattice(FU);
 
@@ -1666,13 +1737,13 @@ Xtal* XtalOpt::generateRandomXtal(uint generation, uint id, uint FU)
   xtal->setStatus(Xtal::Empty);
 
   // Populate crystal
-  QList<uint> atomicNums = comp.keys();
+  QList<uint> atomicNums = cons->comp.keys();
   // Sort atomic number by decreasing minimum radius. Adding the "larger"
   // atoms first encourages a more even (and ordered) distribution
   for (int i = 0; i < atomicNums.size() - 1; ++i) {
     for (int j = i + 1; j < atomicNums.size(); ++j) {
-      if (this->comp.value(atomicNums[i]).minRadius <
-          this->comp.value(atomicNums[j]).minRadius) {
+      if (cons->comp.value(atomicNums[i]).minRadius <
+          cons->comp.value(atomicNums[j]).minRadius) {
         atomicNums.swap(i, j);
       }
     }
@@ -1706,7 +1777,7 @@ Xtal* XtalOpt::generateRandomXtal(uint generation, uint id, uint FU)
       QPair<int, int> key = const_cast<QPair<int, int>&>(it.key());
       if (key.first == 0) {
         for (int i = 0; i < it->numCenters / divisions; i++) {
-          if (!xtal->addAtomRandomly(key.first, key.second, this->comp,
+          if (!xtal->addAtomRandomly(key.first, key.second, cons->comp,
                                      this->compMolUnit, true)) {
             xtal->deleteLater();
             debug("XtalOpt::generateRandomXtal: Failed to add atoms with "
@@ -1721,7 +1792,7 @@ Xtal* XtalOpt::generateRandomXtal(uint generation, uint id, uint FU)
       atomicNum = atomicNums.at(num_idx);
       if (atomicNum == 0)
         continue;
-      qTotal = comp.value(atomicNum).quantity * FU;
+      qTotal = cons->comp.value(atomicNum).quantity * FU;
 
       // Do we use the MolUnit builder?
       bool addAtom = true;
@@ -1767,7 +1838,7 @@ Xtal* XtalOpt::generateRandomXtal(uint generation, uint id, uint FU)
       // Initial atom placement
       for (uint i = 0; i < qRandPre; i++) {
         if (addAtom == true) {
-          if (!xtal->addAtomRandomly(atomicNum, this->comp)) {
+          if (!xtal->addAtomRandomly(atomicNum, cons->comp)) {
             xtal->deleteLater();
             debug("XtalOpt::generateRandomXtal: Failed to add atoms with "
                   "specified interatomic distance.");
@@ -1785,7 +1856,7 @@ Xtal* XtalOpt::generateRandomXtal(uint generation, uint id, uint FU)
           QPair<int, int> key = const_cast<QPair<int, int>&>(it.key());
           if (atomicNum == key.first) {
             for (int i = 0; i < it->numCenters / divisions; i++) {
-              if (!xtal->addAtomRandomly(atomicNum, key.second, this->comp,
+              if (!xtal->addAtomRandomly(atomicNum, key.second, cons->comp,
                                          this->compMolUnit, useMolUnit)) {
                 xtal->deleteLater();
                 debug("XtalOpt::generateRandomXtal: Failed to add atoms with "
@@ -1812,7 +1883,7 @@ Xtal* XtalOpt::generateRandomXtal(uint generation, uint id, uint FU)
     // Randomly place the left over atoms
     for (int num_idx = 0; num_idx < atomicNums.size(); num_idx++) {
       atomicNum = atomicNums.at(num_idx);
-      qTotal = (comp.value(atomicNum).quantity * FU);
+      qTotal = (cons->comp.value(atomicNum).quantity * FU);
 
       // Do we use the MolUnit builder?
       bool addAtom = true;
@@ -1859,7 +1930,7 @@ Xtal* XtalOpt::generateRandomXtal(uint generation, uint id, uint FU)
       // Initial atom placement
       for (uint i = 0; i < qRandPost; i++) {
         if (addAtom == true) {
-          if (!xtal->addAtomRandomly(atomicNum, this->comp)) {
+          if (!xtal->addAtomRandomly(atomicNum, cons->comp)) {
             xtal->deleteLater();
             debug("XtalOpt::generateRandomXtal: Failed to add atoms with "
                   "specified interatomic distance.");
@@ -1877,7 +1948,7 @@ Xtal* XtalOpt::generateRandomXtal(uint generation, uint id, uint FU)
           QPair<int, int> key = const_cast<QPair<int, int>&>(it.key());
           if (atomicNum == key.first) {
             for (int i = 0; i < it->numCenters % divisions; i++) {
-              if (!xtal->addAtomRandomly(atomicNum, key.second, this->comp,
+              if (!xtal->addAtomRandomly(atomicNum, key.second, cons->comp,
                                          this->compMolUnit, useMolUnit)) {
                 xtal->deleteLater();
                 debug("XtalOpt::generateRandomXtal: Failed to add atoms with "
@@ -1892,12 +1963,12 @@ Xtal* XtalOpt::generateRandomXtal(uint generation, uint id, uint FU)
 
     // Mitosis = False
   } else {
-    if (using_customIAD) {
+    if (cons->using_customIAD) {
       for (int num_idx = 0; num_idx < atomicNums.size(); num_idx++) {
         atomicNum = atomicNums.at(num_idx);
-        int q = comp.value(atomicNum).quantity * FU;
+        int q = cons->comp.value(atomicNum).quantity * FU;
         for (uint i = 0; i < q; i++) {
-          if (!xtal->addAtomRandomlyIAD(atomicNum, this->comp, this->interComp,
+          if (!xtal->addAtomRandomlyIAD(atomicNum, cons->comp, cons->interComp,
                                         1000)) {
             xtal->deleteLater();
             debug("XtalOpt::generateRandomXtal: Failed to add atoms with "
@@ -1915,7 +1986,7 @@ Xtal* XtalOpt::generateRandomXtal(uint generation, uint id, uint FU)
         QPair<int, int> key = const_cast<QPair<int, int>&>(it.key());
         if (key.first == 0) {
           for (int i = 0; i < it->numCenters; i++) {
-            if (!xtal->addAtomRandomly(key.first, key.second, this->comp,
+            if (!xtal->addAtomRandomly(key.first, key.second, cons->comp,
                                        this->compMolUnit, true)) {
               xtal->deleteLater();
               debug("XtalOpt::generateRandomXtal: Failed to add atoms with "
@@ -1929,7 +2000,7 @@ Xtal* XtalOpt::generateRandomXtal(uint generation, uint id, uint FU)
       for (int num_idx = 0; num_idx < atomicNums.size(); num_idx++) {
         // To avoid messing up the stoichiometry with the MolUnit builder
         atomicNum = atomicNums.at(num_idx);
-        qRand = comp.value(atomicNum).quantity * FU;
+        qRand = cons->comp.value(atomicNum).quantity * FU;
 
         if (atomicNum == 0)
           continue;
@@ -1973,7 +2044,7 @@ Xtal* XtalOpt::generateRandomXtal(uint generation, uint id, uint FU)
         // Initial atom placement
         for (uint i = 0; i < qRand; i++) {
           if (addAtom == true) {
-            if (!xtal->addAtomRandomly(atomicNum, this->comp)) {
+            if (!xtal->addAtomRandomly(atomicNum, cons->comp)) {
               xtal->deleteLater();
               debug("XtalOpt::generateRandomXtal: Failed to add atoms with "
                     "specified interatomic distance.");
@@ -1990,7 +2061,7 @@ Xtal* XtalOpt::generateRandomXtal(uint generation, uint id, uint FU)
             QPair<int, int> key = const_cast<QPair<int, int>&>(it.key());
             if (atomicNum == key.first) {
               for (int i = 0; i < it->numCenters; i++) {
-                if (!xtal->addAtomRandomly(atomicNum, key.second, this->comp,
+                if (!xtal->addAtomRandomly(atomicNum, key.second, cons->comp,
                                            this->compMolUnit, useMolUnit)) {
                   xtal->deleteLater();
                   debug("XtalOpt::generateRandomXtal: Failed to add atoms with "
@@ -2102,7 +2173,7 @@ void XtalOpt::printSubXtal(Xtal* xtal, uint generation, uint id)
 // without FU specified
 Xtal* XtalOpt::generateRandomXtal(uint generation, uint id)
 {
-  QList<uint> tempFormulaUnitsList = formulaUnitsList;
+  QList<uint> tempFormulaUnitsList = constraints()->formulaUnitsList;
   if (!molecularMode() && using_mitotic_growth && !using_one_pool) {
     // Remove formula units on the list for which there is a smaller multiple
     // that may be used to create a super cell.
@@ -2180,17 +2251,48 @@ void XtalOpt::initializeAndAddXtal(Xtal* xtal, uint generation,
 
 void XtalOpt::generateNewStructure()
 {
-  // Generate in background thread:
-  QtConcurrent::run(this, &XtalOpt::generateNewStructure_);
+  // Generate in background thread. This goes ahead of the candidates
+  // being generated for the buffer.
+  Executor::cpu().run([this]() { generateNewStructure_(); },
+                      Executor::HighPriority);
 }
 
 void XtalOpt::generateNewStructure_()
 {
-  Xtal* newXtal = generateNewXtal();
+  // Supercells and primitive cells that were found in the background go
+  // ahead of the buffered offspring.
+  Xtal* newXtal = generateSupercellOrPrimitiveXtal();
+  if (!newXtal)
+    newXtal = qobject_cast<Xtal*>(m_candidateBuffer.take());
+  if (!newXtal)
+    newXtal = generateOffspringXtal();
+  if (!newXtal) {
+    // Try again later rather than leaving the request unfilled. Back off
+    // so that a failure that keeps happening (e.g., constraints that
+    // nothing satisfies) does not keep a thread busy.
+    int failures = ++m_numGenerationFailures;
+    int seconds = std::min(1 << std::min(failures, 6), 60);
+    warning(tr("Failed to generate a new structure (%1 time(s) in a row). "
+               "Trying again in %2 seconds.")
+              .arg(failures)
+              .arg(seconds));
+    QMetaObject::invokeMethod(this, "retryGenerateNewStructure",
+                              Qt::QueuedConnection,
+                              Q_ARG(int, seconds * 1000));
+    return;
+  }
+  m_numGenerationFailures = 0;
   initializeAndAddXtal(newXtal, newXtal->getGeneration(),
                        newXtal->getParents());
 }
 
+void XtalOpt::retryGenerateNewStructure(int msecs)
+{
+  QTimer::singleShot(msecs, this, [this]() {
+    Executor::cpu().run([this]() { generateNewStructure_(); });
+  });
+}
+
 // Identical to the previous generateNewXtal() function except the number
 // formula units to use have been specified
 Xtal* XtalOpt::generateNewXtal(uint FU)
@@ -2311,116 +2413,221 @@ Xtal* XtalOpt::generateNewXtal(uint FU)
 // Overloaded function of generateNewXtal(uint FU)
 Xtal* XtalOpt::generateNewXtal()
 {
-  // Check to see if there are any structures that need to be primitive
-  // reduced or if there are supercells that needs to be generated. If
-  // there are, then generate and return one.
+  Xtal* xtal = generateSupercellOrPrimitiveXtal();
+  if (xtal)
+    return xtal;
+  return generateOffspringXtal();
+}
+
+Xtal* XtalOpt::generateSupercellOrPrimitiveXtal()
+{
+  // The primitive cells and supercells were found in the background by
+  // checkForSupercellsAndPrimitives_(). Just hand out the next one.
+  std::unique_lock<std::mutex> lock(m_derivedXtalsMutex);
+  if (m_derivedXtals.empty())
+    return nullptr;
+  Xtal* xtal = m_derivedXtals.front().xtal;
+  m_derivedXtals.pop_front();
+  return xtal;
+}
+
+void XtalOpt::checkForSupercellsAndPrimitives()
+{
+  if (isStarting || readOnly)
+    return;
+
+  Executor::cpu().run([this]() { checkForSupercellsAndPrimitives_(); });
+}
+
+void XtalOpt::checkForSupercellsAndPrimitives_()
+{
+  // Only run this function with one thread at a time. Structures that
+  // become ready while it runs are picked up by one more run.
+  std::unique_lock<std::mutex> checkLock(m_derivedCheckMutex,
+                                         std::defer_lock);
+  if (!checkLock.try_lock()) {
+    std::unique_lock<std::mutex> waitLock(m_derivedCheckWaitMutex,
+                                          std::defer_lock);
+    if (!waitLock.try_lock())
+      return;
+    else
+      checkLock.lock();
+  }
+
   QReadLocker trackerLocker(m_tracker->rwLock());
   QList<Structure*> optimizedStructures = m_queue->getAllOptimizedStructures();
-  if (supercellCheckLock.try_lock()) {
-    for (size_t i = 0; i < optimizedStructures.size(); i++) {
-      Xtal* testXtal = qobject_cast<Xtal*>(optimizedStructures.at(i));
-      QReadLocker testXtalLocker(&testXtal->lock());
-      // If the structure has been primitive checked, we don't need to check
-      // it again. If it hasn't been duplicate checked, yet, let it be
-      // duplicate checked first (so we don't check unnecessary structures).
-      if (!testXtal->wasPrimitiveChecked() &&
-          !testXtal->hasChangedSinceDupChecked()) {
-        // If testXtal is found to not be primitive, make a new xtal that is
-        // the primitive of testXtal.
-        if (!testXtal->isPrimitive(tol_spg)) {
-          testXtal->setPrimitiveChecked(true);
-          Xtal* nxtal = generatePrimitiveXtal(testXtal);
-          // This will continue the structure generation while simultaneously
-          // unlocking supercellCheckLock in 0.1 second
-          // This allows time for the structure to be finished before
-          // checking to see if another supercell could be generated
-          waitThenUnlockSupercellCheckLock();
-          return nxtal;
-        }
-        testXtal->setPrimitiveChecked(true);
-      }
 
-      // Now let's check to see if a supercell should be generated from
-      // the optimized structure
-      if (!testXtal->wasSupercellGenerationChecked()) {
-        // If the optimized structure's enthalpy is not the lowest enthalpy
-        // of it's formula unit set, set the supercell generation to be
-        // true and just continue to the next structure in the loop.
-        // For some reason, even though the datatypes are all doubles, it
-        // does not appear that we can do a direct comparison between the
-        // lowestEnthalpyFUList and the structure's enthalpy. So, we will
-        // just do a basic percent diff comparison instead. If the difference
-        // is less than 0.001%, then we will assume they are the same
-        uint FU = testXtal->getFormulaUnits();
-        double percentDiff =
-          fabs((testXtal->getEnthalpy() - lowestEnthalpyFUList.at(FU)) /
-               lowestEnthalpyFUList.at(FU) * 100.00000);
-        if (percentDiff > 0.001) {
-          testXtal->setSupercellGenerationChecked(true);
-          continue;
-        }
-        double enthalpyPerAtom1 =
-          testXtal->getEnthalpy() / static_cast<double>(testXtal->numAtoms());
-        uint numAtomsPerFU = testXtal->numAtoms() / testXtal->getFormulaUnits();
-        for (size_t j = 1; j <= maxFU(); j++) {
-          if (!onTheFormulaUnitsList(j))
-            continue;
-          // j represents a formula unit that is being checked.
-          // If optimizedStructures.at(i) can create a supercell with formula
-          // units of j and optimizedStructures.at(i)'s enthalpy/atom is
-          // smaller than the smallest so-far discovered enthalpy/atom at that
-          // FU, and if there is a difference greater than 3 meV/atom between
-          // the two, build a supercell and add it to the gene pool
-          double enthalpyPerAtom2 =
-            (lowestEnthalpyFUList.at(j) / static_cast<double>(j)) /
-            static_cast<double>(numAtomsPerFU);
-          if (j != testXtal->getFormulaUnits() &&
-              j % testXtal->getFormulaUnits() == 0 &&
-              (enthalpyPerAtom1 < enthalpyPerAtom2 || enthalpyPerAtom2 == 0)) {
-            // enthalpyDiff is in meV
-            double enthalpyDiff =
-              fabs(enthalpyPerAtom1 - enthalpyPerAtom2) * 1000.0000000;
-            if (enthalpyDiff <= 3.000000)
-              continue;
-            else {
-              // We may need to create more than one supercell from a given
-              // xtal, so only update this if it is generating an xtal with
-              // the maxFU
-              if (j == maxFU())
-                testXtal->setSupercellGenerationChecked(true);
-              Xtal* nxtal = generateSuperCell(testXtal->getFormulaUnits(), j,
-                                              testXtal, false);
-              nxtal->setParents(tr("Supercell generated from %1x%2")
-                                  .arg(testXtal->getGeneration())
-                                  .arg(testXtal->getIDNumber()));
-              // We only want to perform offspring tracking for mutated
-              // offspring.
-              nxtal->setParentStructure(nullptr);
-              nxtal->setEnthalpy(testXtal->getEnthalpy() *
-                                 nxtal->getFormulaUnits() /
-                                 testXtal->getFormulaUnits());
-              nxtal->setEnergy(testXtal->getEnergy() *
-                               nxtal->getFormulaUnits() /
-                               testXtal->getFormulaUnits());
-              nxtal->setPrimitiveChecked(true);
-              nxtal->setSkippedOptimization(true);
-              nxtal->setStatus(Xtal::Optimized);
-              // This will continue the structure generation while
-              // simultaneously unlocking supercellCheckLock in 0.1 second
-              // This allows time for the structure to be finished before
-              // checking to see if another supercell could be generated
-              waitThenUnlockSupercellCheckLock();
-              return nxtal;
-            }
-          }
-        }
-        testXtal->setSupercellGenerationChecked(true);
+  std::vector<DerivedXtal> derivedXtals;
+  for (size_t i = 0; i < optimizedStructures.size(); i++) {
+    Xtal* testXtal = qobject_cast<Xtal*>(optimizedStructures.at(i));
+    // The checked flags are set here, so this needs the write lock
+    QWriteLocker testXtalLocker(&testXtal->lock());
+    // If the structure has been primitive checked, we don't need to check
+    // it again. If it hasn't been duplicate checked, yet, let it be
+    // duplicate checked first (so we don't check unnecessary structures).
+    // The duplicate check runs this again when it is done.
+    bool isPrimitive = true;
+    if (!testXtal->wasPrimitiveChecked() &&
+        !testXtal->hasChangedSinceDupChecked()) {
+      isPrimitive = testXtal->isPrimitive(tol_spg);
+      testXtal->setPrimitiveChecked(true);
+    }
+
+    // Now let's check to see if supercells should be generated from
+    // the optimized structure
+    const bool checkSupercells = !testXtal->wasSupercellGenerationChecked();
+    testXtal->setSupercellGenerationChecked(true);
+    testXtalLocker.unlock();
+
+    // If testXtal is found to not be primitive, make a new xtal that is
+    // the primitive of testXtal.
+    if (!isPrimitive)
+      derivedXtals.push_back({ generatePrimitiveXtal(testXtal), testXtal });
+    if (checkSupercells) {
+      for (auto* xtal : generateDerivedSupercells(testXtal))
+        derivedXtals.push_back({ xtal, testXtal });
+    }
+  }
+  trackerLocker.unlock();
+
+  if (derivedXtals.empty())
+    return;
+
+  // They are added to the tracker in the queue thread. Move them there
+  // now, since only the thread that created them can do it.
+  for (const auto& derived : derivedXtals)
+    derived.xtal->moveToThread(m_queueThread);
+
+  std::unique_lock<std::mutex> lock(m_derivedXtalsMutex);
+  m_derivedXtals.insert(m_derivedXtals.end(), derivedXtals.begin(),
+                        derivedXtals.end());
+}
+
+void XtalOpt::clearDerivedXtals()
+{
+  std::deque<DerivedXtal> derivedXtals;
+  {
+    std::unique_lock<std::mutex> lock(m_derivedXtalsMutex);
+    derivedXtals.swap(m_derivedXtals);
+  }
+
+  if (derivedXtals.empty())
+    return;
+
+  // The structures they came from have been marked as checked. Check them
+  // again, so that nothing that is still wanted is lost.
+  QReadLocker trackerLocker(m_tracker->rwLock());
+  QSet<uint> supercellFUs;
+  for (const auto& derived : derivedXtals) {
+    if (!m_tracker->contains(derived.source)) {
+      delete derived.xtal;
+      continue;
+    }
+    QWriteLocker sourceLocker(&derived.source->lock());
+    if (derived.xtal->getFormulaUnits() > derived.source->getFormulaUnits())
+      supercellFUs.insert(derived.xtal->getFormulaUnits());
+    derived.source->setPrimitiveChecked(false);
+    derived.source->setSupercellGenerationChecked(false);
+    delete derived.xtal;
+  }
+
+  // Supercells counted towards the lowest enthalpy of their formula unit
+  // when they were queued. Take them back out, or they would never be
+  // generated again.
+  for (const auto& FU : supercellFUs) {
+    if (FU >= lowestEnthalpyFUList.size())
+      continue;
+    double lowest = 0.0;
+    for (auto* s : *m_tracker->list()) {
+      QReadLocker sLocker(&s->lock());
+      if (s->getStatus() != Structure::Optimized ||
+          s->getFormulaUnits() != FU) {
+        continue;
       }
+      if (lowest == 0.0 || s->getEnthalpy() < lowest)
+        lowest = s->getEnthalpy();
     }
-    supercellCheckLock.unlock();
+    lowestEnthalpyFUList[FU] = lowest;
   }
-  // Having finished doing primitive reduction and supercell generation
-  // checks, we can now continue!
+}
+
+QList<Xtal*> XtalOpt::generateDerivedSupercells(Xtal* testXtal)
+{
+  QList<Xtal*> ret;
+  QReadLocker testXtalLocker(&testXtal->lock());
+
+  // If the optimized structure's enthalpy is not the lowest enthalpy
+  // of it's formula unit set, there is nothing to do.
+  // For some reason, even though the datatypes are all doubles, it
+  // does not appear that we can do a direct comparison between the
+  // lowestEnthalpyFUList and the structure's enthalpy. So, we will
+  // just do a basic percent diff comparison instead. If the difference
+  // is less than 0.001%, then we will assume they are the same
+  uint FU = testXtal->getFormulaUnits();
+  if (FU >= lowestEnthalpyFUList.size())
+    return ret;
+  double percentDiff =
+    fabs((testXtal->getEnthalpy() - lowestEnthalpyFUList.at(FU)) /
+         lowestEnthalpyFUList.at(FU) * 100.00000);
+  if (percentDiff > 0.001)
+    return ret;
+
+  double enthalpyPerAtom1 =
+    testXtal->getEnthalpy() / static_cast<double>(testXtal->numAtoms());
+  uint numAtomsPerFU = testXtal->numAtoms() / testXtal->getFormulaUnits();
+  for (size_t j = 1; j <= maxFU(); j++) {
+    if (!onTheFormulaUnitsList(j) || j >= lowestEnthalpyFUList.size())
+      continue;
+    // j represents a formula unit that is being checked.
+    // If testXtal can create a supercell with formula units of j and
+    // testXtal's enthalpy/atom is smaller than the smallest so-far
+    // discovered enthalpy/atom at that FU, and if there is a difference
+    // greater than 3 meV/atom between the two, build a supercell and add
+    // it to the gene pool
+    double enthalpyPerAtom2 =
+      (lowestEnthalpyFUList.at(j) / static_cast<double>(j)) /
+      static_cast<double>(numAtomsPerFU);
+    if (j == testXtal->getFormulaUnits() ||
+        j % testXtal->getFormulaUnits() != 0 ||
+        (enthalpyPerAtom1 >= enthalpyPerAtom2 && enthalpyPerAtom2 != 0)) {
+      continue;
+    }
+
+    // enthalpyDiff is in meV
+    double enthalpyDiff =
+      fabs(enthalpyPerAtom1 - enthalpyPerAtom2) * 1000.0000000;
+    if (enthalpyDiff <= 3.000000)
+      continue;
+
+    testXtalLocker.unlock();
+    Xtal* nxtal =
+      generateSuperCell(testXtal->getFormulaUnits(), j, testXtal, false);
+    testXtalLocker.relock();
+    nxtal->setParents(tr("Supercell generated from %1x%2")
+                        .arg(testXtal->getGeneration())
+                        .arg(testXtal->getIDNumber()));
+    // We only want to perform offspring tracking for mutated
+    // offspring.
+    nxtal->setParentStructure(nullptr);
+    nxtal->setEnthalpy(testXtal->getEnthalpy() * nxtal->getFormulaUnits() /
+                       testXtal->getFormulaUnits());
+    nxtal->setEnergy(testXtal->getEnergy() * nxtal->getFormulaUnits() /
+                     testXtal->getFormulaUnits());
+    nxtal->setPrimitiveChecked(true);
+    nxtal->setSkippedOptimization(true);
+    nxtal->setStatus(Xtal::Optimized);
+
+    // Count the supercell as found now, so that no other structure
+    // generates one at this FU before it is added
+    updateLowestEnthalpyFUList_(nxtal);
+    ret.append(nxtal);
+  }
+  return ret;
+}
+
+Xtal* XtalOpt::generateOffspringXtal()
+{
+  QReadLocker trackerLocker(m_tracker->rwLock());
 
   // Inputing a formula unit of 0 implies using all formula units when
   // generating the probability list.
@@ -2438,13 +2645,43 @@ Xtal* XtalOpt::generateNewXtal()
   // No need to keep the tracker locked now
   trackerLocker.unlock();
 
+  // Offspring that are waiting in the buffer or are being generated will
+  // be added too, so count them as well. Otherwise, every candidate in the
+  // buffer gets the formula unit that currently has the fewest structures.
+  std::unique_lock<std::mutex> fuLock(m_offspringFUMutex);
+  m_candidateBuffer.forEach([&numberOfEachFormulaUnit](const Structure* s) {
+    uint fu = s->getFormulaUnits();
+    if (fu < static_cast<uint>(numberOfEachFormulaUnit.size()))
+      ++numberOfEachFormulaUnit[fu];
+  });
+  for (const auto& fu : m_offspringFUsInProgress) {
+    if (fu.first < static_cast<uint>(numberOfEachFormulaUnit.size()))
+      numberOfEachFormulaUnit[fu.first] += fu.second;
+  }
+
+  uint FU = pickFormulaUnitToGenerate(numberOfEachFormulaUnit);
+
+  // Reserve the formula unit while this offspring is being generated
+  ++m_offspringFUsInProgress[FU];
+  fuLock.unlock();
+
+  Xtal* xtal = generateNewXtal(FU);
+
+  fuLock.lock();
+  if (--m_offspringFUsInProgress[FU] == 0)
+    m_offspringFUsInProgress.erase(FU);
+
+  return xtal;
+}
+
+uint XtalOpt::pickFormulaUnitToGenerate(
+  const QList<uint>& numberOfEachFormulaUnit)
+{
   // If there are not yet at least 5 of any one FU, make more of that FU
   // Will generate smaller FU's first
   for (uint i = minFU(); i <= maxFU(); ++i) {
-    if ((numberOfEachFormulaUnit.at(i) < 5) && (onTheFormulaUnitsList(i))) {
-      uint FU = i;
-      return generateNewXtal(FU);
-    }
+    if ((numberOfEachFormulaUnit.at(i) < 5) && (onTheFormulaUnitsList(i)))
+      return i;
   }
 
   // Find the formula unit with the smallest number of total structures.
@@ -2459,7 +2696,7 @@ Xtal* XtalOpt::generateNewXtal()
   // Pick the formula unit with the smallest number of optimized structures. If
   // there are two or more formula units that have the smallest number of
   // optimized structures, pick the smallest
-  uint FU;
+  uint FU = minFU();
   for (uint i = minFU(); i <= maxFU(); i++) {
     if ((numberOfEachFormulaUnit.at(i) == smallest) &&
         (onTheFormulaUnitsList(i))) {
@@ -2468,7 +2705,7 @@ Xtal* XtalOpt::generateNewXtal()
     }
   }
 
-  return generateNewXtal(FU);
+  return FU;
 }
 
 // preselectedXtal is nullptr by default
@@ -2478,6 +2715,8 @@ Xtal* XtalOpt::H_getMutatedXtal(QList<Structure*>& structures, int FU,
                                 Xtal* preselectedXtal, bool includeCrossover,
                                 bool includeMitosis, bool mitosisMutation)
 {
+  auto cons = constraints();
+
   // Initialize loop vars
   double r;
   unsigned int gen;
@@ -2516,9 +2755,10 @@ Xtal* XtalOpt::H_getMutatedXtal(QList<Structure*>& structures, int FU,
     if (includeMitosis && using_one_pool) {
       // Find candidate formula units to be created through mitosis
       QList<uint> possibleMitosisFU_index;
-      for (int i = 0; i < formulaUnitsList.size(); i++) {
-        if (formulaUnitsList.at(i) % selectedXtal->getFormulaUnits() == 0 &&
-            formulaUnitsList.at(i) != selectedXtal->getFormulaUnits()) {
+      const uint selectedFU = selectedXtal->getFormulaUnits();
+      for (int i = 0; i < cons->formulaUnitsList.size(); i++) {
+        if (cons->formulaUnitsList.at(i) % selectedFU == 0 &&
+            cons->formulaUnitsList.at(i) != selectedFU) {
           possibleMitosisFU_index.append(i);
         }
       }
@@ -2531,7 +2771,7 @@ Xtal* XtalOpt::H_getMutatedXtal(QList<Structure*>& structures, int FU,
           uint randomListIndex = rand() % int(possibleMitosisFU_index.size());
           uint selectedIndex = possibleMitosisFU_index.at(randomListIndex);
           // Use that selected index to choose the formula units
-          uint formulaUnits = formulaUnitsList.at(selectedIndex);
+          uint formulaUnits = cons->formulaUnitsList.at(selectedIndex);
           // Perform mitosis
           Xtal* nxtal = nullptr;
           maxAttempts = 10000;
@@ -2607,7 +2847,7 @@ Xtal* XtalOpt::H_getMutatedXtal(QList<Structure*>& structures, int FU,
           // alternative crossover function
           // Only perform FU crossover if there is more than one formula unit
           bool enoughStructures = true;
-          if (using_FU_crossovers && formulaUnitsList.size() > 1) {
+          if (using_FU_crossovers && cons->formulaUnitsList.size() > 1) {
             // Get all optimized structures
             QList<Structure*> tempStructures =
               m_queue->getAllOptimizedStructures();
@@ -2634,7 +2874,7 @@ Xtal* XtalOpt::H_getMutatedXtal(QList<Structure*>& structures, int FU,
               // Perform operation
               xtal = XtalOptGenetic::FUcrossover(
                 xtal1, xtal2, cross_minimumContribution, percent1, percent2,
-                formulaUnitsList, this->comp);
+                cons->formulaUnitsList, cons->comp);
 
               if (!xtal)
                 continue;
@@ -2643,7 +2883,7 @@ Xtal* XtalOpt::H_getMutatedXtal(QList<Structure*>& structures, int FU,
 
           // Perform a regular crossover instead!
           if (!using_FU_crossovers || !enoughStructures ||
-              formulaUnitsList.size() <= 1) {
+              cons->formulaUnitsList.size() <= 1) {
             xtal1 = selectedXtal;
             xtal2 = selectXtalFromProbabilityList(structures,
                                                   xtal1->getFormulaUnits());
@@ -2813,16 +3053,17 @@ Xtal* XtalOpt::H_getMutatedXtal(QList<Structure*>& structures, int FU,
 
 Xtal* XtalOpt::generatePrimitiveXtal(Xtal* xtal)
 {
-  Xtal* nxtal = new Xtal();
-  // Copy cell over from xtal to nxtal
   QReadLocker xtalLocker(&xtal->lock());
-  nxtal->setCellInfo(xtal->unitCell().cellMatrix());
-  // Add the atoms in...
-  for (const auto& atom : xtal->atoms())
-    nxtal->addAtom(atom.atomicNumber(), atom.pos());
+  // This uses the symmetry analysis that isPrimitive() already ran
+  Xtal* nxtal = xtal->primitiveXtal(tol_spg);
+  if (!nxtal) {
+    // The reduction failed. Copy xtal as it is.
+    nxtal = new Xtal();
+    nxtal->setCellInfo(xtal->unitCell().cellMatrix());
+    for (const auto& atom : xtal->atoms())
+      nxtal->addAtom(atom.atomicNumber(), atom.pos());
+  }
 
-  // Reduce it to primitive...
-  nxtal->reduceToPrimitive(tol_spg);
   uint gen = xtal->getGeneration() + 1;
   QString parents = tr("Primitive of %1x%2")
                       .arg(xtal->getGeneration())
@@ -3010,8 +3251,17 @@ Xtal* XtalOpt::selectXtalFromProbabilityList(QList<Structure*> structures,
             "not be good.");
   }
 
+  FitnessEvaluator* fitnessEvaluator = nullptr;
+  if (m_fitnessEvaluator->hasActiveTerms())
+    fitnessEvaluator = m_fitnessEvaluator.get();
+
+  if (m_paretoSelection) {
+    return qobject_cast<Xtal*>(selectFromParetoFronts(
+      structures, popSize, hardnessWeight > 1.0e-5, fitnessEvaluator));
+  }
+
   QList<QPair<GlobalSearch::Structure*, double>> probs =
-    getProbabilityList(structures, popSize, hardnessWeight);
+    getProbabilityList(structures, popSize, hardnessWeight, fitnessEvaluator);
 
 #ifdef PROBS_DEBUG
   std::cout << "Sorted structures list with probs is as follows:\n";
@@ -3105,6 +3355,9 @@ bool XtalOpt::checkLimits()
 
 bool XtalOpt::checkComposition(Xtal* xtal, QString* err)
 {
+  auto cons = constraints();
+  const QHash<uint, XtalCompositionStruct>& comp = cons->comp;
+
   // Check composition
   QList<unsigned int> atomTypes = comp.keys();
   QList<unsigned int> atomCounts;
@@ -3133,15 +3386,15 @@ bool XtalOpt::checkComposition(Xtal* xtal, QString* err)
   // Check counts. Adjust for formula units.
   for (size_t i = 0; i < atomTypes.size(); ++i) {
     if (atomCounts[i] !=
-        comp[atomTypes[i]].quantity * xtal->getFormulaUnits()) { // PSA
+        comp.value(atomTypes[i]).quantity * xtal->getFormulaUnits()) { // PSA
       qDebug() << "atomCounts for atomic num " << QString::number(atomTypes[i])
                << "is" << QString::number(atomCounts[i]) << ". It should be "
-               << QString::number(comp[atomTypes[i]].quantity *
+               << QString::number(comp.value(atomTypes[i]).quantity *
                                   xtal->getFormulaUnits())
                << "instead.";
       qDebug() << "FU is " << QString::number(xtal->getFormulaUnits())
                << " and comp[atomTypes[i]].quantity is "
-               << QString::number(comp[atomTypes[i]].quantity);
+               << QString::number(comp.value(atomTypes[i]).quantity);
       // Incorrect count:
       qDebug() << "XtalOpt::checkXtal: Composition incorrect.";
       if (err != nullptr) {
@@ -3156,13 +3409,15 @@ bool XtalOpt::checkComposition(Xtal* xtal, QString* err)
 // Xtal should be write-locked before calling this function
 bool XtalOpt::checkLattice(Xtal* xtal, uint formulaUnits, QString* err)
 {
+  auto cons = constraints();
+
   // Adjust max and min constraints depending on the formula unit
-  new_vol_max = static_cast<double>(formulaUnits) * vol_max;
-  new_vol_min = static_cast<double>(formulaUnits) * vol_min;
+  const double new_vol_max = static_cast<double>(formulaUnits) * cons->vol_max;
+  const double new_vol_min = static_cast<double>(formulaUnits) * cons->vol_min;
 
   // Check volume
-  if (using_fixed_volume) {
-    xtal->setVolume(vol_fixed * static_cast<double>(formulaUnits));
+  if (cons->using_fixed_volume) {
+    xtal->setVolume(cons->vol_fixed * static_cast<double>(formulaUnits));
   } else if (xtal->getVolume() < new_vol_min || // PSA
              xtal->getVolume() > new_vol_max) { // PSA
     // I don't want to initialize a random number generator here, so
@@ -3186,18 +3441,18 @@ bool XtalOpt::checkLattice(Xtal* xtal, uint formulaUnits, QString* err)
   // Scale to any fixed parameters
   double a, b, c, alpha, beta, gamma;
   a = b = c = alpha = beta = gamma = 0;
-  if (fabs(a_min - a_max) < 0.01)
-    a = a_min;
-  if (fabs(b_min - b_max) < 0.01)
-    b = b_min;
-  if (fabs(c_min - c_max) < 0.01)
-    c = c_min;
-  if (fabs(alpha_min - alpha_max) < 0.01)
-    alpha = alpha_min;
-  if (fabs(beta_min - beta_max) < 0.01)
-    beta = beta_min;
-  if (fabs(gamma_min - gamma_max) < 0.01)
-    gamma = gamma_min;
+  if (fabs(cons->a_min - cons->a_max) < 0.01)
+    a = cons->a_min;
+  if (fabs(cons->b_min - cons->b_max) < 0.01)
+    b = cons->b_min;
+  if (fabs(cons->c_min - cons->c_max) < 0.01)
+    c = cons->c_min;
+  if (fabs(cons->alpha_min - cons->alpha_max) < 0.01)
+    alpha = cons->alpha_min;
+  if (fabs(cons->beta_min - cons->beta_max) < 0.01)
+    beta = cons->beta_min;
+  if (fabs(cons->gamma_min - cons->gamma_max) < 0.01)
+    gamma = cons->gamma_min;
   xtal->rescaleCell(a, b, c, alpha, beta, gamma);
 
   // Reject the structure if using VASP and the determinant of the
@@ -3264,27 +3519,28 @@ bool XtalOpt::checkLattice(Xtal* xtal, uint formulaUnits, QString* err)
   }
 
   // Check lattice
-  if ((!a && (xtal->getA() < a_min || xtal->getA() > a_max)) ||
-      (!b && (xtal->getB() < b_min || xtal->getB() > b_max)) ||
-      (!c && (xtal->getC() < c_min || xtal->getC() > c_max)) ||
-      (!alpha &&
-       (xtal->getAlpha() < alpha_min || xtal->getAlpha() > alpha_max)) ||
-      (!beta && (xtal->getBeta() < beta_min || xtal->getBeta() > beta_max)) ||
-      (!gamma &&
-       (xtal->getGamma() < gamma_min || xtal->getGamma() > gamma_max))) {
+  if ((!a && (xtal->getA() < cons->a_min || xtal->getA() > cons->a_max)) ||
+      (!b && (xtal->getB() < cons->b_min || xtal->getB() > cons->b_max)) ||
+      (!c && (xtal->getC() < cons->c_min || xtal->getC() > cons->c_max)) ||
+      (!alpha && (xtal->getAlpha() < cons->alpha_min ||
+                  xtal->getAlpha() > cons->alpha_max)) ||
+      (!beta && (xtal->getBeta() < cons->beta_min ||
+                 xtal->getBeta() > cons->beta_max)) ||
+      (!gamma && (xtal->getGamma() < cons->gamma_min ||
+                  xtal->getGamma() > cons->gamma_max))) {
     qDebug() << "Discarding structure -- Bad lattice:" << endl
-             << "A:     " << a_min << " " << xtal->getA() << " " << a_max
-             << endl
-             << "B:     " << b_min << " " << xtal->getB() << " " << b_max
-             << endl
-             << "C:     " << c_min << " " << xtal->getC() << " " << c_max
-             << endl
-             << "Alpha: " << alpha_min << " " << xtal->getAlpha() << " "
-             << alpha_max << endl
-             << "Beta:  " << beta_min << " " << xtal->getBeta() << " "
-             << beta_max << endl
-             << "Gamma: " << gamma_min << " " << xtal->getGamma() << " "
-             << gamma_max;
+             << "A:     " << cons->a_min << " " << xtal->getA() << " "
+             << cons->a_max << endl
+             << "B:     " << cons->b_min << " " << xtal->getB() << " "
+             << cons->b_max << endl
+             << "C:     " << cons->c_min << " " << xtal->getC() << " "
+             << cons->c_max << endl
+             << "Alpha: " << cons->alpha_min << " " << xtal->getAlpha() << " "
+             << cons->alpha_max << endl
+             << "Beta:  " << cons->beta_min << " " << xtal->getBeta() << " "
+             << cons->beta_max << endl
+             << "Gamma: " << cons->gamma_min << " " << xtal->getGamma() << " "
+             << cons->gamma_max;
     if (err != nullptr) {
       *err = "The unit cell parameters do not fall within the specified "
              "limits.";
@@ -3305,6 +3561,9 @@ bool XtalOpt::checkXtal(Xtal* xtal, QString* err)
     return false;
   }
 
+  // Use the same constraints for every check
+  auto cons = constraints();
+
   // Lock xtal
   QWriteLocker locker(&xtal->lock());
 
@@ -3342,14 +3601,14 @@ bool XtalOpt::checkXtal(Xtal* xtal, QString* err)
   }
 
   // Check interatomic distances
-  if (using_interatomicDistanceLimit && !molecularMode()) {
+  if (cons->using_interatomicDistanceLimit && !molecularMode()) {
     int atom1, atom2;
     double IAD;
-    if (!xtal->checkInteratomicDistances(this->comp, &atom1, &atom2, &IAD)) {
+    if (!xtal->checkInteratomicDistances(cons->comp, &atom1, &atom2, &IAD)) {
       Atom& a1 = xtal->atom(atom1);
       Atom& a2 = xtal->atom(atom2);
-      const double minIAD = this->comp.value(a1.atomicNumber()).minRadius +
-                            this->comp.value(a2.atomicNumber()).minRadius;
+      const double minIAD = cons->comp.value(a1.atomicNumber()).minRadius +
+                            cons->comp.value(a2.atomicNumber()).minRadius;
 
       qDebug() << "Discarding structure -- Bad IAD (" << IAD << " < " << minIAD
                << ")";
@@ -3360,14 +3619,14 @@ bool XtalOpt::checkXtal(Xtal* xtal, QString* err)
     }
   }
 
-  if (using_customIAD && !molecularMode()) {
+  if (cons->using_customIAD && !molecularMode()) {
     int atom1, atom2;
     double IAD;
-    if (!xtal->checkMinIAD(this->interComp, &atom1, &atom2, &IAD)) {
+    if (!xtal->checkMinIAD(cons->interComp, &atom1, &atom2, &IAD)) {
       Atom& a1 = xtal->atom(atom1);
       Atom& a2 = xtal->atom(atom2);
       const double minIAD =
-        this->interComp
+        cons->interComp
           .value(qMakePair<int, int>(a1.atomicNumber(), a2.atomicNumber()))
           .minIAD;
       xtal->setStatus(Xtal::Killed);
@@ -3420,35 +3679,60 @@ bool XtalOpt::checkIntermolecularIADs(const GlobalSearch::Molecule& mol1,
   return true;
 }
 
-bool XtalOpt::checkStepOptimizedStructure(Structure* s, QString* err)
+bool XtalOpt::checkCheckpoint(Structure* s, Structure* checkpoint,
+                              QString* err)
 {
+  if (!OptBase::checkCheckpoint(s, checkpoint, err))
+    return false;
 
   Xtal* xtal = qobject_cast<Xtal*>(s);
-  uint fixCount = xtal->getFixCount();
+  if (!xtal)
+    return true;
 
+  // Check the checkpoint geometry the same way as a new xtal
+  Xtal candidate;
+  {
+    QReadLocker locker(&xtal->lock());
+    candidate = *xtal;
+  }
+  candidate.setCellInfo(checkpoint->unitCell().cellMatrix());
+  candidate.setAtoms(checkpoint->atoms());
+  return checkXtal(&candidate, err);
+}
+
+bool XtalOpt::checkStepOptimizedStructure(Structure* s, QString* err)
+{
+  Xtal* xtal = qobject_cast<Xtal*>(s);
   if (xtal == NULL) {
     return true;
   }
 
+  uint fixCount = xtal->getFixCount();
+  auto cons = constraints();
+
   // Check post-opt
   if (using_checkStepOpt) {
-    if (using_customIAD) {
+    if (cons->using_customIAD) {
       int atom1, atom2;
       double IAD;
+      // Keep the distances up to date so that each fix only measures the
+      // atom that was moved
+      IADTracker tracker(*xtal, cons->interComp);
       for (int i = 0; i < 100; ++i) {
-        if (!xtal->checkMinIAD(this->interComp, &atom1, &atom2, &IAD)) {
+        if (!tracker.check(&atom1, &atom2, &IAD)) {
           Atom& a1 = xtal->atom(atom1);
           Atom& a2 = xtal->atom(atom2);
 
           if (fixCount < 10) {
             int atomicNumber = a2.atomicNumber();
             Atom* atom = &a2;
-            if (xtal->moveAtomRandomlyIAD(atomicNumber, this->comp,
-                                          this->interComp, 1000, atom)) {
+            if (xtal->moveAtomRandomlyIAD(atomicNumber, cons->comp,
+                                          cons->interComp, 1000, atom)) {
+              tracker.moveAtom(atom2, a2.pos());
               continue;
             } else {
               const double minIAD =
-                this->interComp
+                cons->interComp
                   .value(qMakePair<int, int>(a1.atomicNumber(), atomicNumber))
                   .minIAD;
               s->setStatus(Xtal::Killed);
@@ -3459,7 +3743,7 @@ bool XtalOpt::checkStepOptimizedStructure(Structure* s, QString* err)
               return false;
             }
           } else {
-            const double minIAD = this->interComp
+            const double minIAD = cons->interComp
                                     .value(qMakePair<int, int>(
                                       a1.atomicNumber(), a2.atomicNumber()))
                                     .minIAD;
@@ -3483,14 +3767,14 @@ bool XtalOpt::checkStepOptimizedStructure(Structure* s, QString* err)
       return true;
     }
 
-    if (using_interatomicDistanceLimit) {
+    if (cons->using_interatomicDistanceLimit) {
       int atom1, atom2;
       double IAD;
-      if (!xtal->checkInteratomicDistances(this->comp, &atom1, &atom2, &IAD)) {
+      if (!xtal->checkInteratomicDistances(cons->comp, &atom1, &atom2, &IAD)) {
         Atom& a1 = xtal->atom(atom1);
         Atom& a2 = xtal->atom(atom2);
-        const double minIAD = this->comp.value(a1.atomicNumber()).minRadius +
-                              this->comp.value(a2.atomicNumber()).minRadius;
+        const double minIAD = cons->comp.value(a1.atomicNumber()).minRadius +
+                              cons->comp.value(a2.atomicNumber()).minRadius;
 
         qDebug() << "Discarding structure -- Bad IAD (" << IAD << " < "
                  << minIAD << ")";
@@ -3743,6 +4027,12 @@ std::unique_ptr<GlobalSearch::QueueInterface> XtalOpt::createQueueInterface(
   if (caseInsensitiveCompare(queueName, "local"))
     return make_unique<LocalQueueInterface>(this);
 
+  if (caseInsensitiveCompare(queueName, "loadbalancing"))
+    return make_unique<LoadBalancingQueueInterface>(this);
+
+  if (caseInsensitiveCompare(queueName, "simulated"))
+    return make_unique<SimulatedQueueInterface>(this);
+
 #ifdef ENABLE_SSH
   if (caseInsensitiveCompare(queueName, "loadleveler"))
     return make_unique<LoadLevelerQueueInterface>(this);
@@ -3868,6 +4158,10 @@ bool XtalOpt::load(const QString& filename, const bool forceReadOnly)
     }
   }
 
+  // The other files of finished structures may have been packed into the
+  // archive
+  loadStructureArchive(dataPath);
+
   // Set filePath:
   QString newFilePath = dataPath;
   QString newFileBase = filename;
@@ -3941,9 +4235,6 @@ bool XtalOpt::load(const QString& filename, const bool forceReadOnly)
     // info. This sets current cell info, atom info, enthalpy, energy, & PV
     xtal->readSettings(xtalStateFileName, true);
 
-    // Reset it's space group
-    xtal->findSpaceGroup(tol_spg);
-
     // Store current state -- updateXtal will overwrite it.
     Xtal::State state = xtal->getStatus();
     // Set state from InProcess -> Restart if needed
@@ -4059,6 +4350,7 @@ bool XtalOpt::load(const QString& filename, const bool forceReadOnly)
     if (i == 0) {
       formulaUnitsList.clear();
       formulaUnitsList.append(xtal->getFormulaUnits());
+      publishConstraints();
       emit updateFormulaUnitsListUIText();
       emit updateVolumesToBePerFU(xtal->getFormulaUnits());
       error("Warning: an XtalOpt run from an older version is being "
@@ -4076,6 +4368,24 @@ bool XtalOpt::load(const QString& filename, const bool forceReadOnly)
     m_dialog->updateProgressLabel("Sorting and checking structures...");
   }
 
+  // Apply the events that happened after the state file was saved
+  const quint64 journalSequence =
+    settings->value("xtalopt/journalSequence", 0).toULongLong();
+  QList<Structure*> journaledStructures =
+    replayStructureJournal(dataPath, journalSequence, loadedStructures);
+  for (auto* s : journaledStructures) {
+    QWriteLocker locker(&s->lock());
+    if (restartInProcessStructures && s->getStatus() == Structure::InProcess)
+      s->setStatus(Structure::Restart);
+    if (clearJobIDs)
+      s->setJobID(0);
+    locker.unlock();
+    updateLowestEnthalpyFUList_(s);
+  }
+
+  // Reset their space groups
+  Xtal::findSpaceGroups(loadedStructures, tol_spg);
+
   // Sort Xtals by index values
   int curpos = 0;
   // dialog->stopProgressUpdate();
@@ -4118,6 +4428,7 @@ bool XtalOpt::load(const QString& filename, const bool forceReadOnly)
 
   // Reset the local file path information in case the files have moved
   filePath = newFilePath;
+  updateHardnessCacheFile();
 
   Structure* s = 0;
   emit disablePlotUpdate();
@@ -4187,6 +4498,10 @@ bool XtalOpt::plotDir(const QDir& dataDir)
     }
   }
 
+  // The other files of finished structures may have been packed into the
+  // archive
+  loadStructureArchive(dataDir.absolutePath());
+
   qDebug() << xtalDirs.size() << "xtals were found!";
 
   if (xtalDirs.isEmpty()) {
@@ -4210,9 +4525,6 @@ bool XtalOpt::plotDir(const QDir& dataDir)
     // info. This sets current cell info, atom info, enthalpy, energy, & PV
     xtal->readSettings(xtalStateFileName, true);
 
-    // Reset it's space group
-    xtal->findSpaceGroup(tol_spg);
-
     // Store current state -- updateXtal will overwrite it.
     Xtal::State state = xtal->getStatus();
     QDateTime endtime = xtal->getOptTimerEnd();
@@ -4271,6 +4583,9 @@ bool XtalOpt::plotDir(const QDir& dataDir)
     loadedStructures.append(qobject_cast<Structure*>(xtal));
   }
 
+  // Reset their space groups
+  Xtal::findSpaceGroups(loadedStructures, tol_spg);
+
   // Sort Xtals by index values
   int curpos = 0;
   for (int i = 0; i < loadedStructures.size(); i++) {
@@ -4309,11 +4624,7 @@ bool XtalOpt::plotDir(const QDir& dataDir)
 
 bool XtalOpt::onTheFormulaUnitsList(uint FU)
 {
-  for (int i = 0; i < formulaUnitsList.size(); i++) {
-    if (FU == formulaUnitsList.at(i))
-      return true;
-  }
-  return false;
+  return constraints()->formulaUnitsList.contains(FU);
 }
 
 void XtalOpt::resetSpacegroups()
@@ -4321,19 +4632,13 @@ void XtalOpt::resetSpacegroups()
   if (isStarting) {
     return;
   }
-  QtConcurrent::run(this, &XtalOpt::resetSpacegroups_);
+  Executor::maintenance().run([this]() { resetSpacegroups_(); });
 }
 
 void XtalOpt::resetSpacegroups_()
 {
   const QList<Structure*> structures = *(m_tracker->list());
-  for (QList<Structure *>::const_iterator it = structures.constBegin(),
-                                          it_end = structures.constEnd();
-       it != it_end; ++it) {
-    (*it)->lock().lockForWrite();
-    qobject_cast<Xtal*>(*it)->findSpaceGroup(tol_spg);
-    (*it)->lock().unlock();
-  }
+  Xtal::findSpaceGroups(structures, tol_spg);
 }
 
 void XtalOpt::resetDuplicates()
@@ -4341,11 +4646,15 @@ void XtalOpt::resetDuplicates()
   if (isStarting) {
     return;
   }
-  QtConcurrent::run(this, &XtalOpt::resetDuplicates_);
+  Executor::maintenance().run([this]() { resetDuplicates_(); });
 }
 
 void XtalOpt::resetDuplicates_()
 {
+  // The queued primitive cells and supercells were derived from the old
+  // statuses. They are found again after the duplicate check below.
+  clearDerivedXtals();
+
   const QList<Structure*>* structures = m_tracker->list();
   Xtal* xtal = 0;
   for (int i = 0; i < structures->size(); i++) {
@@ -4355,6 +4664,7 @@ void XtalOpt::resetDuplicates_()
     if (xtal->getStatus() == Xtal::Duplicate ||
         xtal->getStatus() == Xtal::Supercell) {
       xtal->setStatus(Xtal::Optimized);
+      journalStructure(xtal, StructureJournal::StatusChanged);
     }
     xtal->structureChanged(); // Reset cached comparisons
   }
@@ -4370,17 +4680,18 @@ struct dupCheckStruct
 
 // Helper Supercell Check Struct is defined in the header
 
-void checkIfDups(dupCheckStruct& st)
+// Returns the xtal that was marked as a duplicate, if any
+Xtal* checkIfDups(dupCheckStruct& st)
 {
   if (st.i == st.j)
-    return;
+    return nullptr;
   Xtal *kickXtal, *keepXtal;
   QReadLocker iLocker(&st.i->lock());
   QReadLocker jLocker(&st.j->lock());
   // if they are already both duplicates, just return.
   if (st.i->getStatus() == Xtal::Duplicate &&
       st.j->getStatus() == Xtal::Duplicate) {
-    return;
+    return nullptr;
   }
   if (st.i->compareCoordinates(*st.j, st.tol_len, st.tol_ang)) {
     // Mark the newest xtal as a duplicate of the oldest. This keeps the
@@ -4404,7 +4715,7 @@ void checkIfDups(dupCheckStruct& st)
     // If the kickXtal is already a duplicate, just return
     if (kickXtal->getStatus() == Xtal::Duplicate ||
         kickXtal->getStatus() == Xtal::Supercell) {
-      return;
+      return nullptr;
     }
     // Unlock the kickXtal and lock it for writing
     kickXtal == st.i ? iLocker.unlock() : jLocker.unlock();
@@ -4413,7 +4724,9 @@ void checkIfDups(dupCheckStruct& st)
     kickXtal->setDuplicateString(QString("%1x%2")
                                    .arg(keepXtal->getGeneration())
                                    .arg(keepXtal->getIDNumber()));
+    return kickXtal;
   }
+  return nullptr;
 }
 
 void XtalOpt::checkIfSups(supCheckStruct& st)
@@ -4471,6 +4784,7 @@ void XtalOpt::checkIfSups(supCheckStruct& st)
         QString("%1x%2")
           .arg(smallerFormulaUnitXtal->getGeneration())
           .arg(smallerFormulaUnitXtal->getIDNumber()));
+    journalStructure(largerFormulaUnitXtal, StructureJournal::DuplicateOf);
   }
   tempXtal->deleteLater();
 }
@@ -4480,7 +4794,7 @@ void XtalOpt::checkForDuplicates()
   if (isStarting)
     return;
 
-  QtConcurrent::run(this, &XtalOpt::checkForDuplicates_);
+  Executor::cpu().run([this]() { checkForDuplicates_(); });
 }
 
 void XtalOpt::checkForDuplicates_()
@@ -4559,8 +4873,13 @@ void XtalOpt::checkForDuplicates_()
     (*xi)->setChangedSinceDupChecked(false);
   }
 
-  for (auto& dupSt : dupSts)
-    checkIfDups(dupSt);
+  for (auto& dupSt : dupSts) {
+    Xtal* dup = checkIfDups(dupSt);
+    if (dup) {
+      QReadLocker dupLocker(&dup->lock());
+      journalStructure(dup, StructureJournal::DuplicateOf);
+    }
+  }
 
   // Tried to run this concurrently. Would freeze upon resuming for some
   // reason, though...
@@ -4596,18 +4915,27 @@ void XtalOpt::checkForDuplicates_()
                                          .arg(xtals.at(i)->getGeneration())
                                          .arg(xtals.at(i)->getIDNumber()));
           }
+          journalStructure(xtals[j], StructureJournal::DuplicateOf);
         }
       }
     }
   }
 
   emit refreshAllStructureInfo();
+
+  // The structures that were just checked may need a primitive reduction
+  checkForSupercellsAndPrimitives();
 }
 
 void XtalOpt::updateLowestEnthalpyFUList(GlobalSearch::Structure* s)
 {
-  // Perform this in a background thread
-  QtConcurrent::run(this, &XtalOpt::updateLowestEnthalpyFUList_, s);
+  // Perform this in a background thread. The supercells to generate
+  // depend on the lowest enthalpies, so look for them afterwards.
+  Executor::cpu().run([this, s]() {
+    updateLowestEnthalpyFUList_(s);
+    if (!isStarting && !readOnly)
+      checkForSupercellsAndPrimitives_();
+  });
 }
 
 void XtalOpt::updateLowestEnthalpyFUList_(GlobalSearch::Structure* s)
@@ -4622,37 +4950,45 @@ void XtalOpt::updateLowestEnthalpyFUList_(GlobalSearch::Structure* s)
   if (lowestEnthalpyFUList.at(s->getFormulaUnits()) == 0 ||
       lowestEnthalpyFUList.at(s->getFormulaUnits()) > s->getEnthalpy()) {
     lowestEnthalpyFUList[s->getFormulaUnits()] = s->getEnthalpy();
+    // A new best structure changes the parent selection too much for the
+    // buffered offspring to be representative
+    m_candidateBuffer.invalidate();
+  } else {
+    m_candidateBuffer.advance();
   }
 }
 
-void XtalOpt::setLatticeMinsAndMaxes(latticeStruct& latticeMins,
+void XtalOpt::setLatticeMinsAndMaxes(const XtalOptConstraints& cons,
+                                     latticeStruct& latticeMins,
                                      latticeStruct& latticeMaxes)
 {
-  latticeMins.a = a_min;
-  latticeMins.b = b_min;
-  latticeMins.c = c_min;
-  latticeMins.alpha = alpha_min;
-  latticeMins.beta = beta_min;
-  latticeMins.gamma = gamma_min;
-
-  latticeMaxes.a = a_max;
-  latticeMaxes.b = b_max;
-  latticeMaxes.c = c_max;
-  latticeMaxes.alpha = alpha_max;
-  latticeMaxes.beta = beta_max;
-  latticeMaxes.gamma = gamma_max;
+  latticeMins.a = cons.a_min;
+  latticeMins.b = cons.b_min;
+  latticeMins.c = cons.c_min;
+  latticeMins.alpha = cons.alpha_min;
+  latticeMins.beta = cons.beta_min;
+  latticeMins.gamma = cons.gamma_min;
+
+  latticeMaxes.a = cons.a_max;
+  latticeMaxes.b = cons.b_max;
+  latticeMaxes.c = cons.c_max;
+  latticeMaxes.alpha = cons.alpha_max;
+  latticeMaxes.beta = cons.beta_max;
+  latticeMaxes.gamma = cons.gamma_max;
 }
 
 QList<uint> XtalOpt::getListOfAtoms(uint FU)
 {
+  auto cons = constraints();
+
   // Populate crystal
-  QList<uint> atomicNums = comp.keys();
+  QList<uint> atomicNums = cons->comp.keys();
   // Sort atomic number by decreasing minimum radius. Adding the "larger"
   // atoms first encourages a more even (and ordered) distribution
   for (int i = 0; i < atomicNums.size() - 1; ++i) {
     for (int j = i + 1; j < atomicNums.size(); ++j) {
-      if (this->comp.value(atomicNums[i]).minRadius <
-          this->comp.value(atomicNums[j]).minRadius) {
+      if (cons->comp.value(atomicNums[i]).minRadius <
+          cons->comp.value(atomicNums[j]).minRadius) {
         atomicNums.swap(i, j);
       }
     }
@@ -4660,7 +4996,7 @@ QList<uint> XtalOpt::getListOfAtoms(uint FU)
 
   QList<uint> atoms;
   for (size_t i = 0; i < atomicNums.size(); i++) {
-    for (size_t j = 0; j < comp.value(atomicNums[i]).quantity * FU; j++) {
+    for (size_t j = 0; j < cons->comp.value(atomicNums[i]).quantity * FU; j++) {
       atoms.push_back(atomicNums[i]);
     }
   }
@@ -4672,6 +5008,64 @@ std::vector<uint> XtalOpt::getStdVecOfAtoms(uint FU)
   return getListOfAtoms(FU).toVector().toStdVector();
 }
 
+std::shared_ptr<RandSpgContext> XtalOpt::randSpgContext()
+{
+  auto cons = constraints();
+  std::unique_lock<std::mutex> lock(m_randSpgContextMutex);
+  if (!m_randSpgContext || m_randSpgContextScaleFactor != cons->scaleFactor ||
+      m_randSpgContextMinRadius != cons->minRadius) {
+    // XtalOpt uses covalent radii
+    m_randSpgContext =
+      std::make_shared<RandSpgContext>(cons->scaleFactor, cons->minRadius);
+    m_randSpgContextScaleFactor = cons->scaleFactor;
+    m_randSpgContextMinRadius = cons->minRadius;
+  }
+  return m_randSpgContext;
+}
+
+std::shared_ptr<const XtalOptConstraints> XtalOpt::constraints() const
+{
+  return std::atomic_load(&m_constraints);
+}
+
+void XtalOpt::publishConstraints()
+{
+  auto cons = std::make_shared<XtalOptConstraints>();
+  cons->a_min = a_min;
+  cons->a_max = a_max;
+  cons->b_min = b_min;
+  cons->b_max = b_max;
+  cons->c_min = c_min;
+  cons->c_max = c_max;
+  cons->alpha_min = alpha_min;
+  cons->alpha_max = alpha_max;
+  cons->beta_min = beta_min;
+  cons->beta_max = beta_max;
+  cons->gamma_min = gamma_min;
+  cons->gamma_max = gamma_max;
+  cons->vol_min = vol_min;
+  cons->vol_max = vol_max;
+  cons->vol_fixed = vol_fixed;
+  cons->scaleFactor = scaleFactor;
+  cons->minRadius = minRadius;
+  cons->using_fixed_volume = using_fixed_volume;
+  cons->using_interatomicDistanceLimit = using_interatomicDistanceLimit;
+  cons->using_customIAD = using_customIAD;
+  cons->formulaUnitsList = formulaUnitsList;
+  if (cons->formulaUnitsList.isEmpty())
+    cons->formulaUnitsList.append(1);
+  else
+    qSort(cons->formulaUnitsList);
+  cons->comp = comp;
+  cons->interComp = interComp;
+
+  std::atomic_store(&m_constraints,
+                    std::shared_ptr<const XtalOptConstraints>(std::move(cons)));
+
+  // The buffered offspring were checked against the old constraints
+  m_candidateBuffer.invalidate();
+}
+
 // minXtalsOfSpgPerFU should already be set up by now
 uint XtalOpt::pickRandomSpgFromPossibleOnes()
 {
@@ -4719,20 +5113,12 @@ void XtalOpt::updateProgressBar(size_t goal, size_t attempted, size_t succeeded)
 
 uint XtalOpt::minFU()
 {
-  if (formulaUnitsList.empty())
-    formulaUnitsList.append(1);
-  else
-    qSort(formulaUnitsList);
-  return formulaUnitsList[0];
+  return constraints()->formulaUnitsList.first();
 }
 
 uint XtalOpt::maxFU()
 {
-  if (formulaUnitsList.empty())
-    formulaUnitsList.append(1);
-  else
-    qSort(formulaUnitsList);
-  return formulaUnitsList[formulaUnitsList.size() - 1];
+  return constraints()->formulaUnitsList.last();
 }
 
 QString toString(bool b)
@@ -4955,6 +5341,13 @@ void XtalOpt::printOptionSettings(QTextStream& stream) const
     stream << "  hardnessFitnessWeight: " << m_hardnessFitnessWeight << "\n";
   }
 
+  if (m_fitnessEvaluator->hasActiveTerms()) {
+    stream << "  fitnessTermWeights: "
+           << m_fitnessEvaluator->weightsString().toStdString() << "\n";
+  }
+
+  stream << "  paretoSelection: " << toString(m_paretoSelection) << "\n";
+
   stream << "\n  usingMitoticGrowth: " << toString(using_mitotic_growth)
          << "\n";
   stream << "  usingFormulUnitCrossovers: " << toString(using_FU_crossovers)
@@ -5000,7 +5393,15 @@ void XtalOpt::printOptionSettings(QTextStream& stream) const
     } else {
       stream << "  queueInterface: " << queue->getIDString() << "\n";
 #ifdef ENABLE_SSH
-      if (queue->getIDString().toLower() != "local") {
+      const GlobalSearch::LoadBalancingQueueInterface* balancer =
+        qobject_cast<const GlobalSearch::LoadBalancingQueueInterface*>(queue);
+      if (balancer) {
+        anyRemote = anyRemote || balancer->hasRemoteBackends();
+        stream << "    backends:\n";
+        for (const auto& line :
+             balancer->statisticsString().split("\n", QString::SkipEmptyParts))
+          stream << "      " << line << "\n";
+      } else if (queue->getIDString().toLower() != "local") {
         anyRemote = true;
 
         const GlobalSearch::RemoteQueueInterface* remoteQueue =
@@ -5027,6 +5428,11 @@ void XtalOpt::printOptionSettings(QTextStream& stream) const
   stream << "\n  localQueueSettings: \n";
   stream << "  localWorkingDirectory: " << filePath << "\n";
   stream << "  logErrorDirectories: " << toString(m_logErrorDirs) << "\n";
+  stream << "  restartFromCheckpoint: " << toString(m_restartFromCheckpoint)
+         << "\n";
+  stream << "  archiveFinishedStructures: "
+         << toString(m_archiveFinishedStructures) << "\n";
+  stream << "  fullSaveInterval: " << m_fullSaveInterval << "\n";
 
   stream << "  autoCancelJobAfterTime: " << toString(m_cancelJobAfterTime)
          << "\n";
@@ -5069,5 +5475,6 @@ void XtalOpt::sendRpcUpdate(GlobalSearch::Structure* s)
 void XtalOpt::readRuntimeOptions()
 {
   XtalOptCLIOptions::readRuntimeOptions(*this);
+  publishConstraints();
 }
 } // end namespace XtalOpt
@@ -15,11 +15,16 @@
 #ifndef XTALOPT_H
 #define XTALOPT_H
 
+#include <globalsearch/candidatebuffer.h>
+#include <globalsearch/executor.h>
 #include <globalsearch/macros.h>
 #include <globalsearch/optbase.h>
 
 #include <QtConcurrent>
 
+#include <atomic>
+#include <deque>
+#include <map>
 #include <memory>
 #include <mutex>
 
@@ -30,6 +35,7 @@ static const double DEG_TO_RAD = 3.14159265358979323846 / 180.0;
 static const double RAD_TO_DEG = 180.0 / 3.14159265358979323846;
 
 // Forward declarations...
+class RandSpgContext;
 struct latticeStruct;
 
 namespace GlobalSearch {
@@ -95,6 +101,28 @@ static inline bool operator==(const XtalCompositionStruct& lhs,
     return false;
 }
 
+// The settings that generated structures are built from and that all
+// structures are checked against. A snapshot is not changed after it is
+// published with XtalOpt::publishConstraints(), so it may be read from any
+// thread while the settings are being edited.
+struct XtalOptConstraints
+{
+  double a_min, a_max, b_min, b_max, c_min, c_max;
+  double alpha_min, alpha_max, beta_min, beta_max, gamma_min, gamma_max;
+  // Volumes per formula unit
+  double vol_min, vol_max, vol_fixed;
+  double scaleFactor, minRadius;
+
+  bool using_fixed_volume;
+  bool using_interatomicDistanceLimit;
+  bool using_customIAD;
+
+  // Sorted and never empty
+  QList<uint> formulaUnitsList;
+  QHash<uint, XtalCompositionStruct> comp;
+  QHash<QPair<int, int>, IAD> interComp;
+};
+
 class XtalOpt : public GlobalSearch::OptBase
 {
   Q_OBJECT
@@ -170,6 +198,9 @@ public:
     GlobalSearch::Structure* s, const QString& reason = "") override;
   bool checkStepOptimizedStructure(GlobalSearch::Structure* s,
                                    QString* err = NULL) override;
+  bool checkCheckpoint(GlobalSearch::Structure* s,
+                       GlobalSearch::Structure* checkpoint,
+                       QString* err = NULL) override;
   bool checkLimits() override;
   bool checkComposition(Xtal* xtal, QString* err = nullptr);
   bool checkLattice(Xtal* xtal, uint formulaUnits, QString* err = nullptr);
@@ -244,8 +275,8 @@ public:
     b_min, b_max, c_min, c_max, new_a_min,
     new_a_max, // new_min and new_max are formula unit corrected
     new_b_min, new_b_max, new_c_min, new_c_max, alpha_min, alpha_max, beta_min,
-    beta_max, gamma_min, gamma_max, vol_min, vol_max, vol_fixed, new_vol_min,
-    new_vol_max, scaleFactor, minRadius;
+    beta_max, gamma_min, gamma_max, vol_min, vol_max, vol_fixed, scaleFactor,
+    minRadius;
 
   int divisions, // Number of divisions for mitosis
     ax,          // Number of divisions for cell vector 'a'
@@ -301,6 +332,15 @@ public slots:
   // Identical to generateNewXtal() except the number of formula units has been
   // specified already
   Xtal* generateNewXtal(uint FU);
+  // The first part of generateNewXtal(). Returns the next primitive cell
+  // or supercell found by checkForSupercellsAndPrimitives(), or nullptr.
+  Xtal* generateSupercellOrPrimitiveXtal();
+  // The rest of generateNewXtal(). Returns an offspring of the current
+  // parent pool, or a random xtal if the pool is too small.
+  Xtal* generateOffspringXtal();
+  // Picks the formula unit that the next offspring should have, given the
+  // number of structures of each formula unit
+  uint pickFormulaUnitToGenerate(const QList<uint>& numberOfEachFormulaUnit);
   // generateSuperCell() returns a dynamically allocated xtal.
   // The caller takes ownership of the pointer.
   // Generate a super cell with parentXtal being the parent
@@ -322,10 +362,26 @@ public slots:
   void resetSpacegroups();
   void resetDuplicates();
   void checkForDuplicates();
+  // Looks for optimized structures that need a primitive reduction or a
+  // supercell in a background thread.
+  void checkForSupercellsAndPrimitives();
   void updateLowestEnthalpyFUList(GlobalSearch::Structure* s);
   uint pickRandomSpgFromPossibleOnes();
 
-  QString CLIRuntimeFile()
+  // Returns the context used for RandSpg generation. It is rebuilt if the
+  // radius settings have changed since it was last built. It may be used
+  // from several threads at once.
+  std::shared_ptr<RandSpgContext> randSpgContext();
+
+  // The last published snapshot of the constraints. Generation and the
+  // structure checks read the constraints only through this.
+  std::shared_ptr<const XtalOptConstraints> constraints() const;
+
+  // Copies the lattice, volume, composition, IAD, and formula unit members
+  // into a new snapshot. This must be called after changing them.
+  void publishConstraints();
+
+  QString CLIRuntimeFile() const override
   {
     return filePath + QDir::separator() + "xtalopt-runtime-options.txt";
   }
@@ -345,7 +401,19 @@ protected:
   void resetSpacegroups_();
   void resetDuplicates_();
   void checkForDuplicates_();
+  // Checks every optimized structure that was not checked yet in one pass
+  // and queues the primitive cells and supercells it finds.
+  void checkForSupercellsAndPrimitives_();
+  // Deletes the queued primitive cells and supercells and lets the
+  // structures they came from be checked again.
+  void clearDerivedXtals();
+  // Returns the supercells of @p testXtal that should be added to the gene
+  // pool. @p testXtal must not be locked.
+  QList<Xtal*> generateDerivedSupercells(Xtal* testXtal);
   void generateNewStructure_();
+  // Runs generateNewStructure_() at normal priority after @p msecs
+  // milliseconds. Called in this object's thread when a generation fails.
+  Q_INVOKABLE void retryGenerateNewStructure(int msecs);
   void updateLowestEnthalpyFUList_(GlobalSearch::Structure* s);
   struct supCheckStruct
   {
@@ -360,23 +428,44 @@ protected:
   QString getTemplateKeywordHelp_xtalopt();
 
   GlobalSearch::SlottedWaitCondition* m_initWC;
-  // This lock is to prevent multiple threads from generating the same
-  // supercell in XtalOpt::generateNewXtal()
-  std::mutex supercellCheckLock;
-  // This creates a background thread that waits 0.1 seconds before unlocking
-  void waitThenUnlockSupercellCheckLock()
-  {
-    QtConcurrent::run(this, &XtalOpt::waitThenUnlockSupercellCheckLock_);
-  };
-  void waitThenUnlockSupercellCheckLock_()
+  // Primitive cells and supercells of optimized structures that are
+  // waiting to be added, each with the structure it was derived from. See
+  // checkForSupercellsAndPrimitives_().
+  struct DerivedXtal
   {
-    GS_MSLEEP(100);
-    supercellCheckLock.unlock();
+    Xtal* xtal;
+    Xtal* source;
   };
-
-  // Sets a_min, b_min, c_min, ... to the given lattice structs
-  void setLatticeMinsAndMaxes(latticeStruct& latticeMins,
-                              latticeStruct& latticeMaxes);
+  std::mutex m_derivedXtalsMutex;
+  std::deque<DerivedXtal> m_derivedXtals;
+  // Only one checkForSupercellsAndPrimitives_() runs at a time, and only
+  // one more waits for it
+  std::mutex m_derivedCheckMutex;
+  std::mutex m_derivedCheckWaitMutex;
+
+  // Offspring generated before they are needed. See generateNewStructure_().
+  GlobalSearch::CandidateBuffer m_candidateBuffer;
+  // The number of offspring of each formula unit that are being generated.
+  // See generateOffspringXtal().
+  std::map<uint, int> m_offspringFUsInProgress;
+  std::mutex m_offspringFUMutex;
+  // The number of generateNewStructure_() calls in a row that failed
+  std::atomic<int> m_numGenerationFailures;
+
+  // Memoizes the RandSpg combinatorics and holds the radii used by RandSpg.
+  // See randSpgContext().
+  std::shared_ptr<RandSpgContext> m_randSpgContext;
+  double m_randSpgContextScaleFactor;
+  double m_randSpgContextMinRadius;
+  std::mutex m_randSpgContextMutex;
+
+  // See constraints(). Only accessed with std::atomic_load/atomic_store.
+  std::shared_ptr<const XtalOptConstraints> m_constraints;
+
+  // Sets the lattice structs to the limits in @p c
+  static void setLatticeMinsAndMaxes(const XtalOptConstraints& c,
+                                     latticeStruct& latticeMins,
+                                     latticeStruct& latticeMaxes);
   void updateProgressBar(size_t goal, size_t attempted, size_t succeeded);
 
   static void setGeom(unsigned int& geom, QString strGeom);
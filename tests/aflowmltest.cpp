@@ -0,0 +1,244 @@
+/**********************************************************************
+  AflowMLTest - Test the AflowML client against a local stand-in server
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ **********************************************************************/
+
+#include <globalsearch/http/aflowml.h>
+
+#include <QNetworkAccessManager>
+#include <QSignalSpy>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <memory>
+
+// A tiny http server that acts like the Aflow ML API. Every job reports
+// "PENDING" once and then "SUCCESS".
+class AflowStandIn : public QTcpServer
+{
+  Q_OBJECT
+public:
+  AflowStandIn() : m_numPosts(0), m_numGets(0)
+  {
+    connect(this, &QTcpServer::newConnection, this,
+            &AflowStandIn::handleConnection);
+  }
+
+  int m_numPosts;
+  int m_numGets;
+
+private slots:
+  void handleConnection()
+  {
+    while (hasPendingConnections()) {
+      QTcpSocket* socket = nextPendingConnection();
+      connect(socket, &QTcpSocket::readyRead, this, &AflowStandIn::handleRead);
+      connect(socket, &QTcpSocket::disconnected, socket,
+              &QTcpSocket::deleteLater);
+    }
+  }
+
+  void handleRead()
+  {
+    QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+    QByteArray& buffer = m_buffers[socket];
+    buffer += socket->readAll();
+
+    // Wait for the whole request
+    int headerEnd = buffer.indexOf("\r\n\r\n");
+    if (headerEnd < 0)
+      return;
+
+    QByteArray header = buffer.left(headerEnd).toLower();
+    int contentLength = 0;
+    int lengthInd = header.indexOf("content-length:");
+    if (lengthInd >= 0) {
+      int lineEnd = header.indexOf("\r\n", lengthInd);
+      contentLength =
+        header.mid(lengthInd + 15, lineEnd - lengthInd - 15).trimmed().toInt();
+    }
+    if (buffer.size() < headerEnd + 4 + contentLength)
+      return;
+
+    QByteArray requestLine = buffer.left(buffer.indexOf("\r\n"));
+    buffer.clear();
+
+    QByteArray body;
+    if (requestLine.startsWith("POST")) {
+      ++m_numPosts;
+      body = "{\"id\": \"job" + QByteArray::number(m_numPosts) + "\"}";
+    } else {
+      ++m_numGets;
+      QByteArray id = requestLine.split(' ')[1].split('/').last();
+      if (!m_checked.contains(id)) {
+        m_checked.insert(id);
+        body = "{\"status\": \"PENDING\"}";
+      } else {
+        body = "{\"status\": \"SUCCESS\", "
+               "\"ml_ael_bulk_modulus_vrh\": \"200.0\", "
+               "\"ml_ael_shear_modulus_vrh\": \"100.0\"}";
+      }
+    }
+
+    socket->write("HTTP/1.1 200 OK\r\n"
+                  "Content-Type: application/json\r\n"
+                  "Content-Length: " +
+                  QByteArray::number(body.size()) + "\r\n\r\n" + body);
+  }
+
+private:
+  QMap<QTcpSocket*, QByteArray> m_buffers;
+  QSet<QByteArray> m_checked;
+};
+
+class AflowMLTest : public QObject
+{
+  Q_OBJECT
+
+private:
+  std::unique_ptr<AflowStandIn> m_server;
+  std::shared_ptr<QNetworkAccessManager> m_networkManager;
+  QTemporaryDir m_tmpDir;
+
+  QUrl serverUrl() const
+  {
+    return QUrl("http://127.0.0.1:" + QString::number(m_server->serverPort()) +
+                "/API/aflow-ml/v1.0/");
+  }
+
+  static QString poscar(const QString& name, double x)
+  {
+    return name + "\n1.0\n"
+                  "3.0 0.0 0.0\n0.0 3.0 0.0\n0.0 0.0 3.0\n"
+                  "Si\n1\nDirect\n" +
+           QString::number(x) + " 0.0 0.0\n";
+  }
+
+private slots:
+  /**
+   * Called before the first test function is executed.
+   */
+  void initTestCase();
+
+  /**
+   * Called after the last test function is executed.
+   */
+  void cleanupTestCase();
+
+  /**
+   * Called before each test function is executed.
+   */
+  void init();
+
+  /**
+   * Called after every test function.
+   */
+  void cleanup();
+
+  // Tests
+  void poscarKey();
+  void deduplicateInFlight();
+  void persistentCache();
+};
+
+void AflowMLTest::initTestCase()
+{
+  m_networkManager = std::make_shared<QNetworkAccessManager>();
+  QVERIFY(m_tmpDir.isValid());
+}
+
+void AflowMLTest::cleanupTestCase()
+{
+}
+
+void AflowMLTest::init()
+{
+  m_server.reset(new AflowStandIn);
+  QVERIFY(m_server->listen(QHostAddress::LocalHost));
+}
+
+void AflowMLTest::cleanup()
+{
+  m_server.reset();
+}
+
+void AflowMLTest::poscarKey()
+{
+  // The comment line should not matter
+  QCOMPARE(AflowML::poscarKey(poscar("1x1", 0.0)),
+           AflowML::poscarKey(poscar("2x5", 0.0)));
+  QVERIFY(AflowML::poscarKey(poscar("1x1", 0.0)) !=
+          AflowML::poscarKey(poscar("1x1", 0.5)));
+}
+
+void AflowMLTest::deduplicateInFlight()
+{
+  AflowML aflowML(m_networkManager);
+  aflowML.setServerUrl(serverUrl());
+  QSignalSpy spy(&aflowML, SIGNAL(received(size_t)));
+
+  // Two of these have the same geometry
+  QStringList poscars;
+  poscars << poscar("1x1", 0.0) << poscar("1x2", 0.0) << poscar("1x3", 0.5);
+  std::vector<size_t> inds = aflowML.submitPoscars(poscars);
+  QCOMPARE(inds.size(), static_cast<size_t>(3));
+  QCOMPARE(aflowML.numInFlight(), static_cast<size_t>(2));
+
+  QTRY_COMPARE_WITH_TIMEOUT(spy.count(), 3, 30000);
+
+  // Only one post per distinct geometry
+  QCOMPARE(m_server->m_numPosts, 2);
+  QCOMPARE(aflowML.numInFlight(), static_cast<size_t>(0));
+
+  for (const auto& ind : inds) {
+    QVERIFY(aflowML.containsData(ind));
+    QCOMPARE(aflowML.data(ind)["ml_ael_shear_modulus_vrh"],
+             std::string("100.0"));
+  }
+}
+
+void AflowMLTest::persistentCache()
+{
+  QString cacheFile = m_tmpDir.path() + "/aflowml-cache.jsonl";
+
+  {
+    AflowML aflowML(m_networkManager);
+    aflowML.setServerUrl(serverUrl());
+    aflowML.setCacheFileName(cacheFile);
+    QSignalSpy spy(&aflowML, SIGNAL(received(size_t)));
+
+    aflowML.submitPoscar(poscar("1x1", 0.25));
+    QTRY_COMPARE_WITH_TIMEOUT(spy.count(), 1, 30000);
+    QCOMPARE(aflowML.cacheSize(), static_cast<size_t>(1));
+  }
+
+  int numPosts = m_server->m_numPosts;
+
+  // A new instance should read the result from the file and never ask the
+  // server
+  AflowML aflowML(m_networkManager);
+  aflowML.setServerUrl(serverUrl());
+  aflowML.setCacheFileName(cacheFile);
+  QCOMPARE(aflowML.cacheSize(), static_cast<size_t>(1));
+
+  QSignalSpy spy(&aflowML, SIGNAL(received(size_t)));
+  size_t ind = aflowML.submitPoscar(poscar("3x7", 0.25));
+  QTRY_COMPARE_WITH_TIMEOUT(spy.count(), 1, 5000);
+  QCOMPARE(m_server->m_numPosts, numPosts);
+  QCOMPARE(aflowML.data(ind)["ml_ael_bulk_modulus_vrh"], std::string("200.0"));
+}
+
+QTEST_MAIN(AflowMLTest)
+
+#include "aflowmltest.moc"
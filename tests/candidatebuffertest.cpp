@@ -0,0 +1,242 @@
+/**********************************************************************
+  CandidateBufferTest - Test the buffer of pre-generated structures
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ **********************************************************************/
+
+#include <globalsearch/candidatebuffer.h>
+#include <globalsearch/structure.h>
+
+#include <QCoreApplication>
+#include <QtTest>
+
+#include <atomic>
+#include <chrono>
+#include <set>
+#include <thread>
+
+using GlobalSearch::CandidateBuffer;
+using GlobalSearch::Executor;
+using GlobalSearch::Structure;
+
+class CandidateBufferTest : public QObject
+{
+  Q_OBJECT
+
+private:
+  Executor m_executor;
+  std::atomic_int m_numProduced;
+
+  CandidateBuffer::Producer producer()
+  {
+    return [this]() -> Structure* {
+      ++m_numProduced;
+      Structure* s = new Structure;
+      s->moveToThread(QCoreApplication::instance()->thread());
+      return s;
+    };
+  }
+
+public:
+  CandidateBufferTest() : m_executor("test", 2), m_numProduced(0) {}
+
+private slots:
+  /**
+   * Called before the first test function is executed.
+   */
+  void initTestCase();
+
+  /**
+   * Called after the last test function is executed.
+   */
+  void cleanupTestCase();
+
+  /**
+   * Called before each test function is executed.
+   */
+  void init();
+
+  /**
+   * Called after every test function.
+   */
+  void cleanup();
+
+  // Tests
+  void fillOnDemand();
+  void aging();
+  void invalidate();
+  void stop();
+  void forEach();
+  void maxProducers();
+};
+
+void CandidateBufferTest::initTestCase()
+{
+}
+
+void CandidateBufferTest::cleanupTestCase()
+{
+}
+
+void CandidateBufferTest::init()
+{
+  m_numProduced = 0;
+}
+
+void CandidateBufferTest::cleanup()
+{
+}
+
+void CandidateBufferTest::fillOnDemand()
+{
+  CandidateBuffer buffer(m_executor);
+  buffer.setProducer(producer());
+  buffer.setCapacity(3);
+
+  // Nothing is made before the first request
+  QTest::qWait(50);
+  QCOMPARE(m_numProduced.load(), 0);
+
+  QVERIFY(buffer.take() == nullptr);
+  QCOMPARE(buffer.numMisses(), static_cast<size_t>(1));
+  QTRY_COMPARE(buffer.size(), static_cast<size_t>(3));
+
+  Structure* s = buffer.take();
+  QVERIFY(s != nullptr);
+  QCOMPARE(buffer.numHits(), static_cast<size_t>(1));
+  delete s;
+
+  // The taken candidate is replaced, but no more than that
+  QTRY_COMPARE(buffer.size(), static_cast<size_t>(3));
+  QTest::qWait(50);
+  QCOMPARE(m_numProduced.load(), 4);
+}
+
+void CandidateBufferTest::aging()
+{
+  CandidateBuffer buffer(m_executor);
+  buffer.setProducer(producer());
+  buffer.setCapacity(2);
+  buffer.setMaxAge(2);
+
+  buffer.refill();
+  QTRY_COMPARE(buffer.size(), static_cast<size_t>(2));
+
+  // Still fresh
+  buffer.advance(2);
+  QCOMPARE(buffer.numDiscarded(), static_cast<size_t>(0));
+
+  // Too old. They are replaced by new ones.
+  buffer.advance();
+  QCOMPARE(buffer.numDiscarded(), static_cast<size_t>(2));
+  QTRY_COMPARE(buffer.size(), static_cast<size_t>(2));
+  QCOMPARE(m_numProduced.load(), 4);
+}
+
+void CandidateBufferTest::invalidate()
+{
+  CandidateBuffer buffer(m_executor);
+  buffer.setProducer(producer());
+  buffer.setCapacity(2);
+
+  buffer.refill();
+  QTRY_COMPARE(buffer.size(), static_cast<size_t>(2));
+
+  buffer.invalidate();
+  QCOMPARE(buffer.numDiscarded(), static_cast<size_t>(2));
+  QTRY_COMPARE(buffer.size(), static_cast<size_t>(2));
+}
+
+void CandidateBufferTest::stop()
+{
+  CandidateBuffer buffer(m_executor);
+  buffer.setProducer(producer());
+  buffer.setCapacity(2);
+
+  buffer.refill();
+  buffer.stop();
+  QCOMPARE(buffer.size(), static_cast<size_t>(0));
+  QCOMPARE(buffer.numPending(), static_cast<size_t>(0));
+
+  // Advancing a stopped buffer does not start it again
+  buffer.advance();
+  QTest::qWait(50);
+  QCOMPARE(buffer.size(), static_cast<size_t>(0));
+}
+
+void CandidateBufferTest::forEach()
+{
+  CandidateBuffer buffer(m_executor);
+  buffer.setProducer(producer());
+  buffer.setCapacity(3);
+
+  size_t count = 0;
+  buffer.forEach([&count](const Structure*) { ++count; });
+  QCOMPARE(count, static_cast<size_t>(0));
+
+  buffer.take();
+  QTRY_COMPARE(buffer.size(), static_cast<size_t>(3));
+
+  // Every waiting candidate is visited once
+  std::set<const Structure*> visited;
+  buffer.forEach([&visited](const Structure* s) { visited.insert(s); });
+  QCOMPARE(visited.size(), static_cast<size_t>(3));
+
+  // The candidate handed out was one of them, and stop() leaves none
+  Structure* s = buffer.take();
+  QVERIFY(s != nullptr);
+  QVERIFY(visited.count(s) == 1);
+  buffer.stop();
+  count = 0;
+  buffer.forEach([&count](const Structure*) { ++count; });
+  QCOMPARE(count, static_cast<size_t>(0));
+  delete s;
+}
+
+void CandidateBufferTest::maxProducers()
+{
+  // Slow producers that keep track of how many run at once
+  std::atomic_int running(0);
+  std::atomic_int maxRunning(0);
+  CandidateBuffer buffer(m_executor);
+  buffer.setProducer([this, &running, &maxRunning]() -> Structure* {
+    int n = ++running;
+    int max = maxRunning.load();
+    while (n > max && !maxRunning.compare_exchange_weak(max, n)) {
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    --running;
+    ++m_numProduced;
+    Structure* s = new Structure;
+    s->moveToThread(QCoreApplication::instance()->thread());
+    return s;
+  });
+  buffer.setCapacity(4);
+  QCOMPARE(buffer.maxProducers(), static_cast<size_t>(1));
+
+  // One thread is left for other work while the buffer fills
+  buffer.refill();
+  QTest::qWait(10);
+  QCOMPARE(buffer.numPending(), static_cast<size_t>(1));
+  std::atomic_bool ran(false);
+  m_executor.run([&ran]() { ran = true; }, Executor::HighPriority);
+  QTRY_VERIFY_WITH_TIMEOUT(ran.load(), 100);
+
+  // The held back producers are started as the others finish
+  QTRY_COMPARE(buffer.size(), static_cast<size_t>(4));
+  QCOMPARE(maxRunning.load(), 1);
+  QCOMPARE(m_numProduced.load(), 4);
+  buffer.stop();
+}
+
+QTEST_MAIN(CandidateBufferTest)
+
+#include "candidatebuffertest.moc"
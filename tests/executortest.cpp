@@ -0,0 +1,207 @@
+/**********************************************************************
+  ExecutorTest - Test the bounded executors
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ **********************************************************************/
+
+#include <globalsearch/executor.h>
+
+#include <QtTest>
+
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using GlobalSearch::Executor;
+
+class ExecutorTest : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  /**
+   * Called before the first test function is executed.
+   */
+  void initTestCase();
+
+  /**
+   * Called after the last test function is executed.
+   */
+  void cleanupTestCase();
+
+  /**
+   * Called before each test function is executed.
+   */
+  void init();
+
+  /**
+   * Called after every test function.
+   */
+  void cleanup();
+
+  // Tests
+  void submit();
+  void priorities();
+  void separateExecutors();
+  void exceptions();
+  void submitFromWorker();
+};
+
+void ExecutorTest::initTestCase()
+{
+}
+
+void ExecutorTest::cleanupTestCase()
+{
+}
+
+void ExecutorTest::init()
+{
+}
+
+void ExecutorTest::cleanup()
+{
+}
+
+void ExecutorTest::submit()
+{
+  Executor executor("test", 2);
+  std::future<int> future = executor.submit([]() { return 42; });
+  QCOMPARE(future.get(), 42);
+  QVERIFY(executor.waitForDone(5000));
+  QCOMPARE(executor.numCompleted(), static_cast<size_t>(1));
+  QCOMPARE(executor.queueDepth(), 0);
+  QCOMPARE(executor.activeCount(), 0);
+}
+
+void ExecutorTest::priorities()
+{
+  Executor executor("test", 1);
+
+  // Block the only thread so that the next tasks have to wait
+  std::promise<void> release;
+  std::shared_future<void> released = release.get_future().share();
+  executor.run([released]() { released.wait(); });
+  QTRY_COMPARE(executor.activeCount(), 1);
+
+  std::mutex orderMutex;
+  std::vector<int> order;
+  auto record = [&](int i) {
+    std::lock_guard<std::mutex> lock(orderMutex);
+    order.push_back(i);
+  };
+  executor.run([&]() { record(0); }, Executor::LowPriority);
+  executor.run([&]() { record(1); }, Executor::NormalPriority);
+  executor.run([&]() { record(2); }, Executor::HighPriority);
+
+  QCOMPARE(executor.queueDepth(), 3);
+  QCOMPARE(executor.maxQueueDepth(), 3);
+
+  release.set_value();
+  QVERIFY(executor.waitForDone(5000));
+
+  std::vector<int> expected{ 2, 1, 0 };
+  QVERIFY(order == expected);
+  QCOMPARE(executor.queueDepth(), 0);
+  QCOMPARE(executor.numCompleted(), static_cast<size_t>(4));
+
+  executor.resetMetrics();
+  QCOMPARE(executor.maxQueueDepth(), 0);
+  QCOMPARE(executor.numCompleted(), static_cast<size_t>(0));
+}
+
+void ExecutorTest::separateExecutors()
+{
+  // Filling up the I/O executor with blocked tasks must not keep the CPU
+  // executor from running
+  Executor& io = Executor::io();
+  io.setMaxThreadCount(2);
+
+  std::promise<void> release;
+  std::shared_future<void> released = release.get_future().share();
+  for (int i = 0; i < 4; ++i)
+    io.run([released]() { released.wait(); });
+
+  QTRY_COMPARE(io.activeCount(), 2);
+  QCOMPARE(io.queueDepth(), 2);
+
+  std::future<bool> ran = Executor::cpu().submit([]() { return true; });
+  QVERIFY(ran.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+  QVERIFY(ran.get());
+
+  release.set_value();
+  QVERIFY(io.waitForDone(5000));
+}
+
+void ExecutorTest::exceptions()
+{
+  Executor executor("test", 1);
+
+  // The exception reaches the future
+  std::future<int> future =
+    executor.submit([]() -> int { throw std::runtime_error("submit"); });
+  QVERIFY(future.wait_for(std::chrono::seconds(5)) ==
+          std::future_status::ready);
+  bool caught = false;
+  try {
+    future.get();
+  } catch (const std::runtime_error& e) {
+    caught = (std::string(e.what()) == "submit");
+  }
+  QVERIFY(caught);
+
+  // A task without a future that throws does not take the executor down
+  executor.run([]() { throw std::runtime_error("run"); });
+  std::future<bool> after = executor.submit([]() { return true; });
+  QVERIFY(after.wait_for(std::chrono::seconds(5)) ==
+          std::future_status::ready);
+  QVERIFY(after.get());
+
+  QVERIFY(executor.waitForDone(5000));
+  QCOMPARE(executor.numCompleted(), static_cast<size_t>(3));
+  QCOMPARE(executor.queueDepth(), 0);
+  QCOMPARE(executor.activeCount(), 0);
+}
+
+void ExecutorTest::submitFromWorker()
+{
+  // With one thread, a task that waits on a task it submitted would wait
+  // forever if the inner task were queued
+  Executor executor("test", 1);
+  QVERIFY(!executor.isWorkerThread());
+
+  std::future<int> outer = executor.submit([&executor]() {
+    if (!executor.isWorkerThread())
+      return -1;
+    return executor.submit([]() { return 42; }).get();
+  });
+  QVERIFY(outer.wait_for(std::chrono::seconds(5)) ==
+          std::future_status::ready);
+  QCOMPARE(outer.get(), 42);
+
+  // Another executor's tasks are still queued
+  Executor other("other", 1);
+  std::future<bool> onOther = executor.submit([&other]() {
+    return other.submit([&other]() { return other.isWorkerThread(); }).get();
+  });
+  QVERIFY(onOther.wait_for(std::chrono::seconds(5)) ==
+          std::future_status::ready);
+  QVERIFY(onOther.get());
+
+  QVERIFY(executor.waitForDone(5000));
+  QVERIFY(other.waitForDone(5000));
+}
+
+QTEST_MAIN(ExecutorTest)
+
+#include "executortest.moc"
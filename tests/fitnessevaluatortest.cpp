@@ -0,0 +1,306 @@
+/**********************************************************************
+  FitnessEvaluatorTest - Test the fitness terms, their evaluation and
+                         caching, and how they enter the probability list
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ **********************************************************************/
+
+#include <globalsearch/eleminfo.h>
+#include <globalsearch/fitness/densityterm.h>
+#include <globalsearch/fitness/fitnessevaluator.h>
+#include <globalsearch/fitness/pairpotentialterm.h>
+#include <globalsearch/optbase.h>
+#include <globalsearch/structure.h>
+#include <globalsearch/utilities/makeunique.h>
+
+#include <QtTest>
+
+#include <atomic>
+#include <cmath>
+
+using namespace GlobalSearch;
+
+// Counts how many structures it has evaluated. The value is the x
+// coordinate of the first atom.
+class CountingTerm : public FitnessTerm
+{
+public:
+  explicit CountingTerm(std::atomic<int>* count) : m_count(count) {}
+
+  std::string name() const override { return "counting"; }
+  bool higherIsBetter() const override { return false; }
+
+  using FitnessTerm::evaluate;
+  double evaluate(const Molecule& mol) const override
+  {
+    ++*m_count;
+    return mol.atom(0).pos().x();
+  }
+
+private:
+  std::atomic<int>* m_count;
+};
+
+class FitnessEvaluatorTest : public QObject
+{
+  Q_OBJECT
+
+private:
+  // A cubic cell with one carbon atom
+  static Structure* makeCarbon(double a, double enthalpy)
+  {
+    Structure* s = new Structure;
+    s->setUnitCell(UnitCell(a, a, a, 90.0, 90.0, 90.0));
+    s->addAtom(6, Vector3(0.0, 0.0, 0.0));
+    s->setEnthalpy(enthalpy);
+    return s;
+  }
+
+  // Checks that a probability list is cumulative and ends at 1
+  static void verifyCumulative(const QList<QPair<Structure*, double>>& probs)
+  {
+    double last = 0.0;
+    for (const auto& prob : probs) {
+      QVERIFY(std::isfinite(prob.second));
+      QVERIFY(prob.second >= last - 1.0e-12);
+      last = prob.second;
+    }
+    QVERIFY(fabs(last - 1.0) < 1.0e-8);
+  }
+
+private slots:
+  /**
+   * Called before the first test function is executed.
+   */
+  void initTestCase();
+
+  /**
+   * Called after the last test function is executed.
+   */
+  void cleanupTestCase();
+
+  /**
+   * Called before each test function is executed.
+   */
+  void init();
+
+  /**
+   * Called after every test function.
+   */
+  void cleanup();
+
+  // Tests
+  void densityTerm();
+  void pairPotentialTerm();
+  void weights();
+  void cache();
+  void probabilityListWeights();
+  void probabilityListZeroSpread();
+};
+
+void FitnessEvaluatorTest::initTestCase()
+{
+}
+
+void FitnessEvaluatorTest::cleanupTestCase()
+{
+}
+
+void FitnessEvaluatorTest::init()
+{
+}
+
+void FitnessEvaluatorTest::cleanup()
+{
+}
+
+void FitnessEvaluatorTest::densityTerm()
+{
+  DensityTerm term;
+  QCOMPARE(term.name(), std::string("density"));
+  QVERIFY(term.higherIsBetter());
+
+  std::unique_ptr<Structure> s(makeCarbon(2.0, 0.0));
+  double ref = 1.66053904 * ElemInfo::getAtomicMass(6) / 8.0;
+  QVERIFY(fabs(term.evaluate(*s) - ref) < 1.0e-8);
+
+  // Without a cell the density is not defined
+  Molecule mol;
+  mol.addAtom(6, Vector3(0.0, 0.0, 0.0));
+  QCOMPARE(term.evaluate(mol), 0.0);
+}
+
+void FitnessEvaluatorTest::pairPotentialTerm()
+{
+  PairPotentialTerm term;
+  QCOMPARE(term.name(), std::string("pairPotential"));
+  QVERIFY(!term.higherIsBetter());
+
+  Molecule mol;
+  QCOMPARE(term.evaluate(mol), 0.0);
+
+  // Two atoms at the minimum of the potential have an energy of -1, which
+  // is -0.5 per atom
+  double rMin = 2.0 * ElemInfo::getCovalentRadius(6);
+  mol.addAtom(6, Vector3(0.0, 0.0, 0.0));
+  mol.addAtom(6, Vector3(rMin, 0.0, 0.0));
+  QVERIFY(fabs(term.evaluate(mol) + 0.5) < 1.0e-8);
+
+  // Pushing them together raises the energy
+  mol.atom(1).setPos(Vector3(0.8 * rMin, 0.0, 0.0));
+  QVERIFY(term.evaluate(mol) > -0.5);
+
+  // The batch evaluation matches the single one
+  std::vector<const Molecule*> batch = { &mol, &mol };
+  std::vector<double> values = term.evaluate(batch);
+  QCOMPARE(values.size(), static_cast<size_t>(2));
+  QCOMPARE(values[0], term.evaluate(mol));
+  QCOMPARE(values[1], values[0]);
+}
+
+void FitnessEvaluatorTest::weights()
+{
+  FitnessEvaluator evaluator;
+  QCOMPARE(evaluator.numTerms(), static_cast<size_t>(2));
+  QVERIFY(!evaluator.hasActiveTerms());
+
+  QVERIFY(evaluator.setWeight("density", 0.25));
+  QVERIFY(!evaluator.setWeight("density", -0.25));
+  QVERIFY(!evaluator.setWeight("density", std::nan("")));
+  QVERIFY(!evaluator.setWeight("unknown", 0.25));
+  QCOMPARE(evaluator.weight("density"), 0.25);
+  QVERIFY(evaluator.hasActiveTerms());
+
+  QVERIFY(evaluator.setWeightsFromString("pairPotential:0.5, density:0.1"));
+  QCOMPARE(evaluator.weight("density"), 0.1);
+  QCOMPARE(evaluator.weight("pairPotential"), 0.5);
+  QVERIFY(fabs(evaluator.totalWeight() - 0.6) < 1.0e-12);
+  QCOMPARE(evaluator.weightsString(),
+           QString("density:0.1, pairPotential:0.5"));
+
+  // Invalid strings leave the weights unchanged
+  QVERIFY(!evaluator.setWeightsFromString("unknown:0.5"));
+  QVERIFY(!evaluator.setWeightsFromString("density:-1"));
+  QVERIFY(!evaluator.setWeightsFromString("density"));
+  QCOMPARE(evaluator.weight("density"), 0.1);
+
+  // Terms that are not listed get a weight of zero
+  QVERIFY(evaluator.setWeightsFromString("density:0.3"));
+  QCOMPARE(evaluator.weight("pairPotential"), 0.0);
+}
+
+void FitnessEvaluatorTest::cache()
+{
+  std::atomic<int> count(0);
+  FitnessEvaluator evaluator;
+  evaluator.addTerm(make_unique<CountingTerm>(&count), 0.5);
+
+  QList<Structure*> structures;
+  for (int i = 0; i < 4; ++i) {
+    structures.append(makeCarbon(3.0, 0.0));
+    structures.back()->atom(0).setPos(Vector3(i, 0.0, 0.0));
+    structures.back()->setIDNumber(i + 1);
+  }
+
+  auto terms = evaluator.evaluate(structures);
+  QCOMPARE(terms.size(), static_cast<size_t>(1));
+  QCOMPARE(terms[0].name, std::string("counting"));
+  QCOMPARE(terms[0].values.size(), static_cast<size_t>(4));
+  QCOMPARE(terms[0].values[2], 2.0);
+  QCOMPARE(count.load(), 4);
+  QCOMPARE(evaluator.cacheSize(), static_cast<size_t>(4));
+
+  // Nothing changed, so everything comes from the cache
+  terms = evaluator.evaluate(structures);
+  QCOMPARE(terms[0].values[3], 3.0);
+  QCOMPARE(count.load(), 4);
+
+  // A changed geometry is evaluated again
+  structures[1]->atom(0).setPos(Vector3(5.0, 0.0, 0.0));
+  terms = evaluator.evaluate(structures);
+  QCOMPARE(terms[0].values[1], 5.0);
+  QCOMPARE(count.load(), 5);
+
+  // So is a different structure at the same address
+  structures[2]->setIDNumber(10);
+  evaluator.evaluate(structures);
+  QCOMPARE(count.load(), 6);
+
+  // Structures that are no longer given are dropped
+  QList<Structure*> subset = { structures[0], structures[3] };
+  evaluator.evaluate(subset);
+  QCOMPARE(count.load(), 6);
+  QCOMPARE(evaluator.cacheSize(), static_cast<size_t>(2));
+
+  // Without active terms, nothing is evaluated or cached
+  QVERIFY(evaluator.setWeight("counting", 0.0));
+  QVERIFY(evaluator.evaluate(structures).empty());
+  QCOMPARE(evaluator.cacheSize(), static_cast<size_t>(0));
+
+  qDeleteAll(structures);
+}
+
+void FitnessEvaluatorTest::probabilityListWeights()
+{
+  // The smallest cell is the densest and has the highest enthalpy
+  QList<Structure*> structures;
+  for (int i = 0; i < 5; ++i)
+    structures.append(makeCarbon(2.0 + i, -static_cast<double>(i)));
+
+  // The weights sum to more than 1, so they are scaled down and the
+  // probabilities stay positive
+  FitnessEvaluator evaluator;
+  QVERIFY(evaluator.setWeight("density", 1.0));
+  auto probs = OptBase::getProbabilityList(structures, structures.size(),
+                                           0.5, &evaluator);
+  QCOMPARE(probs.size(), structures.size());
+  verifyCumulative(probs);
+  QVERIFY(probs.first().second >= 0.0);
+
+  // Only density is considered, so the densest structure is the most
+  // likely one
+  QCOMPARE(probs.last().first, structures.first());
+
+  qDeleteAll(structures);
+}
+
+void FitnessEvaluatorTest::probabilityListZeroSpread()
+{
+  // Every enthalpy is the same, but the densities differ
+  QList<Structure*> structures;
+  for (int i = 0; i < 5; ++i)
+    structures.append(makeCarbon(2.0 + i, 1.0));
+
+  FitnessEvaluator evaluator;
+  QVERIFY(evaluator.setWeight("density", 0.5));
+  auto probs = OptBase::getProbabilityList(structures, structures.size(),
+                                           0.0, &evaluator);
+  QCOMPARE(probs.size(), structures.size());
+  verifyCumulative(probs);
+  QCOMPARE(probs.last().first, structures.first());
+
+  // With no spread in anything, every structure is equally likely
+  for (auto* s : structures)
+    s->setUnitCell(UnitCell(3.0, 3.0, 3.0, 90.0, 90.0, 90.0));
+  probs = OptBase::getProbabilityList(structures, structures.size(), 0.0,
+                                      &evaluator);
+  QCOMPARE(probs.size(), structures.size());
+  for (int i = 0; i < probs.size(); ++i) {
+    QVERIFY(std::isfinite(probs[i].second));
+    QVERIFY(fabs(probs[i].second - i / 5.0) < 1.0e-8);
+  }
+
+  qDeleteAll(structures);
+}
+
+QTEST_MAIN(FitnessEvaluatorTest)
+
+#include "fitnessevaluatortest.moc"
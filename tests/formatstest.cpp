@@ -12,10 +12,12 @@
   limitations under the License.
  **********************************************************************/
 
+#include <globalsearch/formats/cifformat.h>
 #include <globalsearch/formats/cmlformat.h>
 #include <globalsearch/formats/formats.h>
 #include <globalsearch/formats/obconvert.h>
 #include <globalsearch/formats/poscarformat.h>
+#include <globalsearch/formats/sdfformat.h>
 #include <globalsearch/formats/zmatrixformat.h>
 #include <globalsearch/structure.h>
 
@@ -61,6 +63,10 @@ private slots:
   void writePoscar();
   void readCml();
   void writeCml();
+  void readCif();
+  void writeCif();
+  void readSdf();
+  void writeSdf();
   void OBConvert();
   void ZMatrixEntryGenerator();
   void writeSiestaZMatrix();
@@ -285,6 +291,148 @@ void FormatsTest::writeCml()
   QVERIFY(numDoubleBonds == 4);
 }
 
+void FormatsTest::readCif()
+{
+  /**** Diamond ****/
+  QString diamondFileName =
+    QString(TESTDATADIR) + "/data/diamond-primitive.cif";
+  GlobalSearch::Structure diamond;
+  QVERIFY(GlobalSearch::Formats::read(&diamond, diamondFileName));
+
+  QVERIFY(diamond.hasUnitCell());
+  QVERIFY(diamond.numAtoms() == 2);
+  QVERIFY(std::fabs(diamond.unitCell().a() - 2.5221) < 1.e-5);
+  QVERIFY(std::fabs(diamond.unitCell().alpha() - 60.0) < 1.e-5);
+  QVERIFY(diamond.atom(0).atomicNumber() == 6);
+  QVERIFY(GlobalSearch::fuzzyCompare(
+    diamond.unitCell().toFractional(diamond.atom(0).pos()),
+    Vector3(0.75, 0.75, 0.75), 1.e-5));
+
+  /**** Rutile from its asymmetric unit ****/
+  std::stringstream ss;
+  ss << "data_rutile\n"
+     << "_cell_length_a 4.5937(3)\n"
+     << "_cell_length_b 4.5937\n"
+     << "_cell_length_c 2.9587\n"
+     << "_cell_angle_alpha 90\n"
+     << "_cell_angle_beta 90\n"
+     << "_cell_angle_gamma 90\n"
+     << "_symmetry_space_group_name_H-M 'P 42/m n m'\n"
+     << "loop_\n"
+     << "_symmetry_equiv_pos_as_xyz\n"
+     << "'x, y, z'\n'-x, -y, z'\n"
+     << "'-y+1/2, x+1/2, z+1/2'\n'y+1/2, -x+1/2, z+1/2'\n"
+     << "'-x+1/2, y+1/2, -z+1/2'\n'x+1/2, -y+1/2, -z+1/2'\n"
+     << "'y, x, -z'\n'-y, -x, -z'\n"
+     << "'-x, -y, -z'\n'x, y, -z'\n"
+     << "'y+1/2, -x+1/2, -z+1/2'\n'-y+1/2, x+1/2, -z+1/2'\n"
+     << "'x+1/2, -y+1/2, z+1/2'\n'-x+1/2, y+1/2, z+1/2'\n"
+     << "'-y, -x, z'\n'y, x, z'\n"
+     << "loop_\n"
+     << "_atom_site_label\n"
+     << "_atom_site_fract_x\n"
+     << "_atom_site_fract_y\n"
+     << "_atom_site_fract_z\n"
+     << "Ti1 0.0 0.0 0.0\n"
+     << "O1 0.3053 0.3053 0.0 # comment\n";
+
+  GlobalSearch::Structure rutile;
+  QVERIFY(GlobalSearch::CifFormat::read(rutile, ss));
+  QVERIFY(rutile.numAtoms() == 6);
+  size_t numTi = 0;
+  for (const auto& atom : rutile.atoms()) {
+    if (atom.atomicNumber() == 22)
+      ++numTi;
+  }
+  QVERIFY(numTi == 2);
+  QVERIFY(GlobalSearch::fuzzyCompare(
+    rutile.unitCell().toFractional(rutile.atom(1).pos()),
+    Vector3(0.5, 0.5, 0.5), 1.e-5));
+}
+
+void FormatsTest::writeCif()
+{
+  std::stringstream ss;
+  QVERIFY(GlobalSearch::CifFormat::write(m_rutile, ss));
+
+  GlobalSearch::Structure rutile;
+  QVERIFY(GlobalSearch::CifFormat::read(rutile, ss));
+
+  QVERIFY(rutile.hasUnitCell());
+  QVERIFY(rutile.numAtoms() == 6);
+  QVERIFY(abs(62.4233 - rutile.unitCell().volume()) < 1.e-4);
+  for (size_t i = 0; i < rutile.numAtoms(); ++i) {
+    QVERIFY(rutile.atom(i).atomicNumber() == m_rutile.atom(i).atomicNumber());
+    QVERIFY(GlobalSearch::fuzzyCompare(rutile.atom(i).pos(),
+                                       m_rutile.atom(i).pos(), 1.e-4));
+  }
+
+  // A structure without a cell cannot be written
+  QVERIFY(!GlobalSearch::CifFormat::write(m_caffeine, ss));
+}
+
+void FormatsTest::readSdf()
+{
+  /**** Caffeine ****/
+  QString caffeineFileName =
+    QString(TESTDATADIR) + "/data/caffeine-mmff94.sdf";
+  GlobalSearch::Structure caffeine;
+  QVERIFY(GlobalSearch::Formats::read(&caffeine, caffeineFileName));
+
+  // Our structure should have no unit cell, 24 atoms, and 25 bonds
+  QVERIFY(!caffeine.hasUnitCell());
+  QVERIFY(caffeine.numAtoms() == 24);
+  QVERIFY(caffeine.numBonds() == 25);
+
+  // Caffeine should also have 4 double bonds. Make sure of this.
+  size_t numDoubleBonds = 0;
+  for (const GlobalSearch::Bond& bond : caffeine.bonds()) {
+    if (bond.bondOrder() == 2)
+      ++numDoubleBonds;
+  }
+  QVERIFY(numDoubleBonds == 4);
+
+  // The energy and enthalpy are read the same way as with Open Babel
+  QVERIFY(caffeine.hasEnthalpy());
+  QVERIFY(std::fabs(caffeine.getEnthalpy() - -122.350) < 1.e-5);
+  QVERIFY(std::fabs(caffeine.getEnergy() - -122.351) < 1.e-5);
+
+  QVERIFY(caffeine.atom(0).atomicNumber() == 7);
+  QVERIFY(GlobalSearch::fuzzyCompare(caffeine.atom(0).pos(),
+                                     Vector3(1.3173, -1.0661, -0.0255)));
+
+  /**** Molfiles ****/
+  GlobalSearch::Structure aspirin;
+  QVERIFY(GlobalSearch::Formats::read(
+    &aspirin, QString(TESTDATADIR) + "/data/aspirin.mol"));
+  QVERIFY(aspirin.numAtoms() == 21);
+  QVERIFY(aspirin.numBonds() == 21);
+}
+
+void FormatsTest::writeSdf()
+{
+  QString caffeineFileName =
+    QString(TESTDATADIR) + "/data/caffeine-mmff94.sdf";
+  GlobalSearch::Structure caffeine;
+  QVERIFY(GlobalSearch::Formats::read(&caffeine, caffeineFileName));
+
+  std::stringstream ss;
+  QVERIFY(GlobalSearch::SdfFormat::write(caffeine, ss));
+
+  GlobalSearch::Structure copy;
+  QVERIFY(GlobalSearch::SdfFormat::read(copy, ss));
+  QVERIFY(copy.numAtoms() == caffeine.numAtoms());
+  QVERIFY(copy.numBonds() == caffeine.numBonds());
+  for (size_t i = 0; i < copy.numAtoms(); ++i) {
+    QVERIFY(copy.atom(i).atomicNumber() == caffeine.atom(i).atomicNumber());
+    QVERIFY(GlobalSearch::fuzzyCompare(copy.atom(i).pos(),
+                                       caffeine.atom(i).pos(), 1.e-4));
+  }
+  for (size_t i = 0; i < copy.numBonds(); ++i)
+    QVERIFY(copy.bond(i).bondOrder() == caffeine.bond(i).bondOrder());
+  QVERIFY(std::fabs(copy.getEnthalpy() - -122.350) < 1.e-5);
+}
+
 void FormatsTest::OBConvert()
 {
   /**** Caffeine PDB ****/
@@ -0,0 +1,277 @@
+/**********************************************************************
+  LoadBalancingTest - Test dispatching jobs over several queue interfaces
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ **********************************************************************/
+
+#include <globalsearch/queueinterfaces/loadbalancing.h>
+#include <globalsearch/structure.h>
+#include <globalsearch/utilities/makeunique.h>
+
+#include <xtalopt/xtalopt.h>
+
+#include <QtTest>
+
+namespace GlobalSearch {
+
+// A queue that only remembers what it was told. The tests set the status
+// of each job directly.
+class StandInQueue : public QueueInterface
+{
+  Q_OBJECT
+public:
+  explicit StandInQueue(OptBase* parent) : QueueInterface(parent)
+  {
+    m_idString = "Local";
+  }
+
+  QHash<Structure*, QueueInterface::QueueStatus> m_statuses;
+  int m_numStatusChecks = 0;
+  int m_numFetches = 0;
+
+public slots:
+  bool writeFiles(Structure* s,
+                  const QHash<QString, QString>& files) const override
+  {
+    return true;
+  }
+  bool startJob(Structure* s) override
+  {
+    m_statuses[s] = QueueInterface::Queued;
+    return true;
+  }
+  bool stopJob(Structure* s) override
+  {
+    m_statuses.remove(s);
+    return true;
+  }
+  QueueInterface::QueueStatus getStatus(Structure* s) const override
+  {
+    ++const_cast<StandInQueue*>(this)->m_numStatusChecks;
+    return m_statuses.value(s, QueueInterface::Unknown);
+  }
+  bool prepareForStructureUpdate(Structure* s) const override { return true; }
+  bool checkIfFileExists(Structure* s, const QString& filename,
+                         bool* exists) override
+  {
+    *exists = true;
+    return true;
+  }
+  bool fetchFile(Structure* s, const QString& filename,
+                 QString* contents) const override
+  {
+    ++const_cast<StandInQueue*>(this)->m_numFetches;
+    return true;
+  }
+  bool grepFile(Structure* s, const QString& matchText,
+                const QString& filename, QStringList* matches = 0,
+                int* exitcode = 0,
+                const bool caseSensitive = true) const override
+  {
+    return true;
+  }
+};
+
+class LoadBalancingTest : public QObject
+{
+  Q_OBJECT
+
+private:
+  XtalOpt::XtalOpt* m_opt;
+  LoadBalancingQueueInterface* m_qi;
+  StandInQueue* m_a;
+  StandInQueue* m_b;
+  QList<Structure*> m_structures;
+
+  Structure* submit()
+  {
+    Structure* s = new Structure;
+    m_structures.append(s);
+    m_qi->writeFiles(s, QHash<QString, QString>());
+    m_qi->startJob(s);
+    return s;
+  }
+
+private slots:
+  /**
+   * Called before the first test function is executed.
+   */
+  void initTestCase();
+
+  /**
+   * Called after the last test function is executed.
+   */
+  void cleanupTestCase();
+
+  /**
+   * Called before each test function is executed.
+   */
+  void init();
+
+  /**
+   * Called after every test function.
+   */
+  void cleanup();
+
+  // Tests
+  void spreadLoad();
+  void respectCapacity();
+  void avoidJammedQueue();
+  void trackFailures();
+  void routeStatusChecks();
+  void forgetFinishedJobs();
+};
+
+void LoadBalancingTest::initTestCase()
+{
+  m_opt = new XtalOpt::XtalOpt(nullptr);
+}
+
+void LoadBalancingTest::cleanupTestCase()
+{
+  delete m_opt;
+}
+
+void LoadBalancingTest::init()
+{
+  m_qi = new LoadBalancingQueueInterface(m_opt);
+  m_a = static_cast<StandInQueue*>(
+    m_qi->addBackend(make_unique<StandInQueue>(m_opt)));
+  m_b = static_cast<StandInQueue*>(
+    m_qi->addBackend(make_unique<StandInQueue>(m_opt)));
+}
+
+void LoadBalancingTest::cleanup()
+{
+  delete m_qi;
+  qDeleteAll(m_structures);
+  m_structures.clear();
+}
+
+void LoadBalancingTest::spreadLoad()
+{
+  for (int i = 0; i < 4; ++i)
+    submit();
+
+  QCOMPARE(m_a->m_statuses.size(), 2);
+  QCOMPARE(m_b->m_statuses.size(), 2);
+  QCOMPARE(m_qi->backendStats(0).numActive, static_cast<size_t>(2));
+}
+
+void LoadBalancingTest::respectCapacity()
+{
+  delete m_qi;
+  m_qi = new LoadBalancingQueueInterface(m_opt);
+  m_a = static_cast<StandInQueue*>(
+    m_qi->addBackend(make_unique<StandInQueue>(m_opt), 1));
+  m_b = static_cast<StandInQueue*>(
+    m_qi->addBackend(make_unique<StandInQueue>(m_opt)));
+
+  for (int i = 0; i < 3; ++i)
+    submit();
+
+  QCOMPARE(m_a->m_statuses.size(), 1);
+  QCOMPARE(m_b->m_statuses.size(), 2);
+}
+
+void LoadBalancingTest::avoidJammedQueue()
+{
+  Structure* first = submit();
+  Structure* second = submit();
+  QCOMPARE(m_qi->backendOf(first), m_a);
+  QCOMPARE(m_qi->backendOf(second), m_b);
+
+  // The second queue starts its job right away. The first one does not.
+  m_b->m_statuses[second] = QueueInterface::Running;
+  QCOMPARE(m_qi->getStatus(second), QueueInterface::Running);
+  QTest::qWait(200);
+
+  // Both of these should go to the queue that is moving
+  QCOMPARE(m_qi->backendOf(submit()), m_b);
+  QCOMPARE(m_qi->backendOf(submit()), m_b);
+}
+
+void LoadBalancingTest::trackFailures()
+{
+  Structure* first = submit();
+  Structure* second = submit();
+
+  m_a->m_statuses[first] = QueueInterface::Error;
+  m_b->m_statuses[second] = QueueInterface::Success;
+  m_qi->getStatus(first);
+  m_qi->getStatus(second);
+  // Checking again should not count twice
+  m_qi->getStatus(first);
+
+  QCOMPARE(m_qi->backendStats(0).numFailed, static_cast<size_t>(1));
+  QCOMPARE(m_qi->backendStats(0).failureRate(), 1.0);
+  QCOMPARE(m_qi->backendStats(1).numSucceeded, static_cast<size_t>(1));
+  QCOMPARE(m_qi->backendStats(0).numActive, static_cast<size_t>(0));
+
+  // With equal waits, the queue that fails loses
+  QCOMPARE(m_qi->backendOf(submit()), m_b);
+}
+
+void LoadBalancingTest::routeStatusChecks()
+{
+  Structure* first = submit();
+  Structure* second = submit();
+
+  m_qi->getStatus(first);
+  m_qi->getStatus(first);
+  m_qi->getStatus(second);
+  QCOMPARE(m_a->m_numStatusChecks, 2);
+  QCOMPARE(m_b->m_numStatusChecks, 1);
+
+  // Stopping goes to the right queue as well
+  m_qi->stopJob(second);
+  QVERIFY(!m_b->m_statuses.contains(second));
+  QVERIFY(m_a->m_statuses.contains(first));
+}
+}
+
+void LoadBalancingTest::forgetFinishedJobs()
+{
+  Structure* first = submit();
+  Structure* second = submit();
+  first->setFileName("/tmp/first");
+  second->setFileName("/tmp/second");
+
+  m_b->m_statuses[second] = QueueInterface::Success;
+  QCOMPARE(m_qi->getStatus(second), QueueInterface::Success);
+  m_qi->stopJob(first);
+
+  // Neither job is assigned anymore, and neither is counted as active
+  QVERIFY(m_qi->backendOf(first) == nullptr);
+  QVERIFY(m_qi->backendOf(second) == nullptr);
+  QCOMPARE(m_qi->backendStats(0).numActive, static_cast<size_t>(0));
+  QCOMPARE(m_qi->backendStats(1).numActive, static_cast<size_t>(0));
+
+  // Checking a finished job again does not count it twice
+  QCOMPARE(m_qi->getStatus(second), QueueInterface::Success);
+  QCOMPARE(m_qi->backendStats(1).numSucceeded, static_cast<size_t>(1));
+  QCOMPARE(m_qi->backendStats(1).numActive, static_cast<size_t>(0));
+
+  // The output is still fetched from the backend that ran the job
+  QString contents;
+  m_qi->fetchFile(second, "OUTCAR", &contents);
+  m_qi->fetchFile(first, "OUTCAR", &contents);
+  QCOMPARE(m_b->m_numFetches, 1);
+  QCOMPARE(m_a->m_numFetches, 1);
+
+  // The next optimization step may go anywhere
+  m_qi->writeFiles(second, QHash<QString, QString>());
+  QVERIFY(m_qi->backendOf(second) != nullptr);
+}
+
+QTEST_MAIN(GlobalSearch::LoadBalancingTest)
+
+#include "loadbalancingtest.moc"
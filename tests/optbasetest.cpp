@@ -14,12 +14,22 @@
 
 #include <globalsearch/optbase.h>
 
+#include <globalsearch/executor.h>
 #include <globalsearch/optimizer.h>
+#include <globalsearch/queueinterfaces/local.h>
 #include <globalsearch/structure.h>
+#include <globalsearch/tracker.h>
 #include <globalsearch/utilities/makeunique.h>
 
+#include <QTemporaryDir>
 #include <QtTest>
 
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
 using namespace GlobalSearch;
 
 const QString DUMMYNAME = "Dummy";
@@ -34,6 +44,19 @@ public:
     : Optimizer(p){};
 };
 
+// Dummy optimizer that writes VASP checkpoints
+class CheckpointOptimizer : public Optimizer
+{
+  Q_OBJECT
+public:
+  CheckpointOptimizer(OptBase* p)
+    : Optimizer(p)
+  {
+    m_idString = "VASP";
+    m_checkpointFilenames.append("CONTCAR");
+  };
+};
+
 // Since this is a pure virtual class, create a dummy derived class
 class DummyOptBase : public OptBase
 {
@@ -51,12 +74,33 @@ public:
   {
     if (optName == "dummy")
       return make_unique<DummyOptimizer>(this);
+    if (optName == "checkpoint")
+      return make_unique<CheckpointOptimizer>(this);
 
     qDebug() << "Error in" << __FUNCTION__
              << ": unknown optName:" << optName.c_str();
     return nullptr;
   }
 
+  std::unique_ptr<QueueInterface> createQueueInterface(
+    const std::string& queueName) override
+  {
+    if (queueName == "local")
+      return make_unique<LocalQueueInterface>(this);
+
+    qDebug() << "Error in" << __FUNCTION__
+             << ": unknown queueName:" << queueName.c_str();
+    return nullptr;
+  }
+
+  using OptBase::backUpStructureStateFile;
+
+  // Keeps structureChanged() from starting a full save
+  void resetFullSaveTime()
+  {
+    m_lastFullSaveTime = QDateTime::currentMSecsSinceEpoch();
+  }
+
 public slots:
   bool startSearch() override { return true; }
   bool checkLimits() override { return true; }
@@ -100,6 +144,10 @@ private slots:
   void getIDString();
   void getProbabilityList();
   void interpretKeyword();
+  void restoreCheckpoint();
+  void backUpStructureStateFile();
+  void queuedStateFileWrite();
+  void selectFromParetoFronts();
 };
 
 void OptBaseTest::initTestCase()
@@ -108,6 +156,7 @@ void OptBaseTest::initTestCase()
   if (m_opt->getNumOptSteps() == 0)
     m_opt->appendOptStep();
   m_opt->setOptimizer(0, "dummy");
+  m_opt->setQueueInterface(0, "local");
 }
 
 void OptBaseTest::cleanupTestCase()
@@ -327,6 +376,195 @@ void OptBaseTest::interpretKeyword()
   VERIFYKEYWORD("%optStep%", QString::number(COPTSTEP));
 }
 
+void OptBaseTest::restoreCheckpoint()
+{
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+
+  Structure s;
+  s.setFileName(dir.path());
+  s.unitCell().setCellMatrix(Matrix3::Identity() * 3.0);
+  s.addAtom(6, Vector3(0.0, 0.0, 0.0));
+  s.addAtom(6, Vector3(1.0, 1.0, 1.0));
+  s.setEnergy(-5.0);
+
+  m_opt->setOptimizer(0, "checkpoint");
+
+  // Disabled
+  m_opt->m_restartFromCheckpoint = false;
+  QVERIFY(!m_opt->restoreCheckpoint(&s));
+
+  // No checkpoint was written
+  m_opt->m_restartFromCheckpoint = true;
+  QVERIFY(!m_opt->restoreCheckpoint(&s));
+
+  // The run moved the second atom before it was killed
+  QFile contcar(dir.path() + "/CONTCAR");
+  QVERIFY(contcar.open(QIODevice::WriteOnly | QIODevice::Text));
+  contcar.write("C2\n1.0\n3 0 0\n0 3 0\n0 0 3\nC\n2\nDirect\n"
+                "0 0 0\n0.5 0.5 0.5\n");
+  contcar.close();
+
+  QVERIFY(m_opt->restoreCheckpoint(&s));
+  QCOMPARE(s.getCheckpointHops(), 1u);
+  QCOMPARE(s.numAtoms(), size_t(2));
+  QVERIFY((s.atom(1).pos() - Vector3(1.5, 1.5, 1.5)).norm() < 1e-6);
+
+  // A CONTCAR has no energy, so nothing is added to the history, and the
+  // energy of the old geometry is gone
+  QCOMPARE(s.sizeOfHistory(), 0u);
+  QCOMPARE(s.getEnergy(), 0.0);
+  QVERIFY(!s.hasEnthalpy());
+
+  // A checkpoint that did not move is not another hop
+  QVERIFY(!m_opt->restoreCheckpoint(&s));
+  QCOMPARE(s.getCheckpointHops(), 1u);
+
+  m_opt->m_restartFromCheckpoint = false;
+  m_opt->setOptimizer(0, "dummy");
+}
+
+void OptBaseTest::backUpStructureStateFile()
+{
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  DummyOptBase* opt = static_cast<DummyOptBase*>(m_opt);
+  const QString stateFileName = dir.path() + "/structure.state";
+  const QString oldStateFileName = stateFileName + ".old";
+
+  // Nothing to back up yet
+  QVERIFY(opt->backUpStructureStateFile(stateFileName));
+  QVERIFY(!QFile::exists(oldStateFileName));
+
+  // A complete save is copied
+  Structure s;
+  s.setFileName(dir.path());
+  s.setEnergy(-5.0);
+  s.writeSettings(stateFileName);
+  QVERIFY(opt->backUpStructureStateFile(stateFileName));
+  QVERIFY(QFile::exists(oldStateFileName));
+
+  // A truncated one is not, so the previous backup survives
+  QFile file(stateFileName);
+  QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+  file.close();
+  QVERIFY(opt->backUpStructureStateFile(stateFileName));
+  QFile oldFile(oldStateFileName);
+  QVERIFY(oldFile.open(QIODevice::ReadOnly));
+  QVERIFY(oldFile.size() > 0);
+}
+
+void OptBaseTest::queuedStateFileWrite()
+{
+  QTemporaryDir dataDir;
+  QTemporaryDir dir;
+  QVERIFY(dataDir.isValid());
+  QVERIFY(dir.isValid());
+  DummyOptBase* opt = static_cast<DummyOptBase*>(m_opt);
+  const QString stateFileName = dir.path() + "/structure.state";
+  opt->filePath = dataDir.path();
+  opt->isStarting = false;
+  opt->readOnly = false;
+  opt->m_fullSaveInterval = 3600;
+  opt->resetFullSaveTime();
+
+  // Hold every maintenance thread so that the write stays queued
+  Executor& maintenance = Executor::maintenance();
+  std::atomic<bool> release(false);
+  std::atomic<int> blocked(0);
+  for (int i = 0; i < maintenance.maxThreadCount(); ++i) {
+    maintenance.run([&release, &blocked]() {
+      ++blocked;
+      while (!release)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    });
+  }
+  QTRY_COMPARE(blocked.load(), maintenance.maxThreadCount());
+
+  // Adding the structure queues a write of its state file. It is
+  // removed and deleted before the write runs.
+  Structure* s = new Structure;
+  s->setFileName(dir.path());
+  s->addAtom(6, Vector3(0.0, 0.0, 0.0));
+  opt->tracker()->lockForWrite();
+  opt->tracker()->append(s);
+  opt->tracker()->unlock();
+
+  opt->tracker()->lockForWrite();
+  opt->tracker()->remove(s);
+  opt->tracker()->unlock();
+  delete s;
+
+  release = true;
+  QVERIFY(maintenance.waitForDone(5000));
+  QVERIFY(!QFile::exists(stateFileName));
+
+  // A structure that is still tracked is written
+  s = new Structure;
+  s->setFileName(dir.path());
+  s->addAtom(6, Vector3(0.0, 0.0, 0.0));
+  opt->tracker()->lockForWrite();
+  opt->tracker()->append(s);
+  opt->tracker()->unlock();
+  QVERIFY(maintenance.waitForDone(5000));
+  QVERIFY(QFile::exists(stateFileName));
+
+  opt->tracker()->lockForWrite();
+  opt->tracker()->remove(s);
+  opt->tracker()->unlock();
+  delete s;
+  opt->filePath.clear();
+  opt->isStarting = false;
+}
+
+void OptBaseTest::selectFromParetoFronts()
+{
+  std::vector<std::unique_ptr<Structure>> structures;
+  for (int i = 0; i < 24; ++i) {
+    structures.emplace_back(new Structure);
+    structures.back()->addAtom(6, Vector3(0.0, 0.0, 0.0));
+    structures.back()->setEnthalpy(-static_cast<double>(i));
+  }
+
+  // The same set in a different order is the same set
+  QList<Structure*> forward, backward;
+  for (const auto& s : structures) {
+    forward.append(s.get());
+    backward.prepend(s.get());
+  }
+  for (int i = 0; i < 10; ++i) {
+    Structure* s = m_opt->selectFromParetoFronts(forward, 4, false);
+    QVERIFY(forward.contains(s));
+    s = m_opt->selectFromParetoFronts(backward, 4, false);
+    QVERIFY(forward.contains(s));
+  }
+
+  // More sets than are kept, selected from at the same time. Selectors
+  // are evicted while other threads still use them.
+  std::vector<QList<Structure*>> sets;
+  for (int i = 0; i < 20; ++i) {
+    QList<Structure*> set;
+    for (int j = 0; j <= i + 3; ++j)
+      set.append(structures[j].get());
+    sets.push_back(set);
+  }
+
+  std::atomic<int> failures(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([this, &sets, &failures, t]() {
+      for (int i = 0; i < 200; ++i) {
+        const QList<Structure*>& set = sets[(i * 7 + t) % sets.size()];
+        if (!set.contains(m_opt->selectFromParetoFronts(set, 2, false)))
+          ++failures;
+      }
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+  QCOMPARE(failures.load(), 0);
+}
+
 QTEST_MAIN(OptBaseTest)
 
 #include "optbasetest.moc"
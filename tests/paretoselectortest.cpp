@@ -0,0 +1,199 @@
+/**********************************************************************
+  ParetoSelectorTest - Test the Pareto fronts and parent selection
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ **********************************************************************/
+
+#include <globalsearch/fitness/paretoselector.h>
+#include <globalsearch/structure.h>
+
+#include <QtTest>
+
+#include <cmath>
+#include <limits>
+
+using GlobalSearch::ParetoSelector;
+using GlobalSearch::Structure;
+
+class ParetoSelectorTest : public QObject
+{
+  Q_OBJECT
+
+private:
+  // a, b and c are the first front, d and f the second, and e the third
+  Structure m_a, m_b, m_c, m_d, m_e, m_f;
+
+  void addAll(ParetoSelector& selector)
+  {
+    selector.update(&m_a, { 1.0, 5.0 });
+    selector.update(&m_b, { 2.0, 3.0 });
+    selector.update(&m_c, { 4.0, 1.0 });
+    selector.update(&m_d, { 3.0, 4.0 });
+    selector.update(&m_e, { 5.0, 5.0 });
+    selector.update(&m_f, { 2.0, 6.0 });
+  }
+
+private slots:
+  /**
+   * Called before the first test function is executed.
+   */
+  void initTestCase();
+
+  /**
+   * Called after the last test function is executed.
+   */
+  void cleanupTestCase();
+
+  /**
+   * Called before each test function is executed.
+   */
+  void init();
+
+  /**
+   * Called after every test function.
+   */
+  void cleanup();
+
+  // Tests
+  void fronts();
+  void crowdingDistance();
+  void select();
+  void updateAndRemove();
+};
+
+void ParetoSelectorTest::initTestCase()
+{
+}
+
+void ParetoSelectorTest::cleanupTestCase()
+{
+}
+
+void ParetoSelectorTest::init()
+{
+}
+
+void ParetoSelectorTest::cleanup()
+{
+}
+
+void ParetoSelectorTest::fronts()
+{
+  ParetoSelector selector;
+  addAll(selector);
+
+  QCOMPARE(selector.size(), static_cast<size_t>(6));
+  QCOMPARE(selector.front(&m_a), 0LL);
+  QCOMPARE(selector.front(&m_b), 0LL);
+  QCOMPARE(selector.front(&m_c), 0LL);
+  QCOMPARE(selector.front(&m_d), 1LL);
+  QCOMPARE(selector.front(&m_f), 1LL);
+  QCOMPARE(selector.front(&m_e), 2LL);
+
+  std::vector<std::vector<Structure*>> fronts = selector.fronts();
+  QCOMPARE(fronts.size(), static_cast<size_t>(3));
+  QCOMPARE(fronts[0].size(), static_cast<size_t>(3));
+  QCOMPARE(fronts[1].size(), static_cast<size_t>(2));
+  QCOMPARE(fronts[2].size(), static_cast<size_t>(1));
+
+  // The ends of a front come first since they are the least crowded
+  QCOMPARE(fronts[0][2], &m_b);
+
+  // With three objectives, the third one can take a point off a front
+  selector.update(&m_d, { 3.0, 4.0, -1.0 });
+  selector.update(&m_a, { 1.0, 5.0, 0.0 });
+  selector.update(&m_b, { 2.0, 3.0, 0.0 });
+  selector.update(&m_c, { 4.0, 1.0, 0.0 });
+  selector.update(&m_e, { 5.0, 5.0, 0.0 });
+  selector.update(&m_f, { 2.0, 6.0, 0.0 });
+  QCOMPARE(selector.front(&m_d), 0LL);
+  QCOMPARE(selector.front(&m_e), 1LL);
+}
+
+void ParetoSelectorTest::crowdingDistance()
+{
+  ParetoSelector selector;
+  addAll(selector);
+
+  const double inf = std::numeric_limits<double>::infinity();
+  QCOMPARE(selector.crowdingDistance(&m_a), inf);
+  QCOMPARE(selector.crowdingDistance(&m_c), inf);
+  QCOMPARE(selector.crowdingDistance(&m_e), inf);
+
+  // (4 - 1) / (4 - 1) + (5 - 1) / (5 - 1)
+  QCOMPARE(selector.crowdingDistance(&m_b), 2.0);
+
+  Structure other;
+  QCOMPARE(selector.front(&other), -1LL);
+  QCOMPARE(selector.crowdingDistance(&other), -1.0);
+}
+
+void ParetoSelectorTest::select()
+{
+  ParetoSelector selector;
+  QVERIFY(selector.select() == nullptr);
+
+  addAll(selector);
+
+  // The population is a, c, b, f, d, e. The earlier contestant wins.
+  QCOMPARE(selector.select(0.0, 0.9), &m_a);
+  QCOMPARE(selector.select(0.9, 0.0), &m_a);
+  QCOMPARE(selector.select(0.5, 0.99), &m_f);
+  QCOMPARE(selector.select(0.99, 0.99), &m_e);
+
+  // Only the best three take part
+  selector.setPopulationSize(3);
+  QCOMPARE(selector.select(0.99, 0.99), &m_b);
+
+  for (int i = 0; i < 100; ++i) {
+    Structure* s = selector.select();
+    QVERIFY(selector.front(s) == 0);
+  }
+}
+
+void ParetoSelectorTest::updateAndRemove()
+{
+  ParetoSelector selector;
+  addAll(selector);
+
+  // e now dominates everything
+  selector.update(&m_e, { 0.0, 0.0 });
+  QCOMPARE(selector.front(&m_e), 0LL);
+  QCOMPARE(selector.front(&m_a), 1LL);
+  QCOMPARE(selector.front(&m_d), 2LL);
+
+  // NaN is the worst value
+  selector.update(&m_e, { std::nan(""), 0.0 });
+  QCOMPARE(selector.front(&m_e), 0LL);
+  QCOMPARE(selector.front(&m_a), 0LL);
+  selector.update(&m_e, { std::nan(""), std::nan("") });
+  QCOMPARE(selector.front(&m_e), 2LL);
+
+  selector.remove(&m_b);
+  QCOMPARE(selector.size(), static_cast<size_t>(5));
+  QCOMPARE(selector.front(&m_b), -1LL);
+  QCOMPARE(selector.front(&m_d), 0LL);
+
+  // Syncing drops the structures that are not listed
+  selector.sync({ &m_a, &m_c }, { { 1.0, 5.0 }, { 0.5, 6.0 } });
+  QCOMPARE(selector.size(), static_cast<size_t>(2));
+  QCOMPARE(selector.front(&m_a), 0LL);
+  QCOMPARE(selector.front(&m_c), 0LL);
+  QCOMPARE(selector.fronts().size(), static_cast<size_t>(1));
+
+  selector.clear();
+  QCOMPARE(selector.size(), static_cast<size_t>(0));
+  QVERIFY(selector.fronts().empty());
+}
+
+QTEST_MAIN(ParetoSelectorTest)
+
+#include "paretoselectortest.moc"
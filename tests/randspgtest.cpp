@@ -19,12 +19,15 @@
 #include <globalsearch/random.h>
 
 #include <randSpg/include/randSpg.h>
+#include <randSpg/include/randSpgContext.h>
 
 #include <QDebug>
 #include <QString>
 #include <QtTest>
 
+#include <atomic>
 #include <map>
+#include <thread>
 
 class RandSpgTest : public QObject
 {
@@ -59,6 +62,8 @@ private slots:
 
   // Tests
   void generateXtals();
+  void contextMemoization();
+  void contextThreadSafety();
 };
 
 RandSpgTest::RandSpgTest() : m_opt(nullptr)
@@ -121,6 +126,9 @@ void RandSpgTest::init()
 
   m_opt.using_fixed_volume = false;
 
+  // Generation reads the constraints from the published snapshot
+  m_opt.publishConstraints();
+
   // Generate the space groups list (with none turned off by default)
   for (int spg = 1; spg <= 230; spg++) {
     if (RandSpg::isSpgPossible(spg, m_opt.getStdVecOfAtoms(FU)))
@@ -171,6 +179,88 @@ void RandSpgTest::generateXtals()
   QVERIFY(numFailures <= maxFailures);
 }
 
+void RandSpgTest::contextMemoization()
+{
+  // Radii are scaled, and none are below the min radius
+  RandSpgContext context(0.5, 0.33);
+  RandSpgContext unscaled;
+  QVERIFY(fabs(context.radius(22) - 0.5 * unscaled.radius(22)) < 1.0e-8);
+  QCOMPARE(context.radius(1), 0.33);
+  QCOMPARE(context.radius(0), 0.0);
+
+  // The order of the atoms does not matter, so both share one entry
+  std::vector<uint> atoms = { 22, 22, 8, 8, 8, 8 };
+  std::vector<uint> shuffled = { 8, 22, 8, 8, 22, 8 };
+  auto possibilities = context.getSystemPossibilities(136, atoms);
+  QVERIFY(possibilities);
+  QVERIFY(context.getSystemPossibilities(136, shuffled) == possibilities);
+
+  // The memoized answers match the uncached ones
+  for (uint spg = 1; spg <= 230; ++spg) {
+    bool possible = RandSpg::isSpgPossible(spg, atoms);
+    QCOMPARE(context.isSpgPossible(spg, atoms), possible);
+    QCOMPARE(context.isSpgPossible(spg, shuffled), possible);
+  }
+
+  context.clearCache();
+  QVERIFY(context.getSystemPossibilities(136, atoms) != possibilities);
+
+  // XtalOpt keeps its context until the radius settings change
+  std::shared_ptr<RandSpgContext> xtalOptContext = m_opt.randSpgContext();
+  QVERIFY(m_opt.randSpgContext() == xtalOptContext);
+  m_opt.scaleFactor = 0.6;
+  m_opt.publishConstraints();
+  QVERIFY(m_opt.randSpgContext() != xtalOptContext);
+  QVERIFY(fabs(m_opt.randSpgContext()->radius(22) -
+               0.6 * unscaled.radius(22)) < 1.0e-8);
+  m_opt.scaleFactor = 0.5;
+  m_opt.publishConstraints();
+}
+
+void RandSpgTest::contextThreadSafety()
+{
+  RandSpgContext reference(0.5, 0.33);
+  RandSpgContext context(0.5, 0.33);
+  const std::vector<uint> atoms = { 22, 22, 8, 8, 8, 8 };
+  const latticeStruct mins(3.0, 3.0, 3.0, 60.0, 60.0, 60.0);
+  const latticeStruct maxes(10.0, 10.0, 10.0, 120.0, 120.0, 120.0);
+
+  const size_t numThreads = 8;
+  const size_t numCrystals = 10;
+  std::atomic<size_t> numMismatches(0);
+  std::atomic<size_t> numGenerated(0);
+  std::vector<std::shared_ptr<const systemPossibilities>> shared(numThreads);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < numThreads; ++t) {
+    threads.push_back(std::thread([&, t]() {
+      for (uint spg = 1; spg <= 230; ++spg) {
+        if (context.isSpgPossible(spg, atoms) !=
+            reference.isSpgPossible(spg, atoms)) {
+          ++numMismatches;
+        }
+      }
+      shared[t] = context.getSystemPossibilities(136, atoms);
+
+      // P1 and P-1 can always be generated for this composition
+      for (size_t i = 0; i < numCrystals; ++i) {
+        randSpgInput input(1 + i % 2, atoms, mins, maxes);
+        input.minVolume = 25.0;
+        input.maxVolume = 35.0;
+        Crystal crystal = context.randSpgCrystal(input);
+        if (crystal.getVolume() > 0.0 && crystal.getAtoms().size() == 6)
+          ++numGenerated;
+      }
+    }));
+  }
+  for (auto& thread : threads)
+    thread.join();
+
+  QCOMPARE(numMismatches.load(), static_cast<size_t>(0));
+  QCOMPARE(numGenerated.load(), numThreads * numCrystals);
+  for (size_t t = 1; t < numThreads; ++t)
+    QVERIFY(shared[t] == shared[0]);
+}
+
 QTEST_MAIN(RandSpgTest)
 
 #include "randspgtest.moc"
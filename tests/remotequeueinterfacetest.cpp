@@ -0,0 +1,363 @@
+/**********************************************************************
+  RemoteQueueInterfaceTest - Test how the remote queue interfaces fetch
+                             and refresh their snapshot of the queue
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ **********************************************************************/
+
+#include <globalsearch/executor.h>
+#include <globalsearch/optbase.h>
+#include <globalsearch/queueinterfaces/pbs.h>
+#include <globalsearch/sshconnection.h>
+#include <globalsearch/sshmanager.h>
+#include <globalsearch/structure.h>
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QProcess>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace GlobalSearch;
+
+// Answers every command with "job <n>", where n counts the commands, or
+// runs it in a local shell if setRunInShell() was called. Each command
+// waits until the connection is opened.
+class FakeSSHConnection : public SSHConnection
+{
+  Q_OBJECT
+public:
+  explicit FakeSSHConnection(SSHManager* parent)
+    : SSHConnection(parent), m_open(true), m_runInShell(false),
+      m_numExecutes(0)
+  {
+  }
+
+  void setOpen(bool open)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_open = open;
+    m_cond.notify_all();
+  }
+
+  void setRunInShell(bool b) { m_runInShell = b; }
+
+  int numExecutes() const { return m_numExecutes; }
+
+  bool execute(const QString& command, QString& stdout_str,
+               QString& stderr_str, int& exitcode, bool) override
+  {
+    int n = ++m_numExecutes;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cond.wait(lock, [this]() { return m_open; });
+    if (m_runInShell) {
+      QProcess proc;
+      proc.start("sh", QStringList() << "-c" << command);
+      if (!proc.waitForFinished())
+        return false;
+      stdout_str = QString(proc.readAllStandardOutput());
+      stderr_str = QString(proc.readAllStandardError());
+      exitcode = proc.exitCode();
+      return true;
+    }
+    stdout_str = QString("job %1\n").arg(n);
+    stderr_str.clear();
+    exitcode = 0;
+    return true;
+  }
+
+  bool copyFileToServer(const QString&, const QString&) override
+  {
+    return false;
+  }
+  bool copyFileFromServer(const QString&, const QString&) override
+  {
+    return false;
+  }
+  bool readRemoteFile(const QString&, QString&) override { return false; }
+  bool removeRemoteFile(const QString&) override { return false; }
+  bool copyDirectoryToServer(const QString&, const QString&) override
+  {
+    return false;
+  }
+  bool copyDirectoryFromServer(const QString&, const QString&) override
+  {
+    return false;
+  }
+  bool readRemoteDirectoryContents(const QString&, QStringList&) override
+  {
+    return false;
+  }
+  bool removeRemoteDirectory(const QString&, bool) override { return false; }
+
+private:
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+  bool m_open;
+  std::atomic<bool> m_runInShell;
+  std::atomic<int> m_numExecutes;
+};
+
+// Hands out the same connection to everyone. The queue interface only
+// talks to the server from one thread at a time.
+class FakeSSHManager : public SSHManager
+{
+  Q_OBJECT
+public:
+  explicit FakeSSHManager(OptBase* parent)
+    : SSHManager(parent), m_connection(this)
+  {
+  }
+
+  FakeSSHConnection* connection() { return &m_connection; }
+
+  unsigned int numConnections() const override { return 1; }
+
+public slots:
+  SSHConnection* getFreeConnection() override { return &m_connection; }
+  void unlockConnection(SSHConnection*) override {}
+
+private:
+  FakeSSHConnection m_connection;
+};
+
+class FakeSSHOptBase : public OptBase
+{
+  Q_OBJECT
+public:
+  FakeSSHOptBase() : OptBase(0)
+  {
+    m_idString = "FakeSSHOptBase";
+    m_ssh = new FakeSSHManager(this);
+  }
+
+  FakeSSHConnection* connection()
+  {
+    return static_cast<FakeSSHManager*>(m_ssh)->connection();
+  }
+
+public slots:
+  bool startSearch() override { return true; }
+  bool checkLimits() override { return true; }
+  void readRuntimeOptions() override {}
+};
+
+// Makes the snapshot public
+class TestQueueInterface : public PbsQueueInterface
+{
+  Q_OBJECT
+public:
+  explicit TestQueueInterface(OptBase* parent) : PbsQueueInterface(parent) {}
+
+  using RemoteQueueInterface::getQueueList;
+};
+
+class RemoteQueueInterfaceTest : public QObject
+{
+  Q_OBJECT
+
+private:
+  FakeSSHOptBase* m_opt;
+
+private slots:
+  /**
+   * Called before the first test function is executed.
+   */
+  void initTestCase();
+
+  /**
+   * Called after the last test function is executed.
+   */
+  void cleanupTestCase();
+
+  /**
+   * Called before each test function is executed.
+   */
+  void init();
+
+  /**
+   * Called after every test function.
+   */
+  void cleanup();
+
+  // Tests
+  void firstSnapshot();
+  void staleSnapshot();
+  void checkCompletion();
+};
+
+void RemoteQueueInterfaceTest::initTestCase()
+{
+  m_opt = nullptr;
+}
+
+void RemoteQueueInterfaceTest::cleanupTestCase()
+{
+}
+
+void RemoteQueueInterfaceTest::init()
+{
+  m_opt = new FakeSSHOptBase;
+  m_opt->setQueueRefreshInterval(60);
+}
+
+void RemoteQueueInterfaceTest::cleanup()
+{
+  m_opt->connection()->setOpen(true);
+  delete m_opt;
+  m_opt = nullptr;
+}
+
+void RemoteQueueInterfaceTest::firstSnapshot()
+{
+  FakeSSHConnection* connection = m_opt->connection();
+  std::unique_ptr<TestQueueInterface> qi(new TestQueueInterface(m_opt));
+
+  // Everyone waits for the first snapshot, but only one thread fetches it
+  connection->setOpen(false);
+  std::vector<QStringList> lists(4);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < lists.size(); ++i)
+    threads.emplace_back([&qi, &lists, i]() { lists[i] = qi->getQueueList(); });
+
+  // Give every thread time to ask. Let them finish before checking
+  // anything, so that a failure does not leave them waiting.
+  QTest::qWait(200);
+  const int numExecutes = connection->numExecutes();
+  connection->setOpen(true);
+  for (auto& thread : threads)
+    thread.join();
+  QCOMPARE(numExecutes, 1);
+  for (const auto& list : lists)
+    QCOMPARE(list, QStringList() << "job 1");
+
+  // The snapshot is fresh, so the server is not asked again
+  QCOMPARE(qi->getQueueList(), QStringList() << "job 1");
+  QCOMPARE(connection->numExecutes(), 1);
+}
+
+void RemoteQueueInterfaceTest::staleSnapshot()
+{
+  FakeSSHConnection* connection = m_opt->connection();
+  std::unique_ptr<TestQueueInterface> qi(new TestQueueInterface(m_opt));
+  QCOMPARE(qi->getQueueList(), QStringList() << "job 1");
+
+  // Make the snapshot stale and keep the refresh from finishing
+  connection->setOpen(false);
+  m_opt->setQueueRefreshInterval(0);
+  QTest::qWait(10);
+
+  // The stale snapshot is returned right away, and only one refresh is
+  // started for all of the callers
+  QElapsedTimer timer;
+  timer.start();
+  std::vector<std::thread> threads;
+  std::atomic<int> numStale(0);
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&qi, &numStale]() {
+      for (int j = 0; j < 25; ++j) {
+        if (qi->getQueueList() == (QStringList() << "job 1"))
+          ++numStale;
+      }
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+  QCOMPARE(numStale.load(), 100);
+  QVERIFY(timer.elapsed() < 5000);
+
+  QTRY_COMPARE_WITH_TIMEOUT(connection->numExecutes(), 2, 5000);
+  QTest::qWait(100);
+  QCOMPARE(qi->getQueueList(), QStringList() << "job 1");
+  QCOMPARE(connection->numExecutes(), 2);
+
+  // The refreshed snapshot replaces the stale one
+  m_opt->setQueueRefreshInterval(60);
+  connection->setOpen(true);
+  QTRY_COMPARE_WITH_TIMEOUT(qi->getQueueList(), QStringList() << "job 2",
+                            5000);
+  QCOMPARE(connection->numExecutes(), 2);
+
+  // The destructor waits for a refresh that is still running
+  m_opt->setQueueRefreshInterval(0);
+  QTest::qWait(10);
+  connection->setOpen(false);
+  QCOMPARE(qi->getQueueList(), QStringList() << "job 2");
+  QTRY_COMPARE_WITH_TIMEOUT(connection->numExecutes(), 3, 5000);
+  std::thread opener([connection]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    connection->setOpen(true);
+  });
+  qi.reset();
+  opener.join();
+  Executor::io().waitForDone();
+}
+
+void RemoteQueueInterfaceTest::checkCompletion()
+{
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  FakeSSHConnection* connection = m_opt->connection();
+  connection->setRunInShell(true);
+  TestQueueInterface qi(m_opt);
+
+  // The remote path has a space and the marker has a quote, so both must
+  // be quoted for the shell
+  QVERIFY(QDir(dir.path()).mkdir("job 1"));
+  Structure s;
+  s.setRempath(dir.path() + "/job 1");
+  const QString outFile = s.getRempath() + "/job.out";
+  const QStringList markers = QStringList() << "it's done"
+                                            << "Normal termination";
+
+  // Each check is one command
+  bool exists = true, success = true;
+  QVERIFY(qi.checkCompletion(&s, "job.out", markers, &exists, &success));
+  QVERIFY(!exists);
+  QVERIFY(!success);
+  QCOMPARE(connection->numExecutes(), 1);
+
+  QFile file(outFile);
+  QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Text));
+  file.write("still running\n");
+  file.close();
+  QVERIFY(qi.checkCompletion(&s, "job.out", markers, &exists, &success));
+  QVERIFY(exists);
+  QVERIFY(!success);
+  QCOMPARE(connection->numExecutes(), 2);
+
+  QVERIFY(file.open(QIODevice::Append | QIODevice::Text));
+  file.write("it's done\n");
+  file.close();
+  QVERIFY(qi.checkCompletion(&s, "job.out", markers, &exists, &success));
+  QVERIFY(exists);
+  QVERIFY(success);
+  QCOMPARE(connection->numExecutes(), 3);
+
+  // Without completion strings, only the existence is checked
+  QVERIFY(qi.checkCompletion(&s, "job.out", QStringList(), &exists,
+                             &success));
+  QVERIFY(exists);
+  QVERIFY(!success);
+  QCOMPARE(connection->numExecutes(), 4);
+}
+
+QTEST_MAIN(RemoteQueueInterfaceTest)
+
+#include "remotequeueinterfacetest.moc"
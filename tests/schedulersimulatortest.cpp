@@ -0,0 +1,383 @@
+/**********************************************************************
+  SchedulerSimulatorTest - Test the simulated batch scheduler
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ **********************************************************************/
+
+#include <globalsearch/executor.h>
+#include <globalsearch/optbase.h>
+#include <globalsearch/optimizer.h>
+#include <globalsearch/queueinterfaces/schedulersimulator.h>
+#include <globalsearch/queueinterfaces/simulated.h>
+#include <globalsearch/queuemanager.h>
+#include <globalsearch/structure.h>
+#include <globalsearch/tracker.h>
+#include <globalsearch/utilities/makeunique.h>
+
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <set>
+#include <vector>
+
+namespace GlobalSearch {
+
+typedef SchedulerSimulator::Distribution Distribution;
+
+// An optimizer that is done once "job.out" says so. The enthalpy is the
+// job id written in it, so any structure can be "optimized".
+class SimulatedOptimizer : public Optimizer
+{
+  Q_OBJECT
+public:
+  explicit SimulatedOptimizer(OptBase* p) : Optimizer(p)
+  {
+    m_idString = "Simulated";
+    m_completionFilename = "job.out";
+    m_completionStrings.append("done");
+    m_outputFilenames.append("job.out");
+  }
+
+  bool update(Structure* s) override
+  {
+    QString contents;
+    if (!m_opt->queueInterface(s->getCurrentOptStep())
+           ->fetchFile(s, "job.out", &contents)) {
+      return false;
+    }
+    QWriteLocker locker(&s->lock());
+    s->stopOptTimer();
+    s->setEnthalpy(contents.section(' ', 1, 1).toDouble());
+    return true;
+  }
+};
+
+class SimulatedOptBase : public OptBase
+{
+  Q_OBJECT
+public:
+  SimulatedOptBase() : OptBase(0) { m_idString = "SimulatedOptBase"; }
+
+  std::unique_ptr<Optimizer> createOptimizer(const std::string&) override
+  {
+    return make_unique<SimulatedOptimizer>(this);
+  }
+
+  std::unique_ptr<QueueInterface> createQueueInterface(
+    const std::string&) override
+  {
+    return make_unique<SimulatedQueueInterface>(this);
+  }
+
+public slots:
+  bool startSearch() override { return true; }
+  bool checkLimits() override { return true; }
+  void readRuntimeOptions() override {}
+};
+
+class SchedulerSimulatorTest : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  /**
+   * Called before the first test function is executed.
+   */
+  void initTestCase(){};
+
+  /**
+   * Called after the last test function is executed.
+   */
+  void cleanupTestCase(){};
+
+  /**
+   * Called before each test function is executed.
+   */
+  void init(){};
+
+  /**
+   * Called after every test function.
+   */
+  void cleanup(){};
+
+  // Tests
+  void nodesAndQueueWait();
+  void outputDelay();
+  void cancel();
+  void failures();
+  void deterministic();
+  void throughput();
+  void settings();
+  void queueManager();
+};
+
+void SchedulerSimulatorTest::nodesAndQueueWait()
+{
+  SchedulerSimulator sim;
+  sim.setNumNodes(2);
+  sim.setQueueWait(Distribution::constant(10.0));
+  sim.setRunTime(Distribution::constant(100.0));
+
+  unsigned long a = sim.submit();
+  unsigned long b = sim.submit();
+  unsigned long c = sim.submit();
+  QCOMPARE(a, 1ul);
+  QCOMPARE(sim.state(c), SchedulerSimulator::Queued);
+  QCOMPARE(sim.numQueued(), size_t(3));
+
+  // Two start after the queue wait. The third waits for a node.
+  sim.advance(10.0);
+  QCOMPARE(sim.state(a), SchedulerSimulator::Running);
+  QCOMPARE(sim.state(b), SchedulerSimulator::Running);
+  QCOMPARE(sim.state(c), SchedulerSimulator::Queued);
+
+  sim.advance(100.0);
+  QCOMPARE(sim.state(a), SchedulerSimulator::Completed);
+  QCOMPARE(sim.state(c), SchedulerSimulator::Running);
+
+  sim.advance(100.0);
+  QCOMPARE(sim.state(c), SchedulerSimulator::Completed);
+  QCOMPARE(sim.numCompleted(), size_t(3));
+  QCOMPARE(sim.state(12345), SchedulerSimulator::UnknownJob);
+}
+
+void SchedulerSimulatorTest::outputDelay()
+{
+  SchedulerSimulator sim;
+  sim.setRunTime(Distribution::constant(5.0));
+  sim.setOutputDelay(3.0);
+
+  unsigned long id = sim.submit();
+  sim.advance(5.0);
+  QCOMPARE(sim.state(id), SchedulerSimulator::Completed);
+  QVERIFY(!sim.outputReady(id));
+
+  sim.advance(3.0);
+  QVERIFY(sim.outputReady(id));
+}
+
+void SchedulerSimulatorTest::cancel()
+{
+  SchedulerSimulator sim;
+  sim.setRunTime(Distribution::constant(50.0));
+
+  unsigned long running = sim.submit();
+  unsigned long waiting = sim.submit();
+  QCOMPARE(sim.state(running), SchedulerSimulator::Running);
+
+  // Cancelling the running job frees the node for the next one
+  QVERIFY(sim.cancel(running));
+  QCOMPARE(sim.state(running), SchedulerSimulator::Cancelled);
+  QCOMPARE(sim.state(waiting), SchedulerSimulator::Running);
+
+  sim.advance(50.0);
+  QVERIFY(!sim.cancel(waiting));
+  QVERIFY(!sim.outputReady(running));
+  QCOMPARE(sim.numCancelled(), size_t(1));
+}
+
+void SchedulerSimulatorTest::failures()
+{
+  SchedulerSimulator sim(7);
+  sim.setNumNodes(1000);
+  sim.setRunTime(Distribution::uniform(1.0, 2.0));
+  sim.setFailureProbability(0.25);
+
+  std::vector<unsigned long> ids;
+  for (int i = 0; i < 1000; ++i)
+    ids.push_back(sim.submit());
+  sim.advance(2.0);
+
+  size_t failed = 0;
+  for (unsigned long id : ids) {
+    if (sim.state(id) == SchedulerSimulator::Failed) {
+      QVERIFY(!sim.outputReady(id));
+      ++failed;
+    }
+  }
+  QCOMPARE(sim.numFailed(), failed);
+  QCOMPARE(sim.numCompleted() + sim.numFailed(), size_t(1000));
+  QVERIFY(failed > 150 && failed < 350);
+  QCOMPARE(sim.numStatusQueries(), size_t(1000));
+}
+
+void SchedulerSimulatorTest::deterministic()
+{
+  // The schedule may not depend on how often the status is polled
+  std::vector<SchedulerSimulator::JobState> states[2];
+  for (int run = 0; run < 2; ++run) {
+    SchedulerSimulator sim(42);
+    sim.setNumNodes(4);
+    sim.setQueueWait(Distribution::exponential(30.0));
+    sim.setRunTime(Distribution::uniform(10.0, 200.0));
+    sim.setFailureProbability(0.1);
+
+    std::vector<unsigned long> ids;
+    for (int i = 0; i < 50; ++i) {
+      ids.push_back(sim.submit());
+      if (run == 1) {
+        for (unsigned long id : ids)
+          sim.state(id);
+      }
+      sim.advance(5.0);
+    }
+    sim.advance(300.0);
+    for (unsigned long id : ids)
+      states[run].push_back(sim.state(id));
+  }
+  QVERIFY(states[0] == states[1]);
+}
+
+void SchedulerSimulatorTest::throughput()
+{
+  SchedulerSimulator sim(1);
+  sim.setNumNodes(256);
+  sim.setQueueWait(Distribution::exponential(60.0));
+  sim.setRunTime(Distribution::exponential(600.0));
+
+  const size_t numJobs = 20000;
+  std::vector<unsigned long> ids;
+  ids.reserve(numJobs);
+  for (size_t i = 0; i < numJobs; ++i)
+    ids.push_back(sim.submit());
+
+  // Poll the unfinished jobs once a simulated minute, like the queue
+  // manager does, until they are all done
+  size_t polls = 0;
+  while (!ids.empty()) {
+    sim.advance(60.0);
+    std::vector<unsigned long> unfinished;
+    for (unsigned long id : ids) {
+      ++polls;
+      if (sim.state(id) != SchedulerSimulator::Completed)
+        unfinished.push_back(id);
+    }
+    ids.swap(unfinished);
+  }
+  QCOMPARE(sim.numCompleted(), numJobs);
+  QCOMPARE(sim.numStatusQueries(), polls);
+
+  sim.resetCounters();
+  QCOMPARE(sim.numStatusQueries(), size_t(0));
+}
+}
+
+void SchedulerSimulatorTest::settings()
+{
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  QString filename = dir.path() + "/simulated.state";
+
+  SimulatedOptBase opt;
+  opt.appendOptStep();
+  opt.setQueueInterface(0, "simulated");
+  auto* qi = qobject_cast<SimulatedQueueInterface*>(opt.queueInterface(0));
+  QVERIFY(qi != nullptr);
+
+  SchedulerSimulator& sim = qi->simulator();
+  sim.setSeed(1234);
+  sim.setNumNodes(8);
+  sim.setRunTime(Distribution::uniform(5.0, 10.0));
+  sim.setFailureProbability(0.2);
+  qi->writeSettings(filename);
+
+  sim.setSeed(1);
+  sim.setNumNodes(1);
+  sim.setRunTime(Distribution::constant(1.0));
+  sim.setFailureProbability(0.0);
+  qi->readSettings(filename);
+
+  QCOMPARE(sim.seed(), 1234u);
+  QCOMPARE(sim.numNodes(), size_t(8));
+  QCOMPARE(sim.runTime().type, Distribution::Uniform);
+  QCOMPARE(sim.runTime().b, 10.0);
+  QCOMPARE(sim.failureProbability(), 0.2);
+}
+
+void SchedulerSimulatorTest::queueManager()
+{
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+
+  SimulatedOptBase* opt = new SimulatedOptBase;
+  opt->filePath = dir.path();
+  // No new structures are requested
+  opt->contStructs = 0;
+  opt->appendOptStep();
+  opt->setOptimizer(0, "simulated");
+  opt->setQueueInterface(0, "simulated");
+  auto* qi = qobject_cast<SimulatedQueueInterface*>(opt->queueInterface(0));
+  QVERIFY(qi != nullptr);
+
+  // Two nodes for six jobs, so some of them wait for a node. A job takes
+  // 60 ms of real time.
+  SchedulerSimulator& sim = qi->simulator();
+  sim.setNumNodes(2);
+  sim.setQueueWait(Distribution::constant(10.0));
+  sim.setRunTime(Distribution::constant(50.0));
+  sim.setTimeScale(1000.0);
+  QHash<QString, QString> files;
+  files.insert("job.out", "done %jobid%\n");
+  qi->setOutputFiles(files);
+
+  QList<Structure*> structures;
+  for (int i = 1; i <= 6; ++i) {
+    Structure* s = new Structure;
+    s->setIDNumber(i);
+    s->setFileName(dir.path() + "/" + QString::number(i));
+    QVERIFY(QDir().mkpath(s->fileName()));
+    structures.append(s);
+  }
+
+  opt->tracker()->lockForWrite();
+  for (auto* s : structures)
+    opt->tracker()->append(s);
+  opt->tracker()->unlock();
+
+  opt->emitSessionStarted();
+  for (auto* s : structures)
+    opt->queue()->addStructureToSubmissionQueue(s);
+
+  auto numOptimized = [&structures]() {
+    int n = 0;
+    for (auto* s : structures) {
+      QReadLocker locker(&s->lock());
+      if (s->getStatus() == Structure::Optimized)
+        ++n;
+    }
+    return n;
+  };
+  QTRY_COMPARE_WITH_TIMEOUT(numOptimized(), structures.size(), 60000);
+
+  // Each structure went through its own job and read its own output
+  std::set<double> jobIDs;
+  for (auto* s : structures) {
+    QVERIFY(s->getEnthalpy() >= 1.0);
+    jobIDs.insert(s->getEnthalpy());
+  }
+  QCOMPARE(jobIDs.size(), size_t(structures.size()));
+  QCOMPARE(sim.numSubmitted(), size_t(structures.size()));
+  QCOMPARE(sim.numCompleted(), size_t(structures.size()));
+  QVERIFY(sim.numStatusQueries() >= size_t(structures.size()));
+
+  // Stop the queue thread and let the handlers finish before cleaning up
+  QThread* queueThread = opt->queue()->thread();
+  queueThread->quit();
+  QVERIFY(queueThread->wait(10000));
+  QVERIFY(Executor::io().waitForDone(10000));
+  QVERIFY(Executor::maintenance().waitForDone(10000));
+  delete opt;
+  qDeleteAll(structures);
+}
+
+QTEST_MAIN(GlobalSearch::SchedulerSimulatorTest)
+
+#include "schedulersimulatortest.moc"
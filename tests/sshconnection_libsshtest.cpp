@@ -77,6 +77,9 @@ private slots:
 
   void execute();
   void executeLargeOutput();
+  void executeMany();
+  void executeManyOrder();
+  void executeManyDisconnected();
 
   void copyFileToServer();
   void readRemoteFile();
@@ -268,6 +271,78 @@ void SSHConnectionLibSSHTest::executeLargeOutput()
                                    .c_str());
 }
 
+void SSHConnectionLibSSHTest::executeMany()
+{
+  // More commands than there are channels, so some of them wait for one
+  QStringList commands;
+  for (int i = 0; i < 3 * MAX_EXEC_CHANNELS + 1; ++i) {
+    commands.append(
+      QString("echo out %1; echo err %1 >&2; exit %2").arg(i).arg(i % 4));
+  }
+
+  QStringList stdout_strs, stderr_strs;
+  QList<int> exitcodes;
+  QVERIFY(conn->executeMany(commands, stdout_strs, stderr_strs, exitcodes));
+  QCOMPARE(stdout_strs.size(), commands.size());
+  QCOMPARE(stderr_strs.size(), commands.size());
+  QCOMPARE(exitcodes.size(), commands.size());
+
+  // A command that fails is not an error of executeMany()
+  for (int i = 0; i < commands.size(); ++i) {
+    QCOMPARE(stdout_strs[i], QString("out %1\n").arg(i));
+    QCOMPARE(stderr_strs[i], QString("err %1\n").arg(i));
+    QCOMPARE(exitcodes[i], i % 4);
+  }
+
+  // The results of the previous call are replaced
+  QVERIFY(conn->executeMany(QStringList(), stdout_strs, stderr_strs,
+                            exitcodes));
+  QVERIFY(stdout_strs.isEmpty());
+  QVERIFY(stderr_strs.isEmpty());
+  QVERIFY(exitcodes.isEmpty());
+}
+
+void SSHConnectionLibSSHTest::executeManyOrder()
+{
+  // The first commands finish last. Each result still goes to the index
+  // of its command.
+  QStringList commands;
+  for (int i = 0; i < MAX_EXEC_CHANNELS; ++i) {
+    commands.append(QString("sleep 0.%1; echo %2")
+                      .arg(MAX_EXEC_CHANNELS - i)
+                      .arg(i));
+  }
+
+  QStringList stdout_strs, stderr_strs;
+  QList<int> exitcodes;
+  QVERIFY(conn->executeMany(commands, stdout_strs, stderr_strs, exitcodes));
+  for (int i = 0; i < commands.size(); ++i) {
+    QCOMPARE(stdout_strs[i], QString("%1\n").arg(i));
+    QCOMPARE(exitcodes[i], 0);
+  }
+}
+
+void SSHConnectionLibSSHTest::executeManyDisconnected()
+{
+  conn->disconnectSession();
+
+  // Every command gets an entry, even though none of them ran
+  QStringList commands;
+  commands << "echo 1"
+           << "echo 2";
+  QStringList stdout_strs, stderr_strs;
+  QList<int> exitcodes;
+  QVERIFY(!conn->executeMany(commands, stdout_strs, stderr_strs, exitcodes,
+                             false));
+  QCOMPARE(stdout_strs.size(), commands.size());
+  QCOMPARE(exitcodes.size(), commands.size());
+  QCOMPARE(exitcodes[0], -1);
+
+  QVERIFY(conn->reconnectSession(false));
+  QVERIFY(conn->executeMany(commands, stdout_strs, stderr_strs, exitcodes));
+  QCOMPARE(stdout_strs[1], QString("2\n"));
+}
+
 void SSHConnectionLibSSHTest::copyFileToServer()
 {
   QVERIFY2(conn->copyFileToServer(m_localTempFile.fileName(), m_remoteFileName),
@@ -0,0 +1,351 @@
+/**********************************************************************
+  StructureArchiveTest - Test the archive of finished structure directories
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ **********************************************************************/
+
+#include <globalsearch/structurearchive.h>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QtTest>
+
+using GlobalSearch::StructureArchive;
+
+class StructureArchiveTest : public QObject
+{
+  Q_OBJECT
+
+private:
+  QTemporaryDir* m_tempDir;
+
+  QString archivePath() const { return m_tempDir->path() + "/archive"; }
+
+  // Creates a structure directory with @p numFiles files in it
+  QString makeStructureDir(const QString& dirName, int numFiles);
+
+private slots:
+  /**
+   * Called before the first test function is executed.
+   */
+  void initTestCase();
+
+  /**
+   * Called after the last test function is executed.
+   */
+  void cleanupTestCase();
+
+  /**
+   * Called before each test function is executed.
+   */
+  void init();
+
+  /**
+   * Called after every test function.
+   */
+  void cleanup();
+
+  // Tests
+  void writeAndRead();
+  void archiveAndRestore();
+  void keepFiles();
+  void batches();
+  void reopen();
+  void truncatedRecord();
+  void compact();
+  void errorHandler();
+};
+
+QString StructureArchiveTest::makeStructureDir(const QString& dirName,
+                                               int numFiles)
+{
+  QString dirPath = m_tempDir->path() + "/" + dirName;
+  QDir().mkpath(dirPath);
+  for (int i = 0; i < numFiles; ++i) {
+    QFile file(dirPath + QString("/file%1").arg(i));
+    file.open(QIODevice::WriteOnly);
+    file.write(QString("%1 contents of file %2").arg(dirName).arg(i).toUtf8());
+  }
+  QFile old(dirPath + "/structure.state.old");
+  old.open(QIODevice::WriteOnly);
+  old.write("backup");
+  return dirPath;
+}
+
+void StructureArchiveTest::initTestCase()
+{
+}
+
+void StructureArchiveTest::cleanupTestCase()
+{
+}
+
+void StructureArchiveTest::init()
+{
+  m_tempDir = new QTemporaryDir;
+  QVERIFY(m_tempDir->isValid());
+}
+
+void StructureArchiveTest::cleanup()
+{
+  delete m_tempDir;
+  m_tempDir = nullptr;
+}
+
+void StructureArchiveTest::writeAndRead()
+{
+  StructureArchive archive(archivePath());
+  QVERIFY(!archive.contains("00001x00001"));
+
+  QVERIFY(archive.writeFile("00001x00001", "structure.state", "first"));
+  QVERIFY(archive.contains("00001x00001"));
+
+  QByteArray data;
+  QVERIFY(archive.readFile("00001x00001", "structure.state", &data));
+  QCOMPARE(data, QByteArray("first"));
+  QVERIFY(!archive.readFile("00001x00001", "CONTCAR", &data));
+  QVERIFY(!archive.readFile("00001x00002", "structure.state", &data));
+
+  // Writing the same data again should not grow the archive
+  qint64 size = archive.size();
+  QVERIFY(archive.writeFile("00001x00001", "structure.state", "first"));
+  QCOMPARE(archive.size(), size);
+  QCOMPARE(archive.wastedBytes(), qint64(0));
+
+  // Replacing it should
+  QVERIFY(archive.writeFile("00001x00001", "structure.state", "second"));
+  QVERIFY(archive.size() > size);
+  QVERIFY(archive.wastedBytes() > 0);
+  QVERIFY(archive.readFile("00001x00001", "structure.state", &data));
+  QCOMPARE(data, QByteArray("second"));
+
+  // Directory names may not contain slashes
+  QVERIFY(!archive.writeFile("a/b", "structure.state", "data"));
+
+  QString dest = m_tempDir->path() + "/extracted.state";
+  QVERIFY(archive.extractFile("00001x00001", "structure.state", dest));
+  QFile file(dest);
+  QVERIFY(file.open(QIODevice::ReadOnly));
+  QCOMPARE(file.readAll(), QByteArray("second"));
+}
+
+void StructureArchiveTest::archiveAndRestore()
+{
+  StructureArchive archive(archivePath());
+  QString dirPath = makeStructureDir("00002x00003", 3);
+
+  QVERIFY(archive.archiveDirectory(dirPath));
+  QVERIFY(!QDir(dirPath).exists());
+  QVERIFY(archive.contains("00002x00003"));
+
+  // The .old backup is not kept
+  QCOMPARE(archive.files("00002x00003"),
+           QStringList() << "file0"
+                         << "file1"
+                         << "file2");
+
+  QByteArray data;
+  QVERIFY(archive.readFile("00002x00003", "file1", &data));
+  QCOMPARE(data, QByteArray("00002x00003 contents of file 1"));
+
+  // It may be restored to a moved run directory
+  QString movedPath = m_tempDir->path() + "/moved/00002x00003";
+  QVERIFY(archive.restoreDirectory(movedPath));
+  QVERIFY(!archive.contains("00002x00003"));
+  QVERIFY(archive.directories().isEmpty());
+
+  QFile file(movedPath + "/file2");
+  QVERIFY(file.open(QIODevice::ReadOnly));
+  QCOMPARE(file.readAll(), QByteArray("00002x00003 contents of file 2"));
+
+  // Nothing to restore any more
+  QVERIFY(!archive.restoreDirectory(movedPath));
+
+  // A restored directory may be archived again
+  QVERIFY(archive.archiveDirectory(movedPath));
+  QVERIFY(archive.contains("00002x00003"));
+}
+
+void StructureArchiveTest::keepFiles()
+{
+  StructureArchive archive(archivePath());
+  QString dirPath = makeStructureDir("00002x00004", 2);
+  QFile state(dirPath + "/structure.state");
+  QVERIFY(state.open(QIODevice::WriteOnly));
+  state.write("state");
+  state.close();
+
+  // The kept files stay in the directory, and so does the directory
+  QVERIFY(archive.archiveDirectory(dirPath, QStringList()
+                                              << "structure.state"
+                                              << "structure.state.old"));
+  QCOMPARE(archive.files("00002x00004"), QStringList() << "file0"
+                                                       << "file1");
+  QCOMPARE(QDir(dirPath).entryList(QDir::Files, QDir::Name),
+           QStringList() << "structure.state"
+                         << "structure.state.old");
+
+  // Restoring leaves the kept files alone
+  QVERIFY(state.open(QIODevice::WriteOnly));
+  state.write("newer state");
+  state.close();
+  QVERIFY(archive.restoreDirectory(dirPath));
+  QCOMPARE(QDir(dirPath).entryList(QDir::Files, QDir::Name),
+           QStringList() << "file0"
+                         << "file1"
+                         << "structure.state"
+                         << "structure.state.old");
+  QVERIFY(state.open(QIODevice::ReadOnly));
+  QCOMPARE(state.readAll(), QByteArray("newer state"));
+}
+
+void StructureArchiveTest::batches()
+{
+  StructureArchive archive(archivePath());
+  archive.setBatchSize(4);
+
+  for (int i = 1; i <= 10; ++i) {
+    QString dirName = QString("00001x%1").arg(i, 5, 10, QChar('0'));
+    QVERIFY(archive.archiveDirectory(makeStructureDir(dirName, 2)));
+  }
+
+  QCOMPARE(archive.directories().size(), 10);
+  QCOMPARE(QDir(archivePath())
+             .entryList(QStringList("batch-*.xoar"), QDir::Files)
+             .size(),
+           3);
+
+  // Only the archive is left in the run directory
+  QCOMPARE(QDir(m_tempDir->path())
+             .entryList(QDir::AllDirs | QDir::NoDotAndDotDot)
+             .size(),
+           1);
+}
+
+void StructureArchiveTest::reopen()
+{
+  {
+    StructureArchive archive(archivePath());
+    archive.setBatchSize(2);
+    for (int i = 1; i <= 5; ++i) {
+      QString dirName = QString("00001x%1").arg(i, 5, 10, QChar('0'));
+      QVERIFY(archive.archiveDirectory(makeStructureDir(dirName, 2)));
+    }
+    QVERIFY(archive.writeFile("00001x00002", "file0", "replaced"));
+    QVERIFY(archive.restoreDirectory(m_tempDir->path() + "/00001x00004"));
+  }
+
+  StructureArchive archive;
+  QVERIFY(!archive.contains("00001x00001"));
+  archive.setPath(archivePath());
+
+  QCOMPARE(archive.directories(), QStringList() << "00001x00001"
+                                                << "00001x00002"
+                                                << "00001x00003"
+                                                << "00001x00005");
+  QByteArray data;
+  QVERIFY(archive.readFile("00001x00002", "file0", &data));
+  QCOMPARE(data, QByteArray("replaced"));
+  QVERIFY(archive.readFile("00001x00005", "file1", &data));
+  QCOMPARE(data, QByteArray("00001x00005 contents of file 1"));
+  QVERIFY(archive.wastedBytes() > 0);
+}
+
+void StructureArchiveTest::truncatedRecord()
+{
+  QString batchFile;
+  {
+    StructureArchive archive(archivePath());
+    QVERIFY(archive.writeFile("00001x00001", "structure.state", "good"));
+    QVERIFY(archive.writeFile("00001x00001", "structure.state",
+                              QByteArray(100, 'x')));
+    batchFile = archivePath() + "/batch-00000.xoar";
+  }
+
+  // Cut the last record short, as if we crashed while writing it
+  QFile file(batchFile);
+  QVERIFY(file.open(QIODevice::ReadWrite));
+  QVERIFY(file.resize(file.size() - 10));
+  file.close();
+
+  StructureArchive archive(archivePath());
+  QByteArray data;
+  QVERIFY(archive.readFile("00001x00001", "structure.state", &data));
+  QCOMPARE(data, QByteArray("good"));
+
+  // The next write replaces the incomplete record
+  QVERIFY(archive.writeFile("00001x00001", "structure.state", "better"));
+
+  StructureArchive reopened(archivePath());
+  QVERIFY(reopened.readFile("00001x00001", "structure.state", &data));
+  QCOMPARE(data, QByteArray("better"));
+  QCOMPARE(reopened.size(), QFileInfo(batchFile).size());
+}
+
+void StructureArchiveTest::compact()
+{
+  StructureArchive archive(archivePath());
+  for (int i = 0; i < 20; ++i) {
+    QVERIFY(archive.writeFile("00001x00001", "structure.state",
+                              QString("version %1").arg(i).toUtf8()));
+  }
+  QVERIFY(archive.writeFile("00001x00002", "structure.state", "other"));
+
+  qint64 size = archive.size();
+  QVERIFY(archive.wastedBytes() > 0);
+
+  QVERIFY(archive.compact());
+  QCOMPARE(archive.wastedBytes(), qint64(0));
+  QVERIFY(archive.size() < size);
+
+  QByteArray data;
+  QVERIFY(archive.readFile("00001x00001", "structure.state", &data));
+  QCOMPARE(data, QByteArray("version 19"));
+  QVERIFY(archive.readFile("00001x00002", "structure.state", &data));
+  QCOMPARE(data, QByteArray("other"));
+
+  // The compacted batch is read back the same way
+  StructureArchive reopened(archivePath());
+  QCOMPARE(reopened.size(), archive.size());
+  QVERIFY(reopened.readFile("00001x00001", "structure.state", &data));
+  QCOMPARE(data, QByteArray("version 19"));
+}
+
+void StructureArchiveTest::errorHandler()
+{
+  // A file is in the way of the archive directory
+  QFile blocker(archivePath());
+  QVERIFY(blocker.open(QIODevice::WriteOnly));
+  blocker.close();
+
+  QStringList errors;
+  StructureArchive archive(archivePath());
+  archive.setErrorHandler(
+    [&errors](const QString& message) { errors.append(message); });
+
+  QVERIFY(!archive.writeFile("00001x00001", "structure.state", "data"));
+  QCOMPARE(errors.size(), 1);
+  QVERIFY(errors[0].contains(archivePath()));
+
+  // So is a failed extraction
+  QFile::remove(archivePath());
+  QVERIFY(archive.writeFile("00001x00001", "structure.state", "data"));
+  QString dest = m_tempDir->path() + "/missing/extracted.state";
+  QVERIFY(!archive.extractFile("00001x00001", "structure.state", dest));
+  QCOMPARE(errors.size(), 2);
+  QVERIFY(errors[1].contains(dest));
+}
+
+QTEST_MAIN(StructureArchiveTest)
+
+#include "structurearchivetest.moc"
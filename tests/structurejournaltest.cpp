@@ -0,0 +1,286 @@
+/**********************************************************************
+  StructureJournalTest - Test the journal of structure events
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ **********************************************************************/
+
+#include <globalsearch/structure.h>
+#include <globalsearch/structurejournal.h>
+
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QtTest>
+
+using GlobalSearch::Structure;
+using GlobalSearch::StructureJournal;
+
+class StructureJournalTest : public QObject
+{
+  Q_OBJECT
+
+private:
+  QTemporaryDir* m_tempDir;
+
+  QString journalPath() const
+  {
+    return m_tempDir->path() + "/structures.journal";
+  }
+
+  // Creates an event for directory @p dirName
+  StructureJournal::Event makeEvent(StructureJournal::EventType type,
+                                    const QString& dirName, int status);
+
+private slots:
+  /**
+   * Called before the first test function is executed.
+   */
+  void initTestCase();
+
+  /**
+   * Called after the last test function is executed.
+   */
+  void cleanupTestCase();
+
+  /**
+   * Called before each test function is executed.
+   */
+  void init();
+
+  /**
+   * Called after every test function.
+   */
+  void cleanup();
+
+  // Tests
+  void appendAndRead();
+  void syncThread();
+  void reopen();
+  void truncatedRecord();
+  void checkpoint();
+  void applyEvents();
+};
+
+StructureJournal::Event StructureJournalTest::makeEvent(
+  StructureJournal::EventType type, const QString& dirName, int status)
+{
+  StructureJournal::Event e;
+  e.type = type;
+  e.dirName = dirName;
+  e.status = status;
+  return e;
+}
+
+void StructureJournalTest::initTestCase()
+{
+}
+
+void StructureJournalTest::cleanupTestCase()
+{
+}
+
+void StructureJournalTest::init()
+{
+  m_tempDir = new QTemporaryDir;
+  QVERIFY(m_tempDir->isValid());
+}
+
+void StructureJournalTest::cleanup()
+{
+  delete m_tempDir;
+  m_tempDir = nullptr;
+}
+
+void StructureJournalTest::appendAndRead()
+{
+  StructureJournal journal(journalPath());
+  QCOMPARE(journal.lastSequence(), quint64(0));
+  QVERIFY(journal.events().empty());
+
+  StructureJournal::Event e = makeEvent(StructureJournal::Submitted,
+                                        "00001x00001", Structure::Submitted);
+  e.optStep = 2;
+  e.jobID = 1234;
+  e.energy = -12.5;
+  e.hasEnthalpy = true;
+  e.enthalpy = -13.25;
+  QCOMPARE(journal.append(e), quint64(1));
+  QCOMPARE(journal.append(makeEvent(StructureJournal::DuplicateOf,
+                                    "00001x00002", Structure::Duplicate)),
+           quint64(2));
+  QCOMPARE(journal.lastSequence(), quint64(2));
+
+  auto events = journal.events();
+  QCOMPARE(events.size(), size_t(2));
+  QCOMPARE(events[0].type, StructureJournal::Submitted);
+  QCOMPARE(events[0].sequence, quint64(1));
+  QCOMPARE(events[0].dirName, QString("00001x00001"));
+  QCOMPARE(events[0].status, static_cast<int>(Structure::Submitted));
+  QCOMPARE(events[0].optStep, 2u);
+  QCOMPARE(events[0].jobID, 1234u);
+  QCOMPARE(events[0].energy, -12.5);
+  QVERIFY(events[0].hasEnthalpy);
+  QCOMPARE(events[0].enthalpy, -13.25);
+  QCOMPARE(events[1].type, StructureJournal::DuplicateOf);
+  QCOMPARE(events[1].dirName, QString("00001x00002"));
+
+  // Only the events after a sequence number
+  events = journal.events(1);
+  QCOMPARE(events.size(), size_t(1));
+  QCOMPARE(events[0].sequence, quint64(2));
+}
+
+void StructureJournalTest::syncThread()
+{
+  StructureJournal journal(journalPath());
+  journal.setSyncInterval(10);
+
+  // The events are written without flushing
+  for (int i = 0; i < 10; ++i) {
+    journal.append(
+      makeEvent(StructureJournal::StatusChanged, "00001x00001", i));
+  }
+  QTRY_VERIFY(QFileInfo(journalPath()).size() > 0);
+  QTRY_COMPARE(journal.events().size(), size_t(10));
+}
+
+void StructureJournalTest::reopen()
+{
+  {
+    StructureJournal journal(journalPath());
+    journal.setSyncInterval(60000);
+    for (int i = 0; i < 3; ++i) {
+      journal.append(
+        makeEvent(StructureJournal::Created, "00001x00001", i));
+    }
+    // Buffered events are written when the journal is destroyed
+  }
+
+  StructureJournal journal;
+  QCOMPARE(journal.lastSequence(), quint64(0));
+  journal.setFileName(journalPath());
+  QCOMPARE(journal.lastSequence(), quint64(3));
+  QCOMPARE(journal.events().size(), size_t(3));
+
+  // The numbering continues
+  QCOMPARE(journal.append(
+             makeEvent(StructureJournal::Created, "00001x00002", 0)),
+           quint64(4));
+
+  // It also continues above a sequence stored elsewhere
+  journal.setMinimumSequence(10);
+  QCOMPARE(journal.append(
+             makeEvent(StructureJournal::Created, "00001x00003", 0)),
+           quint64(11));
+  journal.setMinimumSequence(5);
+  QCOMPARE(journal.lastSequence(), quint64(11));
+}
+
+void StructureJournalTest::truncatedRecord()
+{
+  {
+    StructureJournal journal(journalPath());
+    journal.append(makeEvent(StructureJournal::Created, "00001x00001", 0));
+    journal.append(makeEvent(StructureJournal::Created, "00001x00002", 0));
+    QVERIFY(journal.flush());
+  }
+
+  // Cut the last record short, as if we crashed while writing it
+  QFile file(journalPath());
+  QVERIFY(file.open(QIODevice::ReadWrite));
+  QVERIFY(file.resize(file.size() - 5));
+  file.close();
+
+  StructureJournal journal(journalPath());
+  QCOMPARE(journal.lastSequence(), quint64(1));
+  auto events = journal.events();
+  QCOMPARE(events.size(), size_t(1));
+  QCOMPARE(events[0].dirName, QString("00001x00001"));
+
+  // The next record replaces the incomplete one
+  journal.append(makeEvent(StructureJournal::Created, "00001x00003", 0));
+  QVERIFY(journal.flush());
+
+  StructureJournal reopened(journalPath());
+  events = reopened.events();
+  QCOMPARE(events.size(), size_t(2));
+  QCOMPARE(events[1].dirName, QString("00001x00003"));
+  QCOMPARE(events[1].sequence, quint64(2));
+}
+
+void StructureJournalTest::checkpoint()
+{
+  StructureJournal journal(journalPath());
+  for (int i = 0; i < 20; ++i) {
+    journal.append(
+      makeEvent(StructureJournal::StatusChanged, "00001x00001", i));
+  }
+  QVERIFY(journal.flush());
+  const qint64 size = QFileInfo(journalPath()).size();
+
+  QVERIFY(journal.checkpoint(15));
+  QVERIFY(QFileInfo(journalPath()).size() < size);
+  auto events = journal.events();
+  QCOMPARE(events.size(), size_t(5));
+  QCOMPARE(events[0].sequence, quint64(16));
+
+  // Appending still works after the file was rewritten
+  QCOMPARE(journal.append(
+             makeEvent(StructureJournal::StatusChanged, "00001x00001", 20)),
+           quint64(21));
+  QCOMPARE(journal.events().size(), size_t(6));
+
+  // The numbering continues even if every event was dropped
+  QVERIFY(journal.checkpoint(21));
+  QVERIFY(journal.events().empty());
+  StructureJournal reopened(journalPath());
+  QCOMPARE(reopened.lastSequence(), quint64(21));
+  QVERIFY(reopened.events().empty());
+}
+
+void StructureJournalTest::applyEvents()
+{
+  Structure s;
+  s.setFileName("/some/run/00002x00007");
+  s.setStatus(Structure::StepOptimized);
+  s.setCurrentOptStep(1);
+  s.setJobID(42);
+  s.setEnergy(-3.0);
+  s.setEnthalpy(-4.0);
+
+  StructureJournal::Event e =
+    StructureJournal::makeEvent(StructureJournal::StepFinished, s);
+  QCOMPARE(e.dirName, QString("00002x00007"));
+  QCOMPARE(e.status, static_cast<int>(Structure::StepOptimized));
+
+  Structure loaded;
+  loaded.setStatus(Structure::InProcess);
+  StructureJournal::apply(e, loaded);
+  QCOMPARE(loaded.getStatus(), Structure::StepOptimized);
+  QCOMPARE(loaded.getCurrentOptStep(), 1u);
+  QCOMPARE(loaded.getJobID(), 42u);
+  QCOMPARE(loaded.getEnergy(), -3.0);
+  QVERIFY(loaded.hasEnthalpy());
+  QCOMPARE(loaded.getEnthalpy(), -4.0);
+
+  // Duplicates and supercells keep the structure they match
+  s.setStatus(Structure::Supercell);
+  s.setSupercellString("1x3");
+  e = StructureJournal::makeEvent(StructureJournal::DuplicateOf, s);
+  QCOMPARE(e.text, QString("1x3"));
+  StructureJournal::apply(e, loaded);
+  QCOMPARE(loaded.getStatus(), Structure::Supercell);
+  QCOMPARE(loaded.getSupercellString(), QString("1x3"));
+}
+
+QTEST_MAIN(StructureJournalTest)
+
+#include "structurejournaltest.moc"
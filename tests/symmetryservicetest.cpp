@@ -0,0 +1,175 @@
+/**********************************************************************
+  SymmetryServiceTest - Test the memoized spglib symmetry service
+
+  Copyright (C) 2018 by Patrick Avery
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ **********************************************************************/
+
+#include <xtalopt/structures/symmetryservice.h>
+#include <xtalopt/structures/xtal.h>
+
+#include <QtTest>
+
+using namespace GlobalSearch;
+using namespace XtalOpt;
+
+class SymmetryServiceTest : public QObject
+{
+  Q_OBJECT
+
+private:
+  // A conventional bcc cell with two hydrogen atoms
+  static SymmetryService::Geometry bcc()
+  {
+    SymmetryService::Geometry geometry;
+    geometry.cellMatrix = Matrix3::Identity() * 3.0;
+    geometry.fcoords.push_back(Vector3(0.0, 0.0, 0.0));
+    geometry.fcoords.push_back(Vector3(0.5, 0.5, 0.5));
+    geometry.atomicNums.push_back(1);
+    geometry.atomicNums.push_back(1);
+    return geometry;
+  }
+
+private slots:
+  /**
+   * Called before the first test function is executed.
+   */
+  void initTestCase();
+
+  /**
+   * Called after the last test function is executed.
+   */
+  void cleanupTestCase();
+
+  /**
+   * Called before each test function is executed.
+   */
+  void init();
+
+  /**
+   * Called after every test function.
+   */
+  void cleanup();
+
+  // Tests
+  void spacegroup();
+  void memoization();
+  void primitive();
+  void eviction();
+  void xtalBatch();
+};
+
+void SymmetryServiceTest::initTestCase()
+{
+}
+
+void SymmetryServiceTest::cleanupTestCase()
+{
+}
+
+void SymmetryServiceTest::init()
+{
+  SymmetryService::instance().clear();
+}
+
+void SymmetryServiceTest::cleanup()
+{
+}
+
+void SymmetryServiceTest::spacegroup()
+{
+  SymmetryService& service = SymmetryService::instance();
+  SymmetryService::Spacegroup spg = service.spacegroup(bcc(), 0.05);
+  QCOMPARE(spg.number, 229u);
+  QCOMPARE(QString::fromStdString(spg.symbol), QString("Im-3m"));
+  QCOMPARE(QString::fromStdString(service.wyckoffLetters(bcc(), 0.05)),
+           QString("aa"));
+}
+
+void SymmetryServiceTest::memoization()
+{
+  SymmetryService& service = SymmetryService::instance();
+  service.spacegroup(bcc(), 0.05);
+  QCOMPARE(service.numMisses(), static_cast<size_t>(1));
+  QCOMPARE(service.numHits(), static_cast<size_t>(0));
+
+  // The same geometry and precision is a hit
+  service.spacegroup(bcc(), 0.05);
+  QCOMPARE(service.numHits(), static_cast<size_t>(1));
+
+  // A different precision is a different entry
+  service.spacegroup(bcc(), 0.01);
+  QCOMPARE(service.numMisses(), static_cast<size_t>(2));
+
+  // So is a moved atom
+  SymmetryService::Geometry moved = bcc();
+  moved.fcoords[1] = Vector3(0.4, 0.5, 0.5);
+  QVERIFY(SymmetryService::hash(moved, 0.05) !=
+          SymmetryService::hash(bcc(), 0.05));
+  QVERIFY(service.spacegroup(moved, 0.05).number != 229u);
+  QCOMPARE(service.size(), static_cast<size_t>(3));
+}
+
+void SymmetryServiceTest::primitive()
+{
+  std::shared_ptr<const SymmetryService::Primitive> primitive =
+    SymmetryService::instance().primitive(bcc(), 0.05);
+  QCOMPARE(primitive->spacegroup, 229u);
+  QCOMPARE(primitive->fcoords.size(), static_cast<size_t>(1));
+
+  // The second call shares the cached result
+  QCOMPARE(SymmetryService::instance().primitive(bcc(), 0.05).get(),
+           primitive.get());
+}
+
+void SymmetryServiceTest::eviction()
+{
+  SymmetryService& service = SymmetryService::instance();
+  size_t maxSize = service.maxSize();
+  service.setMaxSize(2);
+
+  service.spacegroup(bcc(), 0.01);
+  service.spacegroup(bcc(), 0.02);
+  service.spacegroup(bcc(), 0.03);
+  QCOMPARE(service.size(), static_cast<size_t>(2));
+
+  // The oldest entry was dropped
+  service.spacegroup(bcc(), 0.01);
+  QCOMPARE(service.numHits(), static_cast<size_t>(0));
+
+  service.setMaxSize(maxSize);
+}
+
+void SymmetryServiceTest::xtalBatch()
+{
+  QList<Structure*> structures;
+  for (int i = 0; i < 4; ++i) {
+    Xtal* xtal = new Xtal(3.0, 3.0, 3.0, 90.0, 90.0, 90.0);
+    xtal->addAtom(1, Vector3(0.0, 0.0, 0.0));
+    xtal->addAtom(1, Vector3(1.5, 1.5, 1.5));
+    structures.append(xtal);
+  }
+
+  Xtal::findSpaceGroups(structures, 0.05);
+  for (const auto& s : structures) {
+    Xtal* xtal = qobject_cast<Xtal*>(s);
+    QCOMPARE(xtal->getSpaceGroupNumber(), 229u);
+    QCOMPARE(xtal->getSpaceGroupSymbol(), QString("Im-3m"));
+  }
+
+  // All of them share one entry
+  QCOMPARE(SymmetryService::instance().size(), static_cast<size_t>(1));
+
+  qDeleteAll(structures);
+}
+
+QTEST_MAIN(SymmetryServiceTest)
+
+#include "symmetryservicetest.moc"
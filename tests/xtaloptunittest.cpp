@@ -15,6 +15,7 @@
 #include <xtalopt/xtalopt.h>
 
 #include <xtalopt/optimizers/gulp.h>
+#include <xtalopt/structures/xtal.h>
 #include <xtalopt/ui/dialog.h>
 
 #include <globalsearch/macros.h>
@@ -61,6 +62,7 @@ private slots:
   void loadTest();
   void checkForDuplicatesTest();
   void stepwiseCheckForDuplicatesTest();
+  void derivedXtalsTest();
 
   void destroyDialogAndXtalOpt();
 };
@@ -163,6 +165,60 @@ void XtalOptUnitTest::stepwiseCheckForDuplicatesTest()
   m_opt->tracker()->blockSignals(false);
 }
 
+void XtalOptUnitTest::derivedXtalsTest()
+{
+  m_opt->tracker()->blockSignals(true);
+  QList<Structure*> listAll = *m_opt->tracker()->list();
+  m_opt->tracker()->reset();
+  const auto lowestEnthalpyFUList = m_opt->lowestEnthalpyFUList;
+  m_opt->lowestEnthalpyFUList = { 0, 0 };
+
+  // A body-centered cell, so its primitive cell has half the atoms. It
+  // has no supercells, since no lowest enthalpy is known for its formula
+  // units.
+  Xtal* xtal = new Xtal(3.0, 3.0, 3.0, 90.0, 90.0, 90.0);
+  xtal->addAtom(14, Vector3(0.0, 0.0, 0.0));
+  xtal->addAtom(14, Vector3(1.5, 1.5, 1.5));
+  xtal->setEnthalpy(-10.0);
+  xtal->setStatus(Xtal::Optimized);
+  xtal->setChangedSinceDupChecked(false);
+  m_opt->tracker()->append(xtal);
+
+  // The primitive cell is queued once, however often the check runs
+  m_opt->checkForSupercellsAndPrimitives_();
+  QCOMPARE(m_opt->m_derivedXtals.size(), size_t(1));
+  QVERIFY(m_opt->m_derivedXtals.front().source == xtal);
+  QCOMPARE(m_opt->m_derivedXtals.front().xtal->numAtoms(), size_t(1));
+  QVERIFY(xtal->wasPrimitiveChecked());
+  m_opt->checkForSupercellsAndPrimitives_();
+  QCOMPARE(m_opt->m_derivedXtals.size(), size_t(1));
+
+  // Resetting the duplicates drops it, and lets it be found again. The
+  // duplicate check that the reset starts is skipped while starting.
+  m_opt->isStarting = true;
+  m_opt->resetDuplicates_();
+  m_opt->isStarting = false;
+  QVERIFY(m_opt->m_derivedXtals.empty());
+  QVERIFY(!xtal->wasPrimitiveChecked());
+  QVERIFY(!xtal->wasSupercellGenerationChecked());
+
+  xtal->setChangedSinceDupChecked(false);
+  m_opt->checkForSupercellsAndPrimitives_();
+  QCOMPARE(m_opt->m_derivedXtals.size(), size_t(1));
+
+  // Hand it out, and nothing is left
+  Xtal* primitive = m_opt->generateSupercellOrPrimitiveXtal();
+  QVERIFY(primitive != nullptr);
+  QVERIFY(m_opt->generateSupercellOrPrimitiveXtal() == nullptr);
+  delete primitive;
+
+  m_opt->tracker()->reset();
+  delete xtal;
+  m_opt->tracker()->append(listAll);
+  m_opt->lowestEnthalpyFUList = lowestEnthalpyFUList;
+  m_opt->tracker()->blockSignals(false);
+}
+
 void XtalOptUnitTest::destroyDialogAndXtalOpt()
 {
   delete m_dialog;
@@ -12,6 +12,7 @@
   limitations under the License.
  **********************************************************************/
 
+#include <xtalopt/structures/iadtracker.h>
 #include <xtalopt/structures/xtal.h>
 
 #include <xtalopt/debug.h>
@@ -88,6 +89,7 @@ private slots:
 
   // tests
   void rotateToStdOrientationTest();
+  void fracCoordsTest();
   void compareCoordinatesTest_simple();
   void compareCoordinatesTest_shifted();
   void compareCoordinatesTest_huge();
@@ -95,8 +97,10 @@ private slots:
   void equalityOperatorTest_shifted();
   void equalityOperatorTest_huge();
   void niggliReduceTest();
+  void niggliReductionCacheTest();
   void fixAnglesTest();
   void getRandomRepresentationTest();
+  void iadTrackerTest();
 
 #ifdef ENABLE_MOLECULAR
   void addMoleculeRandomly();
@@ -203,6 +207,53 @@ void XtalTest::rotateToStdOrientationTest()
   ROTTEST_ROT_AND_TEST;
 }
 
+void XtalTest::fracCoordsTest()
+{
+  Xtal xtal(3, 4, 5, 80, 95, 100);
+  std::vector<Vector3> fcoords;
+  fcoords.push_back(Vector3(0.0, 0.0, 0.0));
+  fcoords.push_back(Vector3(0.25, 0.5, 0.75));
+  fcoords.push_back(Vector3(0.9, 0.1, 0.4));
+  for (size_t i = 0; i < fcoords.size(); ++i)
+    xtal.addAtom().setAtomicNumber(6);
+
+  xtal.setFracCoords(fcoords);
+  for (size_t i = 0; i < fcoords.size(); ++i) {
+    QVERIFY((xtal.atom(i).pos() - xtal.fracToCart(fcoords[i])).norm() < 1e-8);
+    QVERIFY((xtal.getFracCoords()[i] - fcoords[i]).norm() < 1e-8);
+  }
+
+  // Changing the cell carries the atoms along
+  Matrix3 strained = xtal.unitCell().cellMatrix();
+  strained(0, 1) += 0.3;
+  strained(2, 2) *= 1.2;
+  xtal.setCellInfoKeepFractional(strained);
+  QVERIFY((xtal.unitCell().cellMatrix() - strained).norm() < 1e-12);
+  for (size_t i = 0; i < fcoords.size(); ++i)
+    QVERIFY((xtal.getFracCoords()[i] - fcoords[i]).norm() < 1e-8);
+
+  // So does changing the volume
+  xtal.setVolume(2.0 * xtal.getVolume());
+  for (size_t i = 0; i < fcoords.size(); ++i)
+    QVERIFY((xtal.getFracCoords()[i] - fcoords[i]).norm() < 1e-8);
+
+  // Wrapping only moves atoms outside of the cell
+  fcoords[1] = Vector3(1.25, -0.5, 0.75);
+  xtal.setFracCoords(fcoords);
+  xtal.wrapAtomsToCell();
+  QVERIFY((xtal.getFracCoords()[1] - Vector3(0.25, 0.5, 0.75)).norm() < 1e-8);
+  QVERIFY((xtal.getFracCoords()[2] - fcoords[2]).norm() < 1e-8);
+
+  // An empty cell has no inverse, so the cached matrix stays zero
+  UnitCell empty;
+  QVERIFY(empty.cellMatrix().isZero());
+  QVERIFY(empty.fractionalMatrix().isZero());
+  QVERIFY(empty.toFractional(Vector3(1.0, 2.0, 3.0)).isZero());
+  empty.setCellParameters(3.0, 4.0, 5.0, 90.0, 90.0, 90.0);
+  QVERIFY((empty.toFractional(Vector3(1.5, 2.0, 2.5)) -
+           Vector3(0.5, 0.5, 0.5)).norm() < 1e-8);
+}
+
 void XtalTest::compareCoordinatesTest_simple()
 {
   Xtal xtal1, xtal2;
@@ -380,6 +431,57 @@ void XtalTest::niggliReduceTest()
   }
 }
 
+void XtalTest::niggliReductionCacheTest()
+{
+  Xtal xtal(3.000, 5.19615242271, 2.00, 103.919748556, 109.471220635,
+            134.882107117);
+  xtal.addAtom(1, xtal.fracToCart(Vector3(0.1, 0.2, 0.3)));
+  xtal.addAtom(8, xtal.fracToCart(Vector3(0.7, 0.4, 0.9)));
+  xtal.addAtom(8, xtal.fracToCart(Vector3(-0.3, 1.6, 0.5)));
+  const Xtal orig(xtal);
+
+  // Asking again for the same cell is a lookup
+  std::shared_ptr<const Xtal::NiggliReduction> reduction =
+    xtal.niggliReduction();
+  QVERIFY(reduction->success);
+  QVERIFY(reduction->changed);
+  QVERIFY(xtal.niggliReduction() == reduction);
+
+  QVERIFY(xtal.niggliReduce());
+  QVERIFY(fuzzyCompare(xtal.unitCell().cellMatrix(), reduction->cellMatrix));
+  QVERIFY(xtal.compareCoordinates(orig));
+  for (const auto& fcoord : xtal.getFracCoords()) {
+    for (int i = 0; i < 3; ++i)
+      QVERIFY(fcoord[i] >= 0.0 && fcoord[i] < 1.0);
+  }
+
+  // The reduced cell is known to be reduced, and copies know it too
+  std::shared_ptr<const Xtal::NiggliReduction> again = xtal.niggliReduction();
+  QVERIFY(again != reduction);
+  QVERIFY(again->success);
+  QVERIFY(!again->changed);
+  QVERIFY(fuzzyCompare(again->cob, Matrix3::Identity()));
+  Xtal copy(xtal);
+  QVERIFY(copy.niggliReduction() == again);
+  Xtal moved(std::move(copy));
+  QVERIFY(moved.niggliReduction() == again);
+
+  // Reducing it again leaves it alone
+  const Matrix3 reducedCell = xtal.unitCell().cellMatrix();
+  QVERIFY(xtal.niggliReduce());
+  QVERIFY(xtal.unitCell().cellMatrix() == reducedCell);
+
+  // A fresh reduction of the reduced cell does not change it
+  Xtal::NiggliReduction fresh =
+    Xtal::computeNiggliReduction(xtal.unitCell().cellMatrix());
+  QVERIFY(fresh.success);
+  QVERIFY(fuzzyCompare(fresh.cob, Matrix3::Identity()));
+
+  // Changing the cell forgets the result
+  xtal.setVolume(2.0 * xtal.getVolume());
+  QVERIFY(xtal.niggliReduction() != again);
+}
+
 struct CellParam
 {
   CellParam(const double& a_, const double& b_, const double& c_,
@@ -618,6 +720,50 @@ void XtalTest::getRandomRepresentationTest()
                 .arg(failure_msecs / static_cast<double>(iterations));
 }
 
+void XtalTest::iadTrackerTest()
+{
+  Xtal xtal;
+  xtal.setCellInfo(4.0, 4.5, 5.0, 80.0, 95.0, 100.0);
+  for (int i = 0; i < 8; ++i) {
+    xtal.addAtom(i % 2 == 0 ? 1 : 8,
+                 xtal.fracToCart(Vector3(getRandDouble(), getRandDouble(),
+                                         getRandDouble())));
+  }
+
+  QHash<QPair<int, int>, IAD> limitsIAD;
+  limitsIAD[qMakePair(1, 1)].minIAD = 1.0;
+  limitsIAD[qMakePair(1, 8)].minIAD = 1.5;
+  limitsIAD[qMakePair(8, 1)].minIAD = 1.5;
+  limitsIAD[qMakePair(8, 8)].minIAD = 2.0;
+
+  IADTracker tracker(xtal, limitsIAD);
+  QCOMPARE(tracker.numAtoms(), xtal.numAtoms());
+
+  // Move atoms one at a time, and compare with a full check after each
+  for (int step = 0; step < 50; ++step) {
+    int atom1 = 0, atom2 = 0, trackedAtom1 = 0, trackedAtom2 = 0;
+    double iad = 0.0, trackedIAD = 0.0;
+    bool ok = xtal.checkMinIAD(limitsIAD, &atom1, &atom2, &iad);
+    QCOMPARE(tracker.check(&trackedAtom1, &trackedAtom2, &trackedIAD), ok);
+    QCOMPARE(trackedAtom1, atom1);
+    QCOMPARE(trackedAtom2, atom2);
+    QVERIFY(GlobalSearch::fuzzyCompare(trackedIAD, iad, 1.e-8));
+    QCOMPARE(tracker.numViolations() == 0, ok);
+
+    size_t ind = step % xtal.numAtoms();
+    Vector3 pos = xtal.fracToCart(
+      Vector3(getRandDouble(), getRandDouble(), getRandDouble()));
+    xtal.atom(ind).setPos(pos);
+    tracker.moveAtom(ind, pos);
+  }
+
+  // Putting an atom on top of another is always too close
+  xtal.atom(1).setPos(xtal.atom(0).pos());
+  tracker.moveAtom(1, xtal.atom(0).pos());
+  QVERIFY(!tracker.check());
+  QVERIFY(GlobalSearch::fuzzyCompare(tracker.squaredDistance(0, 1), 0.0));
+}
+
 #ifdef ENABLE_MOLECULAR
 void XtalTest::addMoleculeRandomly()
 {